@@ -0,0 +1,1714 @@
+// Mesures de performance du parser.
+//
+// Usage : bench [fichier] [itérations]
+// Chaque scénario est répété et le temps moyen par analyse est affiché. Les
+// sorties de débogage du parser sont désactivées pendant les mesures.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <adts-demux.hpp>
+#include <box-query.hpp>
+#include <box-serializer.hpp>
+#include <box-visitor.hpp>
+#include <compact-table.hpp>
+#include <concat.hpp>
+#include <container-parser.hpp>
+#include <fingerprint.hpp>
+#include <forward-input.hpp>
+#include <hash.hpp>
+#include <index-cache.hpp>
+#include <interleave.hpp>
+#include <keyframe-extract.hpp>
+#include <memory-report.hpp>
+#include <metadata-edit.hpp>
+#include <parse-stats.hpp>
+#include <range-reader.hpp>
+#include <sample-table.hpp>
+#include <segment-planner.hpp>
+#include <table-validation.hpp>
+#include <track-analytics.hpp>
+#include <track-split.hpp>
+#include <trim.hpp>
+
+
+// Octets alloués et non libérés pendant une mesure (cf AllocationScope),
+// suivis par les opérateurs new/delete globaux ci-dessous pour vérifier le
+// bilan mémoire de l'arbre.
+static std::atomic<int64_t> s_live_bytes{0};
+// Vrai pendant une mesure du thread courant ; hors mesure, les allocations ne
+// touchent pas au compteur et les autres scénarios ne paient que l'entête.
+static thread_local bool s_counting = false;
+
+// Taille de l'entête placé devant chaque allocation : la taille comptée, 0 si
+// l'allocation est hors mesure ; conserve l'alignement de malloc.
+constexpr size_t ALLOC_HEADER = 16;
+
+void *operator new(size_t a_size) {
+    char *block = static_cast<char*>(std::malloc(a_size + ALLOC_HEADER));
+    if (block == nullptr) {
+        throw std::bad_alloc();
+    }
+    *reinterpret_cast<size_t*>(block) = s_counting ? a_size : 0;
+    if (s_counting) {
+        s_live_bytes += a_size;
+    }
+    return block + ALLOC_HEADER;
+}
+
+// std::stable_sort obtient son tampon par la forme nothrow : elle doit poser
+// le même entête que les autres allocations.
+void *operator new(size_t a_size, const std::nothrow_t& /*tag*/) noexcept {
+    try {
+        return operator new(a_size);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void operator delete(void *a_ptr) noexcept {
+    if (a_ptr == nullptr) {
+        return;
+    }
+    // l'entête précède le bloc rendu par new : calcul sur l'adresse, que le
+    // compilateur ne confond pas avec un accès hors d'un objet connu
+    char *block = reinterpret_cast<char*>(reinterpret_cast<uintptr_t>(a_ptr) - ALLOC_HEADER);
+    size_t counted = *reinterpret_cast<size_t*>(block);
+    if (counted != 0) {
+        s_live_bytes -= counted;
+    }
+    std::free(block);
+}
+
+void operator delete(void *a_ptr, size_t /*size*/) noexcept {
+    operator delete(a_ptr);
+}
+
+void operator delete(void *a_ptr, const std::nothrow_t& /*tag*/) noexcept {
+    operator delete(a_ptr);
+}
+
+// Compte les octets alloués par le thread courant et non libérés, pendant la
+// durée de vie de l'objet.
+class AllocationScope {
+public:
+    AllocationScope() : m_before(s_live_bytes) { s_counting = true; }
+    ~AllocationScope() { s_counting = false; }
+
+    int64_t allocated() const { return s_live_bytes - m_before; }
+
+private:
+    int64_t m_before;
+};
+
+// Nombre de vérifications du bench en échec ; le code de sortie en dépend.
+static int s_failures = 0;
+
+// Enregistre le résultat d'une vérification.
+//     @ok: vrai si la vérification réussit
+//     @return: `ok`, pour choisir le message affiché
+static bool check(bool a_ok) {
+    s_failures += a_ok ? 0 : 1;
+    return a_ok;
+}
+
+// Temps moyen d'exécution d'un scénario, en microsecondes.
+//     @iterations: nombre de répétitions
+//     @scenario: la fonction mesurée
+//     @return: la durée moyenne d'une répétition
+static double measure(int a_iterations, const std::function<void()>& a_scenario) {
+    std::cout.setstate(std::ios::badbit);
+    auto beg = std::chrono::steady_clock::now();
+    for (int i = 0; i < a_iterations; i++) {
+        a_scenario();
+    }
+    auto end = std::chrono::steady_clock::now();
+    std::cout.clear();
+    return std::chrono::duration<double, std::micro>(end - beg).count() / a_iterations;
+}
+
+// Taille d'un fichier, en octets.
+static uint64_t fileSize(const std::string& a_filepath) {
+    return std::ifstream(a_filepath, std::ios::binary | std::ios::ate).tellg();
+}
+
+// Copie le début d'un fichier.
+//     @source: le fichier copié
+//     @output: la copie
+//     @size: nombre d'octets copiés
+static void copyPrefix(const std::string& a_source, const std::string& a_output, uint64_t a_size) {
+    std::ifstream source(a_source, std::ios::binary);
+    std::vector<char> bytes(a_size);
+    source.read(bytes.data(), bytes.size());
+    std::ofstream(a_output, std::ios::binary).write(bytes.data(), source.gcount());
+}
+
+// Analyse complète du fichier.
+static void fullParse(const std::string& a_filepath) {
+    std::ifstream file(a_filepath, std::ios::binary);
+    Root root;
+    root.parse(file);
+}
+
+// Analyse sélective du fichier.
+static void selectiveParse(const std::string& a_filepath, const BoxQuery& a_query) {
+    std::ifstream file(a_filepath, std::ios::binary);
+    Root root;
+    ParseContext context;
+    parseSelective(file, root, a_query, context);
+}
+
+// Compare l'analyse sélective à l'analyse complète pour des requêtes usuelles.
+static void benchSelectiveParse(const std::string& a_filepath, int a_iterations) {
+    const std::vector<std::vector<std::string>> queries = {
+        {"moov/trak/mdia/mdhd"},
+        {"moov/trak/mdia/minf/stbl/stss"},
+        {"moov/trak/tkhd", "moov/trak/mdia/hdlr"},
+        {"moov/trak[0]/mdia/minf/stbl"},
+    };
+
+    double full_time = measure(a_iterations, [&]() { fullParse(a_filepath); });
+    std::cout << "== selective parse ==\n"
+              << "full parse: " << full_time << " us\n";
+    for (const std::vector<std::string>& paths : queries) {
+        BoxQuery query(paths);
+        double time = measure(a_iterations, [&]() { selectiveParse(a_filepath, query); });
+        std::string name;
+        for (const std::string& path : paths) {
+            name += (name.empty() ? "" : " + ") + path;
+        }
+        std::cout << name << ": " << time << " us ("
+                  << 100. * (full_time - time) / full_time << "% saved)\n";
+    }
+    // rangs hors de 32 bits : refusés au lieu d'être tronqués
+    for (const char *path : {"moov/trak[4294967294]", "moov/trak[4294967295]", "moov/trak[4294967296]",
+                             "moov/trak[99999999999999999999]"}) {
+        try {
+            BoxQuery query({path});
+            std::cout << path << ": accepted\n";
+        } catch (const std::runtime_error&) {
+            std::cout << path << ": rejected\n";
+        }
+    }
+    std::cout << std::endl;
+}
+
+// Visiteur minimal : compte les boîtes et les entrées de `stsz`.
+class CountingVisitor : public BoxVisitor {
+public:
+    uint64_t boxes   = 0;
+    uint64_t samples = 0;
+
+    VisitAction enterBox(Box& a_box, size_t a_depth) override {
+        (void) a_box; (void) a_depth;
+        boxes++;
+        return VisitAction::Continue;
+    }
+    VisitAction onStszEntries(const Stsz& a_box, const uint32_t *a_entry_size, size_t a_count) override {
+        (void) a_box; (void) a_entry_size;
+        samples += a_count;
+        return VisitAction::Continue;
+    }
+};
+
+// Compare l'analyse par évènements, sans arbre, à la construction de l'arbre.
+static void benchEventParse(const std::string& a_filepath, int a_iterations) {
+    double tree_time = measure(a_iterations, [&]() { fullParse(a_filepath); });
+    double event_time = measure(a_iterations, [&]() {
+        std::ifstream file(a_filepath, std::ios::binary);
+        Root root;
+        ParseContext context;
+        CountingVisitor visitor;
+        parseEvents(file, root, visitor, context);
+    });
+    std::cout << "== event parse ==\n"
+              << "tree builder: " << tree_time << " us\n"
+              << "counting visitor: " << event_time << " us\n"
+              << std::endl;
+}
+
+// Compte les boîtes de l'arbre et cumule leurs tailles, par type.
+static void countTree(const Box& a_box, std::vector<BoxTypeStats>& a_counts) {
+    for (const std::unique_ptr<Box>& child : a_box.getChildren()) {
+        auto it = std::find_if(a_counts.begin(), a_counts.end(),
+                               [&](const BoxTypeStats& s) { return s.type == child->type; });
+        if (it == a_counts.end()) {
+            a_counts.push_back(BoxTypeStats());
+            a_counts.back().type = child->type;
+            it = a_counts.end() - 1;
+        }
+        it->count++;
+        it->bytes += child->size;
+        countTree(*child, a_counts);
+    }
+}
+
+// Vérifie les compteurs d'analyse contre l'arbre et contre les valeurs connues
+// du fichier de test, puis mesure le coût de la mesure des temps.
+static void benchParseStats(const std::string& a_filepath, int a_iterations) {
+    struct Known {
+        const char *type;
+        uint64_t count;
+        uint64_t bytes;
+    };
+    // big_buck_bunny_240p_1mb.mp4
+    const Known known[] = {
+        {"moov", 1, 6904}, {"mdat", 2, 1046707}, {"trak", 2, 6692}, {"stsz", 2, 3428},
+        {"stco", 2, 1676}, {"hdlr", 3, 123},     {"url ", 2, 24},
+    };
+    std::cout << "== parse stats ==\n";
+
+    setParseTiming(false);
+    resetParseStats();
+    std::ifstream file(a_filepath, std::ios::binary);
+    Root root;
+    root.parse(file);
+    ParseStats stats = parseStats();
+    std::vector<BoxTypeStats> tree;
+    countTree(root, tree);
+
+    uint64_t headers = 0;
+    uint64_t timed_ns = stats.header_ns;
+    size_t mismatches = 0;
+    for (const BoxTypeStats& expected : tree) {
+        headers += expected.count;
+        auto it = std::find_if(stats.boxes.begin(), stats.boxes.end(),
+                               [&](const BoxTypeStats& s) { return s.type == expected.type; });
+        if (it == stats.boxes.end() || it->count != expected.count || it->bytes != expected.bytes) {
+            mismatches++;
+        }
+    }
+    for (const BoxTypeStats& box : stats.boxes) {
+        timed_ns += box.parse_ns;
+    }
+    std::cout << "counters vs tree: " << tree.size() << " types, " << headers << " boxes, "
+              << (check(stats.boxes.size() == tree.size() && stats.headers == headers && mismatches == 0) ? "match" : "MISMATCH")
+              << '\n'
+              << "timing disabled: " << timed_ns << " ns recorded\n";
+
+    if (stats.headers == 51) {
+        size_t known_mismatches = 0;
+        for (const Known& expected : known) {
+            auto it = std::find_if(stats.boxes.begin(), stats.boxes.end(), [&](const BoxTypeStats& s) {
+                return std::string_view(s.type.data(), 4) == expected.type;
+            });
+            if (it == stats.boxes.end() || it->count != expected.count || it->bytes != expected.bytes) {
+                known_mismatches++;
+            }
+        }
+        std::cout << "counters vs known test file values: " << (check(known_mismatches == 0) ? "match" : "MISMATCH") << '\n';
+    }
+
+    double untimed = measure(a_iterations, [&]() { fullParse(a_filepath); });
+    setParseTiming(true);
+    double timed = measure(a_iterations, [&]() { fullParse(a_filepath); });
+    setParseTiming(false);
+    resetParseStats();
+    std::cout << "parse without timing: " << untimed << " us\n"
+              << "parse with timing: " << timed << " us\n"
+              << std::endl;
+}
+
+// Compare une boîte et ses descendants aux entrées du sidecar, en ordre préfixe.
+//     @next: indice de la prochaine entrée attendue, avancé au fil du parcours
+//     @return: vrai si l'arbre et les entrées sont identiques
+static bool sameIndexedTree(const Box& a_box, const MappedIndex& a_index, uint32_t& a_next, uint8_t a_depth) {
+    if (a_next >= a_index.header().box_count) {
+        return false;
+    }
+    const IndexedBox& entry = a_index.boxes()[a_next++];
+    bool same = entry.type == a_box.type && entry.depth == a_depth
+             && entry.child_count == a_box.getChildren().size();
+    if (a_depth != 0) { // la racine porte la taille du fichier
+        same = same && entry.offset == a_box.offset && entry.size == a_box.size
+                    && entry.header_size == a_box.header_size;
+    }
+    for (const std::unique_ptr<Box>& child : a_box.getChildren()) {
+        same = same && sameIndexedTree(*child, a_index, a_next, a_depth + 1);
+    }
+    return same;
+}
+
+// Écrit le sidecar d'une copie du fichier, le projette et compare boîtes et
+// échantillons à l'analyse ; compare ensuite l'ouverture du sidecar à l'analyse.
+static void benchIndexCache(const std::string& a_filepath, int a_iterations) {
+    const std::string copy = "build/bench-index.mp4";
+    copyPrefix(a_filepath, copy, fileSize(a_filepath));
+    std::ifstream file(copy, std::ios::binary);
+    Root root;
+    root.parse(file);
+    writeIndex(copy, root);
+
+    std::cout << "== index sidecar ==\n";
+    std::unique_ptr<MappedIndex> index = MappedIndex::open(copy);
+    if (index == nullptr) {
+        check(false);
+        std::cout << "sidecar NOT OPENED\n" << std::endl;
+        return;
+    }
+    uint32_t next = 0;
+    bool same_boxes = sameIndexedTree(root, *index, next, 0) && next == index->header().box_count;
+    std::vector<Trak*> traks = findTracks(root);
+    bool same_samples = traks.size() == index->header().track_count;
+    uint64_t samples = 0;
+    for (size_t t = 0; same_samples && t < traks.size(); t++) {
+        std::vector<SampleInfo> flat = flattenSamples(*traks[t]);
+        const IndexedTrack& track = index->tracks()[t];
+        same_samples = track.sample_count == flat.size();
+        const IndexedSample *indexed = index->samples(track);
+        for (size_t i = 0; same_samples && i < flat.size(); i++) {
+            same_samples = indexed[i].offset == flat[i].offset && indexed[i].dts == flat[i].dts
+                        && indexed[i].size == flat[i].size && indexed[i].sync == flat[i].sync;
+        }
+        samples += flat.size();
+    }
+    std::cout << index->header().box_count << " boxes " << (check(same_boxes) ? "identical" : "DIFFER") << ", "
+              << samples << " samples " << (check(same_samples) ? "identical" : "DIFFER") << '\n';
+
+    double parse_time = measure(a_iterations, [&]() { fullParse(copy); });
+    double open_time  = measure(a_iterations, [&]() { MappedIndex::open(copy); });
+    std::cout << "parse: " << parse_time << " us\n"
+              << "mmap sidecar: " << open_time << " us\n";
+
+    // sidecar corrompu : sections dont la fin déborde d'un entier 64 bits, hors du
+    // fichier ou mal alignées ; chacun doit être refusé
+    const uint64_t samples_offset = index->header().samples_offset;
+    const struct {
+        const char *name;
+        size_t      field;
+        uint64_t    value;
+    } corruptions[] = {
+        {"wrapping sample count", offsetof(IndexHeader, sample_count), UINT64_MAX / sizeof(IndexedSample) + 2},
+        {"offset past the end", offsetof(IndexHeader, samples_offset), UINT64_MAX - 15},
+        {"misaligned offset", offsetof(IndexHeader, samples_offset), samples_offset - 4},
+    };
+    index.reset();
+    std::ifstream sidecar(indexPath(copy), std::ios::binary);
+    std::string original((std::istreambuf_iterator<char>(sidecar)), std::istreambuf_iterator<char>());
+    size_t accepted = 0;
+    for (const auto& corruption : corruptions) {
+        std::string corrupt = original;
+        std::memcpy(&corrupt[corruption.field], &corruption.value, sizeof(uint64_t));
+        std::ofstream(indexPath(copy), std::ios::binary) << corrupt;
+        if (!check(MappedIndex::open(copy) == nullptr)) {
+            std::cout << corruption.name << ": ACCEPTED\n";
+            accepted++;
+        }
+    }
+    std::cout << "corrupt sidecars: " << (check(accepted == 0) ? "all rejected" : "NOT ALL REJECTED") << '\n'
+              << std::endl;
+    std::remove(indexPath(copy).c_str());
+    std::remove(copy.c_str());
+}
+
+// Boîte feuille du fichier : analysée seule, sans appel à `parseBox`.
+struct LeafBox {
+    Box     *box;
+    uint64_t payload; // position des données après l'entête
+};
+
+// Liste les boîtes sans enfant de l'arbre, hors données (`mdat`, `free`).
+static void collectLeaves(Box& a_box, std::vector<LeafBox>& a_leaves) {
+    for (const std::unique_ptr<Box>& child : a_box.getChildren()) {
+        if (child->kind == BoxKind::Mdat || child->kind == BoxKind::Free) {
+            continue;
+        }
+        if (child->getChildren().empty()) {
+            a_leaves.push_back(LeafBox{child.get(), child->offset + child->header_size});
+        } else {
+            collectLeaves(*child, a_leaves);
+        }
+    }
+}
+
+// Compare l'appel virtuel de `parse` à l'appel direct par `visitBox`, en
+// ré-analysant toutes les boîtes feuilles du fichier.
+static void benchDispatch(const std::string& a_filepath, int a_iterations) {
+    std::ifstream file(a_filepath, std::ios::binary);
+    Root root;
+    std::cout.setstate(std::ios::badbit);
+    root.parse(file);
+    std::cout.clear();
+    std::vector<LeafBox> leaves;
+    collectLeaves(root, leaves);
+
+    uint64_t bytes = 0;
+    for (const LeafBox& leaf : leaves) {
+        bytes += leaf.box->size;
+    }
+
+    auto reparse = [&](bool a_virtual) {
+        for (const LeafBox& leaf : leaves) {
+            std::unique_ptr<Box> box = visitBox(*leaf.box, [](auto& a_box) -> std::unique_ptr<Box> {
+                return std::make_unique<std::decay_t<decltype(a_box)>>();
+            });
+            box->size = leaf.box->size;
+            box->setParseOffset(leaf.box->header_size);
+            file.clear();
+            file.seekg(leaf.payload);
+            if (a_virtual) {
+                box->parse(file);
+            } else {
+                visitBox(*box, [&](auto& a_box) { a_box.parse(file); });
+            }
+        }
+    };
+    double virtual_time = measure(a_iterations, [&]() { reparse(true); });
+    double static_time  = measure(a_iterations, [&]() { reparse(false); });
+    std::cout << "== box dispatch (" << leaves.size() << " leaf boxes, " << bytes << " bytes) ==\n"
+              << "virtual parse: " << virtual_time << " us (" << bytes / virtual_time << " MB/s)\n"
+              << "visitBox parse: " << static_time << " us (" << bytes / static_time << " MB/s)\n"
+              << std::endl;
+}
+
+// Débit de l'écriture du contenu de toutes les boîtes.
+static void benchDump(const std::string& a_filepath, int a_iterations) {
+    std::ifstream file(a_filepath, std::ios::binary);
+    Root root;
+    std::cout.setstate(std::ios::badbit);
+    root.parse(file);
+    std::cout.clear();
+
+    std::ostringstream text;
+    {
+        DumpWriter writer(text);
+        dumpTree(writer, root);
+    }
+    double bytes = text.str().size();
+
+    std::ofstream null_stream("/dev/null");
+    double dump_time = measure(a_iterations, [&]() {
+        DumpWriter writer(null_stream);
+        dumpTree(writer, root);
+    });
+    double columnar_time = measure(a_iterations, [&]() {
+        DumpWriter writer(null_stream, DumpWriter::DEFAULT_CAPACITY, true);
+        dumpTree(writer, root);
+    });
+    std::cout << "== text dump (" << bytes << " bytes) ==\n"
+              << "dumpTree: " << dump_time << " us (" << bytes / dump_time << " MB/s)\n"
+              << "dumpTree, columnar: " << columnar_time << " us\n"
+              << std::endl;
+}
+
+// Compare la représentation compacte des tables d'échantillons d'une piste
+// aux tables brutes et à leur version aplatie : mémoire, accès aléatoire,
+// décodage.
+//     @trak: la piste
+//     @name: nom de la piste dans le rapport
+//     @iterations: nombre de répétitions des mesures
+static void benchCompactTrack(const Trak& a_trak, const std::string& a_name, int a_iterations) {
+    TrackBoxes boxes = findTrackBoxes(a_trak);
+    std::vector<SampleInfo> flat = flattenSamples(a_trak);
+    CompactSampleTable compact(a_trak);
+    uint32_t count = compact.sampleCount();
+    if (count == 0) {
+        return;
+    }
+
+    size_t mismatches = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        SampleInfo a = flat[i];
+        SampleInfo b = compact.sample(i);
+        mismatches += a.offset != b.offset || a.dts != b.dts || a.size != b.size || a.sync != b.sync;
+    }
+
+    uint64_t raw_bytes = boxes.stsz->entry_size.capacity() * 4 + boxes.stco->chunk_offset.capacity() * 4
+                       + (boxes.stts->sample_count.capacity() + boxes.stts->sample_delta.capacity()) * 4
+                       + (boxes.stsc->first_chunk.capacity() + boxes.stsc->samples_per_chunk.capacity()
+                          + boxes.stsc->samples_description_index.capacity()) * 4
+                       + (boxes.stss != nullptr ? boxes.stss->sample_number.capacity() * 4 : 0);
+    uint64_t flat_bytes = flat.capacity() * sizeof(SampleInfo);
+
+    // indices pseudo-aléatoires, identiques pour les deux représentations
+    std::vector<uint32_t> indices(count);
+    uint32_t state = 12345;
+    for (uint32_t& index : indices) {
+        state = state * 1664525 + 1013904223;
+        index = state % count;
+    }
+    uint64_t checksum = 0;
+    double flat_time = measure(a_iterations, [&]() {
+        for (uint32_t index : indices) {
+            checksum += flat[index].offset + flat[index].dts + flat[index].size;
+        }
+    });
+    double compact_time = measure(a_iterations, [&]() {
+        for (uint32_t index : indices) {
+            checksum += compact.sampleOffset(index) + compact.sampleDts(index) + compact.sampleSize(index);
+        }
+    });
+    std::vector<uint32_t> sizes(count);
+    double decode_time = measure(a_iterations, [&]() {
+        compact.decodeSizes(0, count, sizes.data());
+        checksum += sizes[count - 1];
+    });
+
+    std::cout << a_name << " (" << count << " samples"
+              << (check(mismatches == 0) ? "" : ", MISMATCH") << ")\n"
+              << "  memory: raw tables " << raw_bytes << " B, flattened " << flat_bytes
+              << " B, compact " << compact.memoryBytes() << " B ("
+              << double(compact.memoryBytes()) / count << " B per sample)\n"
+              << "  random access: flattened " << 1000 * flat_time / count << " ns, compact "
+              << 1000 * compact_time / count << " ns (checksum " << checksum % 10 << ")\n"
+              << "  decodeSizes: " << 1000 * decode_time / count << " ns per sample\n";
+}
+
+// Piste vidéo synthétique d'une heure à 60 images par seconde, en chunks
+// d'une seconde entrelacés avec l'audio : l'ordre de grandeur des flux
+// longs, que le fichier de test, court et en petits chunks, ne représente
+// pas.
+static std::unique_ptr<Trak> longTrack() {
+    const uint32_t samples = 60 * 3600;
+    const uint32_t samples_per_chunk = 60;
+    auto stts = std::make_unique<Stts>();
+    stts->entry_count = 1;
+    stts->sample_count = {samples};
+    stts->sample_delta = {1000};
+    auto stss = std::make_unique<Stss>();
+    auto stsz = std::make_unique<Stsz>();
+    stsz->sample_size = 0;
+    stsz->sample_count = samples;
+    auto stsc = std::make_unique<Stsc>();
+    stsc->entry_count = 1;
+    stsc->first_chunk = {1};
+    stsc->samples_per_chunk = {samples_per_chunk};
+    stsc->samples_description_index = {1};
+    auto stco = std::make_unique<Stco>();
+
+    // une image clé toutes les deux secondes, plus grosse que les autres ;
+    // l'audio de chaque seconde sépare deux chunks
+    uint32_t state = 12345;
+    uint64_t offset = 48;
+    for (uint32_t i = 0; i < samples; i++) {
+        state = state * 1664525 + 1013904223;
+        bool key = i % 120 == 0;
+        if (key) {
+            stss->sample_number.push_back(i + 1);
+        }
+        if (i % samples_per_chunk == 0) {
+            offset += 16000 + state % 512;
+            stco->chunk_offset.push_back((uint32_t) offset);
+        }
+        uint32_t size = key ? 40000 + state % 20000 : 2000 + state % 6000;
+        stsz->entry_size.push_back(size);
+        offset += size;
+    }
+    stss->entry_count = (uint32_t) stss->sample_number.size();
+    stco->entry_count = (uint32_t) stco->chunk_offset.size();
+
+    std::unique_ptr<Box> children[] = {std::move(stts), std::move(stss), std::move(stsz),
+                                       std::move(stsc), std::move(stco)};
+    std::unique_ptr<Box> stbl = std::make_unique<Stbl>();
+    for (std::unique_ptr<Box>& child : children) {
+        stbl->addChild(child);
+    }
+    std::unique_ptr<Box> minf = std::make_unique<Minf>();
+    minf->addChild(stbl);
+    std::unique_ptr<Box> mdia = std::make_unique<Mdia>();
+    mdia->addChild(minf);
+    auto trak = std::make_unique<Trak>();
+    trak->addChild(mdia);
+    return trak;
+}
+
+static void benchCompactTables(const std::string& a_filepath, int a_iterations) {
+    std::ifstream file(a_filepath, std::ios::binary);
+    Root root;
+    std::cout.setstate(std::ios::badbit);
+    root.parse(file);
+    std::cout.clear();
+
+    std::cout << "== compact sample tables ==\n";
+    for (const Trak *trak : findTracks(root)) {
+        benchCompactTrack(*trak, "track " + std::to_string(findTrackBoxes(*trak).tkhd->track_ID), a_iterations);
+    }
+    benchCompactTrack(*longTrack(), "synthetic 1 h track", a_iterations);
+    std::cout << std::endl;
+}
+
+// Débit du calcul des statistiques de pistes, en échantillons par seconde.
+static void benchAnalytics(const std::string& a_filepath, int a_iterations) {
+    std::ifstream file(a_filepath, std::ios::binary);
+    Root root;
+    std::cout.setstate(std::ios::badbit);
+    root.parse(file);
+    std::cout.clear();
+
+    uint64_t samples = 0;
+    for (const TrackAnalytics& track : analyzeTracks(root)) {
+        samples += track.sample_count;
+    }
+    double time = measure(a_iterations, [&]() { analyzeTracks(root); });
+    std::cout << "== track analytics ==\n"
+              << "analyzeTracks: " << time << " us (" << samples / time << " Msamples/s)\n"
+              << std::endl;
+}
+
+// Durée du découpage en segments et vérification du parcours des échantillons
+// (`SampleCursor`) par rapport aux tables aplaties.
+static void benchSegments(const std::string& a_filepath, int a_iterations) {
+    std::ifstream file(a_filepath, std::ios::binary);
+    Root root;
+    std::cout.setstate(std::ios::badbit);
+    root.parse(file);
+    std::cout.clear();
+
+    size_t mismatches = 0;
+    for (const Trak *trak : findTracks(root)) {
+        std::vector<SampleInfo> flat = flattenSamples(*trak);
+        SampleCursor cursor(*trak);
+        for (; !cursor.done(); cursor.next()) {
+            const SampleInfo& a = flat[cursor.index()];
+            const SampleInfo& b = cursor.sample();
+            mismatches += a.offset != b.offset || a.dts != b.dts || a.size != b.size || a.sync != b.sync;
+        }
+        mismatches += cursor.index() != flat.size();
+    }
+    double time = measure(a_iterations, [&]() { planSegments(root, 4.0); });
+    std::cout << "== segment planner ==\n"
+              << "SampleCursor: " << (check(mismatches == 0) ? "matches flattenSamples" : "MISMATCH") << '\n'
+              << "planSegments (4 s): " << time << " us\n"
+              << std::endl;
+}
+
+// Analyse complète au travers d'un RangeStreamBuf.
+//     @reader: la source
+//     @options: configuration du tampon
+//     @return: les compteurs de requêtes
+static RangeCounters rangeParse(RangeReader& a_reader, RangeStreamBuf::Options a_options) {
+    RangeStreamBuf buffer(a_reader, a_options);
+    std::istream stream(&buffer);
+    Root root;
+    std::cout.setstate(std::ios::badbit);
+    root.parse(stream);
+    std::cout.clear();
+    return buffer.counters();
+}
+
+// Nombre de requêtes d'une analyse complète selon la configuration du lecteur
+// par plages, et durée avec une latence simulée de source distante.
+static void benchRangeReader(const std::string& a_filepath) {
+    struct Config {
+        const char *name;
+        RangeStreamBuf::Options options;
+    };
+    const std::vector<Config> configs = {
+        {"8 B blocks, no cache (~ one request per read)", {8, 1, 1, 1}},
+        {"4 KiB blocks, no read-ahead", {4 * 1024, 1, 1, 1}},
+        {"16 KiB blocks, read-ahead 1-16", {16 * 1024, 32, 1, 16}},
+        {"64 KiB blocks, read-ahead 1-16", RangeStreamBuf::Options()},
+    };
+    FileRangeReader file(a_filepath);
+    std::cout << "== range reader (" << file.size() << " bytes) ==\n";
+    for (const Config& config : configs) {
+        RangeCounters counters = rangeParse(file, config.options);
+        std::cout << config.name << ": " << counters.requests << " requests, "
+                  << counters.fetched << " bytes fetched, " << counters.overfetched << " over-fetched\n";
+    }
+
+    const std::chrono::milliseconds latency(5);
+    LatencyRangeReader remote(std::make_unique<FileRangeReader>(a_filepath), latency);
+    auto beg = std::chrono::steady_clock::now();
+    RangeCounters counters = rangeParse(remote, RangeStreamBuf::Options());
+    double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - beg).count();
+    std::cout << "default, " << latency.count() << " ms per request: " << time << " ms ("
+              << counters.requests << " requests)\n"
+              << std::endl;
+}
+
+// Analyse au travers d'un tube (moov après mdat), sans spool puis avec
+// plusieurs plafonds : les échantillons doivent être ceux de flattenSamples
+// sur le fichier, et ceux que le spool conserve doivent y être relus à
+// l'identique.
+static void benchForwardInput(const std::string& a_filepath) {
+    std::ifstream file(a_filepath, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.clear();
+    file.seekg(0);
+    Root reference;
+    reference.size = 0;
+    std::cout.setstate(std::ios::badbit);
+    reference.parse(file);
+    std::cout.clear();
+    std::vector<std::vector<SampleInfo>> expected;
+    for (const Trak *trak : findTracks(reference)) {
+        expected.push_back(flattenSamples(*trak));
+    }
+
+    std::cout << "== forward input ==\n";
+    for (uint64_t cap : {uint64_t(0), uint64_t(256 * 1024), uint64_t(bytes.size())}) {
+        int fds[2];
+        if (::pipe(fds) != 0) {
+            throw std::runtime_error("Cannot create pipe.");
+        }
+        std::thread writer([&]() {
+            for (size_t done = 0; done < bytes.size(); ) {
+                ssize_t n = ::write(fds[1], bytes.data() + done, bytes.size() - done);
+                if (n <= 0) {
+                    break;
+                }
+                done += n;
+            }
+            ::close(fds[1]);
+        });
+        std::unique_ptr<Spool> spool = cap > 0 ? std::make_unique<Spool>(cap) : nullptr;
+        ForwardStreamBuf buffer(fds[0], spool.get());
+        std::istream input(&buffer);
+        Root root;
+        root.size = 0;
+        std::cout.setstate(std::ios::badbit);
+        root.parse(input);
+        std::cout.clear();
+        input.clear();
+        input.seekg(0, std::ios::end); // vide le tube
+        writer.join();
+        ::close(fds[0]);
+
+        std::vector<Trak*> traks = findTracks(root);
+        bool same = traks.size() == expected.size();
+        uint64_t samples  = 0;
+        uint64_t resolved = 0;
+        uint64_t wrong    = 0;
+        std::vector<char> sample;
+        for (size_t t = 0; same && t < traks.size(); t++) {
+            std::vector<SampleInfo> flat = flattenSamples(*traks[t]);
+            same = flat.size() == expected[t].size();
+            for (size_t i = 0; same && i < flat.size(); i++) {
+                const SampleInfo& info = flat[i];
+                same = info.offset == expected[t][i].offset && info.dts == expected[t][i].dts
+                    && info.size == expected[t][i].size && info.sync == expected[t][i].sync;
+                samples++;
+                if (spool && spool->contains(info.offset, info.size)) {
+                    sample.resize(info.size);
+                    spool->read(info.offset, sample.data(), info.size);
+                    resolved++;
+                    wrong += bytes.compare(info.offset, info.size, sample.data(), info.size) != 0;
+                }
+            }
+        }
+        std::cout << (cap == 0 ? std::string("no spool") : "spool cap " + std::to_string(cap)) << ": "
+                  << (check(same) ? "samples match flattenSamples" : "samples DIFFER");
+        if (spool) {
+            std::cout << ", " << spool->spooled() << " spooled, " << spool->dropped() << " dropped, "
+                      << resolved << '/' << samples << " samples resolved"
+                      << (check(wrong == 0) ? ", bytes identical" : ", " + std::to_string(wrong) + " samples DIFFER");
+        }
+        std::cout << '\n';
+    }
+
+    // retour en arrière dans le tampon puis saut en avant : les octets déjà
+    // conservés ne le sont pas une seconde fois
+    int fds[2];
+    if (::pipe(fds) != 0) {
+        throw std::runtime_error("Cannot create pipe.");
+    }
+    const size_t head = 4096;
+    if (::write(fds[1], bytes.data(), head) != ssize_t(head)) {
+        throw std::runtime_error("Cannot write to pipe.");
+    }
+    ::close(fds[1]);
+    Spool spool(head);
+    ForwardStreamBuf buffer(fds[0], &spool);
+    std::istream input(&buffer);
+    input.seekg(1000);
+    input.seekg(500);
+    input.seekg(3000);
+    std::vector<char> spooled(3000);
+    bool readable = spool.contains(0, spooled.size());
+    if (readable) {
+        spool.read(0, spooled.data(), spooled.size());
+    }
+    ::close(fds[0]);
+    std::cout << "seek 1000, back to 500, then 3000: " << spool.spooled() << " bytes spooled, "
+              << (readable && bytes.compare(0, spooled.size(), spooled.data(), spooled.size()) == 0
+                  ? "[0, 3000) readable" : "[0, 3000) NOT readable") << '\n'
+              << std::endl;
+}
+
+// Débit de la vérification des tables, puis détection d'erreurs introduites
+// dans l'arbre : chunk hors de mdat, chunks superposés, stss désordonnée,
+// total de stts faux.
+static void benchValidation(const std::string& a_filepath, int a_iterations) {
+    std::ifstream file(a_filepath, std::ios::binary);
+    Root root;
+    std::cout.setstate(std::ios::badbit);
+    root.parse(file);
+    std::cout.clear();
+
+    uint64_t size = fileSize(a_filepath);
+    ValidationReport report;
+    double time = measure(a_iterations, [&]() { report = validateSampleTables(root, size); });
+    std::cout << "== table validation ==\n"
+              << "validateSampleTables: " << time << " us, " << report.media_bytes / (time * 1e3)
+              << " GB of media per second\n";
+    printValidationReport(std::cout, report);
+    check(report.valid());
+
+    // fichier faststart (moov en tête) tronqué au milieu de mdat, puis fichier
+    // coupé avant moov : les échantillons absents et l'absence de moov sont signalés
+    const std::string faststart = "build/bench-validation-faststart.mp4";
+    const std::string truncated = "build/bench-validation-truncated.mp4";
+    const std::string headless  = "build/bench-validation-nomoov.mp4";
+    MovieWriteStats write = reinterleave(root, a_filepath, faststart, 0.5);
+    copyPrefix(faststart, truncated, write.file_size - write.mdat_size / 2);
+    copyPrefix(a_filepath, headless, root.findChild({'m', 'o', 'o', 'v'})->offset);
+    for (const std::string& path : {truncated, headless}) {
+        std::ifstream damaged(path, std::ios::binary);
+        Root damaged_root;
+        std::cout.setstate(std::ios::badbit);
+        damaged_root.parse(damaged);
+        std::cout.clear();
+        std::cout << path << ": ";
+        ValidationReport damaged_report = validateSampleTables(damaged_root, fileSize(path), 4);
+        printValidationReport(std::cout, damaged_report);
+        check(!damaged_report.valid());
+        std::remove(path.c_str());
+    }
+    std::remove(faststart.c_str());
+
+    std::vector<Trak*> traks = findTracks(root);
+    TrackBoxes video = findTrackBoxes(*traks.front());
+    TrackBoxes audio = findTrackBoxes(*traks.back());
+    video.stco->chunk_offset.back() += 1 << 20;                             // au-delà de mdat
+    audio.stco->chunk_offset[1] = video.stco->chunk_offset[1];              // mêmes octets que la vidéo
+    std::swap(video.stss->sample_number[1], video.stss->sample_number[2]); // ordre rompu
+    audio.stts->sample_count.front() += 1;                                  // total faux
+    ValidationReport broken = validateSampleTables(root, fileSize(a_filepath));
+    printValidationReport(std::cout, broken);
+    check(!broken.valid());
+    std::cout << std::endl;
+}
+
+// Vecteurs de test des fonctions de hachage, puis empreintes des pistes avec
+// un et plusieurs threads (4, ou un par cœur s'il y en a plus) : les résultats
+// doivent être identiques. Le fichier de test est trop petit pour justifier
+// des threads ; une concaténation de 32 copies montre le passage à l'échelle.
+static void benchFingerprint(const std::string& a_filepath, int a_iterations) {
+    const std::string abc = "abc";
+    Sha256::Digest sha = Sha256::hash(abc.data(), abc.size());
+    bool vectors = xxhash64("", 0) == 0xEF46DB3751D8E999 && xxhash64(abc.data(), abc.size()) == 0x44BC2CF5AD770999
+                && sha[0] == 0xba && sha[1] == 0x78 && sha[30] == 0x15 && sha[31] == 0xad;
+
+    std::ifstream file(a_filepath, std::ios::binary);
+    Root root;
+    std::cout.setstate(std::ios::badbit);
+    root.parse(file);
+    std::cout.clear();
+
+    const std::string large = "build/bench-fingerprint.mp4";
+    concatFiles(std::vector<const Root*>(32, &root), std::vector<std::string>(32, a_filepath), large);
+    std::ifstream large_file(large, std::ios::binary);
+    Root large_root;
+    std::cout.setstate(std::ios::badbit);
+    large_root.parse(large_file);
+    std::cout.clear();
+
+    std::cout << "== fingerprint ==\n"
+              << "hash test vectors: " << (check(vectors) ? "ok" : "MISMATCH") << '\n'
+              << "hardware threads: " << std::thread::hardware_concurrency() << '\n';
+    unsigned cores = std::max(4u, std::thread::hardware_concurrency());
+    for (const auto& input : {std::make_pair(&root, a_filepath), std::make_pair(&large_root, large)}) {
+        FileRangeReader reader(input.second);
+        int iterations = input.first == &root ? a_iterations : std::max(1, a_iterations / 32);
+        std::cout << input.second << " (" << fileSize(input.second) << " bytes)\n";
+        for (bool sha256 : {false, true}) {
+            Fingerprints reference;
+            double reference_time = 0;
+            for (unsigned threads : {1u, cores}) {
+                FingerprintOptions options;
+                options.threads = threads;
+                options.sha256  = sha256;
+                Fingerprints result;
+                double time = measure(iterations, [&]() { result = fingerprintTracks(*input.first, reader, options); });
+                if (reference.tracks.empty()) {
+                    reference = result;
+                    reference_time = time;
+                }
+                bool same = true;
+                for (size_t t = 0; t < result.tracks.size(); t++) {
+                    same = same && result.tracks[t].digest == reference.tracks[t].digest;
+                }
+                uint64_t bytes = 0;
+                for (const TrackFingerprint& track : result.tracks) {
+                    bytes += track.bytes;
+                }
+                std::cout << "  " << (sha256 ? "xxh64+sha256, " : "xxh64, ") << threads << " threads requested, "
+                          << result.stats.threads << " used: " << time << " us, " << bytes / time << " MB/s (x"
+                          << reference_time / time << "), " << result.stats.reads << " reads"
+                          << (check(same) ? "" : " (DIGEST MISMATCH)") << '\n';
+            }
+        }
+    }
+    std::remove(large.c_str());
+    std::cout << std::endl;
+}
+
+// Analyse d'une boîte hdlr synthétique au nom long, sans '\0' final : le nom
+// doit être tronqué à la fin de la boîte et le flux positionné juste après.
+// Hashs des échantillons [first, first+count) d'une piste.
+static std::vector<uint64_t> sampleHashes(const Trak& a_trak, std::ifstream& a_file, uint32_t a_first, uint32_t a_count) {
+    std::vector<SampleInfo> samples = flattenSamples(a_trak);
+    std::vector<uint64_t> hashes;
+    std::vector<char> buffer;
+    for (uint32_t i = a_first; i < a_first + a_count && i < samples.size(); i++) {
+        buffer.resize(samples[i].size);
+        a_file.seekg(samples[i].offset);
+        a_file.read(buffer.data(), buffer.size());
+        hashes.push_back(xxhash64(buffer.data(), buffer.size()));
+    }
+    return hashes;
+}
+
+static void benchTrim(const std::string& a_filepath, int a_iterations) {
+    std::ifstream file(a_filepath, std::ios::binary);
+    Root root;
+    std::cout.setstate(std::ios::badbit);
+    root.parse(file);
+    std::cout.clear();
+
+    uint64_t source_size = fileSize(a_filepath);
+
+    std::cout << "== trim ==\n";
+    const std::string output = "build/bench-trim.mp4";
+    for (std::pair<double, double> interval : {std::make_pair(0.0, 4.0), std::make_pair(9.0, 12.0)}) {
+        TrimResult result;
+        double time = measure(a_iterations, [&]() {
+            result = trimFile(root, a_filepath, interval.first, interval.second, output);
+        });
+
+        // le fichier écrit est analysé, vérifié et ses échantillons comparés à la source
+        std::ifstream written(output, std::ios::binary);
+        Root trimmed;
+        std::cout.setstate(std::ios::badbit);
+        trimmed.parse(written);
+        std::cout.clear();
+        ValidationReport report = validateSampleTables(trimmed, fileSize(output));
+        std::vector<Trak*> sources = findTracks(root);
+        std::vector<Trak*> outputs = findTracks(trimmed);
+        bool same = outputs.size() == result.tracks.size();
+        for (size_t t = 0; same && t < outputs.size(); t++) {
+            const TrimTrack& track = result.tracks[t];
+            const Trak *source = nullptr;
+            for (const Trak *trak : sources) {
+                if (findTrackBoxes(*trak).tkhd->track_ID == track.track_ID) {
+                    source = trak;
+                }
+            }
+            same = source != nullptr
+                && sampleHashes(*source, file, track.first_sample, track.sample_count)
+                   == sampleHashes(*outputs[t], written, 0, track.sample_count);
+        }
+        std::cout << "[" << interval.first << ", " << interval.second << ") -> [" << result.start << ", "
+                  << result.end << "): " << time << " us, " << result.write.copied_bytes << " of "
+                  << source_size << " bytes copied in " << result.write.copy_runs << " runs, "
+                  << (check(report.valid()) ? "valid" : "INVALID") << ", samples " << (check(same) ? "identical" : "DIFFER") << '\n';
+    }
+
+    // fin au-delà du film : toutes les pistes sont gardées jusqu'à leur
+    // dernier échantillon ; début au-delà du film : refusé
+    std::vector<Trak*> sources = findTracks(root);
+    TrimResult whole = trimFile(root, a_filepath, 0, 1000, output);
+    bool complete = whole.tracks.size() == sources.size();
+    for (size_t t = 0; complete && t < sources.size(); t++) {
+        complete = whole.tracks[t].first_sample == 0
+                && whole.tracks[t].sample_count == SampleCursor(*sources[t]).sampleCount();
+    }
+    std::cout << "[0, 1000) -> [" << whole.start << ", " << whole.end << "): "
+              << (check(complete) ? "all tracks complete" : "INCOMPLETE") << '\n';
+    try {
+        TrimResult beyond = trimFile(root, a_filepath, 100, 200, output);
+        check(false);
+        std::cout << "[100, 200) -> [" << beyond.start << ", " << beyond.end << "): NOT REJECTED\n";
+    } catch (const std::runtime_error& e) {
+        std::cout << "[100, 200): rejected (" << e.what() << ")\n";
+    }
+    std::remove(output.c_str());
+    std::cout << std::endl;
+}
+
+// Coupe d'une piste vidéo à images B : une table ctts synthétique (motif
+// I P B B) est ajoutée à la piste vidéo. La table écrite doit reprendre les
+// décalages des échantillons gardés ; une boîte de `stbl` que l'écriture ne
+// sait pas reconstruire est refusée.
+static void benchTrimReordered(const std::string& a_filepath) {
+    std::ifstream file(a_filepath, std::ios::binary);
+    Root root;
+    std::cout.setstate(std::ios::badbit);
+    root.parse(file);
+    std::cout.clear();
+
+    std::cout << "== trim with composition offsets ==\n";
+    Trak *video = nullptr;
+    for (Trak *trak : findTracks(root)) {
+        TrackBoxes boxes = findTrackBoxes(*trak);
+        if (boxes.hdlr != nullptr && boxes.hdlr->handler_type == 0x76696465) {
+            video = trak;
+        }
+    }
+    if (!check(video != nullptr)) {
+        std::cout << "no video track\n\n";
+        return;
+    }
+    TrackBoxes boxes = findTrackBoxes(*video);
+    const uint32_t pattern[] = {1, 3, 0, 0};
+    uint32_t delta = boxes.stts->sample_delta[0];
+    auto ctts = std::make_unique<Ctts>();
+    for (uint32_t i = 0; i < boxes.stsz->sample_count; i++) {
+        uint32_t offset = pattern[i % 4] * delta;
+        if (!ctts->sample_offset.empty() && ctts->sample_offset.back() == offset) {
+            ctts->sample_count.back()++;
+        } else {
+            ctts->sample_count.push_back(1);
+            ctts->sample_offset.push_back(offset);
+        }
+    }
+    ctts->entry_count = (uint32_t) ctts->sample_count.size();
+    std::unique_ptr<Box> child = std::move(ctts);
+    boxes.stbl->addChild(child);
+
+    const std::string output = "build/bench-trim.mp4";
+    TrimResult result = trimFile(root, a_filepath, 9.0, 12.0, output);
+    std::ifstream written(output, std::ios::binary);
+    Root trimmed;
+    std::cout.setstate(std::ios::badbit);
+    trimmed.parse(written);
+    std::cout.clear();
+    uint32_t first = 0, count = 0;
+    for (const TrimTrack& track : result.tracks) {
+        if (track.track_ID == boxes.tkhd->track_ID) {
+            first = track.first_sample;
+            count = track.sample_count;
+        }
+    }
+    bool same = false;
+    for (Trak *trak : findTracks(trimmed)) {
+        if (findTrackBoxes(*trak).tkhd->track_ID != boxes.tkhd->track_ID) {
+            continue;
+        }
+        SampleCursor cursor(*trak);
+        same = cursor.sampleCount() == count && count > 0;
+        for (; same && !cursor.done(); cursor.next()) {
+            same = uint32_t(cursor.compositionOffset()) == pattern[(first + cursor.index()) % 4] * delta;
+        }
+    }
+    std::cout << "[9, 12) -> [" << result.start << ", " << result.end << "): " << count << " video samples, "
+              << (check(validateSampleTables(trimmed, fileSize(output)).valid()) ? "valid" : "INVALID") << ", ctts "
+              << (check(same) ? "rebuilt for the kept samples" : "DIFFERS") << '\n';
+
+    std::unique_ptr<Box> unknown = std::make_unique<Free>();
+    boxes.stbl->addChild(unknown);
+    try {
+        trimFile(root, a_filepath, 9.0, 12.0, output);
+        check(false);
+        std::cout << "extra stbl box: NOT REJECTED\n";
+    } catch (const std::runtime_error& e) {
+        std::cout << "extra stbl box: rejected (" << e.what() << ")\n";
+    }
+    std::remove(output.c_str());
+    std::cout << std::endl;
+}
+
+static void benchSplit(const std::string& a_filepath, int a_iterations) {
+    std::ifstream file(a_filepath, std::ios::binary);
+    Root root;
+    std::cout.setstate(std::ios::badbit);
+    root.parse(file);
+    std::cout.clear();
+    FileRangeReader reader(a_filepath);
+    Fingerprints source = fingerprintTracks(root, reader);
+
+    std::cout << "== split ==\n";
+    for (size_t block_size : {size_t(64 * 1024), size_t(1024 * 1024)}) {
+        SplitResult result;
+        double time = measure(a_iterations, [&]() { result = splitTracks(root, a_filepath, "build/bench-split", block_size); });
+
+        // chaque fichier écrit doit être valide et garder l'empreinte de sa piste
+        bool same = result.outputs.size() == source.tracks.size();
+        bool valid = true;
+        for (size_t t = 0; same && t < result.outputs.size(); t++) {
+            std::ifstream written(result.outputs[t].path, std::ios::binary);
+            Root split;
+            std::cout.setstate(std::ios::badbit);
+            split.parse(written);
+            std::cout.clear();
+            valid = valid && validateSampleTables(split, fileSize(result.outputs[t].path)).valid();
+            FileRangeReader split_reader(result.outputs[t].path);
+            Fingerprints fingerprints = fingerprintTracks(split, split_reader);
+            same = fingerprints.tracks.size() == 1 && fingerprints.tracks[0].digest == source.tracks[t].digest;
+            std::remove(result.outputs[t].path.c_str());
+        }
+        std::cout << block_size / 1024 << " KiB blocks: " << time << " us, " << result.outputs.size() << " files, "
+                  << result.reads << " reads of " << result.bytes_read << " bytes, "
+                  << (check(valid) ? "valid" : "INVALID") << ", fingerprints " << (check(same) ? "identical" : "DIFFER") << '\n';
+    }
+    std::cout << std::endl;
+}
+
+static void benchConcat(const std::string& a_filepath, int a_iterations) {
+    std::ifstream file(a_filepath, std::ios::binary);
+    Root root;
+    std::cout.setstate(std::ios::badbit);
+    root.parse(file);
+    std::cout.clear();
+    FileRangeReader reader(a_filepath);
+    Fingerprints source = fingerprintTracks(root, reader);
+
+    // deux segments coupés sur la deuxième image clé, analysés une fois chacun
+    const Trak& video = *findTracks(root)[0];
+    double cut = 0;
+    int syncs = 0;
+    for (const SampleInfo& sample : flattenSamples(video)) {
+        if (sample.sync && syncs++ == 1) {
+            cut = double(sample.dts) / findTrackBoxes(video).mdhd->timescale;
+        }
+    }
+    std::vector<std::string> segments = {"build/bench-concat-a.mp4", "build/bench-concat-b.mp4"};
+    trimFile(root, a_filepath, 0, cut, segments[0]);
+    trimFile(root, a_filepath, cut, 1e9, segments[1]);
+    std::vector<std::unique_ptr<Root>> trees;
+    std::cout.setstate(std::ios::badbit);
+    for (const std::string& segment : segments) {
+        std::ifstream input(segment, std::ios::binary);
+        trees.push_back(std::make_unique<Root>());
+        trees.back()->parse(input);
+    }
+    std::cout.clear();
+
+    std::cout << "== concat ==\n";
+    const std::string output = "build/bench-concat.mp4";
+    for (size_t count : {size_t(2), size_t(200)}) {
+        std::vector<const Root*> roots;
+        std::vector<std::string> paths;
+        for (size_t i = 0; i < count; i++) {
+            roots.push_back(trees[i % 2].get());
+            paths.push_back(segments[i % 2]);
+        }
+        ConcatResult result;
+        double time = measure(count > 2 ? 1 : a_iterations, [&]() { result = concatFiles(roots, paths, output); });
+
+        std::ifstream written(output, std::ios::binary);
+        Root concatenated;
+        std::cout.setstate(std::ios::badbit);
+        concatenated.parse(written);
+        std::cout.clear();
+        bool valid = validateSampleTables(concatenated, fileSize(output)).valid();
+        std::cout << count << " inputs: " << time << " us, " << result.write.copied_bytes / time << " MB/s, "
+                  << result.tracks[0].sample_count << " video samples, " << (check(valid) ? "valid" : "INVALID");
+        if (count == 2) {
+            // les deux moitiés redonnent la vidéo source, échantillon pour échantillon
+            FileRangeReader written_reader(output);
+            bool same = fingerprintTracks(concatenated, written_reader).tracks[0].digest == source.tracks[0].digest;
+            std::cout << ", video fingerprint " << (check(same) ? "identical to the source" : "DIFFERS");
+        }
+        std::cout << '\n';
+    }
+    std::remove(output.c_str());
+    for (const std::string& segment : segments) {
+        std::remove(segment.c_str());
+    }
+    std::cout << std::endl;
+}
+
+static void benchSerializer(const std::string& a_filepath, int a_iterations) {
+    std::ifstream file(a_filepath, std::ios::binary);
+    Root root;
+    std::cout.setstate(std::ios::badbit);
+    root.parse(file);
+    RoundTripReport report = checkRoundTrip(a_filepath);
+    std::cout.clear();
+
+    std::cout << "== serializer ==\n";
+    printRoundTripReport(std::cout, report);
+    check(report.same_bytes && report.same_tree);
+    int source = ::open(a_filepath.c_str(), O_RDONLY);
+    const std::string output = "build/bench-write.mp4";
+    int fd = ::open(output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    std::vector<char> bytes;
+    SerializeStats stats;
+    double memory_time = measure(a_iterations, [&]() { bytes = serializeToMemory(root, source); });
+    double file_time = measure(a_iterations, [&]() { stats = serializeTree(root, source, fd); });
+    std::cout << "to memory: " << memory_time << " us, to file: " << file_time << " us ("
+              << stats.bytes / file_time << " MB/s), " << stats.boxes << " boxes in " << stats.segments
+              << " segments, " << stats.write_calls << " pwritev calls, " << stats.copy_calls << " copy calls\n";
+    ::close(fd);
+    std::remove(output.c_str());
+
+    // durées sur 64 bits et largesize : version 1 et entête de 16 octets choisis à l'écriture
+    Box *moov = root.findChild({'m', 'o', 'o', 'v'});
+    Mvhd *mvhd = static_cast<Mvhd*>(moov->findChild({'m', 'v', 'h', 'd'}));
+    Trak *trak = findTracks(root)[0];
+    Elst *elst = static_cast<Elst*>(trak->findChild({'e', 'd', 't', 's'})->findChild({'e', 'l', 's', 't'}));
+    mvhd->duration = uint64_t(1) << 33;
+    elst->segment_duration[0] = uint64_t(1) << 34;
+    elst->media_rate_integer[0] = 2;
+    moov->header_size = 16;
+    bytes = serializeToMemory(root, source);
+    ::close(source);
+    std::istringstream copy(std::string(bytes.begin(), bytes.end()));
+    Root reparsed;
+    reparsed.size = 0;
+    std::cout.setstate(std::ios::badbit);
+    reparsed.parse(copy);
+    std::cout.clear();
+    Box *moov2 = reparsed.findChild({'m', 'o', 'o', 'v'});
+    Mvhd *mvhd2 = static_cast<Mvhd*>(moov2->findChild({'m', 'v', 'h', 'd'}));
+    Trak *trak2 = findTracks(reparsed)[0];
+    Elst *elst2 = static_cast<Elst*>(trak2->findChild({'e', 'd', 't', 's'})->findChild({'e', 'l', 's', 't'}));
+    bool promoted = moov2->header_size == 16 && mvhd2->version == 1 && mvhd2->duration == mvhd->duration
+                 && elst2->version == 1 && elst2->segment_duration[0] == elst->segment_duration[0]
+                 && elst2->media_rate_integer[0] == 2;
+    std::cout << "64-bit durations and largesize: " << (check(promoted) ? "version 1 and 16-byte header written"
+                                                                 : "NOT PRESERVED") << "\n\n";
+}
+
+// Analyse un fichier, sans l'affichage de l'analyse.
+static std::unique_ptr<Root> parseQuietly(const std::string& a_filepath) {
+    std::ifstream file(a_filepath, std::ios::binary);
+    auto root = std::make_unique<Root>();
+    root->size = 0;
+    std::cout.setstate(std::ios::badbit);
+    root->parse(file);
+    std::cout.clear();
+    return root;
+}
+
+static void benchMetadata(const std::string& a_filepath) {
+    std::unique_ptr<Root> source = parseQuietly(a_filepath);
+    std::ifstream file(a_filepath, std::ios::binary);
+    std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // moov en fin de fichier, suivi d'une boîte free, puis devant mdat (sortie de trimFile)
+    const std::string at_end = "build/bench-meta-end.mp4";
+    const std::string padded = "build/bench-meta-free.mp4";
+    const std::string front  = "build/bench-meta-front.mp4";
+    std::ofstream(at_end, std::ios::binary) << bytes;
+    std::string free_box = {0, 0, 0x10, 0, 'f', 'r', 'e', 'e'};
+    free_box.resize(4096, '\0');
+    std::ofstream(padded, std::ios::binary) << bytes << free_box;
+    trimFile(*source, a_filepath, 0, 1e9, front);
+
+    std::cout << "== metadata ==\n";
+    const MetadataTag title{{'\xA9', 'n', 'a', 'm'}, "Big Buck Bunny"};
+    for (const std::string& path : {at_end, padded, front}) {
+        std::unique_ptr<Root> root = parseQuietly(path);
+        FileRangeReader before_reader(path);
+        Fingerprints before = fingerprintTracks(*root, before_reader);
+        MetadataEditResult result;
+        double time = measure(1, [&]() { result = editMetadata(*root, path, {title}); });
+        printMetadataEditResult(std::cout, result);
+
+        std::unique_ptr<Root> edited = parseQuietly(path);
+        std::vector<MetadataTag> tags = readMetadata(*edited, path);
+        bool tagged = !tags.empty() && tags.back().key == title.key && tags.back().value == title.value;
+        FileRangeReader after_reader(path);
+        Fingerprints after = fingerprintTracks(*edited, after_reader);
+        bool same = after.tracks.size() == before.tracks.size();
+        for (size_t t = 0; same && t < after.tracks.size(); t++) {
+            same = after.tracks[t].digest == before.tracks[t].digest;
+        }
+        std::cout << "  " << time << " us, " << tags.size() << " tags, title " << (check(tagged) ? "found" : "MISSING")
+                  << ", " << (check(validateSampleTables(*edited, fileSize(path)).valid()) ? "valid" : "INVALID") << ", samples "
+                  << (check(same) ? "unchanged" : "DIFFER") << '\n';
+        std::remove(path.c_str());
+    }
+    std::cout << std::endl;
+}
+
+static void benchKeyframes(const std::string& a_filepath, int a_iterations) {
+    std::unique_ptr<Root> root = parseQuietly(a_filepath);
+    FileRangeReader reader(a_filepath);
+    std::ifstream file(a_filepath, std::ios::binary);
+    std::vector<SampleInfo> samples = flattenSamples(*findTracks(*root)[0]);
+    uint64_t track_bytes = 0;
+    for (const SampleInfo& sample : samples) {
+        track_bytes += sample.size;
+    }
+
+    std::cout << "== keyframes ==\n";
+    for (NalFormat format : {NalFormat::LengthPrefixed, NalFormat::AnnexB}) {
+        KeyframeOptions options;
+        options.format = format;
+        KeyframeSet set;
+        double time = measure(a_iterations, [&]() { set = extractKeyframes(*root, reader, 16, options); });
+        // chaque image : les octets du fichier, tailles des NAL remplacées par des codes de départ en Annex B
+        bool same = true;
+        for (const Keyframe& frame : set.frames) {
+            std::vector<char> bytes(frame.size);
+            file.seekg(frame.offset);
+            file.read(bytes.data(), bytes.size());
+            if (format == NalFormat::AnnexB) {
+                size_t p = 0;
+                while (p + 4 <= bytes.size()) {
+                    size_t length = size_t(uint8_t(bytes[p])) << 24 | uint8_t(bytes[p+1]) << 16
+                                  | uint8_t(bytes[p+2]) << 8 | uint8_t(bytes[p+3]);
+                    bytes[p] = bytes[p+1] = bytes[p+2] = 0;
+                    bytes[p+3] = 1;
+                    p += 4 + length;
+                }
+            }
+            same = same && bytes == frame.data && samples[frame.sample - 1].sync;
+        }
+        std::cout << (format == NalFormat::AnnexB ? "Annex B" : "length-prefixed") << ": " << time << " us, "
+                  << set.frames.size() << " frames (" << set.distinct << " distinct), " << set.reads << " reads of "
+                  << set.bytes_read << " bytes for " << set.sample_bytes << " bytes of keyframes ("
+                  << track_bytes << " in the track), " << (check(same) ? "samples match" : "SAMPLES DIFFER") << '\n';
+    }
+    std::cout << std::endl;
+}
+
+// Configuration hvcC construite : Main, niveau 3.1, un VPS, un SPS, un PPS.
+static std::vector<char> hevcConfigRecord() {
+    std::vector<char> record = {1, 0x01, 0x60, 0, 0, 0, char(0x90), 0, 0, 0, 0, 0, 93,
+                                char(0xF0), 0, char(0xFC), char(0xFD), char(0xF8), char(0xF8), 0, 0, 0x0F, 3};
+    const std::vector<std::vector<char>> arrays = {
+        {char(0xA0), 0x40, 0x01, 0x0C, 0x01},       // VPS
+        {char(0xA1), 0x42, 0x01, 0x01, 0x01, 0x60}, // SPS
+        {char(0xA2), 0x44, 0x01, char(0xC1)},       // PPS
+    };
+    for (const std::vector<char>& array : arrays) {
+        record.push_back(array[0]);
+        record.push_back(0);
+        record.push_back(1);
+        record.push_back(0);
+        record.push_back(char(array.size() - 1));
+        record.insert(record.end(), array.begin() + 1, array.end());
+    }
+    return record;
+}
+
+// Copie du fichier où l'entrée avc1 devient hvc1, avec la configuration hvcC
+// construite. Les échantillons restent des NAL AVC de 4 octets de taille :
+// seule la description change. Les tailles des ancêtres sont corrigées ;
+// moov doit suivre mdat.
+static bool writeHevcCopy(const std::string& a_filepath, Root& a_root, const std::string& a_output) {
+    Box *avcc = nullptr;
+    for (const Trak *trak : findTracks(a_root)) {
+        Box *stsd = findTrackBoxes(*trak).stbl->findChild({'s', 't', 's', 'd'});
+        if (stsd != nullptr && !stsd->getChildren().empty() && stsd->getChildren()[0]->kind == BoxKind::Icpv) {
+            avcc = stsd->getChildren()[0]->findChild({'a', 'v', 'c', 'c'});
+        }
+    }
+    Box *moov = a_root.findChild({'m', 'o', 'o', 'v'});
+    Box *mdat = a_root.findChild({'m', 'd', 'a', 't'});
+    if (avcc == nullptr || moov == nullptr || mdat == nullptr || moov->offset < mdat->offset) {
+        return false;
+    }
+    std::ifstream file(a_filepath, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    std::vector<char> record = hevcConfigRecord();
+    std::vector<char> hvcc = {0, 0, 0, char(8 + record.size()), 'h', 'v', 'c', 'C'};
+    hvcc.insert(hvcc.end(), record.begin(), record.end());
+    int64_t delta = int64_t(hvcc.size()) - int64_t(avcc->size);
+    for (Box *box = avcc->getParent(); box != nullptr && box->kind != BoxKind::Root; box = box->getParent()) {
+        uint32_t size = uint32_t(box->size + delta);
+        char *p = bytes.data() + box->offset;
+        p[0] = char(size >> 24); p[1] = char(size >> 16); p[2] = char(size >> 8); p[3] = char(size);
+    }
+    std::memcpy(bytes.data() + avcc->getParent()->offset + 4, "hvc1", 4);
+    bytes.erase(bytes.begin() + avcc->offset, bytes.begin() + avcc->offset + avcc->size);
+    bytes.insert(bytes.begin() + avcc->offset, hvcc.begin(), hvcc.end());
+    std::ofstream out(a_output, std::ios::binary);
+    out.write(bytes.data(), bytes.size());
+    return bool(out);
+}
+
+static void benchHevc(const std::string& a_filepath, int a_iterations) {
+    std::unique_ptr<Root> source = parseQuietly(a_filepath);
+    FileRangeReader reader(a_filepath);
+    const std::string output = "build/bench-hevc.mp4";
+
+    std::cout << "== hevc ==\n";
+    if (!writeHevcCopy(a_filepath, *source, output)) {
+        std::cout << "no avc1 entry before a trailing moov, skipped\n" << std::endl;
+        return;
+    }
+    std::unique_ptr<Root> root;
+    double time = measure(a_iterations, [&]() { root = parseQuietly(output); });
+    const Hvcc *hvcc = nullptr;
+    uint64_t entry_offset = 0;
+    for (const Trak *trak : findTracks(*root)) {
+        const Box *stsd = findTrackBoxes(*trak).stbl->findChild({'s', 't', 's', 'd'});
+        if (stsd != nullptr && !stsd->getChildren().empty() && stsd->getChildren()[0]->kind == BoxKind::Hvc1) {
+            hvcc = static_cast<const Hvcc*>(stsd->getChildren()[0]->findChild({'h', 'v', 'c', 'C'}));
+            entry_offset = stsd->getChildren()[0]->offset;
+        }
+    }
+    if (hvcc == nullptr) {
+        check(false);
+        std::cout << "hvcC NOT FOUND\n" << std::endl;
+        return;
+    }
+    // les ensembles de paramètres sont des vues sur l'enregistrement lu
+    auto inRecord = [&](std::string_view a_nal) {
+        return a_nal.data() >= hvcc->record.data() && a_nal.data() + a_nal.size() <= hvcc->record.data() + hvcc->record.size();
+    };
+    bool views = hvcc->vps.size() == 1 && hvcc->sps.size() == 1 && hvcc->pps.size() == 1
+              && inRecord(hvcc->vps[0]) && inRecord(hvcc->sps[0]) && inRecord(hvcc->pps[0]);
+    std::cout << "parse: " << time << " us, profile " << unsigned(hvcc->general_profile_idc) << ", tier "
+              << unsigned(hvcc->general_tier_flag) << ", level " << unsigned(hvcc->general_level_idc) << ", chroma "
+              << unsigned(hvcc->chroma_format_idc) << ", " << unsigned(hvcc->bit_depth_luma) << "/"
+              << unsigned(hvcc->bit_depth_chroma) << " bits, NAL length " << unsigned(hvcc->nal_length_size) << ", "
+              << (check(views) ? "parameter sets viewed in place" : "PARAMETER SETS WRONG") << '\n';
+
+    // hvc1 et hev1 partagent leur classe mais sont comptés à part dans les statistiques
+    const std::string hev1 = "build/bench-hev1.mp4";
+    {
+        std::ifstream file(output, std::ios::binary);
+        std::string bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        bytes.replace(entry_offset + 4, 4, "hev1");
+        std::ofstream(hev1, std::ios::binary) << bytes;
+    }
+    resetParseStats();
+    parseQuietly(output);
+    parseQuietly(hev1);
+    ParseStats stats = parseStats();
+    resetParseStats();
+    std::remove(hev1.c_str());
+    auto countOf = [&](std::string_view a_type) {
+        auto it = std::find_if(stats.boxes.begin(), stats.boxes.end(), [&](const BoxTypeStats& box) {
+            return std::string_view(box.type.data(), 4) == a_type;
+        });
+        return it != stats.boxes.end() ? it->count : 0;
+    };
+    std::cout << "parse stats: " << countOf("hvc1") << " hvc1, " << countOf("hev1") << " hev1 ("
+              << (check(countOf("hvc1") == 1 && countOf("hev1") == 1) ? "counted apart" : "MERGED") << ")\n";
+
+    // mêmes échantillons : l'extraction Annex B doit donner les mêmes images qu'en AVC
+    FileRangeReader hevc_reader(output);
+    KeyframeSet avc = extractKeyframes(*source, reader, 16);
+    KeyframeSet hevc;
+    time = measure(a_iterations, [&]() { hevc = extractKeyframes(*root, hevc_reader, 16); });
+    bool same = hevc.config.codec == VideoCodec::Hevc && hevc.frames.size() == avc.frames.size();
+    for (size_t i = 0; same && i < hevc.frames.size(); i++) {
+        same = hevc.frames[i].data == avc.frames[i].data;
+    }
+    std::cout << "keyframes: " << time << " us, " << (check(same) ? "Annex B frames match the AVC extraction" : "FRAMES DIFFER")
+              << ", " << hevc.reads << " reads\n";
+    std::cout.setstate(std::ios::badbit);
+    RoundTripReport round_trip = checkRoundTrip(output);
+    std::cout.clear();
+    printRoundTripReport(std::cout, round_trip);
+    check(round_trip.same_bytes && round_trip.same_tree);
+    std::remove(output.c_str());
+    std::cout << std::endl;
+}
+
+static void benchInterleave(const std::string& a_filepath, int a_iterations) {
+    std::unique_ptr<Root> root = parseQuietly(a_filepath);
+    FileRangeReader reader(a_filepath);
+    Fingerprints source = fingerprintTracks(*root, reader);
+
+    std::cout << "== interleaving ==\n";
+    InterleaveReport report;
+    double time = measure(a_iterations, [&]() { report = analyzeInterleaving(*root); });
+    std::cout << "source, analyzed in " << time << " us: ";
+    printInterleaveReport(std::cout, report);
+
+    // mal entrelacé (une piste après l'autre), puis repris à plusieurs durées de chunk
+    const std::string bad = "build/bench-interleave-bad.mp4";
+    const std::string output = "build/bench-interleave.mp4";
+    reinterleave(*root, a_filepath, bad, 1e9);
+    std::unique_ptr<Root> sequential = parseQuietly(bad);
+    std::cout << "one chunk per track: ";
+    printInterleaveReport(std::cout, analyzeInterleaving(*sequential));
+    for (double interleave : {0.5, 2.0}) {
+        MovieWriteStats write;
+        time = measure(a_iterations, [&]() { write = reinterleave(*sequential, bad, output, interleave); });
+        std::unique_ptr<Root> written = parseQuietly(output);
+        FileRangeReader written_reader(output);
+        Fingerprints after = fingerprintTracks(*written, written_reader);
+        bool same = after.tracks.size() == source.tracks.size();
+        for (size_t t = 0; same && t < after.tracks.size(); t++) {
+            same = after.tracks[t].digest == source.tracks[t].digest;
+        }
+        std::cout << interleave << " s chunks: " << time << " us, " << write.copy_runs << " runs, "
+                  << (check(validateSampleTables(*written, fileSize(output)).valid()) ? "valid" : "INVALID") << ", samples "
+                  << (check(same) ? "identical" : "DIFFER") << "; ";
+        printInterleaveReport(std::cout, analyzeInterleaving(*written));
+    }
+    std::remove(bad.c_str());
+    std::remove(output.c_str());
+    std::cout << std::endl;
+}
+
+static void benchAdts(const std::string& a_filepath, int a_iterations) {
+    std::unique_ptr<Root> root = parseQuietly(a_filepath);
+    FileRangeReader reader(a_filepath);
+    const std::string output = "build/bench-adts.aac";
+    const std::string naive_output = "build/bench-adts-naive.aac";
+
+    std::cout << "== adts ==\n";
+    AdtsStats stats;
+    double time = measure(a_iterations, [&]() { stats = demuxAdts(*root, reader, output); });
+    std::vector<SampleInfo> samples;
+    for (const Trak *trak : findTracks(*root)) {
+        TrackBoxes boxes = findTrackBoxes(*trak);
+        if (boxes.tkhd != nullptr && boxes.tkhd->track_ID == stats.track_ID) {
+            samples = flattenSamples(*trak);
+        }
+    }
+
+    // référence : une lecture par trame, entête recalculé et écrit séparément
+    double naive_time = measure(a_iterations, [&]() {
+        int fd = ::open(naive_output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        std::vector<char> frame;
+        for (const SampleInfo& sample : samples) {
+            uint32_t length = sample.size + 7;
+            uint8_t header[7] = {0xFF, 0xF1,
+                                 uint8_t((stats.config.audio_object_type - 1) << 6 | stats.config.sampling_frequency_index << 2
+                                         | stats.config.channel_configuration >> 2),
+                                 uint8_t((stats.config.channel_configuration & 3) << 6 | length >> 11),
+                                 uint8_t(length >> 3), uint8_t(length << 5 | 0x1F), 0xFC};
+            frame.resize(sample.size);
+            reader.read(sample.offset, frame.data(), frame.size());
+            bool ok = ::write(fd, header, 7) == 7 && ::write(fd, frame.data(), frame.size()) == ssize_t(frame.size());
+            (void) ok;
+        }
+        ::close(fd);
+    });
+
+    // chaque trame : syncword, longueur, puis les octets de l'échantillon
+    std::ifstream adts(output, std::ios::binary);
+    std::vector<char> bytes((std::istreambuf_iterator<char>(adts)), std::istreambuf_iterator<char>());
+    std::ifstream naive(naive_output, std::ios::binary);
+    std::vector<char> naive_bytes((std::istreambuf_iterator<char>(naive)), std::istreambuf_iterator<char>());
+    bool same = true;
+    size_t p = 0;
+    std::vector<char> frame;
+    for (const SampleInfo& sample : samples) {
+        const uint8_t *h = reinterpret_cast<const uint8_t*>(bytes.data()) + p;
+        uint32_t length = uint32_t(h[3] & 3) << 11 | uint32_t(h[4]) << 3 | h[5] >> 5;
+        frame.resize(sample.size);
+        reader.read(sample.offset, frame.data(), frame.size());
+        same = same && p + 7 + sample.size <= bytes.size() && h[0] == 0xFF && (h[1] & 0xF0) == 0xF0
+            && length == sample.size + 7 && std::equal(frame.begin(), frame.end(), bytes.begin() + p + 7);
+        if (!same) {
+            break;
+        }
+        p += length;
+    }
+    same = same && p == bytes.size();
+    std::cout << "batched: " << time << " us, per-frame reads and writes: " << naive_time << " us, "
+              << (check(same) ? "frames match" : "FRAMES DIFFER") << ", "
+              << (check(bytes == naive_bytes) ? "identical to the per-frame output" : "DIFFERENT from the per-frame output") << '\n';
+    printAdtsStats(std::cout, stats);
+
+    // signalisation explicite de SBR : cœur AAC LC à 24 kHz, extension à 48 kHz
+    const char sbr[] = {0x2B, 0x11, char(0x88), 0x00};
+    AudioSpecificConfig config = decodeAudioSpecificConfig(sbr, sizeof(sbr));
+    std::cout << "explicit SBR config: object type " << unsigned(config.audio_object_type) << ", "
+              << config.sampling_frequency << " Hz, extension " << unsigned(config.extension_object_type)
+              << (check(config.audio_object_type == 2 && config.sampling_frequency == 24000
+                        && config.extension_object_type == 5) ? " (ok)" : " (WRONG)") << '\n';
+    std::remove(output.c_str());
+    std::remove(naive_output.c_str());
+    std::cout << std::endl;
+}
+
+static void benchStrings(int a_iterations) {
+    const std::string name(4096, 'n');
+    uint32_t size = 8 + 4 + 20 + name.size();
+    std::string box = {char(size >> 24), char(size >> 16), char(size >> 8), char(size),
+                       'h', 'd', 'l', 'r', 0, 0, 0, 0};
+    box += std::string(4, '\0') + "vide" + std::string(12, '\0') + name + "next";
+
+    bool ok = true;
+    double time = measure(a_iterations, [&]() {
+        std::istringstream stream(box);
+        std::unique_ptr<Box> hdlr = parseHeader(stream);
+        static_cast<Hdlr&>(*hdlr).parse(stream);
+        ok = ok && static_cast<Hdlr&>(*hdlr).name == name && (uint64_t) stream.tellg() == size;
+    });
+    std::cout << "== string fields ==\n"
+              << "hdlr with a " << name.size() << "-byte unterminated name: " << time << " us per parse"
+              << (check(ok) ? " (truncated at box end)" : " (MISMATCH)") << '\n'
+              << std::endl;
+}
+
+// Compare le bilan mémoire de l'arbre (`memoryReport`) aux octets réellement
+// alloués pendant l'analyse.
+static void benchMemory(const std::string& a_filepath) {
+    std::cout.setstate(std::ios::badbit);
+    fullParse(a_filepath); // crée les objets statiques du parser avant la mesure
+
+    std::ifstream file(a_filepath, std::ios::binary);
+    Root root;
+    int64_t allocated;
+    {
+        AllocationScope scope;
+        root.parse(file);
+        allocated = scope.allocated();
+    }
+    std::cout.clear();
+
+    MemoryReport report = memoryReport(root);
+    int64_t accounted = report.total.total() - sizeof(Root); // la racine est sur la pile
+    std::cout << "== memory footprint ==\n"
+              << "memoryReport: " << accounted << " bytes (" << report.total.wasted() << " wasted)\n"
+              << "allocator: " << allocated << " bytes"
+              << (check(accounted == allocated) ? " (match)" : " (MISMATCH)") << '\n'
+              << std::endl;
+}
+
+int main(int argc, char *argv[]) {
+    std::string filepath = argc > 1 ? argv[1] : "test/big_buck_bunny_240p_1mb.mp4";
+    int iterations = argc > 2 ? std::atoi(argv[2]) : 200;
+    if (!std::ifstream(filepath)) {
+        std::cerr << "Error opening file for reading.";
+        return 1;
+    }
+
+    benchSelectiveParse(filepath, iterations);
+    benchEventParse(filepath, iterations);
+    benchParseStats(filepath, iterations);
+    benchIndexCache(filepath, iterations);
+    benchDispatch(filepath, iterations);
+    benchDump(filepath, iterations);
+    benchCompactTables(filepath, iterations);
+    benchAnalytics(filepath, iterations);
+    benchSegments(filepath, iterations);
+    benchRangeReader(filepath);
+    benchForwardInput(filepath);
+    benchValidation(filepath, iterations);
+    benchFingerprint(filepath, iterations);
+    benchTrim(filepath, iterations);
+    benchTrimReordered(filepath);
+    benchSplit(filepath, iterations);
+    benchConcat(filepath, iterations);
+    benchSerializer(filepath, iterations);
+    benchMetadata(filepath);
+    benchKeyframes(filepath, iterations);
+    benchHevc(filepath, iterations);
+    benchInterleave(filepath, iterations);
+    benchAdts(filepath, iterations);
+    benchStrings(iterations);
+    benchMemory(filepath);
+    if (s_failures != 0) {
+        std::cerr << s_failures << " checks failed.\n";
+        return 1;
+    }
+    return 0;
+}
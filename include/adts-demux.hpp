@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include <container-parser.hpp>
+#include <range-reader.hpp>
+
+struct AdtsOptions {
+    size_t max_batch = 4 * 1024 * 1024; // octets d'échantillons par lot lu puis écrit
+};
+
+struct AdtsStats {
+    uint32_t track_ID = 0;
+    AudioSpecificConfig config;
+    uint64_t frames        = 0;
+    uint64_t batches       = 0;
+    uint64_t reads         = 0; // lectures envoyées à la source, une par plage d'échantillons contigus
+    uint64_t bytes_read    = 0;
+    uint64_t write_calls   = 0; // appels à pwritev
+    uint64_t bytes_written = 0; // entêtes ADTS compris
+};
+
+// Écrit la première piste AAC (mp4a, esds) en flux ADTS : chaque trame est
+// précédée d'un entête de 7 octets sans CRC, calculé une fois à partir de
+// l'AudioSpecificConfig ; seule la longueur de trame change d'une trame à
+// l'autre. Les échantillons sont parcourus par SampleCursor et groupés en
+// lots : chaque plage contiguë (un chunk en général) est lue en une requête,
+// et le lot est écrit en un pwritev qui alterne entêtes et trames. La lecture
+// du lot suivant se fait pendant l'écriture du lot courant.
+// Lève une exception s'il n'y a pas de piste AAC, si sa configuration n'a pas
+// d'équivalent ADTS (type d'objet au-delà de LTP, fréquence explicite,
+// disposition par PCE), si une trame dépasse 8191 octets ou en cas d'erreur
+// d'entrée-sortie.
+//     @root: la racine de l'arbre, tables d'échantillons conservées
+//     @reader: la source des échantillons
+//     @output: chemin du fichier .aac créé
+//     @options: taille des lots
+//     @return: le bilan de l'écriture
+AdtsStats demuxAdts(const Root& a_root, RangeReader& a_reader, const std::string& a_output,
+                    const AdtsOptions& a_options = AdtsOptions());
+
+// Affiche le bilan de l'écriture.
+//     @outstream: flux d'affichage
+//     @stats: le bilan affiché
+void printAdtsStats(std::ostream& a_outstream, const AdtsStats& a_stats);
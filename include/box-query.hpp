@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Élément d'un chemin dans l'arbre : type de la boîte et rang parmi les
+// boîtes sœurs de même type (0 pour la première).
+struct PathSegment {
+    std::array<char, 4> type;
+    uint32_t index;
+};
+
+// Ensemble de chemins de boîtes à analyser, par exemple `moov/trak/mdia/mdhd`.
+// Chaque élément d'un chemin est :
+//     - un type de boîte (complété par des espaces s'il fait moins de 4 caractères, `url` -> `url `),
+//     - `*` pour n'importe quel type,
+//     - un type suivi d'un rang entre crochets pour une seule occurrence, `trak[1]` pour la deuxième piste.
+// Sans rang, toutes les occurrences d'un type correspondent.
+class BoxQuery {
+public:
+    // Niveau de correspondance d'une boîte avec la requête
+    enum class Match {
+        None,     // boîte ignorée : sautée grâce à sa taille
+        Ancestor, // ancêtre d'une boîte demandée : analysée, ses enfants sont filtrés
+        Selected, // boîte demandée : analysée avec tous ses descendants
+    };
+
+    BoxQuery() = default;
+    explicit BoxQuery(const std::vector<std::string>& a_paths);
+
+    // Ajoute un chemin à la requête. Lève une exception si le chemin est mal formé.
+    //     @path: le chemin, éléments séparés par '/'
+    void addPath(const std::string& a_path);
+
+    // Compare le chemin d'une boîte aux chemins de la requête.
+    //     @path: le chemin de la boîte depuis la racine (racine exclue)
+    //     @return: le niveau de correspondance le plus fort
+    Match match(const std::vector<PathSegment>& a_path) const;
+
+    bool empty() const { return m_paths.empty(); }
+
+private:
+    static constexpr uint32_t ANY_INDEX = UINT32_MAX;
+
+    struct Pattern {
+        std::array<char, 4> type;
+        bool     any_type;
+        uint32_t index; // ANY_INDEX si toutes les occurrences correspondent
+    };
+
+    std::vector<std::vector<Pattern>> m_paths;
+};
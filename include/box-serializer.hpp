@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <container-parser.hpp>
+
+struct SerializeStats {
+    uint64_t boxes        = 0;
+    uint64_t bytes        = 0; // taille du fichier écrit
+    uint64_t source_bytes = 0; // contenus non décodés recopiés de la source (mdat, avcC...)
+    uint64_t segments     = 0; // morceaux écrits : entêtes, tables, plages de la source
+    uint64_t write_calls  = 0; // appels pwritev
+    uint64_t copy_calls   = 0; // appels de copie depuis la source
+};
+
+// Réécrit un arbre de boîtes. Les tailles sont calculées d'abord, des
+// feuilles vers la racine, avec les choix d'encodage qui en dépendent :
+// largesize (entête de 16 octets) pour une boîte de plus de 4 Gio ou lue
+// ainsi, version 1 de mvhd, tkhd, mdhd et elst si une date ou une durée
+// dépasse 32 bits ou si la boîte était déjà en version 1. L'arbre est ensuite
+// encodé : entêtes et champs dans un tampon commun, tables d'échantillons en
+// gros-boutiste par blocs, chacune dans son tampon ; le tout est écrit par
+// pwritev, sans recopie des tables, et les contenus que l'analyse ne décode
+// pas (mdat, free, avcC, mp4a, ilst non modifié) sont recopiés du fichier source.
+// Les champs réservés sont écrits à zéro et les compteurs d'entrées sont ceux
+// des tables en mémoire : un arbre modifié s'écrit sans autre mise à jour.
+// Lève une exception si une table n'a pas été conservée par l'analyse ou en
+// cas d'erreur d'entrée-sortie.
+//     @root: la racine de l'arbre ; seuls ses enfants sont écrits
+//     @source: descripteur du fichier analysé, -1 si aucun contenu n'y est lu
+//     @output: descripteur du fichier écrit, à partir de la position 0
+//     @return: le bilan de l'écriture
+SerializeStats serializeTree(const Box& a_root, int a_source, int a_output);
+
+// Écrit l'arbre dans un nouveau fichier (cf serializeTree) : l'écriture se fait
+// dans un fichier temporaire du même répertoire, renommé à la fin ; la sortie
+// n'est jamais tronquée avant d'être complète, et jamais si c'est la source.
+// Lève une exception si la sortie est le fichier source ou en cas d'erreur
+// d'entrée-sortie.
+//     @root: la racine de l'arbre ; seuls ses enfants sont écrits
+//     @source: chemin du fichier analysé
+//     @output: chemin du fichier écrit
+//     @return: le bilan de l'écriture
+SerializeStats serializeTreeToFile(const Box& a_root, const std::string& a_source, const std::string& a_output);
+
+// Taille qu'aurait le fichier écrit par `serializeTree`, sans rien écrire.
+uint64_t serializedSize(const Box& a_root, int a_source);
+
+// Écrit l'arbre en mémoire (cf serializeTree).
+std::vector<char> serializeToMemory(const Box& a_root, int a_source);
+
+// Écrit une seule boîte et ses descendants en mémoire, entête compris (cf serializeTree).
+std::vector<char> serializeBox(const Box& a_box, int a_source);
+
+struct RoundTripReport {
+    uint64_t source_size    = 0;
+    uint64_t written_size   = 0;
+    uint64_t boxes          = 0;
+    bool     same_bytes     = false;
+    uint64_t first_mismatch = 0; // position du premier octet différent
+    bool     same_tree      = false; // même contenu décodé (dumpTree) après une seconde analyse
+};
+
+// Vérifie qu'un fichier analysé puis réécrit donne les mêmes octets, et que
+// l'analyse de la copie donne le même arbre.
+// Lève une exception en cas d'erreur d'entrée-sortie ou d'analyse.
+//     @path: le fichier vérifié
+//     @return: le bilan de la comparaison
+RoundTripReport checkRoundTrip(const std::string& a_path);
+
+// Affiche le bilan de la vérification.
+//     @outstream: flux d'affichage
+//     @report: le bilan affiché
+void printRoundTripReport(std::ostream& a_outstream, const RoundTripReport& a_report);
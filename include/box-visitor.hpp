@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include <container-parser.hpp>
+
+// Décision renvoyée par les fonctions de rappel d'un visiteur.
+enum class VisitAction {
+    Continue,    // poursuit l'analyse
+    SkipSubtree, // saute la fin de la boîte courante et ses descendants
+    Stop,        // interrompt toute l'analyse
+};
+
+// Interface « à la SAX » : les fonctions sont appelées directement depuis la
+// boucle d'analyse (`parseBox`), sans construire l'arbre. Une boîte n'est
+// conservée que si `adopt` en prend possession ; sinon elle est détruite dès
+// la fin de son analyse, la mémoire utilisée ne dépend donc pas de la taille
+// du fichier.
+//
+// Les tables d'échantillons (stts, ctts, stss, stsc, stsz, stco) sont transmises par
+// lots : si `keepsTables` est faux, les vecteurs de ces boîtes restent vides.
+class BoxVisitor {
+public:
+    virtual ~BoxVisitor() = default;
+
+    // Vrai si les entrées des tables d'échantillons doivent être stockées dans les boîtes.
+    virtual bool keepsTables() const { return false; }
+
+    // Appelée après la lecture de l'entête, avant l'analyse du contenu.
+    //     @box: la boîte dont seul l'entête est renseigné
+    //     @depth: profondeur de la boîte, 1 pour les boîtes de premier niveau
+    virtual VisitAction enterBox(Box& /*box*/, size_t /*depth*/) { return VisitAction::Continue; }
+    // Appelée après l'analyse de la boîte et de tous ses descendants.
+    virtual VisitAction leaveBox(Box& /*box*/, size_t /*depth*/) { return VisitAction::Continue; }
+    // Propose la boîte analysée au visiteur, qui peut en prendre possession.
+    //     @parent: la boîte parente
+    //     @box: la boîte analysée, vide en sortie si le visiteur la conserve
+    virtual void adopt(Box& /*parent*/, std::unique_ptr<Box>& /*box*/) {}
+
+    // Boîtes feuilles décodées, appelées entre `enterBox` et `leaveBox`.
+    virtual VisitAction onFtyp(const Ftyp& /*box*/) { return VisitAction::Continue; }
+    virtual VisitAction onMdat(const Mdat& /*box*/) { return VisitAction::Continue; }
+    virtual VisitAction onPdin(const Pdin& /*box*/) { return VisitAction::Continue; }
+    virtual VisitAction onMvhd(const Mvhd& /*box*/) { return VisitAction::Continue; }
+    virtual VisitAction onTkhd(const Tkhd& /*box*/) { return VisitAction::Continue; }
+    virtual VisitAction onElst(const Elst& /*box*/) { return VisitAction::Continue; }
+    virtual VisitAction onMdhd(const Mdhd& /*box*/) { return VisitAction::Continue; }
+    virtual VisitAction onHdlr(const Hdlr& /*box*/) { return VisitAction::Continue; }
+    virtual VisitAction onVmhd(const Vmhd& /*box*/) { return VisitAction::Continue; }
+    virtual VisitAction onSmhd(const Smhd& /*box*/) { return VisitAction::Continue; }
+    virtual VisitAction onUrl (const Url&  /*box*/) { return VisitAction::Continue; }
+    virtual VisitAction onUrn (const Urn&  /*box*/) { return VisitAction::Continue; }
+    virtual VisitAction onBtrt(const Btrt& /*box*/) { return VisitAction::Continue; }
+    virtual VisitAction onVisualSampleEntry(const VisualSampleEntry& /*box*/) { return VisitAction::Continue; }
+    virtual VisitAction onHvcc(const Hvcc& /*box*/) { return VisitAction::Continue; }
+    virtual VisitAction onAudioSampleEntry(const AudioSampleEntry& /*box*/) { return VisitAction::Continue; }
+    virtual VisitAction onEsds(const Esds& /*box*/) { return VisitAction::Continue; }
+
+    // Lots d'entrées des tables d'échantillons, dans l'ordre du fichier.
+    // Les pointeurs ne sont valides que pendant l'appel.
+    virtual VisitAction onSttsEntries(const Stts& /*box*/, const uint32_t * /*sample_count*/,
+                                      const uint32_t * /*sample_delta*/, size_t /*count*/) {
+        return VisitAction::Continue;
+    }
+    virtual VisitAction onCttsEntries(const Ctts& /*box*/, const uint32_t * /*sample_count*/,
+                                      const uint32_t * /*sample_offset*/, size_t /*count*/) {
+        return VisitAction::Continue;
+    }
+    virtual VisitAction onStssEntries(const Stss& /*box*/, const uint32_t * /*sample_number*/, size_t /*count*/) {
+        return VisitAction::Continue;
+    }
+    virtual VisitAction onStscEntries(const Stsc& /*box*/, const uint32_t * /*first_chunk*/,
+                                      const uint32_t * /*samples_per_chunk*/,
+                                      const uint32_t * /*samples_description_index*/, size_t /*count*/) {
+        return VisitAction::Continue;
+    }
+    virtual VisitAction onStszEntries(const Stsz& /*box*/, const uint32_t * /*entry_size*/, size_t /*count*/) {
+        return VisitAction::Continue;
+    }
+    virtual VisitAction onStcoEntries(const Stco& /*box*/, const uint32_t * /*chunk_offset*/, size_t /*count*/) {
+        return VisitAction::Continue;
+    }
+};
+
+// Visiteur par défaut de l'analyse : construit l'arbre des boîtes en
+// rattachant chaque boîte à son parent et conserve les tables.
+class TreeBuilder : public BoxVisitor {
+public:
+    bool keepsTables() const override { return true; }
+    void adopt(Box& a_parent, std::unique_ptr<Box>& a_box) override { a_parent.addChild(a_box); }
+};
+
+// Analyse le fichier en transmettant les évènements au visiteur. L'arbre n'est
+// construit que si le visiteur conserve les boîtes (cf `TreeBuilder`).
+//     @file: le bitstream du fichier analysé, positionné au début
+//     @root: la racine à laquelle sont rattachées les boîtes conservées
+//     @visitor: le destinataire des évènements
+//     @context: contexte d'analyse ; une requête éventuelle (`query`) filtre les boîtes
+void parseEvents(std::istream& a_file, Root& a_root, BoxVisitor& a_visitor, ParseContext& a_context);
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sys/uio.h>
+
+// Tampon d'écriture de boîtes : entiers gros-boutistes et tailles des boîtes
+// complétées à leur fermeture, une fois leur contenu écrit.
+class BoxBuffer {
+public:
+    void u8(uint8_t a_x)   { m_data.push_back(char(a_x)); }
+    void u16(uint16_t a_x) { put(a_x, 2); }
+    void u32(uint32_t a_x) { put(a_x, 4); }
+    void u64(uint64_t a_x) { put(a_x, 8); }
+    void bytes(const void *a_data, size_t a_size);
+
+    // Ouvre une boîte : écrit une taille provisoire et le type.
+    //     @type: le type de la boîte
+    //     @return: la position de la boîte, à passer à `end`
+    size_t begin(std::array<char, 4> a_type);
+    // Ouvre une boîte complète (FullBox) : entête, version et drapeaux.
+    size_t beginFull(std::array<char, 4> a_type, uint8_t a_version, uint32_t a_flags = 0);
+    // Ferme une boîte : écrit sa taille, sur 32 bits.
+    //     @position: la position renvoyée par `begin`
+    void end(size_t a_position);
+
+    // Réécrit un entier déjà écrit.
+    //     @position: position du premier octet
+    //     @x: la valeur
+    //     @length: nombre d'octets
+    void patch(size_t a_position, uint64_t a_x, size_t a_length);
+
+    const char *data() const { return m_data.data(); }
+    size_t      size() const { return m_data.size(); }
+
+private:
+    void put(uint64_t a_x, size_t a_length);
+
+    std::vector<char> m_data;
+};
+
+// Descripteur de fichier fermé à la destruction, y compris en cas d'exception.
+// Déplaçable, non copiable.
+class FileDescriptor {
+public:
+    FileDescriptor() = default;
+    explicit FileDescriptor(int a_fd) : m_fd(a_fd) {}
+    FileDescriptor(FileDescriptor&& a_other) : m_fd(a_other.release()) {}
+    FileDescriptor& operator=(FileDescriptor&& a_other);
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+    ~FileDescriptor() { reset(); }
+
+    int  get() const   { return m_fd; }
+    bool valid() const { return m_fd >= 0; }
+    // Rend le descripteur sans le fermer.
+    int  release();
+    // Ferme le descripteur courant et prend le nouveau.
+    void reset(int a_fd = -1);
+    // Ferme le descripteur en signalant l'échec, que le destructeur ignore.
+    //     @return: faux si close a échoué
+    bool close();
+
+private:
+    int m_fd = -1;
+};
+
+// Lit un nombre exact d'octets à une position d'un fichier.
+// Lève une exception si le fichier est trop court.
+//     @fd: le fichier
+//     @data: le tampon rempli
+//     @size: nombre d'octets lus
+//     @offset: la position de lecture
+void readAll(int a_fd, char *a_data, size_t a_size, uint64_t a_offset);
+
+// Écrit tout un tampon à une position d'un fichier.
+//     @fd: le fichier
+//     @data: les octets
+//     @size: leur nombre
+//     @offset: la position d'écriture
+void writeAll(int a_fd, const char *a_data, size_t a_size, uint64_t a_offset);
+
+// Écrit des vecteurs bout à bout à une position d'un fichier par pwritev,
+// IOV_MAX à la fois ; les écritures partielles sont reprises (les vecteurs
+// sont modifiés en conséquence).
+//     @fd: le fichier
+//     @vectors: les vecteurs écrits
+//     @offset: la position d'écriture du premier vecteur
+//     @return: le nombre d'appels à pwritev
+uint64_t writevAll(int a_fd, std::vector<struct iovec>& a_vectors, uint64_t a_offset);
+
+// Copie une plage d'octets d'un fichier à un autre par copy_file_range, sans
+// passer par l'espace utilisateur (partage des blocs sur les systèmes de
+// fichiers qui le permettent) ; à défaut (systèmes de fichiers différents,
+// noyau ancien), par un tampon. Lève une exception si la source est trop courte.
+//     @in: le fichier source
+//     @in_offset: position dans la source
+//     @out: le fichier destination
+//     @out_offset: position dans la destination
+//     @size: nombre d'octets copiés
+//     @return: le nombre d'appels système de copie
+uint64_t copyFileRange(int a_in, uint64_t a_in_offset, int a_out, uint64_t a_out_offset, uint64_t a_size);
+
+// Vrai si un chemin désigne un fichier déjà ouvert.
+//     @fd: le fichier ouvert
+//     @path: le chemin comparé
+bool sameFile(int a_fd, const std::string& a_path);
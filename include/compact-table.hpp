@@ -0,0 +1,180 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <container-parser.hpp>
+#include <sample-table.hpp>
+
+// Tableau d'entiers compressé par blocs (« frame of reference ») : chaque bloc
+// de BLOCK valeurs stocke son minimum et les écarts à ce minimum sur un
+// nombre de bits fixe, le plus petit qui les contienne tous. L'accès à une
+// valeur ne dépend que de son bloc ; le décodage d'un bloc entier est une
+// boucle sans branche sur des mots de 64 bits, vectorisable par le compilateur.
+class PackedArray {
+public:
+    static constexpr size_t BLOCK = 128;
+
+    PackedArray() = default;
+    // @values: les valeurs compressées
+    // @count: le nombre de valeurs
+    PackedArray(const uint32_t *a_values, size_t a_count);
+    PackedArray(const uint64_t *a_values, size_t a_count);
+
+    size_t size() const { return m_size; }
+
+    // Valeur d'indice `index`, qui doit être inférieur à `size()`.
+    uint64_t get(size_t a_index) const {
+        const Block& block = m_blocks[a_index / BLOCK];
+        if (block.width == 0) {
+            return block.base;
+        }
+        uint64_t bit = (a_index % BLOCK) * block.width;
+        return block.base + (extract(m_words.data() + block.word + bit / 64, bit % 64) & mask(block.width));
+    }
+
+    // Décode `count` valeurs consécutives à partir de `first`.
+    //     @first: indice de la première valeur
+    //     @count: nombre de valeurs décodées
+    //     @out: destination, de `count` éléments
+    void decode(size_t a_first, size_t a_count, uint32_t *a_out) const;
+    void decode(size_t a_first, size_t a_count, uint64_t *a_out) const;
+
+    // Somme de `count` valeurs consécutives à partir de `first`.
+    uint64_t sum(size_t a_first, size_t a_count) const;
+
+    // Somme de `count` <= N valeurs consécutives à partir de `first`, toutes
+    // dans le bloc de `first` : N lectures sans branche quel que soit
+    // `count`, dont la valeur imprévisible ferait sinon mal prédire la fin
+    // de boucle à chaque appel.
+    template<unsigned N>
+    uint64_t sumFew(size_t a_first, size_t a_count) const {
+        const Block& block = m_blocks[a_first / BLOCK];
+        uint64_t total = a_count * block.base;
+        if (block.width == 0) {
+            return total;
+        }
+        const uint64_t *words = m_words.data() + block.word;
+        const uint64_t  value_mask = mask(block.width);
+        size_t from = a_first % BLOCK;
+        for (unsigned i = 0; i < N; i++) {
+            // au-delà de `count`, relit la première valeur, qui existe, et
+            // l'ignore ; masques plutôt que conditions, que le compilateur
+            // rétablirait en branches
+            uint64_t used  = uint64_t(0) - (i < a_count);
+            uint64_t bit   = (from + (i & used)) * block.width;
+            uint64_t value = extract(words + bit / 64, bit % 64) & value_mask;
+            total += value & used;
+        }
+        return total;
+    }
+
+    // Mémoire occupée par le tableau, objet compris.
+    size_t memoryBytes() const;
+
+private:
+    struct Block {
+        uint64_t base;  // minimum des valeurs du bloc
+        uint32_t word;  // indice du premier mot du bloc dans `m_words`
+        uint8_t  width; // nombre de bits par écart, 0 si toutes les valeurs sont égales
+    };
+
+    static uint64_t mask(unsigned a_width) {
+        return a_width >= 64 ? ~uint64_t(0) : (uint64_t(1) << a_width) - 1;
+    }
+    // Bits de `word[0]` à partir de `shift`, complétés par ceux de `word[1]`
+    // (qui existe toujours, cf `m_words`), sans branche : le double décalage
+    // de `word[1]` vaut 0 quand `shift` est nul.
+    static uint64_t extract(const uint64_t *a_word, unsigned a_shift) {
+        return (a_word[0] >> a_shift) | ((a_word[1] << 1) << (63 - a_shift));
+    }
+
+    template<typename T>
+    void assign(const T *a_values, size_t a_count);
+    template<typename T>
+    void decodeBlock(size_t a_block, size_t a_from, size_t a_to, T *a_out) const;
+
+    std::vector<Block>    m_blocks;
+    std::vector<uint64_t> m_words;  // suivis d'un mot nul, lu par `extract` après le dernier
+    size_t                m_size = 0;
+};
+
+// Représentation compacte des tables d'échantillons d'une piste, avec accès
+// direct à chaque échantillon sans aplatir les tables (cf `flattenSamples`) :
+//     - stsz : une seule valeur si la taille est constante, sinon tailles
+//       compressées par blocs, avec leur somme préfixe tous les ANCHOR
+//       échantillons (ancres, compressées par blocs) ;
+//     - stts, stsc : plages conservées telles quelles, avec les sommes
+//       préfixes (premier échantillon, premier instant) de chaque plage ;
+//     - stco : positions des chunks compressées par blocs, diminuées de la
+//       somme préfixe des tailles au premier échantillon de chaque chunk ;
+//     - stss : valeurs croissantes compressées par blocs.
+// Les plages donnent l'instant et le chunk d'un échantillon ; sa position est
+// celle (diminuée) de son chunk plus la somme préfixe des tailles qui le
+// précèdent, soit l'ancre la plus proche et au plus ANCHOR / 2 tailles d'un
+// même bloc, quelle que soit la taille des chunks.
+class CompactSampleTable {
+public:
+    // diviseur pair de PackedArray::BLOCK : les tailles sommées depuis une
+    // ancre sont dans un seul bloc
+    static constexpr uint32_t ANCHOR = 8;
+    static_assert(PackedArray::BLOCK % ANCHOR == 0 && ANCHOR % 2 == 0, "ANCHOR must be an even divisor of BLOCK.");
+
+    // Construit la table à partir des boîtes de la piste. Lève une exception
+    // si les tables sont absentes ou incohérentes.
+    //     @trak: la boîte `trak` analysée
+    explicit CompactSampleTable(const Trak& a_trak);
+
+    uint32_t sampleCount() const { return m_sample_count; }
+
+    uint32_t sampleSize(uint32_t a_index) const {
+        return m_constant_size != 0 ? m_constant_size : (uint32_t) m_sizes.get(a_index);
+    }
+    uint64_t sampleDts(uint32_t a_index) const;
+    uint64_t sampleOffset(uint32_t a_index) const;
+    bool     isSync(uint32_t a_index) const;
+
+    // Description complète d'un échantillon, identique à l'élément
+    // correspondant de `flattenSamples`.
+    SampleInfo sample(uint32_t a_index) const;
+
+    // Décode les tailles de `count` échantillons consécutifs.
+    //     @first: indice du premier échantillon
+    //     @count: nombre d'échantillons
+    //     @out: destination, de `count` éléments
+    void decodeSizes(uint32_t a_first, uint32_t a_count, uint32_t *a_out) const;
+
+    // Mémoire occupée par la table, objet compris.
+    size_t memoryBytes() const;
+
+private:
+    // Plage de `stts` : `sample_delta` constant à partir de `first_sample`
+    struct TimeRun {
+        uint32_t first_sample;
+        uint32_t delta;
+        uint64_t first_dts;
+    };
+    // Plage de `stsc` : `samples_per_chunk` constant à partir de `first_chunk`
+    struct ChunkRun {
+        uint32_t first_sample;
+        uint32_t first_chunk;      // à partir de 0
+        uint64_t reciprocal;       // 2^64 / samples_per_chunk arrondi au-dessus, 0 si samples_per_chunk vaut 1
+    };
+
+    // Chunk de l'échantillon `index`.
+    uint32_t chunkOf(uint32_t a_index) const;
+    // Somme des tailles des échantillons qui précèdent `index`.
+    uint64_t sizePrefix(uint32_t a_index) const;
+
+    uint32_t              m_sample_count = 0;
+    uint32_t              m_constant_size = 0; // taille commune, 0 si les tailles varient
+    PackedArray           m_sizes;
+    PackedArray           m_size_anchors;      // somme des tailles des `ANCHOR * i` premiers échantillons, puis de tous
+    std::vector<TimeRun>  m_time_runs;         // triées par `first_sample`
+    std::vector<ChunkRun> m_chunk_runs;        // triées par `first_sample`
+    PackedArray           m_anchor_runs;       // plage de `stsc` de l'échantillon `ANCHOR * i`, vide s'il n'y en a qu'une
+    PackedArray           m_chunk_bases;       // position de chaque chunk moins `sizePrefix` de son premier échantillon
+    PackedArray           m_sync_samples;      // numéros (à partir de 1), vide si tous sont des points d'accès
+    bool                  m_all_sync = true;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <container-parser.hpp>
+#include <movie-writer.hpp>
+
+struct ConcatTrack {
+    uint32_t track_ID     = 0;
+    uint32_t handler_type = 0;
+    uint32_t sample_count = 0;
+    uint64_t duration     = 0; // échelle de temps du média
+};
+
+struct ConcatResult {
+    size_t inputs = 0;
+    std::vector<ConcatTrack> tracks;
+    MovieWriteStats write;
+};
+
+// Met bout à bout des fichiers mp4 sans réencodage. Les fichiers doivent avoir
+// les mêmes pistes, dans le même ordre, avec des descriptions d'échantillons
+// (boîtes stsd : avc1/avcC, mp4a/esds...) identiques octet pour octet et les
+// mêmes échelles de temps. Les tables (stts, stsz, stsc, stss) sont fusionnées,
+// les positions des chunks recalculées pour le `mdat` unique du fichier écrit
+// et les données de chaque entrée copiées par copy_file_range : la mémoire
+// utilisée dépend du nombre d'échantillons, pas de la taille des fichiers.
+// Les boîtes autres que les tables sont reprises du premier fichier ; la
+// liste d'éditions garde son décalage initial et couvre toute la durée.
+// Lève une exception si les entrées sont incompatibles ou en cas d'erreur
+// d'entrée-sortie.
+//     @roots: les arbres des fichiers d'entrée, tables d'échantillons conservées
+//     @paths: les chemins de ces fichiers, dans le même ordre
+//     @output: chemin du fichier créé
+//     @return: les pistes fusionnées et le bilan d'écriture
+ConcatResult concatFiles(const std::vector<const Root*>& a_roots, const std::vector<std::string>& a_paths,
+                         const std::string& a_output);
+
+// Affiche les pistes fusionnées et le bilan des copies.
+//     @outstream: flux d'affichage
+//     @result: le résultat affiché
+void printConcatResult(std::ostream& a_outstream, const ConcatResult& a_result);
@@ -1,18 +1,79 @@
+#pragma once
+
 #include <cstdint>
 #include <streambuf>
 #include <string>
+#include <string_view>
 #include <sys/types.h>
 #include <vector>
 #include <array>
 #include <memory> // for unique pointers (C++11)
 #include <fstream>
 #include <iostream>
-
+#include <stdexcept>
+
+#include <box-query.hpp>
+#include <text-dump.hpp>
+
+class BoxVisitor;
+
+
+// Type concret d'une boîte. L'ensemble des classes instanciables est fermé :
+// `visitBox` s'en sert pour appeler directement les méthodes de la classe
+// concrète, sans passer par la table virtuelle.
+enum class BoxKind : uint8_t {
+    Unknown,
+    Root,
+    Ftyp,
+    Mdat,
+    Free,
+    Pdin,
+    Moov,
+    Mvhd,
+    Trak,
+    Tkhd,
+    Edts,
+    Elst,
+    Mdia,
+    Mdhd,
+    Hdlr,
+    Minf,
+    Vmhd,
+    Dinf,
+    Url,
+    Urn,
+    Dref,
+    Stbl,
+    Btrt,
+    Stsd,
+    Meta,
+    Frma,
+    Cinf,
+    Avcc,
+    Icpv,
+    Hvcc,
+    Hvc1,
+    Stts,
+    Ctts,
+    Stss,
+    Stsc,
+    Stsz,
+    Stco,
+    Smhd,
+    Enca,
+    Mp4a,
+    Esds,
+    Udta,
+    Ilst,
+};
 
 class Box {
 public:
     std::array<char, 4>  type = {'u', 'n', 'k', 'n'};
     uint64_t size = 0; // Choix de renseigner une taille unique sur 8 octets (pas de largesize)
+    uint64_t offset = 0; // position du début de la boîte (entête compris) dans le bitstream
+    uint8_t  header_size = 8; // taille de l'entête : 8 octets, 16 avec largesize
+    BoxKind  kind = BoxKind::Unknown; // classe concrète, renseignée par son constructeur
     
     Box(const Box&) = delete;                // no copy
     Box& operator=(const Box&) = delete;
@@ -32,14 +93,25 @@ public:
     
     const std::vector<std::unique_ptr<Box>>& getChildren() const { return m_children; }
     void addChild(std::unique_ptr<Box>& a_pChild)    { m_children.push_back(std::move(a_pChild)); }
+    
+    // Cherche le premier enfant direct du type donné.
+    //     @type: le type recherché
+    //     @return: un pointeur vers l'enfant, nullptr s'il n'existe pas
+    Box *findChild(std::array<char, 4> a_type) const;
 
     // Parse la boite
-    virtual void parse(std::ifstream& a_file) = 0;
+    virtual void parse(std::istream& a_file) = 0;
     
-    // Affiche les informations de la boite
+    // Affiche les informations de la boite, selon sa classe concrète
     //     @outstream: flux d'affichage
     void print(std::ostream& a_outstream);
 
+    // Écrit les informations de la boite. Chaque classe masque cette méthode
+    // pour compléter le texte de sa classe de base ; `print` appelle celle de
+    // la classe concrète.
+    //     @writer: tampon d'écriture
+    void dump(DumpWriter& a_writer) const;
+
 protected:
     uint8_t m_parse_offset = 0; // offset à appliquer pour le parsing, après tous les entêtes des classes héritées
     Box*    m_parent = nullptr; // pointeur vers la boîte parente
@@ -70,14 +142,40 @@ public:
         flags[2] = a_flags[2];
     }
 
-    void print(std::ostream& a_outstream);
-    virtual void parse(std::ifstream& a_file) override;
+    void dump(DumpWriter& a_writer) const;
+    virtual void parse(std::istream& a_file) override;
+};
+
+// Chaînes terminées par '\0' d'une boîte (hdlr, url, urn). La fin de la boîte
+// est lue en une seule fois dans un tampon propre à la boîte ; les champs sont
+// des vues sur ce tampon, valides tant que la boîte existe (déplacement
+// compris). Une copie (`std::string(vue)`) n'est faite que par l'appelant qui
+// en a besoin.
+class BoxStrings {
+public:
+    // Lit la fin de la boîte.
+    //     @file: le bitstream, positionné après les champs fixes
+    //     @size: nombre d'octets restant dans la boîte
+    void read(std::istream& a_file, uint64_t a_size);
+
+    // Chaîne suivante, cherchée par memchr dans les bornes de la boîte et
+    // tronquée à sa fin si le '\0' manque. Vide une fois le tampon épuisé.
+    std::string_view next();
+
+    size_t size() const { return m_size; } // taille du tampon
+    const char *data() const { return m_data.get(); } // octets lus, '\0' compris
+
+private:
+    std::unique_ptr<char[]> m_data;
+    size_t m_size = 0;
+    size_t m_position = 0; // début de la prochaine chaîne
 };
 
 // Boite racine, sans informations particulières
 class Root final : public Box {
 public:
     Root() {
+        kind = BoxKind::Root;
         type = {'r', 'o', 'o', 't'};
     }
     
@@ -85,7 +183,7 @@ public:
 
     // Parse tout le fichier
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 }; 
 
 class Ftyp final : public Box {
@@ -95,15 +193,16 @@ public:
     std::vector<std::array<char, 4>> compatible_brands;
 
     Ftyp() {
+        kind = BoxKind::Ftyp;
         type = {'f', 't', 'y', 'p'};
     }
     
     void setParent(Box *a_parent) override final;
-    void print(std::ostream& a_outstream);
+    void dump(DumpWriter& a_writer) const;
     
     // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 class Mdat final : public Box {
@@ -111,29 +210,31 @@ public:
     uint64_t beg_data; // index de début des données images/audio dans le bitstream
 
     Mdat() {
+        kind = BoxKind::Mdat;
         type = {'m', 'd', 'a', 't'};
     }
     
     void setParent(Box *pParent) override final;
-    void print(std::ostream& a_outstream);
+    void dump(DumpWriter& a_writer) const;
     
     // Parse la boîte : avance le bitstream jusqu'à la prochaine boîte et stocke
     // le début des données. La fin de la boîte est connue grâce à sa taille.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 // Boite pour l'alignement (padding)
 class Free final : public Box {
 public:
     Free() {
+        kind = BoxKind::Free;
         type = {'f', 'r', 'e', 'e'};
     }
     
     void setParent(Box *pParent) override final;
     
     // Saute la boîte entièrement
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 class Pdin final : public FullBox {
@@ -142,20 +243,22 @@ public:
     std::vector<uint32_t> initial_delay;
 
     Pdin() {
+        kind = BoxKind::Pdin;
         type = {'p', 'd', 'i', 'n'};
     }
     
     void setParent(Box *pParent) override final;
-    void print(std::ostream& a_outstream);
+    void dump(DumpWriter& a_writer) const;
     
     // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream &a_file) override final;
+    void parse(std::istream &a_file) override final;
 };
 
 class Moov final : public Box {
 public:
     Moov() {
+        kind = BoxKind::Moov;
         type = {'m', 'o', 'o', 'v'};
     }
     
@@ -163,13 +266,14 @@ public:
     
     // Avance le bitstream jusqu'à la prochaine boite de même niveau en parsant toutes les boîtes contenues.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 // Moov header
 class Mvhd final : public FullBox {
 public:
     Mvhd() {
+        kind = BoxKind::Mvhd;
         type = {'m', 'v', 'h', 'd'};
         flags = {0, 0, 0};
     }
@@ -185,16 +289,17 @@ public:
     uint32_t next_track_ID;
 
     void setParent(Box *pParent) override final;
-    void print(std::ostream& a_outstream);
+    void dump(DumpWriter& a_writer) const;
     
     // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 class Trak final : public Box {
 public:
     Trak() {
+        kind = BoxKind::Trak;
         type = {'t', 'r', 'a', 'k'};
     }
     
@@ -202,13 +307,14 @@ public:
     
     // Avance le bitstream jusqu'à la prochaine boite de même niveau en parsant toutes les boîtes contenues.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 // Trak header
 class Tkhd final : public FullBox {
 public:
     Tkhd() {
+        kind = BoxKind::Tkhd;
         type = {'t', 'k', 'h', 'd'};
     }
     
@@ -225,16 +331,17 @@ public:
     uint32_t height;
 
     void setParent(Box *pParent) override final;
-    void print(std::ostream& a_outfile);
+    void dump(DumpWriter& a_writer) const;
 
     // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 class Edts final : public Box {
 public:
     Edts() {
+        kind = BoxKind::Edts;
         type = {'e', 'd', 't', 's'};
     }
     
@@ -242,13 +349,14 @@ public:
 
     // Avance le bitstream jusqu'à la prochaine boite de même niveau en parsant toutes les boîtes contenues.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 // Timeline map
 class Elst final : public FullBox {
 public:
     Elst() {
+        kind = BoxKind::Elst;
         type = {'e', 'l', 's', 't'};
     }
 
@@ -259,17 +367,18 @@ public:
     std::vector<int16_t> media_rate_fraction;
     
     void setParent(Box *pParent) override final;
-    void print(std::ostream& a_outstream);
+    void dump(DumpWriter& a_writer) const;
     
     // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 // Contains all the objects that declare information about the media data within a track.
 class Mdia final : public Box {
 public:
     Mdia() {
+        kind = BoxKind::Mdia;
         type = {'m', 'd', 'i', 'a'};
     }
     
@@ -277,13 +386,14 @@ public:
 
     // Avance le bitstream jusqu'à la prochaine boite de même niveau en parsant toutes les boîtes contenues.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 // Mdia header
 class Mdhd final : public FullBox {
 public:
     Mdhd() {
+        kind = BoxKind::Mdhd;
         type = {'m', 'd', 'h', 'd'};
     }
 
@@ -294,33 +404,38 @@ public:
     uint16_t language; // (5 bin)[3], le premier? bit est inutilisé
     
     void setParent(Box *pParent) override final;
-    void print(std::ostream& a_outstream);
+    void dump(DumpWriter& a_writer) const;
     
     // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 class Hdlr final : public FullBox {
 public:
     Hdlr() {
+        kind = BoxKind::Hdlr;
         type = {'h', 'd', 'l', 'r'};
     }
 
+    uint32_t pre_defined = 0;          // nul selon la norme, type de composant (mhlr) pour QuickTime
     uint32_t handler_type;
-    std::string name;
+    std::array<char, 12> reserved = {}; // nul selon la norme, fabricant (appl) pour QuickTime
+    std::string_view name; // vue sur `strings`
+    BoxStrings strings;
     
     void setParent(Box *pParent) override final;
-    void print(std::ostream& a_outstream);
+    void dump(DumpWriter& a_writer) const;
     
     // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 class Minf final : public Box {
 public:
     Minf() {
+        kind = BoxKind::Minf;
         type = {'m', 'i', 'n', 'f'};
     }
     
@@ -328,13 +443,14 @@ public:
 
     // Avance le bitstream jusqu'à la prochaine boite de même niveau en parsant toutes les boîtes contenues.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 // Video media header
 class Vmhd final : public FullBox {
 public:
     Vmhd() {
+        kind = BoxKind::Vmhd;
         type = {'v', 'm', 'h', 'd'};
         version = 1;
         flags[0] = 1;
@@ -344,17 +460,18 @@ public:
     std::array<uint16_t, 3> opcolor = {0, 0, 0};
     
     void setParent(Box *pParent) override final;
-    void print(std::ostream& a_outstream);
+    void dump(DumpWriter& a_writer) const;
     
     // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 // Contains objects that declare the location of the media information in a track.
 class Dinf final : public Box {
 public:
     Dinf() {
+        kind = BoxKind::Dinf;
         type = {'d', 'i', 'n', 'f'};
     }
     
@@ -362,47 +479,52 @@ public:
 
     // Avance le bitstream jusqu'à la prochaine boite de même niveau en parsant toutes les boîtes contenues.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 class Url final : public FullBox {
 public:
     Url() {
+        kind = BoxKind::Url;
         type = {'u', 'r', 'l', ' '};
         version = 0;
     }
 
-    std::string location;
+    std::string_view location; // vue sur `strings`
+    BoxStrings strings;
     
     void setParent(Box *pParent) override final;
-    void print(std::ostream& a_outstream);
+    void dump(DumpWriter& a_writer) const;
     
     // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 class Urn final : public FullBox {
 public:
     Urn() {
+        kind = BoxKind::Urn;
         type = {'u', 'r', 'n', ' '};
         version = 0;
     }
 
-    std::string name;
-    std::string location;
+    std::string_view name;     // vues sur `strings`
+    std::string_view location;
+    BoxStrings strings;
     
     void setParent(Box *pParent) override final;
-    void print(std::ostream& a_outstream);
+    void dump(DumpWriter& a_writer) const;
     
     // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 class Dref final : public FullBox {
 public:
     Dref() {
+        kind = BoxKind::Dref;
         type = {'d', 'r', 'e', 'f'};
         version = 0;
         flags = {0,0,0};
@@ -412,16 +534,17 @@ public:
     // data_entry est ici remplacée par `children`
     
     void setParent(Box *pParent) override final;
-    void print(std::ostream& a_outstream);
+    void dump(DumpWriter& a_writer) const;
     
     // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 class Stbl final : public Box {
 public:
     Stbl() {
+        kind = BoxKind::Stbl;
         type = {'s', 't', 'b', 'l'};
     }
     
@@ -429,15 +552,15 @@ public:
     
     // Avance le bitstream jusqu'à la prochaine boite de même niveau en parsant toutes les boîtes contenues.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 class SampleEntry : public Box {
 public:
     uint16_t data_reference_index;
     
-    void print(std::ostream& a_outstream);
-    virtual void parse(std::ifstream& a_file) override;
+    void dump(DumpWriter& a_writer) const;
+    virtual void parse(std::istream& a_file) override;
 };
 
 class Btrt final : public Box {
@@ -447,15 +570,16 @@ public:
     uint32_t avgBitrate;
     
     Btrt() {
+        kind = BoxKind::Btrt;
         type = {'b', 't', 'r', 't'};
     }
     
     void setParent(Box *pParent) override final;
-    void print(std::ostream& a_outstream);
+    void dump(DumpWriter& a_writer) const;
     
     // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
     //     @file: le bitstream du fichier analysé
-    virtual void parse(std::ifstream& a_file) override;
+    virtual void parse(std::istream& a_file) override;
 };
 
 class Stsd final : public FullBox {
@@ -464,26 +588,28 @@ public:
     // toutes les instances sont stockées dans `children`
 
     Stsd() {
+        kind = BoxKind::Stsd;
         type = {'s', 't', 's', 'd'};
         flags = {0, 0, 0};
     }
     
     void setParent(Box *pParent) override final;
-    void print(std::ostream& a_outstream);
+    void dump(DumpWriter& a_writer) const;
     
     // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
     //     @file: le bitstream du fichier analysé
-    virtual void parse(std::ifstream& a_file) override;
+    virtual void parse(std::istream& a_file) override;
 };
 
 class Meta final : public FullBox {
 public:
     Meta() {
+        kind = BoxKind::Meta;
         type = {'m', 'e', 't', 'a'};
     }
     
     void setParent(Box *pParent) override final;
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 class Frma final : public Box {
@@ -491,12 +617,13 @@ public:
     std::array<char, 4> data_format;
     
     Frma() {
+        kind = BoxKind::Frma;
         type = {'f', 'r', 'm', 'a'};
     }
     
     void setParent(Box *pParent) override final;
-    void print(std::ostream& a_outstream);
-    void parse(std::ifstream& a_file) override final;
+    void dump(DumpWriter& a_writer) const;
+    void parse(std::istream& a_file) override final;
     
 private:
     uint64_t m_beg_data;
@@ -509,11 +636,12 @@ public:
     // avcC config;
 
     Cinf() {
+        kind = BoxKind::Cinf;
         type = {'c', 'i', 'n', 'f'};
     }
     
     void setParent(Box *pParent) override final;
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 class Avcc final : public Box {
@@ -521,6 +649,7 @@ public:
     uint64_t beg_data; // index de début des données images/audio dans le bitstream
 
     Avcc() {
+        kind = BoxKind::Avcc;
         type = {'a', 'v', 'c', 'c'};
     }
     
@@ -529,7 +658,7 @@ public:
     // Parse la boîte : avance le bitstream jusqu'à la prochaine boîte et stocke
     // le début des données. La fin de la boîte est connue grâce à sa taille.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 class VisualSampleEntry : public SampleEntry {
@@ -545,8 +674,8 @@ public:
     // CleanApertureBox clap;
     // PixelAspectRatioBox pasp;
     
-    void print(std::ostream& a_outstream);
-    virtual void parse(std::ifstream& a_file) override;
+    void dump(DumpWriter& a_writer) const;
+    virtual void parse(std::istream& a_file) override;
 };
 
 class Icpv final : public VisualSampleEntry {
@@ -560,15 +689,80 @@ public:
     std::array<char, 4> transformed_type; // pas à parser, info a transmettre a un enfant
     
     Icpv() {
+        kind = BoxKind::Icpv;
         type = {'i', 'c', 'p', 'v'};
     }
     
     void setParent(Box *pParent) override final;
-    void print(std::ostream& a_outstream);
+    void dump(DumpWriter& a_writer) const;
     
     // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
+};
+
+class Hvcc final : public Box {
+public:
+    // HEVCDecoderConfigurationRecord (ISO/IEC 14496-15)
+    uint8_t  configuration_version = 1;
+    uint8_t  general_profile_space = 0;
+    uint8_t  general_tier_flag = 0;   // 0 : Main, 1 : High
+    uint8_t  general_profile_idc = 0; // 1 : Main, 2 : Main 10, 4 : RExt
+    uint32_t general_profile_compatibility_flags = 0;
+    uint64_t general_constraint_indicator_flags = 0; // 48 bits
+    uint8_t  general_level_idc = 0;   // 30 fois le niveau
+    uint16_t min_spatial_segmentation_idc = 0;
+    uint8_t  parallelism_type = 0;
+    uint8_t  chroma_format_idc = 1;   // 1 : 4:2:0
+    uint8_t  bit_depth_luma = 8;
+    uint8_t  bit_depth_chroma = 8;
+    uint16_t avg_frame_rate = 0;      // images par 256 s, 0 si non précisé
+    uint8_t  constant_frame_rate = 0;
+    uint8_t  num_temporal_layers = 0;
+    uint8_t  temporal_id_nested = 0;
+    uint8_t  nal_length_size = 4;     // lengthSizeMinusOne + 1
+    // ensembles de paramètres, sans taille ni code de départ : vues sur `record`,
+    // valides tant que la boîte existe (les boîtes ne se copient pas, cf Box)
+    std::vector<std::string_view> vps;
+    std::vector<std::string_view> sps;
+    std::vector<std::string_view> pps;
+    // enregistrement tel que lu, tableaux de NAL compris (SEI...), pour la réécriture
+    std::vector<char> record;
+
+    Hvcc() {
+        kind = BoxKind::Hvcc;
+        type = {'h', 'v', 'c', 'C'};
+    }
+
+    void setParent(Box *pParent) override final;
+    void dump(DumpWriter& a_writer) const;
+
+    // Parse la boîte : l'enregistrement est lu en une fois puis décodé.
+    // Lève une exception s'il est tronqué.
+    //     @file: le bitstream du fichier analysé
+    void parse(std::istream& a_file) override final;
+};
+
+// Entrée HEVC : hvc1 (ensembles de paramètres dans hvcC seulement) ou hev1
+// (ensembles de paramètres aussi dans les échantillons).
+class Hvc1 final : public VisualSampleEntry {
+public:
+    // dans les enfants
+    // HEVCConfigurationBox config;
+    // MPEG4BitRateBox (); // optional
+
+    // @type: le type lu, hvc1 ou hev1
+    explicit Hvc1(std::array<char, 4> a_type = {'h', 'v', 'c', '1'}) {
+        kind = BoxKind::Hvc1;
+        type = a_type;
+    }
+
+    void setParent(Box *pParent) override final;
+    void dump(DumpWriter& a_writer) const;
+
+    // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
+    //     @file: le bitstream du fichier analysé
+    void parse(std::istream& a_file) override final;
 };
 
 class Stts final : public FullBox {
@@ -578,17 +772,39 @@ public:
     std::vector<uint32_t> sample_delta;
     
     Stts() {
+        kind = BoxKind::Stts;
         type = {'s', 't', 't', 's'};
         version = 0;
         setFlags({0, 0, 0});
     }
     
     void setParent(Box *pParent) override final;
-    void print(std::ostream& a_outstream);
+    void dump(DumpWriter& a_writer) const;
 
     // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
+};
+
+class Ctts final : public FullBox {
+public:
+    uint32_t entry_count;
+    std::vector<uint32_t> sample_count;
+    std::vector<uint32_t> sample_offset; // décalage de composition, signé en version 1
+    
+    Ctts() {
+        kind = BoxKind::Ctts;
+        type = {'c', 't', 't', 's'};
+        version = 0;
+        setFlags({0, 0, 0});
+    }
+    
+    void setParent(Box *pParent) override final;
+    void dump(DumpWriter& a_writer) const;
+
+    // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
+    //     @file: le bitstream du fichier analysé
+    void parse(std::istream& a_file) override final;
 };
 
 class Stss final : public FullBox {
@@ -597,17 +813,18 @@ public:
     std::vector<uint32_t> sample_number;
     
     Stss() {
+        kind = BoxKind::Stss;
         type = {'s', 't', 's', 's'};
         version = 0;
         setFlags({0, 0, 0});
     }
     
     void setParent(Box *pParent) override final;
-    void print(std::ostream& a_outstream);
+    void dump(DumpWriter& a_writer) const;
 
     // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 class Stsc final : public FullBox {
@@ -618,17 +835,18 @@ public:
     std::vector<uint32_t> samples_description_index;
     
     Stsc() {
+        kind = BoxKind::Stsc;
         type = {'s', 't', 's', 'c'};
         version = 0;
         setFlags({0, 0, 0});
     }
     
     void setParent(Box *pParent) override final;
-    void print(std::ostream& a_outstream);
+    void dump(DumpWriter& a_writer) const;
 
     // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 class Stsz final : public FullBox {
@@ -638,17 +856,18 @@ public:
     std::vector<uint32_t> entry_size;
     
     Stsz() {
+        kind = BoxKind::Stsz;
         type = {'s', 't', 's', 'z'};
         version = 0;
         setFlags({0, 0, 0});
     }
     
     void setParent(Box *pParent) override final;
-    void print(std::ostream& a_outstream);
+    void dump(DumpWriter& a_writer) const;
 
     // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 class Stco final : public FullBox {
@@ -657,17 +876,18 @@ public:
     std::vector<uint32_t> chunk_offset;
     
     Stco() {
+        kind = BoxKind::Stco;
         type = {'s', 't', 'c', 'o'};
         version = 0;
         setFlags({0, 0, 0});
     }
     
     void setParent(Box *pParent) override final;
-    void print(std::ostream& a_outstream);
+    void dump(DumpWriter& a_writer) const;
 
     // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 class Smhd final : public FullBox {
@@ -675,17 +895,18 @@ public:
     int16_t balance = 0;
     
     Smhd() {
+        kind = BoxKind::Smhd;
         type = {'s', 'm', 'h', 'd'};
         version = 0;
         setFlags({0, 0, 0});
     }
     
     void setParent(Box *pParent) override final;
-    void print(std::ostream& a_outstream);
+    void dump(DumpWriter& a_writer) const;
 
     // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 class Enca final : public Box {
@@ -693,6 +914,7 @@ public:
     uint64_t beg_data; // index de début des données images/audio dans le bitstream
 
     Enca() {
+        kind = BoxKind::Enca;
         type = {'e', 'n', 'c', 'a'};
     }
     
@@ -701,12 +923,96 @@ public:
     // Parse la boîte : avance le bitstream jusqu'à la prochaine boîte et stocke
     // le début des données. La fin de la boîte est connue grâce à sa taille.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
+};
+
+class AudioSampleEntry : public SampleEntry {
+public:
+    uint16_t version = 0; // version de la description QuickTime, 0 en ISO
+    std::array<char, 6> reserved = {}; // revision et vendor en QuickTime, conservés pour la réécriture
+    uint16_t channelcount = 2;
+    uint16_t samplesize = 16;
+    uint32_t pre_defined = 0; // compression_id et packet_size en QuickTime
+    uint32_t samplerate = 0; // fréquence d'échantillonnage en virgule fixe 16.16
+    std::vector<char> qt_extension; // champs des versions 1 (16 octets) et 2 (36 octets), recopiés tels quels
+
+    void dump(DumpWriter& a_writer) const;
+    virtual void parse(std::istream& a_file) override;
+};
+
+class Mp4a final : public AudioSampleEntry {
+public:
+    // dans les enfants
+    // ESDBox ES;
+    // MPEG4BitRateBox (); // optional
+
+    Mp4a() {
+        kind = BoxKind::Mp4a;
+        type = {'m', 'p', '4', 'a'};
+    }
+
+    void setParent(Box *pParent) override final;
+    void dump(DumpWriter& a_writer) const;
+
+    // Parse la boîte actuelle et avance le bitstream jusqu'à la prochaine boîte.
+    //     @file: le bitstream du fichier analysé
+    void parse(std::istream& a_file) override final;
 };
 
+// AudioSpecificConfig (ISO/IEC 14496-3), porté par le DecSpecificInfo d'une
+// piste audio MPEG-4. Avec une signalisation explicite de SBR ou PS, les
+// champs décrivent le cœur AAC et `extension_object_type` l'extension.
+struct AudioSpecificConfig {
+    uint8_t  audio_object_type        = 0;  // 2 : AAC LC
+    uint8_t  sampling_frequency_index = 15; // 15 : fréquence donnée explicitement
+    uint32_t sampling_frequency       = 0;  // Hz
+    uint8_t  channel_configuration    = 0;  // 0 : disposition donnée par un PCE
+    uint8_t  extension_object_type    = 0;  // 5 (SBR) ou 29 (PS), 0 sans extension
+};
+
+class Esds final : public FullBox {
+public:
+    // ES_Descriptor
+    uint16_t ES_ID = 0;
+    uint8_t  stream_priority = 0;
+    // DecoderConfigDescriptor
+    uint8_t  object_type_indication = 0; // 0x40 : audio MPEG-4
+    uint8_t  stream_type = 0;            // 5 : audio
+    uint32_t buffer_size_DB = 0;
+    uint32_t max_bitrate = 0;
+    uint32_t avg_bitrate = 0;
+    // DecSpecificInfo, vue sur `descriptors`, valide tant que la boîte existe
+    // (les boîtes ne se copient pas, cf Box)
+    std::string_view decoder_specific_info;
+    // décodé si object_type_indication vaut 0x40
+    AudioSpecificConfig audio_config;
+    // descripteurs tels que lus, pour la réécriture
+    std::vector<char> descriptors;
+
+    Esds() {
+        kind = BoxKind::Esds;
+        type = {'e', 's', 'd', 's'};
+    }
+
+    void setParent(Box *pParent) override final;
+    void dump(DumpWriter& a_writer) const;
+
+    // Parse la boîte : les descripteurs sont lus en une fois puis décodés.
+    // Lève une exception si un descripteur dépasse la fin de la boîte.
+    //     @file: le bitstream du fichier analysé
+    void parse(std::istream& a_file) override final;
+};
+
+// Décode un AudioSpecificConfig.
+// Lève une exception s'il est tronqué.
+//     @data: le contenu du DecSpecificInfo
+//     @size: sa taille
+AudioSpecificConfig decodeAudioSpecificConfig(const char *a_data, size_t a_size);
+
 class Udta final : public Box {
 public:
     Udta() {
+        kind = BoxKind::Udta;
         type = {'u', 'd', 't', 'a'};
     }
     
@@ -714,14 +1020,17 @@ public:
     
     // Avance le bitstream jusqu'à la prochaine boite de même niveau en parsant toutes les boîtes contenues.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 class Ilst final : public Box {
 public:
     uint64_t beg_data; // index de début des données images/audio dans le bitstream
+    std::vector<char> items;   // éléments de métadonnées remplaçant ceux du fichier (cf metadata-edit.hpp)
+    bool items_loaded = false; // vrai si `items` est le contenu à écrire
 
     Ilst() {
+        kind = BoxKind::Ilst;
         type = {'i', 'l', 's', 't'};
     }
     
@@ -730,7 +1039,7 @@ public:
     // Parse la boîte : avance le bitstream jusqu'à la prochaine boîte et stocke
     // le début des données. La fin de la boîte est connue grâce à sa taille.
     //     @file: le bitstream du fichier analysé
-    void parse(std::ifstream& a_file) override final;
+    void parse(std::istream& a_file) override final;
 };
 
 
@@ -750,3 +1059,120 @@ struct TreeBoxDisplay {
     Box* pBox;
     int level;                  // profondeur dans l'arbre
 };
+
+// État d'une analyse en cours, partagé par les appels récursifs à `parseBox`.
+// Un contexte est actif sur un thread le temps de vie d'un `ParseContext::Scope`.
+struct ParseContext {
+    const BoxQuery *query = nullptr;    // filtre des boîtes analysées, nullptr pour tout analyser
+    BoxVisitor *visitor = nullptr;      // destinataire des évènements, nullptr pour construire l'arbre
+    bool     stopped = false;           // vrai si le visiteur a interrompu l'analyse
+    std::vector<PathSegment> path;      // chemin de la boîte en cours d'analyse
+    bool     selected = false;          // vrai dans le sous-arbre d'une boîte sélectionnée
+    uint64_t skipped_boxes = 0;         // boîtes sautées par le filtre
+    uint64_t skipped_bytes = 0;         // octets sautés par le filtre
+
+    // Contexte actif sur le thread appelant, nullptr hors d'une analyse.
+    static ParseContext *current();
+
+    class Scope {
+    public:
+        explicit Scope(ParseContext& a_context);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    private:
+        ParseContext *m_previous;
+    };
+};
+
+// Parse le header directement à la position du stream.
+//     @file: un pointeur vers le bitstream de lecture
+//     @return: la boite du type lu
+std::unique_ptr<Box> parseHeader(std::istream& a_file);
+
+// Parse la boîte à la position du bitstream.
+//     @file: un pointeur vers le bitstream de lecture
+//     @box:  la boîte analysée, parente des boîtes suivantes
+void parseBox(std::istream& a_file, Box& a_box);
+
+// Saute la boîte entière sans l'analyser. L'entête doit avoir été lu.
+//     @file: le bitstream du fichier analysé
+//     @box: la boîte à sauter
+//     @return: le nombre d'octets sautés
+uint64_t skipBox(std::istream& a_file, const Box& a_box);
+
+// Parse seulement les boîtes désignées par la requête et leurs ancêtres, les
+// autres sous-arbres sont sautés grâce à leur taille.
+//     @file: le bitstream du fichier analysé, positionné au début
+//     @root: la racine de l'arbre construit
+//     @query: les chemins des boîtes voulues
+//     @context: contexte d'analyse, renseigne les statistiques de saut
+void parseSelective(std::istream& a_file, Root& a_root, const BoxQuery& a_query,
+                    ParseContext& a_context);
+
+// Écrit les informations de toutes les boîtes de l'arbre, en ordre préfixe,
+// chaque boîte suivie d'une ligne vide.
+//     @writer: tampon d'écriture
+//     @box: la racine du sous-arbre écrit
+void dumpTree(DumpWriter& a_writer, Box& a_box);
+
+// Affiche l'arborescence des boîtes sur la sortie standard.
+//     @pRoot: la boîte racine de l'arbre
+//     @fileName: le nom du fichier affiché en tête
+void displayFileTree(Box* pRoot, const std::string fileName);
+
+// Appelle `f` avec la boîte convertie vers sa classe concrète. Le switch sur
+// `kind` est compilé en table de sauts ; les classes concrètes étant `final`,
+// les appels faits dans `f` sont directs et peuvent être inlinés.
+//     @box: la boîte
+//     @f: fonction générique appelée avec la boîte typée
+//     @return: la valeur renvoyée par `f`
+template<typename F>
+decltype(auto) visitBox(Box& a_box, F&& a_f) {
+    switch (a_box.kind) {
+    case BoxKind::Root: return a_f(static_cast<Root&>(a_box));
+    case BoxKind::Ftyp: return a_f(static_cast<Ftyp&>(a_box));
+    case BoxKind::Mdat: return a_f(static_cast<Mdat&>(a_box));
+    case BoxKind::Free: return a_f(static_cast<Free&>(a_box));
+    case BoxKind::Pdin: return a_f(static_cast<Pdin&>(a_box));
+    case BoxKind::Moov: return a_f(static_cast<Moov&>(a_box));
+    case BoxKind::Mvhd: return a_f(static_cast<Mvhd&>(a_box));
+    case BoxKind::Trak: return a_f(static_cast<Trak&>(a_box));
+    case BoxKind::Tkhd: return a_f(static_cast<Tkhd&>(a_box));
+    case BoxKind::Edts: return a_f(static_cast<Edts&>(a_box));
+    case BoxKind::Elst: return a_f(static_cast<Elst&>(a_box));
+    case BoxKind::Mdia: return a_f(static_cast<Mdia&>(a_box));
+    case BoxKind::Mdhd: return a_f(static_cast<Mdhd&>(a_box));
+    case BoxKind::Hdlr: return a_f(static_cast<Hdlr&>(a_box));
+    case BoxKind::Minf: return a_f(static_cast<Minf&>(a_box));
+    case BoxKind::Vmhd: return a_f(static_cast<Vmhd&>(a_box));
+    case BoxKind::Dinf: return a_f(static_cast<Dinf&>(a_box));
+    case BoxKind::Url: return a_f(static_cast<Url&>(a_box));
+    case BoxKind::Urn: return a_f(static_cast<Urn&>(a_box));
+    case BoxKind::Dref: return a_f(static_cast<Dref&>(a_box));
+    case BoxKind::Stbl: return a_f(static_cast<Stbl&>(a_box));
+    case BoxKind::Btrt: return a_f(static_cast<Btrt&>(a_box));
+    case BoxKind::Stsd: return a_f(static_cast<Stsd&>(a_box));
+    case BoxKind::Meta: return a_f(static_cast<Meta&>(a_box));
+    case BoxKind::Frma: return a_f(static_cast<Frma&>(a_box));
+    case BoxKind::Cinf: return a_f(static_cast<Cinf&>(a_box));
+    case BoxKind::Avcc: return a_f(static_cast<Avcc&>(a_box));
+    case BoxKind::Icpv: return a_f(static_cast<Icpv&>(a_box));
+    case BoxKind::Hvcc: return a_f(static_cast<Hvcc&>(a_box));
+    case BoxKind::Hvc1: return a_f(static_cast<Hvc1&>(a_box));
+    case BoxKind::Stts: return a_f(static_cast<Stts&>(a_box));
+    case BoxKind::Ctts: return a_f(static_cast<Ctts&>(a_box));
+    case BoxKind::Stss: return a_f(static_cast<Stss&>(a_box));
+    case BoxKind::Stsc: return a_f(static_cast<Stsc&>(a_box));
+    case BoxKind::Stsz: return a_f(static_cast<Stsz&>(a_box));
+    case BoxKind::Stco: return a_f(static_cast<Stco&>(a_box));
+    case BoxKind::Smhd: return a_f(static_cast<Smhd&>(a_box));
+    case BoxKind::Enca: return a_f(static_cast<Enca&>(a_box));
+    case BoxKind::Mp4a: return a_f(static_cast<Mp4a&>(a_box));
+    case BoxKind::Esds: return a_f(static_cast<Esds&>(a_box));
+    case BoxKind::Udta: return a_f(static_cast<Udta&>(a_box));
+    case BoxKind::Ilst: return a_f(static_cast<Ilst&>(a_box));
+    case BoxKind::Unknown: break;
+    }
+    throw std::runtime_error("Box of type `" + std::string(a_box.type.data(), 4) + "` has no concrete kind.");
+}
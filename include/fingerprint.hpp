@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include <container-parser.hpp>
+#include <hash.hpp>
+#include <range-reader.hpp>
+
+struct FingerprintOptions {
+    unsigned threads  = 0;               // 0 : un thread par cœur
+    bool     sha256   = false;           // calcule aussi un condensé SHA-256
+    size_t   max_read = 1024 * 1024;     // taille maximale d'une lecture
+    uint64_t max_gap  = 4096;            // octets hors échantillons lus pour joindre deux plages voisines
+    uint64_t min_thread_bytes = 4 * 1024 * 1024; // octets à lire par thread, en dessous un thread de moins
+};
+
+// Empreinte du contenu d'une piste : ne dépend que des octets de ses
+// échantillons et de leur ordre de décodage, pas de la disposition du
+// conteneur (positions, entrelacement, ordre des boîtes).
+struct TrackFingerprint {
+    uint32_t track_ID     = 0;
+    uint32_t handler_type = 0;
+    uint32_t sample_count = 0;
+    uint64_t bytes        = 0;
+    uint64_t digest       = 0;      // XXH64 de la suite des XXH64 des échantillons
+    bool     has_sha256   = false;
+    Sha256::Digest sha256 = {};     // SHA-256 de la suite des SHA-256 des échantillons
+};
+
+struct FingerprintStats {
+    unsigned threads    = 0;
+    uint64_t reads      = 0; // lectures envoyées à la source
+    uint64_t bytes_read = 0; // octets lus, écarts entre plages compris
+    double   seconds    = 0;
+};
+
+struct Fingerprints {
+    std::vector<TrackFingerprint> tracks; // dans l'ordre des pistes du fichier
+    FingerprintStats              stats;
+};
+
+// Calcule l'empreinte de chaque piste. Les échantillons (stco, stsc, stsz)
+// sont regroupés en plages contiguës du fichier, lues et hachées en parallèle
+// par un groupe de threads ; chaque échantillon a son hash, rangé à son indice,
+// et les hashs sont combinés dans l'ordre de décodage une fois toutes les
+// lectures terminées : le résultat ne dépend ni du nombre de threads ni de
+// l'ordre d'exécution. Le nombre de threads est limité par le nombre de
+// lectures et par `min_thread_bytes` : un petit fichier est lu par le seul
+// thread appelant, sans coût de démarrage de threads.
+// Lève une exception si les tables sont incohérentes ou si une lecture échoue.
+//     @root: la racine de l'arbre
+//     @reader: la source des données, dont `read` doit pouvoir être appelé par plusieurs threads
+//     @options: parallélisme, SHA-256, taille des lectures
+//     @return: les empreintes et le bilan des lectures
+Fingerprints fingerprintTracks(const Root& a_root, RangeReader& a_reader,
+                               const FingerprintOptions& a_options = FingerprintOptions());
+
+// Affiche les empreintes et le débit obtenu.
+//     @outstream: flux d'affichage
+//     @fingerprints: les empreintes affichées
+void printFingerprints(std::ostream& a_outstream, const Fingerprints& a_fingerprints);
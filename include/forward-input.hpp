@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+#include <range-reader.hpp>
+
+// Octets sautés d'une entrée non repositionnable, conservés pour être relus
+// plus tard : quand `moov` suit `mdat`, les positions des échantillons ne sont
+// connues qu'après le passage des données. Les octets sont gardés en mémoire
+// ou dans un fichier temporaire anonyme, dans la limite d'un plafond ; au-delà
+// ils sont perdus.
+class Spool : public RangeReader {
+public:
+    // @cap: nombre maximal d'octets conservés
+    // @directory: répertoire du fichier temporaire, vide pour garder les octets en mémoire
+    Spool(uint64_t a_cap, const std::string& a_directory = "");
+    ~Spool() override;
+
+    Spool(const Spool&) = delete;
+    Spool& operator=(const Spool&) = delete;
+
+    // Conserve une plage d'octets, tronquée si le plafond est atteint.
+    //     @offset: position des octets dans l'entrée
+    //     @data: les octets
+    //     @size: leur nombre
+    void append(uint64_t a_offset, const char *a_data, size_t a_size);
+
+    // Vrai si toute la plage est conservée.
+    bool contains(uint64_t a_offset, uint64_t a_size) const;
+
+    uint64_t spooled() const { return m_spooled; } // octets conservés
+    uint64_t dropped() const { return m_dropped; } // octets perdus, plafond atteint
+
+    // Position de fin du dernier octet conservé.
+    uint64_t size() override;
+    // Lit une plage conservée ; lève une exception si elle ne l'est pas entièrement.
+    size_t read(uint64_t a_offset, char *a_buffer, size_t a_size) override;
+
+private:
+    struct Range {
+        uint64_t offset;   // position dans l'entrée
+        uint64_t size;
+        uint64_t position; // position dans le stockage
+    };
+
+    uint64_t           m_cap;
+    uint64_t           m_spooled = 0;
+    uint64_t           m_dropped = 0;
+    std::vector<Range> m_ranges;  // par position croissante, plages adjacentes fusionnées
+    std::vector<char>  m_memory;  // stockage en mémoire, si pas de fichier
+    int                m_fd = -1; // fichier temporaire
+};
+
+// Tampon de flux en lecture seule, en avant uniquement, sur un descripteur
+// non repositionnable (tube, entrée standard). Les déplacements vers l'avant
+// (seekg) lisent et jettent les octets sautés sans les accumuler, ou les
+// confient au `Spool` s'il y en a un ; un déplacement vers la fin lit l'entrée
+// jusqu'au bout. Les retours en arrière ne sont possibles qu'à l'intérieur du
+// tampon courant ; les octets sautés de nouveau après un tel retour ne sont
+// pas confiés une seconde fois au `Spool`.
+class ForwardStreamBuf : public std::streambuf {
+public:
+    static constexpr size_t DEFAULT_BUFFER = 64 * 1024;
+
+    // @fd: le descripteur lu, qui reste ouvert à la destruction
+    // @spool: destinataire des octets sautés, nullptr pour les jeter
+    // @buffer_size: taille du tampon de lecture
+    explicit ForwardStreamBuf(int a_fd, Spool *a_spool = nullptr, size_t a_buffer_size = DEFAULT_BUFFER);
+
+    uint64_t discarded() const { return m_discarded; } // octets sautés
+
+protected:
+    int_type underflow() override;
+    pos_type seekoff(off_type a_offset, std::ios_base::seekdir a_dir, std::ios_base::openmode a_which) override;
+    pos_type seekpos(pos_type a_position, std::ios_base::openmode a_which) override;
+
+private:
+    // Position de lecture courante dans l'entrée.
+    uint64_t position() const { return m_buffer_offset + (gptr() - eback()); }
+    // Remplit le tampon, renvoie faux en fin d'entrée.
+    bool fill();
+    // Saute des octets à partir de la position courante.
+    //     @count: nombre d'octets, UINT64_MAX pour aller jusqu'à la fin
+    //     @return: le nombre d'octets réellement sautés
+    uint64_t skip(uint64_t a_count);
+
+    int               m_fd;
+    Spool            *m_spool;
+    std::vector<char> m_buffer;
+    uint64_t          m_buffer_offset = 0; // position de eback() dans l'entrée
+    uint64_t          m_discarded = 0;
+    uint64_t          m_spool_end = 0;     // fin des octets déjà confiés au spool
+};
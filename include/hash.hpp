@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Hash XXH64 d'un bloc d'octets : rapide, non cryptographique, identique à
+// l'implémentation de référence de xxHash.
+//     @data: les octets
+//     @size: leur nombre
+//     @seed: graine du hash
+//     @return: le hash sur 64 bits
+uint64_t xxhash64(const void *a_data, size_t a_size, uint64_t a_seed = 0);
+
+// Condensé SHA-256 (FIPS 180-4), calculé par morceaux.
+class Sha256 {
+public:
+    using Digest = std::array<uint8_t, 32>;
+
+    Sha256();
+
+    // Ajoute des octets au message.
+    //     @data: les octets
+    //     @size: leur nombre
+    void update(const void *a_data, size_t a_size);
+
+    // Termine le message et renvoie son condensé ; l'objet ne doit plus servir ensuite.
+    Digest digest();
+
+    // Condensé d'un bloc d'octets.
+    static Digest hash(const void *a_data, size_t a_size);
+
+private:
+    // Traite un bloc de 64 octets.
+    void compress(const uint8_t *a_block);
+
+    std::array<uint32_t, 8> m_state;
+    std::array<uint8_t, 64> m_block;
+    size_t                  m_block_size = 0; // octets en attente dans `m_block`
+    uint64_t                m_length = 0;     // taille totale du message, en octets
+};
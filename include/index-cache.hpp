@@ -0,0 +1,117 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include <container-parser.hpp>
+
+// Index persistant (fichier « sidecar ») d'un fichier mp4 analysé.
+// Le sidecar contient l'arbre des boîtes et les tables d'échantillons aplaties,
+// stockés sous forme de tableaux de structures à taille fixe : il est utilisable
+// directement après un mmap, sans étape de désérialisation.
+//
+// Organisation du fichier (tous les champs en boutisme natif, sections alignées
+// sur 8 octets) :
+//     IndexHeader
+//     IndexedBox[box_count]          arbre en ordre préfixe
+//     IndexedTrack[track_count]
+//     IndexedSample[...]             échantillons de chaque piste, bout à bout
+
+constexpr std::array<char, 8> INDEX_MAGIC = {'M', 'P', '4', 'I', 'D', 'X', '\0', '\0'};
+constexpr uint32_t INDEX_VERSION = 2;
+constexpr uint32_t INDEX_NO_PARENT = UINT32_MAX;
+
+struct IndexHeader {
+    std::array<char, 8> magic;
+    uint32_t version;
+    uint32_t header_size;    // sizeof(IndexHeader), contrôle de cohérence du format
+    uint64_t source_size;    // taille du fichier indexé
+    int64_t  source_mtime;   // date de modification du fichier indexé (ns)
+    uint64_t source_inode;   // numéro d'inode du fichier indexé
+    uint32_t box_count;
+    uint32_t track_count;
+    uint64_t boxes_offset;   // positions des sections dans le sidecar
+    uint64_t tracks_offset;
+    uint64_t samples_offset;
+    uint64_t sample_count;   // nombre total d'échantillons, toutes pistes confondues
+};
+
+struct IndexedBox {
+    std::array<char, 4> type;
+    uint8_t  header_size;    // taille de l'entête (8 ou 16 octets)
+    uint8_t  depth;          // profondeur dans l'arbre, 0 pour la racine
+    uint16_t reserved;
+    uint32_t parent;         // indice du parent, INDEX_NO_PARENT pour la racine
+    uint32_t child_count;
+    uint64_t offset;         // position du début de la boîte dans le fichier indexé
+    uint64_t size;
+};
+
+struct IndexedTrack {
+    uint32_t track_ID;
+    uint32_t handler_type;
+    uint32_t timescale;
+    uint32_t trak_box;       // indice de la boîte `trak` dans la table des boîtes
+    uint64_t duration;       // dans l'échelle de temps du média
+    uint64_t first_sample;   // indice du premier échantillon dans la section des échantillons
+    uint64_t sample_count;
+};
+
+struct IndexedSample {
+    uint64_t offset;
+    uint64_t dts;
+    uint32_t size;
+    uint32_t sync;
+};
+
+// Vue en lecture seule d'un sidecar projeté en mémoire.
+class MappedIndex {
+public:
+    MappedIndex(const MappedIndex&) = delete;
+    MappedIndex& operator=(const MappedIndex&) = delete;
+    ~MappedIndex();
+
+    // Projette le sidecar associé au fichier source s'il existe et s'il est
+    // toujours valide (taille, date de modification et inode du fichier source,
+    // relevés par un seul stat) et si ses sections tiennent dans le fichier.
+    //     @source_path: chemin du fichier mp4 indexé
+    //     @return: l'index projeté, nullptr si le sidecar est absent ou périmé
+    static std::unique_ptr<MappedIndex> open(const std::string& a_source_path);
+
+    const IndexHeader&   header() const { return *m_header; }
+    const IndexedBox    *boxes()  const { return m_boxes; }
+    const IndexedTrack  *tracks() const { return m_tracks; }
+    // Échantillons d'une piste, dans l'ordre de décodage.
+    const IndexedSample *samples(const IndexedTrack& a_track) const { return m_samples + a_track.first_sample; }
+
+private:
+    void       *m_data = nullptr;
+    size_t      m_size = 0;
+    const IndexHeader   *m_header  = nullptr;
+    const IndexedBox    *m_boxes   = nullptr;
+    const IndexedTrack  *m_tracks  = nullptr;
+    const IndexedSample *m_samples = nullptr;
+
+    MappedIndex() = default;
+};
+
+// Chemin du sidecar associé à un fichier.
+//     @source_path: chemin du fichier mp4
+//     @return: le chemin du sidecar
+std::string indexPath(const std::string& a_source_path);
+
+// Écrit le sidecar d'un fichier analysé. L'écriture passe par un fichier
+// temporaire unique (mkstemp) du même répertoire, renommé à la fin : un
+// lecteur concurrent ne voit jamais de sidecar partiel, et deux écritures
+// concurrentes ne se mélangent pas.
+//     @source_path: chemin du fichier mp4 analysé
+//     @root: l'arbre obtenu en analysant ce fichier
+void writeIndex(const std::string& a_source_path, const Root& a_root);
+
+// Affiche l'arborescence des boîtes d'un index projeté.
+//     @index: l'index projeté
+//     @fileName: le nom du fichier affiché en tête
+void displayIndexTree(const MappedIndex& a_index, const std::string fileName);
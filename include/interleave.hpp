@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <container-parser.hpp>
+#include <movie-writer.hpp>
+
+struct TrackInterleave {
+    uint32_t track_ID       = 0;
+    uint32_t handler_type   = 0;
+    uint32_t chunks         = 0;
+    uint64_t bytes          = 0;
+    double   chunk_duration = 0; // durée moyenne d'un chunk (s)
+};
+
+// Entrelacement des pistes d'un fichier, vu par un lecteur qui le lit
+// séquentiellement et joue toutes les pistes ensemble.
+struct InterleaveReport {
+    std::vector<TrackInterleave> tracks;
+    uint64_t max_distance      = 0; // plus grand écart entre les chunks des pistes lus pour un même instant
+    double   max_distance_time = 0; // instant où il est atteint (s)
+    uint64_t read_ahead        = 0; // octets à garder en mémoire pour jouer les pistes ensemble
+    uint64_t track_switches    = 0; // changements de piste d'un chunk au suivant, dans l'ordre du fichier
+};
+
+// Analyse l'entrelacement : les chunks de toutes les pistes (stco, stsc, stsz,
+// stts) sont placés sur une même ligne de temps. À chaque début de chunk, les
+// chunks qui couvrent cet instant dans chaque piste donnent l'écart entre
+// leurs positions et la plage que le lecteur doit avoir lue.
+// Lève une exception si les tables sont absentes ou incohérentes.
+//     @root: la racine de l'arbre, tables d'échantillons conservées
+//     @return: le bilan de l'entrelacement
+InterleaveReport analyzeInterleaving(const Root& a_root);
+
+// Réécrit un fichier avec ses chunks dans l'ordre de décodage : chaque piste
+// est découpée en chunks de `interleave` secondes, qui alternent dans `mdat`.
+// Les tables stsc et stco sont reconstruites ; les échantillons sont recopiés
+// par copy_file_range, sans passer par l'espace utilisateur (cf writeMovie).
+// Lève une exception si les tables sont incohérentes ou en cas d'erreur
+// d'entrée-sortie.
+//     @root: l'arbre du fichier source, tables d'échantillons conservées
+//     @source: le fichier source
+//     @output: chemin du fichier créé
+//     @interleave: durée d'un chunk (s), strictement positive
+//     @return: le bilan d'écriture
+MovieWriteStats reinterleave(const Root& a_root, const std::string& a_source, const std::string& a_output,
+                             double a_interleave);
+
+// Affiche le bilan de l'entrelacement.
+//     @outstream: flux d'affichage
+//     @report: le bilan affiché
+void printInterleaveReport(std::ostream& a_outstream, const InterleaveReport& a_report);
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include <container-parser.hpp>
+#include <range-reader.hpp>
+
+// Format des unités NAL d'un échantillon extrait.
+enum class NalFormat : uint8_t {
+    LengthPrefixed, // tel que dans le fichier : taille de chaque NAL sur `nal_length_size` octets
+    AnnexB,         // chaque NAL précédée du code de départ 00 00 00 01
+};
+
+struct KeyframeOptions {
+    NalFormat format   = NalFormat::AnnexB;
+    unsigned  threads  = 0;               // 0 : un thread par cœur
+    size_t    max_read = 4 * 1024 * 1024; // taille maximale d'une lecture
+    uint64_t  max_gap  = 4096;            // octets hors images clés lus pour joindre deux plages voisines
+};
+
+// Codage d'une piste vidéo dont les échantillons sont des NAL précédées de leur taille.
+enum class VideoCodec : uint8_t {
+    Avc,  // avc1, configuration avcC
+    Hevc, // hvc1 ou hev1, configuration hvcC
+};
+
+// Configuration de décodage d'une piste vidéo (boîte avcC ou hvcC).
+struct VideoConfig {
+    VideoCodec codec        = VideoCodec::Avc;
+    uint8_t profile         = 0; // AVCProfileIndication, general_profile_idc en HEVC
+    uint8_t compatibility   = 0; // profile_compatibility (AVC)
+    uint8_t level           = 0; // AVCLevelIndication, general_level_idc en HEVC
+    uint8_t nal_length_size = 4; // lengthSizeMinusOne + 1
+    std::vector<std::vector<char>> vps; // ensembles de paramètres, sans taille ni code de départ ; VPS en HEVC seulement
+    std::vector<std::vector<char>> sps;
+    std::vector<std::vector<char>> pps;
+};
+
+struct Keyframe {
+    double   target = 0; // instant visé (s)
+    double   time   = 0; // instant de décodage de l'image clé retenue (s)
+    uint32_t sample = 0; // numéro de l'échantillon, à partir de 1
+    uint64_t offset = 0; // position dans le fichier
+    uint32_t size   = 0; // taille dans le fichier
+    std::vector<char> data; // l'échantillon, au format demandé
+};
+
+struct KeyframeSet {
+    uint32_t  track_ID = 0;
+    NalFormat format   = NalFormat::AnnexB;
+    VideoConfig config;
+    std::vector<Keyframe> frames; // une par instant visé, dans l'ordre ; deux instants peuvent donner la même image
+    uint32_t  distinct     = 0;   // images clés distinctes lues
+    uint64_t  sample_bytes = 0;   // octets de ces images clés
+    uint64_t  reads        = 0;   // lectures envoyées à la source, avcC compris
+    uint64_t  bytes_read   = 0;   // octets lus, écarts entre plages compris
+};
+
+// Décode une configuration AVC (AVCDecoderConfigurationRecord).
+// Lève une exception si l'enregistrement est tronqué.
+//     @data: le contenu de la boîte avcC, après l'entête
+//     @size: sa taille
+VideoConfig decodeAvcConfig(const char *a_data, size_t a_size);
+
+// Remplace la taille de chaque NAL d'un échantillon par le code de départ
+// 00 00 00 01 (Annex B), en AVC comme en HEVC.
+// Lève une exception si une NAL dépasse la fin de l'échantillon.
+//     @data: l'échantillon, NAL précédées de leur taille
+//     @size: sa taille
+//     @length_size: taille du champ de longueur (1 à 4 octets)
+//     @return: l'échantillon au format Annex B
+std::vector<char> toAnnexB(const char *a_data, size_t a_size, uint8_t a_length_size);
+
+// Extrait N images clés réparties sur la durée de la première piste vidéo
+// AVC ou HEVC, pour une planche de vignettes. Les instants visés sont les
+// milieux de N intervalles égaux ; chacun est ramené à l'image clé la plus
+// proche (stts, stss), dont la position et la taille sont calculées à partir
+// de stsc, stco et stsz sans aplatir les tables. Les images clés sont triées
+// par position, les plages voisines regroupées, puis lues en parallèle : le
+// volume lu est celui des images retenues et, en AVC, de la boîte avcC (hvcC
+// est décodée par l'analyse).
+// Lève une exception s'il n'y a pas de piste AVC ou HEVC, si les tables sont
+// incohérentes ou si une lecture échoue.
+//     @root: la racine de l'arbre, tables d'échantillons conservées
+//     @reader: la source des données, dont `read` doit pouvoir être appelé par plusieurs threads
+//     @count: nombre d'images voulues
+//     @options: format des NAL, parallélisme, regroupement des lectures
+//     @return: les images et les ensembles de paramètres de la piste
+KeyframeSet extractKeyframes(const Root& a_root, RangeReader& a_reader, size_t a_count,
+                             const KeyframeOptions& a_options = KeyframeOptions());
+
+// Affiche les images extraites et le bilan des lectures.
+//     @outstream: flux d'affichage
+//     @set: le résultat affiché
+void printKeyframeSet(std::ostream& a_outstream, const KeyframeSet& a_set);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include <container-parser.hpp>
+
+// Mémoire occupée par une ou plusieurs boîtes de l'arbre.
+struct MemoryUsage {
+    uint64_t objects = 0; // taille des objets boîtes eux-mêmes (sizeof de la classe finale)
+    uint64_t heap    = 0; // octets alloués par les vecteurs et chaînes : capacités
+    uint64_t used    = 0; // part de `heap` réellement occupée : tailles
+
+    uint64_t wasted() const { return heap - used; }
+    uint64_t total() const  { return objects + heap; }
+
+    void add(const MemoryUsage& a_other) {
+        objects += a_other.objects;
+        heap    += a_other.heap;
+        used    += a_other.used;
+    }
+};
+
+// Mémoire occupée par les boîtes d'un type.
+struct BoxTypeMemory {
+    std::array<char, 4> type;
+    uint64_t count = 0;
+    MemoryUsage usage;
+};
+
+// Mémoire occupée par une piste : la boîte `trak` et tous ses descendants.
+struct TrackMemory {
+    uint32_t track_ID     = 0;
+    uint32_t handler_type = 0;
+    MemoryUsage usage;
+};
+
+// Bilan mémoire d'un arbre analysé.
+struct MemoryReport {
+    std::vector<BoxTypeMemory> boxes;  // par type de boîte, triés par total décroissant
+    std::vector<TrackMemory>   tracks; // dans l'ordre du fichier
+    MemoryUsage total;                 // arbre entier, racine comprise
+};
+
+// Mémoire occupée par une boîte seule, sans ses enfants. Le vecteur des
+// enfants (pointeurs) est compté dans la boîte parente.
+//     @box: la boîte
+//     @return: la mémoire de l'objet et de ses allocations propres
+MemoryUsage boxMemory(const Box& a_box);
+
+// Parcourt l'arbre depuis la racine et totalise la mémoire par type de boîte
+// et par piste.
+//     @root: la racine de l'arbre analysé
+//     @return: le bilan
+MemoryReport memoryReport(const Root& a_root);
+
+// Affiche le bilan sous forme de tableaux.
+//     @outstream: flux d'affichage
+//     @report: le bilan affiché
+void printMemoryReport(std::ostream& a_outstream, const MemoryReport& a_report);
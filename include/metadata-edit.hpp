@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <container-parser.hpp>
+
+// Élément texte de la liste de métadonnées (moov/udta/meta/ilst).
+struct MetadataTag {
+    std::array<char, 4> key;   // clé de l'élément, ex. '\xA9' 'n' 'a' 'm' pour le titre
+    std::string         value; // texte UTF-8 ; vide pour supprimer l'élément
+};
+
+// Façon dont la modification a été écrite.
+enum class MetadataPlacement : uint8_t {
+    InPlace,   // à sa place, en prenant sur une boîte free voisine ou en en créant une
+    EndOfFile, // moov en fin de fichier : réécrit là, le fichier allongé ou raccourci
+    Rewritten, // fichier réécrit : moov agrandi, positions des chunks décalées
+};
+
+struct MetadataEditResult {
+    MetadataPlacement   placement = MetadataPlacement::InPlace;
+    uint64_t            ilst_size_before = 0; // 0 si la boîte n'existait pas
+    uint64_t            ilst_size_after  = 0;
+    std::array<char, 4> resized = {'i', 'l', 's', 't'}; // plus haute boîte dont la taille change
+    uint64_t            free_before = 0; // boîte free voisine absorbée ou créée, avant
+    uint64_t            free_after  = 0; // et après (0 : supprimée ou absente)
+    uint64_t            bytes_written = 0;
+    uint64_t            write_calls   = 0;
+    uint64_t            shifted_chunks = 0; // positions de chunks décalées (Rewritten)
+};
+
+// Lit les éléments texte de la liste de métadonnées.
+// Lève une exception en cas d'erreur d'entrée-sortie.
+//     @root: l'arbre du fichier
+//     @path: le fichier analysé
+//     @return: les éléments texte, dans l'ordre du fichier
+std::vector<MetadataTag> readMetadata(const Root& a_root, const std::string& a_path);
+
+// Modifie les métadonnées d'un fichier sans réécrire ses échantillons. La
+// liste ilst est recalculée (éléments remplacés, ajoutés ou supprimés) et la
+// branche udta/meta/ilst créée si elle manque. La variation de taille est
+// reportée sur les boîtes englobantes jusqu'à la première qui peut l'absorber :
+// une boîte free qui la suit et qu'on réduit ou agrandit, une boîte free créée
+// derrière elle si elle rétrécit, ou moov s'il termine le fichier. Seuls la
+// boîte modifiée, ce qui la suit dans la boîte qui absorbe et les tailles des
+// boîtes englobantes sont écrits : quelques Kio, quelle que soit la taille du
+// fichier. À défaut, le fichier est réécrit avec un moov agrandi et les
+// positions des chunks décalées (cf serializeTree).
+// L'arbre reçoit les nouvelles boîtes, mais ses tailles et positions ne sont
+// pas mises à jour : le fichier doit être relu avant une autre opération.
+// Lève une exception si moov manque, si une position de chunk dépasse 32 bits
+// après décalage ou en cas d'erreur d'entrée-sortie.
+//     @root: l'arbre du fichier, tables d'échantillons conservées
+//     @path: le fichier modifié
+//     @tags: les éléments à écrire
+//     @return: le bilan de l'écriture
+MetadataEditResult editMetadata(Root& a_root, const std::string& a_path, const std::vector<MetadataTag>& a_tags);
+
+// Affiche les éléments texte, une ligne chacun.
+//     @outstream: flux d'affichage
+//     @tags: les éléments affichés
+void printMetadata(std::ostream& a_outstream, const std::vector<MetadataTag>& a_tags);
+
+// Affiche le bilan de la modification.
+//     @outstream: flux d'affichage
+//     @result: le bilan affiché
+void printMetadataEditResult(std::ostream& a_outstream, const MetadataEditResult& a_result);
@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <box-writer.hpp>
+#include <container-parser.hpp>
+
+// Échantillon d'un fichier réécrit, désigné par sa place dans un fichier source.
+struct OutputSample {
+    uint64_t offset;       // position dans le fichier source
+    uint32_t size;
+    uint32_t delta;        // durée, dans l'échelle de temps du média
+    int32_t  composition;  // présentation moins décodage (ctts), dans l'échelle de temps du média
+    uint32_t source;       // indice du fichier source
+    uint32_t source_chunk; // chunk d'origine : deux échantillons consécutifs du même chunk sont écrits dans un même chunk
+    uint32_t description;  // entrée de `stsd`, à partir de 1
+    bool     sync;
+};
+
+// Entrée de liste d'éditions (elst), vitesse 1.
+struct EditEntry {
+    uint64_t segment_duration; // dans l'échelle de temps du film (mvhd)
+    int64_t  media_time;       // dans l'échelle de temps du média, -1 pour une édition vide
+};
+
+// Piste d'un fichier réécrit. Les boîtes de la piste source sont recopiées
+// telles quelles, sauf les durées (tkhd, mdhd), la liste d'éditions et les
+// tables d'échantillons, reconstruites à partir de `samples`. stss n'est
+// écrite que si la piste source en a une, ctts que si un échantillon a un
+// décalage de composition ; stsz garde une taille commune si la source en a
+// une et que tous les échantillons la respectent. Les autres boîtes de `stbl`
+// décrivent les échantillons de la source et ne sont pas reprises : l'écriture
+// échoue si la piste source en contient.
+struct OutputTrack {
+    const Trak *trak = nullptr;        // piste source, dans l'arbre du premier fichier source
+    std::vector<OutputSample> samples; // dans l'ordre de décodage
+    std::vector<EditEntry> edits;      // remplace elst de la source ; vide pour omettre edts
+};
+
+// Reprend une piste source entière : tous ses échantillons, dans leurs chunks,
+// et sa liste d'éditions (vitesse 1).
+// Lève une exception si les tables sont absentes ou incohérentes.
+//     @trak: la piste source
+//     @source: indice du fichier source de la piste
+//     @return: la piste à écrire
+OutputTrack copyTrack(const Trak& a_trak, uint32_t a_source = 0);
+
+struct MovieWriteStats {
+    uint64_t moov_size    = 0;
+    uint64_t mdat_size    = 0; // données, entête compris
+    uint64_t file_size    = 0;
+    uint64_t copied_bytes = 0; // octets d'échantillons copiés
+    uint64_t copy_runs    = 0; // plages contiguës copiées
+    uint64_t copy_calls   = 0; // appels système de copie
+};
+
+// Ordre des chunks dans le `mdat` écrit.
+enum class ChunkOrder : uint8_t {
+    Source, // ordre des fichiers sources : l'entrelacement est conservé
+    Time,   // ordre de décodage, toutes pistes confondues (à égalité, ordre des pistes)
+};
+
+// Plage d'octets d'un fichier source recopiée telle quelle dans le fichier écrit.
+struct PayloadRun {
+    uint32_t source;        // indice du fichier source
+    uint64_t source_offset;
+    uint64_t size;
+    uint64_t offset;        // position dans le fichier écrit
+};
+
+// Contenu d'un fichier à écrire : les boîtes qui précèdent les échantillons
+// (ftyp, moov, entête de mdat), puis les plages d'échantillons.
+struct MovieLayout {
+    BoxBuffer head;
+    std::vector<PayloadRun> runs; // triées par source puis par position, plages contiguës jointes
+    MovieWriteStats stats;        // tailles ; les champs de copie restent nuls
+};
+
+// Prépare l'écriture d'un fichier (cf writeMovie) sans rien écrire.
+// Lève une exception si une position dépasse 32 bits.
+//     @root: l'arbre du premier fichier source, tables d'échantillons comprises
+//     @boxes_source: descripteur du fichier de `root`, d'où sont recopiées les boîtes
+//     @tracks: les pistes écrites
+//     @order: ordre des chunks
+//     @return: l'entête du fichier et les plages à copier
+MovieLayout layoutMovie(const Root& a_root, int a_boxes_source, const std::vector<OutputTrack>& a_tracks,
+                        ChunkOrder a_order = ChunkOrder::Source);
+
+// Écrit un fichier mp4 : `ftyp` du premier fichier source, `moov` reconstruit
+// (seules les pistes de `tracks` sont gardées), puis un `mdat` formé des
+// échantillons. Par défaut, les chunks gardent l'ordre des fichiers sources,
+// ce qui conserve l'entrelacement ; dans tous les cas, les plages contiguës
+// dans la source et dans le fichier écrit sont copiées en une seule fois par
+// copy_file_range.
+// Lève une exception si une position dépasse 32 bits (co64 non pris en charge)
+// ou en cas d'erreur d'entrée-sortie.
+//     @root: l'arbre du premier fichier source, tables d'échantillons comprises
+//     @sources: descripteurs des fichiers sources, le premier étant celui de `root`
+//     @tracks: les pistes écrites
+//     @output: chemin du fichier créé, distinct des sources
+//     @order: ordre des chunks
+//     @return: les tailles écrites et le bilan des copies
+MovieWriteStats writeMovie(const Root& a_root, const std::vector<int>& a_sources,
+                           const std::vector<OutputTrack>& a_tracks, const std::string& a_output,
+                           ChunkOrder a_order = ChunkOrder::Source);
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+
+// Fonction qui traite une tâche, désignée par son indice.
+using ParallelJob = std::function<void(size_t)>;
+
+// Traite les tâches 0 à count-1 sur un groupe de threads : chaque thread prend
+// l'indice suivant tant qu'il en reste, le thread appelant participe. Chaque
+// thread obtient sa propre fonction de `make_job`, qui peut garder un état
+// réutilisé d'une tâche à l'autre (tampon de lecture). À la première
+// exception, les threads s'arrêtent après leur tâche en cours et l'exception
+// est relancée dans le thread appelant.
+//     @count: nombre de tâches
+//     @threads: nombre de threads demandé, 0 pour un par cœur ; jamais plus que de tâches
+//     @make_job: appelée une fois par thread, renvoie la fonction qui traite une tâche
+//     @return: le nombre de threads utilisés, thread appelant compris
+unsigned runParallel(size_t a_count, unsigned a_threads, const std::function<ParallelJob()>& a_make_job);
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+// Statistiques d'analyse d'un type de boîte. Les valeurs sont propres à la
+// boîte : celles de ses boîtes enfants ne sont pas comptées.
+struct BoxTypeStats {
+    std::array<char, 4> type = {' ', ' ', ' ', ' '};
+    uint64_t count         = 0; // nombre de boîtes analysées
+    uint64_t bytes         = 0; // taille cumulée des boîtes, entêtes et enfants compris
+    uint64_t decoded_bytes = 0; // octets de données lus par l'analyse de la boîte elle-même
+    uint64_t parse_ns      = 0; // temps passé dans `parse`, hors boîtes enfants
+    uint64_t seeks         = 0; // déplacements dans le bitstream
+};
+
+// Statistiques d'analyse d'un thread.
+struct ParseStats {
+    std::vector<BoxTypeStats> boxes; // un élément par type de boîte rencontré
+    uint64_t headers   = 0;          // nombre d'entêtes lus
+    uint64_t header_ns = 0;          // temps passé dans `parseHeader`
+
+    // Ajoute les statistiques d'un autre thread.
+    //     @other: les statistiques ajoutées
+    void merge(const ParseStats& a_other);
+};
+
+// Compteurs bruts du thread, mis à jour par le parser.
+struct ParseCounters {
+    // Cumul inclusif (boîte et descendants) de l'analyse d'une boîte
+    struct Totals {
+        uint64_t ns      = 0;
+        uint64_t bytes   = 0;
+        uint64_t seeks   = 0;
+        uint64_t skipped = 0;
+    };
+
+    std::unordered_map<uint32_t, BoxTypeStats> by_type; // indexé par le code FourCC (hvc1 et hev1 distincts)
+    uint64_t headers   = 0;
+    uint64_t header_ns = 0;
+    uint64_t seeks     = 0;  // déplacements depuis le début du thread
+    uint64_t skipped   = 0;  // octets sautés depuis le début du thread
+    Totals   children;       // cumul des boîtes enfants de la boîte en cours d'analyse
+    bool     timed     = false; // mesure des temps d'analyse, cf setParseTiming
+};
+
+// Compteurs du thread appelant.
+ParseCounters& parseCounters();
+
+// Statistiques d'analyse du thread appelant, depuis son démarrage ou le
+// dernier appel à `resetParseStats`.
+//     @return: les statistiques, triées par temps d'analyse décroissant
+ParseStats parseStats();
+
+// Remet à zéro les statistiques du thread appelant. La mesure des temps
+// reste dans l'état choisi par `setParseTiming`.
+void resetParseStats();
+
+// Active la mesure des temps d'analyse du thread appelant. Désactivée par
+// défaut : seuls les nombres de boîtes, d'octets et de déplacements sont
+// comptés, sans lecture d'horloge par boîte.
+//     @enabled: vrai pour mesurer `parse_ns` et `header_ns`
+void setParseTiming(bool a_enabled);
+
+// Affiche les statistiques sous forme de tableau.
+//     @outstream: flux d'affichage
+//     @stats: les statistiques affichées
+void printParseStats(std::ostream& a_outstream, const ParseStats& a_stats);
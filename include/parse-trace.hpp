@@ -0,0 +1,112 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+
+#include <text-dump.hpp>
+
+// Export de la chronologie de l'analyse au format « Chrome trace event » (JSON),
+// lisible par Perfetto (ui.perfetto.dev) et chrome://tracing.
+//
+// Chaque portée tracée produit un évènement complet (`"ph":"X"`) ; les
+// évènements d'un même thread s'imbriquent d'après leurs horodatages, ce qui
+// reproduit l'arbre des boîtes. Les évènements portant sur une boîte ont pour
+// arguments son type, sa position et sa taille.
+//
+// Le traçage est désactivé tant qu'aucun TraceWriter n'est installé : une
+// portée ne coûte alors qu'un test de pointeur.
+class TraceWriter {
+public:
+    // Arguments d'un évènement portant sur une boîte
+    struct BoxArgs {
+        std::array<char, 4> type;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    // @out: le flux de sortie du JSON, qui doit survivre au TraceWriter
+    explicit TraceWriter(std::ostream& a_out);
+    // Termine le document JSON.
+    ~TraceWriter();
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    // Installe le writer destinataire des évènements de tous les threads.
+    //     @writer: le writer, nullptr pour désactiver le traçage
+    static void install(TraceWriter *a_writer) { s_active = a_writer; }
+    // Writer installé, nullptr si le traçage est désactivé.
+    static TraceWriter *active() { return s_active; }
+
+    // Écrit un évènement complet.
+    //     @name: nom de l'évènement
+    //     @category: catégorie (parse, header, table, io)
+    //     @beg: début de l'évènement
+    //     @end: fin de l'évènement
+    //     @box: type, position et taille de la boîte concernée, nullptr si aucune
+    void complete(std::string_view a_name, const char *a_category,
+                  std::chrono::steady_clock::time_point a_beg,
+                  std::chrono::steady_clock::time_point a_end, const BoxArgs *a_box);
+
+private:
+    // Écrit une chaîne JSON échappée, guillemets compris.
+    void writeString(std::string_view a_str);
+    // Écrit une durée en microsecondes avec trois décimales.
+    void writeMicros(uint64_t a_ns);
+
+    static inline TraceWriter *s_active = nullptr;
+
+    std::mutex m_mutex;
+    DumpWriter m_writer;
+    std::chrono::steady_clock::time_point m_epoch;
+    bool m_first = true;
+};
+
+// Portée tracée : l'évènement couvre la durée de vie de l'objet.
+class TraceScope {
+public:
+    // @name: nom de l'évènement, doit rester valide jusqu'à la fin de la portée
+    // @category: catégorie de l'évènement
+    TraceScope(std::string_view a_name, const char *a_category)
+        : m_writer(TraceWriter::active()) {
+        if (m_writer != nullptr) {
+            m_name = a_name;
+            m_category = a_category;
+            m_beg = std::chrono::steady_clock::now();
+        }
+    }
+    ~TraceScope() {
+        if (m_writer != nullptr) {
+            m_writer->complete(m_name, m_category, m_beg, std::chrono::steady_clock::now(),
+                               m_has_box ? &m_box : nullptr);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+    bool enabled() const { return m_writer != nullptr; }
+
+    // Associe une boîte à l'évènement, par ex. une fois son entête lu.
+    //     @type: type de la boîte
+    //     @offset: position de la boîte dans le fichier
+    //     @size: taille de la boîte
+    void setBox(std::array<char, 4> a_type, uint64_t a_offset, uint64_t a_size) {
+        if (m_writer != nullptr) {
+            m_box = {a_type, a_offset, a_size};
+            m_has_box = true;
+        }
+    }
+
+private:
+    TraceWriter *m_writer;
+    std::string_view m_name;
+    const char *m_category = nullptr;
+    std::chrono::steady_clock::time_point m_beg;
+    TraceWriter::BoxArgs m_box;
+    bool m_has_box = false;
+};
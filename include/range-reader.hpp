@@ -0,0 +1,128 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <vector>
+
+// Source de données lue par plages d'octets : fichier local, stockage objet
+// (requêtes HTTP Range)... Chaque appel à `read` correspond à une requête.
+class RangeReader {
+public:
+    virtual ~RangeReader() = default;
+
+    // Taille totale de la source.
+    virtual uint64_t size() = 0;
+
+    // Lit une plage d'octets.
+    //     @offset: position du début de la plage
+    //     @buffer: destination, d'au moins `size` octets
+    //     @size: taille de la plage
+    //     @return: le nombre d'octets lus, inférieur à `size` en fin de source
+    virtual size_t read(uint64_t a_offset, char *a_buffer, size_t a_size) = 0;
+};
+
+// Fichier local lu par pread.
+class FileRangeReader : public RangeReader {
+public:
+    // @path: chemin du fichier, lève une exception s'il ne peut être ouvert
+    explicit FileRangeReader(const std::string& a_path);
+    ~FileRangeReader() override;
+
+    FileRangeReader(const FileRangeReader&) = delete;
+    FileRangeReader& operator=(const FileRangeReader&) = delete;
+
+    uint64_t size() override { return m_size; }
+    size_t read(uint64_t a_offset, char *a_buffer, size_t a_size) override;
+
+private:
+    int      m_fd;
+    uint64_t m_size;
+};
+
+// Substitut d'une source distante pour les essais : délègue à une autre
+// source en ajoutant une latence fixe à chaque requête.
+class LatencyRangeReader : public RangeReader {
+public:
+    // @source: la source réelle
+    // @latency: durée ajoutée à chaque requête
+    LatencyRangeReader(std::unique_ptr<RangeReader> a_source, std::chrono::microseconds a_latency)
+        : m_source(std::move(a_source)), m_latency(a_latency) {}
+
+    uint64_t size() override { return m_source->size(); }
+    size_t read(uint64_t a_offset, char *a_buffer, size_t a_size) override;
+
+private:
+    std::unique_ptr<RangeReader> m_source;
+    std::chrono::microseconds    m_latency;
+};
+
+// Compteurs d'un RangeStreamBuf.
+struct RangeCounters {
+    uint64_t requests     = 0; // requêtes envoyées à la source
+    uint64_t fetched      = 0; // octets reçus de la source
+    uint64_t overfetched  = 0; // octets reçus mais jamais lus par le parser
+    uint64_t cache_hits   = 0; // blocs servis depuis le cache
+    uint64_t cache_misses = 0; // blocs demandés à la source
+};
+
+// Tampon de flux (std::streambuf) au-dessus d'un RangeReader : le parser
+// l'utilise au travers d'un std::istream, sans connaître la source.
+//
+// La source est découpée en blocs de taille fixe gardés dans un petit cache
+// LRU. Un déplacement (seekg) ne coûte aucune requête ; une lecture hors cache
+// demande en une seule requête le bloc manquant et les blocs suivants
+// (lecture anticipée). La fenêtre de lecture anticipée double tant que les
+// accès sont séquentiels et revient au minimum après un saut, ce qui regroupe
+// les petites lectures adjacentes sans lire les grandes zones sautées (mdat).
+class RangeStreamBuf : public std::streambuf {
+public:
+    struct Options {
+        size_t block_size      = 64 * 1024;
+        size_t cache_blocks    = 32; // blocs gardés en cache
+        size_t min_read_ahead  = 1;  // blocs lus par requête après un saut
+        size_t max_read_ahead  = 16; // blocs lus par requête en lecture séquentielle
+    };
+
+    // @reader: la source, qui doit survivre au tampon
+    // @options: tailles des blocs, du cache et de la lecture anticipée
+    explicit RangeStreamBuf(RangeReader& a_reader, Options a_options);
+    explicit RangeStreamBuf(RangeReader& a_reader) : RangeStreamBuf(a_reader, Options()) {}
+
+    // Compteurs depuis la création du tampon.
+    RangeCounters counters() const;
+
+protected:
+    int_type underflow() override;
+    pos_type seekoff(off_type a_offset, std::ios_base::seekdir a_dir, std::ios_base::openmode a_which) override;
+    pos_type seekpos(pos_type a_position, std::ios_base::openmode a_which) override;
+
+private:
+    struct Block {
+        uint64_t          index;
+        uint64_t          last_use;
+        std::vector<char> data;
+        bool              touched; // au moins un octet lu par le parser
+    };
+
+    // Position de lecture courante dans la source.
+    uint64_t position() const;
+    // Bloc d'indice donné, lu depuis la source si besoin.
+    Block& loadBlock(uint64_t a_index);
+    // Bloc du cache à remplacer.
+    Block& evictBlock();
+
+    RangeReader&       m_reader;
+    Options            m_options;
+    uint64_t           m_size;
+    std::vector<Block> m_blocks;
+    uint64_t           m_clock = 0;          // horloge LRU
+    uint64_t           m_area_offset = 0;    // position du début de la zone de lecture (eback)
+    uint64_t           m_position = 0;       // position courante quand la zone de lecture est vide
+    uint64_t           m_next_block = 0;     // bloc suivant le dernier bloc demandé
+    size_t             m_read_ahead;         // fenêtre courante, en blocs
+    RangeCounters      m_counters;
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <container-parser.hpp>
+
+// Description d'un échantillon (image, trame audio) obtenue en aplatissant les
+// tables de la boîte `stbl` (stts, stss, stsc, stsz, stco).
+struct SampleInfo {
+    uint64_t offset; // position de l'échantillon dans le bitstream
+    uint64_t dts;    // instant de décodage, dans l'échelle de temps du média
+    uint32_t size;   // taille en octets
+    uint32_t sync;   // 1 si l'échantillon est un point d'accès aléatoire
+};
+
+// Boîtes d'une piste utiles à la lecture de ses échantillons. Les pointeurs
+// absents (boîte optionnelle ou manquante) valent nullptr.
+struct TrackBoxes {
+    Tkhd *tkhd = nullptr;
+    Mdhd *mdhd = nullptr;
+    Hdlr *hdlr = nullptr;
+    Stbl *stbl = nullptr;
+    Stts *stts = nullptr;
+    Ctts *ctts = nullptr;
+    Stss *stss = nullptr;
+    Stsc *stsc = nullptr;
+    Stsz *stsz = nullptr;
+    Stco *stco = nullptr;
+};
+
+// Retrouve les boîtes utiles d'une piste.
+//     @trak: la boîte `trak` analysée
+//     @return: les pointeurs vers les boîtes trouvées
+TrackBoxes findTrackBoxes(const Trak& a_trak);
+
+// Liste les pistes contenues dans l'arbre.
+//     @root: la racine de l'arbre
+//     @return: les boîtes `trak` dans l'ordre du fichier
+std::vector<Trak*> findTracks(const Root& a_root);
+
+// Aplatit les tables d'échantillons d'une piste : un élément par échantillon.
+// Lève une exception si les tables sont absentes ou incohérentes.
+//     @trak: la boîte `trak` analysée
+//     @return: les échantillons dans l'ordre de décodage
+std::vector<SampleInfo> flattenSamples(const Trak& a_trak);
+
+// Parcours des échantillons d'une piste dans l'ordre de décodage, sans aplatir
+// les tables : la mémoire utilisée ne dépend pas du nombre d'échantillons.
+// Les échantillons produits sont identiques à ceux de `flattenSamples`.
+// Lève une exception si les tables sont absentes ou incohérentes.
+class SampleCursor {
+public:
+    // @trak: la boîte `trak` analysée
+    explicit SampleCursor(const Trak& a_trak);
+
+    uint32_t sampleCount() const { return m_count; }
+    // Vrai une fois tous les échantillons parcourus.
+    bool done() const { return m_index >= m_count; }
+    // Indice de l'échantillon courant, à partir de 0.
+    uint32_t index() const { return m_index; }
+    // Échantillon courant, valide tant que `done()` est faux.
+    const SampleInfo& sample() const { return m_sample; }
+    // Fin des échantillons déjà parcourus, dans l'échelle de temps du média :
+    // l'instant de décodage de l'échantillon courant, ou celui qui suit le
+    // dernier échantillon (durée totale de stts) une fois `done()` vrai.
+    uint64_t endDts() const { return m_sample.dts; }
+    // Chunk de l'échantillon courant, à partir de 1.
+    uint32_t chunk() const { return m_chunk; }
+    // Entrée de `stsd` décrivant l'échantillon courant, à partir de 1.
+    uint32_t descriptionIndex() const { return m_boxes.stsc->samples_description_index[m_stsc_entry]; }
+    // Écart entre instants de présentation et de décodage de l'échantillon
+    // courant (ctts), 0 si la piste n'a pas de `ctts`.
+    int32_t compositionOffset() const { return m_composition; }
+    // Passe à l'échantillon suivant.
+    void next();
+
+private:
+    // Passe au chunk suivant et place la position au début de celui-ci.
+    void nextChunk();
+    // Renseigne la taille et l'indicateur de synchronisation de l'échantillon courant.
+    void loadSample();
+
+    TrackBoxes m_boxes;
+    uint32_t   m_count = 0;
+    uint32_t   m_index = 0;
+    uint32_t   m_stts_entry = 0; // entrée courante de `stts`
+    uint32_t   m_stts_done  = 0; // échantillons de l'entrée courante déjà parcourus
+    uint32_t   m_ctts_entry = 0; // entrée courante de `ctts`
+    uint32_t   m_ctts_done  = 0; // échantillons de l'entrée courante déjà parcourus
+    int32_t    m_composition = 0; // décalage de composition de l'échantillon courant
+    uint32_t   m_stsc_entry = 0; // entrée courante de `stsc`
+    uint32_t   m_chunk      = 0; // chunk courant, à partir de 1
+    uint32_t   m_chunk_left = 0; // échantillons restant dans le chunk courant
+    size_t     m_stss_next  = 0; // prochaine entrée de `stss` à comparer
+    SampleInfo m_sample = {0, 0, 0, 0};
+};
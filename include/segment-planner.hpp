@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <container-parser.hpp>
+
+// Plage d'octets contiguë du fichier.
+struct ByteRange {
+    uint64_t offset;
+    uint64_t size;
+};
+
+// Segment d'une piste : échantillons consécutifs dans l'ordre de décodage.
+struct Segment {
+    uint32_t first_sample = 0;
+    uint32_t sample_count = 0;
+    uint64_t start    = 0;          // instant du premier échantillon, dans l'échelle de temps du média
+    uint64_t duration = 0;          // dans l'échelle de temps du média
+    std::vector<ByteRange> ranges;  // données des échantillons, plages adjacentes fusionnées
+
+    // Plage couvrant toutes les données du segment, du premier au dernier octet.
+    ByteRange span() const;
+};
+
+// Segments d'une piste.
+struct TrackPlan {
+    uint32_t track_ID     = 0;
+    uint32_t handler_type = 0;
+    uint32_t timescale    = 0;
+    std::vector<Segment> segments;
+};
+
+// Découpage de toutes les pistes du fichier aux mêmes instants.
+struct SegmentPlan {
+    uint32_t reference_track = 0;     // piste dont les points d'accès aléatoire fixent les limites
+    uint32_t timescale = 0;           // échelle de temps de `boundaries`
+    std::vector<uint64_t> boundaries; // débuts des segments, dans l'échelle de temps de la piste de référence
+    std::vector<TrackPlan> tracks;    // dans l'ordre du fichier
+};
+
+// Découpe les pistes en segments d'au moins `target` secondes commençant sur
+// un point d'accès aléatoire de la première piste vidéo (ou de la première
+// piste à défaut). Les autres pistes sont coupées aux mêmes instants. Le
+// calcul parcourt une fois les tables de chaque piste, sans lire `mdat`.
+//     @root: la racine de l'arbre analysé
+//     @target: durée visée des segments, en secondes
+//     @return: le découpage
+SegmentPlan planSegments(const Root& a_root, double a_target);
+
+// Écrit la liste de lecture HLS d'une piste, un segment par plage d'octets
+// (EXT-X-BYTERANGE). La plage d'un segment couvre toutes ses données : dans un
+// fichier entrelacé, elle contient aussi celles des autres pistes.
+//     @outstream: flux d'écriture
+//     @track: les segments de la piste
+//     @uri: l'URI du fichier média
+void writeHlsPlaylist(std::ostream& a_outstream, const TrackPlan& a_track, const std::string& a_uri);
+
+// Affiche le découpage : limites puis segments et plages d'octets de chaque piste.
+//     @outstream: flux d'affichage
+//     @plan: le découpage affiché
+void printSegmentPlan(std::ostream& a_outstream, const SegmentPlan& a_plan);
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include <container-parser.hpp>
+
+// Invariant des tables d'échantillons non respecté.
+enum class ValidationError : uint8_t {
+    MissingMovie,   // pas de boîte moov
+    NoTracks,       // moov sans boîte trak
+    MissingTable,   // stts, stsc, stsz ou stco absente
+    EntryCount,     // entry_count (sample_count pour stsz) différent du nombre d'entrées lues
+    StscFirstChunk, // first_chunk ne commence pas à 1, ne croît pas strictement ou dépasse stco
+    StscTotal,      // échantillons décrits par stsc et stco différents de sample_count de stsz
+    SttsTotal,      // somme des sample_count de stts différente de sample_count de stsz
+    StssOrder,      // stss non strictement croissante ou hors des échantillons
+    OutOfBounds,    // échantillons hors de toute boîte mdat
+    Overlap,        // échantillons partageant des octets avec un autre chunk
+};
+
+// Nom court d'une erreur, pour l'affichage.
+const char *validationErrorName(ValidationError a_error);
+
+struct ValidationIssue {
+    uint32_t            track_ID; // 0 pour les erreurs du fichier (MissingMovie, NoTracks)
+    ValidationError     error;
+    std::array<char, 4> table  = {' ', ' ', ' ', ' '}; // table fautive
+    uint64_t            index  = 0; // entrée de table fautive, ou premier échantillon concerné (à partir de 0)
+    uint64_t            count  = 0; // échantillons concernés (OutOfBounds, Overlap), ou total trouvé (SttsTotal, StscTotal)
+    uint64_t            offset = 0; // octets concernés (OutOfBounds, Overlap)
+    uint64_t            size   = 0;
+    uint32_t            other_track = 0; // piste de l'autre chunk (Overlap)
+};
+
+struct ValidationReport {
+    uint32_t tracks      = 0;
+    uint64_t chunks      = 0; // chunks vérifiés
+    uint64_t samples     = 0; // échantillons vérifiés
+    uint64_t media_bytes = 0; // octets de mdat décrits par les échantillons vérifiés
+    uint64_t issue_count = 0; // toutes les erreurs, y compris celles non conservées
+    std::vector<ValidationIssue> issues; // les premières erreurs, dans l'ordre de détection
+
+    bool valid() const { return issue_count == 0; }
+};
+
+// Vérifie la cohérence des tables d'échantillons de toutes les pistes, sans
+// lire les données de `mdat` : tables présentes et de tailles cohérentes,
+// first_chunk de stsc strictement croissant, totaux de stts et stsc égaux au
+// nombre d'échantillons de stsz, stss ordonnée, chaque chunk (stco et tailles
+// de stsz) contenu dans une boîte mdat et sans recouvrement avec un autre.
+// Les boîtes mdat sont bornées par la taille réelle du fichier : celles d'un
+// fichier tronqué ne couvrent que les octets présents. Un fichier sans moov ou
+// sans piste est signalé comme invalide.
+//
+// Chaque table est parcourue une seule fois par des boucles sans branchement
+// (comptage des violations, sommes des tailles) que le compilateur vectorise ;
+// les erreurs ne sont localisées qu'une fois détectées. Les recouvrements sont
+// cherchés par un tri des chunks de toutes les pistes.
+//     @root: la racine de l'arbre, tables d'échantillons conservées
+//     @file_size: taille du fichier analysé, en octets
+//     @max_issues: nombre maximal d'erreurs conservées dans le rapport
+//     @return: le rapport, vide d'erreurs si le fichier est valide
+ValidationReport validateSampleTables(const Root& a_root, uint64_t a_file_size, size_t a_max_issues = 1000);
+
+// Affiche le bilan et les erreurs conservées.
+//     @outstream: flux d'affichage
+//     @report: le rapport affiché
+void printValidationReport(std::ostream& a_outstream, const ValidationReport& a_report);
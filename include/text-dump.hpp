@@ -0,0 +1,100 @@
+#pragma once
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <string_view>
+#include <type_traits>
+
+// Tampon d'écriture du texte des boîtes. Les entiers sont formatés avec
+// std::to_chars directement dans le tampon, qui n'est vidé dans le flux de
+// sortie que lorsqu'il est plein (ou à la destruction) : l'affichage des
+// grandes tables ne coûte que quelques appels système.
+// Le texte produit est identique à celui des `operator<<` d'un std::ostream
+// dans son état par défaut.
+class DumpWriter {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 20;
+
+    // @out: le flux de sortie
+    // @capacity: taille du tampon
+    // @columnar: affiche les tables d'échantillons en colonnes, une ligne par entrée
+    explicit DumpWriter(std::ostream& a_out, size_t a_capacity = DEFAULT_CAPACITY, bool a_columnar = false)
+        : m_out(a_out), m_buffer(new char[a_capacity]), m_capacity(a_capacity), m_columnar(a_columnar) {}
+    ~DumpWriter() { flush(); }
+
+    DumpWriter(const DumpWriter&) = delete;
+    DumpWriter& operator=(const DumpWriter&) = delete;
+
+    bool columnar() const { return m_columnar; }
+
+    // Vide le tampon dans le flux de sortie.
+    void flush() {
+        m_out.write(m_buffer.get(), m_size);
+        m_size = 0;
+    }
+
+    void write(const char *a_data, size_t a_size) {
+        if (m_size + a_size > m_capacity) {
+            flush();
+            if (a_size > m_capacity) {
+                m_out.write(a_data, a_size);
+                return;
+            }
+        }
+        std::memcpy(m_buffer.get() + m_size, a_data, a_size);
+        m_size += a_size;
+    }
+
+    DumpWriter& operator<<(std::string_view a_str) {
+        write(a_str.data(), a_str.size());
+        return *this;
+    }
+    DumpWriter& operator<<(const char *a_str) {
+        return *this << std::string_view(a_str);
+    }
+    // les types caractères sont écrits tels quels, comme avec un std::ostream
+    DumpWriter& operator<<(char a_c) {
+        if (m_size == m_capacity) {
+            flush();
+        }
+        m_buffer[m_size++] = a_c;
+        return *this;
+    }
+    DumpWriter& operator<<(signed char a_c)   { return *this << char(a_c); }
+    DumpWriter& operator<<(unsigned char a_c) { return *this << char(a_c); }
+
+    template<typename T, typename = std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+    DumpWriter& operator<<(T a_value) {
+        // 20 chiffres et le signe suffisent pour tous les entiers sur 64 bits
+        if (m_size + 21 > m_capacity) {
+            flush();
+        }
+        char *end = std::to_chars(m_buffer.get() + m_size, m_buffer.get() + m_capacity, a_value).ptr;
+        m_size = end - m_buffer.get();
+        return *this;
+    }
+
+    // Écrit un entier aligné à droite sur `width` caractères.
+    //     @value: l'entier
+    //     @width: largeur minimale de la colonne
+    template<typename T>
+    void column(T a_value, size_t a_width) {
+        char digits[24];
+        size_t length = std::to_chars(digits, digits + sizeof(digits), a_value).ptr - digits;
+        for (size_t i = length; i < a_width; i++) {
+            *this << ' ';
+        }
+        write(digits, length);
+    }
+
+private:
+    std::ostream&           m_out;
+    std::unique_ptr<char[]> m_buffer;
+    size_t                  m_capacity;
+    size_t                  m_size = 0;
+    bool                    m_columnar;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include <container-parser.hpp>
+
+// Statistiques de débit, de GOP et de tailles d'échantillons d'une piste,
+// calculées à partir des seules tables d'échantillons (stsz, stts, stss) et de
+// l'échelle de temps de `mdhd`, sans lire les données de `mdat`.
+struct TrackAnalytics {
+    uint32_t track_ID     = 0;
+    uint32_t handler_type = 0;
+    uint32_t timescale    = 0;
+
+    uint32_t sample_count = 0;
+    uint64_t duration     = 0; // somme des durées des échantillons, dans l'échelle de temps du média
+    uint64_t total_bytes  = 0;
+
+    // débits en bit/s
+    double   window          = 0; // durée de la fenêtre glissante du débit crête (s)
+    uint64_t average_bitrate = 0;
+    uint64_t peak_bitrate    = 0; // débit maximal sur une fenêtre glissante
+    uint64_t peak_dts        = 0; // début de la fenêtre du débit crête
+
+    // tailles d'échantillons
+    uint32_t min_sample_size = 0;
+    uint32_t max_sample_size = 0;
+    std::vector<uint64_t> size_histogram; // indice k : tailles dans [2^k, 2^(k+1)), 0 compris dans k = 0
+
+    // GOP : échantillons d'un point d'accès aléatoire (inclus) au suivant (exclu)
+    uint32_t keyframe_count = 0;                           // tous les échantillons sans `stss`
+    std::vector<std::pair<uint32_t, uint64_t>> gop_lengths; // longueur, nombre de GOP ; par longueur croissante
+    double   mean_gop_length       = 0;
+    uint64_t min_keyframe_interval = 0; // écart d'instant entre points d'accès, dans l'échelle de temps du média
+    uint64_t max_keyframe_interval = 0;
+
+    // valeurs déclarées par la boîte `btrt`, si présente
+    bool     has_btrt          = false;
+    uint32_t btrt_buffer_size  = 0;
+    uint32_t btrt_max_bitrate  = 0;
+    uint32_t btrt_avg_bitrate  = 0;
+};
+
+// Calcule les statistiques d'une piste en un seul parcours de ses tables. Le
+// débit crête est obtenu par une fenêtre glissante à deux curseurs, en O(n).
+// Lève une exception si les tables sont absentes ou incohérentes.
+//     @trak: la boîte `trak` analysée
+//     @window: durée de la fenêtre du débit crête, en secondes
+//     @return: les statistiques de la piste
+TrackAnalytics analyzeTrack(const Trak& a_trak, double a_window = 1.0);
+
+// Calcule les statistiques de toutes les pistes de l'arbre.
+//     @root: la racine de l'arbre
+//     @window: durée de la fenêtre du débit crête, en secondes
+//     @return: les statistiques, dans l'ordre des pistes du fichier
+std::vector<TrackAnalytics> analyzeTracks(const Root& a_root, double a_window = 1.0);
+
+// Affiche les statistiques d'une piste, comparées à `btrt` s'il est présent.
+//     @outstream: flux d'affichage
+//     @analytics: les statistiques affichées
+void printTrackAnalytics(std::ostream& a_outstream, const TrackAnalytics& a_analytics);
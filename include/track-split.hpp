@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <container-parser.hpp>
+#include <movie-writer.hpp>
+
+struct SplitOutput {
+    uint32_t        track_ID     = 0;
+    uint32_t        handler_type = 0;
+    std::string     path;
+    MovieWriteStats write;        // copy_calls : écritures de données
+};
+
+struct SplitResult {
+    std::vector<SplitOutput> outputs; // dans l'ordre des pistes du fichier
+    uint64_t reads      = 0;          // lectures de la source
+    uint64_t bytes_read = 0;
+};
+
+// Écrit chaque piste dans son propre fichier mp4 (`moov` réduit à la piste,
+// un `mdat` contigu). Les fichiers sont remplis en une seule lecture
+// séquentielle de la source : les plages d'échantillons de toutes les sorties
+// sont triées par position et chaque bloc lu est distribué aux fichiers qui
+// en ont besoin, au lieu d'une lecture de la source par piste.
+// Lève une exception en cas d'erreur d'entrée-sortie.
+//     @root: la racine de l'arbre du fichier source, tables d'échantillons conservées
+//     @source: chemin du fichier source
+//     @prefix: préfixe des fichiers créés, complété par `-track<ID>.mp4`
+//     @block_size: taille des lectures de la source
+//     @return: les fichiers écrits et le bilan des lectures
+SplitResult splitTracks(const Root& a_root, const std::string& a_source, const std::string& a_prefix,
+                        size_t a_block_size = 1024 * 1024);
+
+// Affiche les fichiers écrits et le bilan des lectures.
+//     @outstream: flux d'affichage
+//     @result: le résultat affiché
+void printSplitResult(std::ostream& a_outstream, const SplitResult& a_result);
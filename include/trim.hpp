@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <container-parser.hpp>
+#include <movie-writer.hpp>
+
+// Échantillons gardés d'une piste.
+struct TrimTrack {
+    uint32_t track_ID     = 0;
+    uint32_t first_sample = 0; // indice dans la piste source, à partir de 0
+    uint32_t sample_count = 0;
+};
+
+struct TrimResult {
+    double start = 0;              // début effectif (s), ramené sur une image clé
+    double end   = 0;              // fin effective (s), au plus la durée du film
+    std::vector<TrimTrack> tracks;
+    MovieWriteStats write;
+};
+
+// Extrait l'intervalle [start, end) d'un fichier sans réencodage. Le début est
+// ramené sur l'échantillon de synchronisation (stss) qui le précède dans la
+// piste de référence (première piste vidéo, sinon première piste) ; les autres
+// pistes sont coupées aux mêmes instants, elles aussi ramenées sur une image
+// clé si elles ont une table stss. Les tables d'échantillons et les listes
+// d'éditions sont reconstruites (une édition vide garde le décalage d'une
+// piste qui commence plus tard, le pré-roll d'une piste qui commence plus tôt
+// est masqué par media_time) et seuls les octets des échantillons gardés sont
+// copiés, par copy_file_range en plages contiguës. La fin est bornée par la
+// durée du film, chaque piste étant coupée à sa propre fin. Les instants
+// comparés sont des instants de présentation (décodage plus décalage de ctts) :
+// une piste à images B garde tous les échantillons décodés avant le dernier
+// présenté dans l'intervalle.
+// Lève une exception si l'intervalle est vide ou si le début est au-delà de la
+// fin de la piste de référence.
+//     @root: la racine de l'arbre du fichier source, tables d'échantillons conservées
+//     @source: chemin du fichier source
+//     @start: début demandé (s), en temps de présentation
+//     @end: fin demandée (s)
+//     @output: chemin du fichier créé
+//     @return: l'intervalle effectif, les échantillons gardés et le bilan d'écriture
+TrimResult trimFile(const Root& a_root, const std::string& a_source, double a_start, double a_end,
+                    const std::string& a_output);
+
+// Affiche l'intervalle effectif, les pistes et le bilan des copies.
+//     @outstream: flux d'affichage
+//     @result: le résultat affiché
+void printTrimResult(std::ostream& a_outstream, const TrimResult& a_result);
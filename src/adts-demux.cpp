@@ -0,0 +1,182 @@
+// Extraction d'une piste AAC en flux ADTS (cf adts-demux.hpp).
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+
+#include <adts-demux.hpp>
+#include <box-writer.hpp>
+#include <container-parser.hpp>
+#include <range-reader.hpp>
+#include <sample-table.hpp>
+
+// Plus grande trame représentable : frame_length sur 13 bits, entête compris.
+static const uint32_t ADTS_MAX_FRAME = 8191;
+static const uint32_t ADTS_HEADER_SIZE = 7;
+
+// Plage d'échantillons contigus dans la source.
+struct AdtsRange {
+    uint64_t offset;
+    uint64_t size;
+};
+
+// Lot d'échantillons : les plages sont lues bout à bout dans `data`.
+struct AdtsBatch {
+    std::vector<AdtsRange> ranges;
+    std::vector<uint32_t>  sizes; // taille de chaque trame, dans l'ordre
+    std::vector<char>      data;
+};
+
+// Entête ADTS sans la longueur de trame : syncword, MPEG-4, sans CRC, profil,
+// fréquence, disposition des canaux, buffer fullness 0x7FF (débit variable),
+// une trame AAC par trame ADTS.
+static std::array<uint8_t, 7> adtsTemplate(const AudioSpecificConfig& a_config) {
+    if (a_config.audio_object_type < 1 || a_config.audio_object_type > 4) {
+        throw std::runtime_error("Audio object type " + std::to_string(a_config.audio_object_type)
+                                 + " has no ADTS profile.");
+    }
+    if (a_config.sampling_frequency_index > 12) {
+        throw std::runtime_error("Explicit sampling frequency cannot be written in an ADTS header.");
+    }
+    if (a_config.channel_configuration < 1 || a_config.channel_configuration > 7) {
+        throw std::runtime_error("Channel configuration " + std::to_string(a_config.channel_configuration)
+                                 + " cannot be written in an ADTS header.");
+    }
+    uint8_t profile  = a_config.audio_object_type - 1;
+    uint8_t channels = a_config.channel_configuration;
+    return {0xFF, 0xF1,
+            uint8_t(profile << 6 | a_config.sampling_frequency_index << 2 | channels >> 2),
+            uint8_t((channels & 3) << 6),
+            0x00,
+            0x1F,
+            0xFC};
+}
+
+// Prend les trames suivantes du curseur jusqu'à remplir un lot, en joignant
+// les trames contiguës en plages.
+static void planBatch(SampleCursor& a_cursor, AdtsBatch& a_batch, size_t a_max_batch) {
+    a_batch.ranges.clear();
+    a_batch.sizes.clear();
+    uint64_t total = 0;
+    for (; !a_cursor.done() && (total == 0 || total + a_cursor.sample().size <= a_max_batch); a_cursor.next()) {
+        const SampleInfo& sample = a_cursor.sample();
+        if (sample.size + ADTS_HEADER_SIZE > ADTS_MAX_FRAME) {
+            throw std::runtime_error("AAC frame of " + std::to_string(sample.size) + " bytes is too large for ADTS.");
+        }
+        if (!a_batch.ranges.empty() && a_batch.ranges.back().offset + a_batch.ranges.back().size == sample.offset) {
+            a_batch.ranges.back().size += sample.size;
+        } else {
+            a_batch.ranges.push_back(AdtsRange{sample.offset, sample.size});
+        }
+        a_batch.sizes.push_back(sample.size);
+        total += sample.size;
+    }
+    a_batch.data.resize(total);
+}
+
+// Lit les plages d'un lot, une requête par plage.
+static void readBatch(RangeReader& a_reader, AdtsBatch& a_batch) {
+    char *out = a_batch.data.data();
+    for (const AdtsRange& range : a_batch.ranges) {
+        if (a_reader.read(range.offset, out, range.size) != range.size) {
+            throw std::runtime_error("Short read while demuxing AAC frames.");
+        }
+        out += range.size;
+    }
+}
+
+// Écrit un lot : entêtes et trames alternés, IOV_MAX vecteurs par pwritev.
+static void writeBatch(const AdtsBatch& a_batch, const std::array<uint8_t, 7>& a_template, int a_output,
+                       uint64_t& a_position, AdtsStats& a_stats) {
+    std::vector<std::array<uint8_t, 7>> headers(a_batch.sizes.size(), a_template);
+    std::vector<struct iovec> vectors;
+    vectors.reserve(2 * headers.size());
+    const char *data = a_batch.data.data();
+    for (size_t i = 0; i < headers.size(); i++) {
+        uint32_t length = a_batch.sizes[i] + ADTS_HEADER_SIZE;
+        headers[i][3] |= uint8_t(length >> 11);
+        headers[i][4]  = uint8_t(length >> 3);
+        headers[i][5] |= uint8_t(length << 5);
+        vectors.push_back(iovec{headers[i].data(), ADTS_HEADER_SIZE});
+        vectors.push_back(iovec{const_cast<char*>(data), a_batch.sizes[i]});
+        data += a_batch.sizes[i];
+    }
+    a_stats.write_calls   += writevAll(a_output, vectors, a_position);
+    a_stats.bytes_written += a_batch.data.size() + ADTS_HEADER_SIZE * headers.size();
+    a_position            += a_batch.data.size() + ADTS_HEADER_SIZE * headers.size();
+}
+
+AdtsStats demuxAdts(const Root& a_root, RangeReader& a_reader, const std::string& a_output, const AdtsOptions& a_options) {
+    // première piste dont l'entrée de description est un mp4a AAC
+    const Trak *audio = nullptr;
+    const Esds *esds  = nullptr;
+    AdtsStats stats;
+    for (const Trak *trak : findTracks(a_root)) {
+        TrackBoxes boxes = findTrackBoxes(*trak);
+        const Box *stsd = boxes.stbl != nullptr ? boxes.stbl->findChild({'s', 't', 's', 'd'}) : nullptr;
+        if (stsd == nullptr || stsd->getChildren().empty() || stsd->getChildren()[0]->kind != BoxKind::Mp4a) {
+            continue;
+        }
+        const Box *child = stsd->getChildren()[0]->findChild({'e', 's', 'd', 's'});
+        if (child != nullptr && !static_cast<const Esds*>(child)->decoder_specific_info.empty()) {
+            audio = trak;
+            esds  = static_cast<const Esds*>(child);
+            stats.track_ID = boxes.tkhd != nullptr ? boxes.tkhd->track_ID : 0;
+            break;
+        }
+    }
+    if (audio == nullptr) {
+        throw std::runtime_error("No AAC audio track.");
+    }
+    stats.config = esds->audio_config;
+    std::array<uint8_t, 7> header = adtsTemplate(stats.config);
+
+    FileDescriptor output(::open(a_output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+    if (!output.valid()) {
+        throw std::runtime_error("Cannot create file `" + a_output + "`.");
+    }
+
+    // deux lots : le suivant est lu pendant que le courant est écrit
+    SampleCursor cursor(*audio);
+    size_t max_batch = std::max<size_t>(a_options.max_batch, 1);
+    AdtsBatch batches[2];
+    std::future<void> pending;
+    planBatch(cursor, batches[0], max_batch);
+    if (!batches[0].sizes.empty()) {
+        pending = std::async(std::launch::async, readBatch, std::ref(a_reader), std::ref(batches[0]));
+    }
+    uint64_t position = 0;
+    for (size_t current = 0; !batches[current].sizes.empty(); current = 1 - current) {
+        pending.get();
+        AdtsBatch& ready = batches[current];
+        AdtsBatch& next  = batches[1 - current];
+        planBatch(cursor, next, max_batch);
+        if (!next.sizes.empty()) {
+            pending = std::async(std::launch::async, readBatch, std::ref(a_reader), std::ref(next));
+        }
+        writeBatch(ready, header, output.get(), position, stats);
+        stats.batches++;
+        stats.frames     += ready.sizes.size();
+        stats.reads      += ready.ranges.size();
+        stats.bytes_read += ready.data.size();
+    }
+    return stats;
+}
+
+void printAdtsStats(std::ostream& a_outstream, const AdtsStats& a_stats) {
+    a_outstream << "adts: track " << a_stats.track_ID << ", audio object type "
+                << unsigned(a_stats.config.audio_object_type) << ", " << a_stats.config.sampling_frequency << " Hz, "
+                << "channel configuration " << unsigned(a_stats.config.channel_configuration) << '\n'
+                << a_stats.frames << " frames, " << a_stats.bytes_written << " bytes written in "
+                << a_stats.write_calls << " pwritev calls, " << a_stats.bytes_read << " bytes read in "
+                << a_stats.reads << " reads (" << a_stats.batches << " batches)\n";
+}
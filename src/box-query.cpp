@@ -0,0 +1,80 @@
+// Requêtes de chemins de boîtes pour l'analyse sélective (cf box-query.hpp).
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+#include <system_error>
+#include <string>
+#include <vector>
+
+#include <box-query.hpp>
+
+
+BoxQuery::BoxQuery(const std::vector<std::string>& a_paths) {
+    for (const std::string& path : a_paths) {
+        addPath(path);
+    }
+}
+
+void BoxQuery::addPath(const std::string& a_path) {
+    std::vector<Pattern> patterns;
+    size_t beg = 0;
+    while (beg <= a_path.size()) {
+        size_t end = a_path.find('/', beg);
+        if (end == std::string::npos) {
+            end = a_path.size();
+        }
+        std::string element = a_path.substr(beg, end - beg);
+        beg = end + 1;
+
+        Pattern pattern = {{' ', ' ', ' ', ' '}, false, ANY_INDEX};
+        // rang optionnel entre crochets
+        size_t bracket = element.find('[');
+        if (bracket != std::string::npos) {
+            if (element.back() != ']' || bracket + 2 >= element.size()) {
+                throw std::runtime_error("Malformed index in box path `" + a_path + "`.");
+            }
+            std::string index = element.substr(bracket + 1, element.size() - bracket - 2);
+            if (index != "*") {
+                // chiffres seulement, sans dépasser 32 bits ; ANY_INDEX est réservé à `*`
+                const char *last = index.data() + index.size();
+                std::from_chars_result parsed = std::from_chars(index.data(), last, pattern.index);
+                if (parsed.ec != std::errc() || parsed.ptr != last || pattern.index == ANY_INDEX) {
+                    throw std::runtime_error("Malformed index in box path `" + a_path + "`.");
+                }
+            }
+            element.resize(bracket);
+        }
+        if (element == "*") {
+            pattern.any_type = true;
+        } else if (element.empty() || element.size() > 4) {
+            throw std::runtime_error("Malformed box type in box path `" + a_path + "`.");
+        } else {
+            element.copy(pattern.type.data(), element.size());
+        }
+        patterns.push_back(pattern);
+    }
+    m_paths.push_back(patterns);
+}
+
+BoxQuery::Match BoxQuery::match(const std::vector<PathSegment>& a_path) const {
+    Match best = Match::None;
+    for (const std::vector<Pattern>& patterns : m_paths) {
+        size_t depth = std::min(patterns.size(), a_path.size());
+        bool matches = true;
+        for (size_t i=0; i<depth && matches; i++) {
+            const Pattern& pattern = patterns[i];
+            matches = (pattern.any_type || pattern.type == a_path[i].type)
+                   && (pattern.index == ANY_INDEX || pattern.index == a_path[i].index);
+        }
+        if (!matches) {
+            continue;
+        }
+        if (a_path.size() >= patterns.size()) {
+            return Match::Selected;
+        }
+        best = Match::Ancestor;
+    }
+    return best;
+}
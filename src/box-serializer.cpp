@@ -0,0 +1,748 @@
+// Réécriture d'un arbre de boîtes (cf box-serializer.hpp).
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <box-serializer.hpp>
+#include <box-writer.hpp>
+#include <container-parser.hpp>
+#include <text-dump.hpp>
+
+// Choix d'encodage d'une boîte, fixés avant l'écriture.
+struct BoxPlan {
+    const Box *box;
+    uint64_t size;        // entête compris
+    uint8_t  header_size; // 8, ou 16 avec largesize
+    uint8_t  version;     // version écrite des boîtes complètes
+    uint64_t opaque;      // octets recopiés de la source après l'entête
+};
+
+// Morceau du fichier écrit.
+struct WriteSegment {
+    enum Kind : uint8_t { Arena, Table, Source } kind;
+    size_t   table;  // indice du tampon, pour Table
+    uint64_t offset; // position dans le tampon commun ou dans la source
+    uint64_t size;
+};
+
+struct TreeSerializer {
+    int source = -1;
+    uint64_t source_size = 0;
+    std::vector<BoxPlan> plans;               // ordre préfixe, celui de l'écriture
+    BoxBuffer arena;                          // entêtes et champs
+    std::vector<std::vector<char>> tables;    // tables d'échantillons encodées
+    std::vector<WriteSegment> segments;
+    uint64_t arena_mark = 0;                  // début du morceau Arena en cours
+};
+
+// Vrai si une date ou une durée demande la version 1.
+static bool needsVersion1(uint64_t a_creation, uint64_t a_modification, uint64_t a_duration) {
+    return a_creation > UINT32_MAX || a_modification > UINT32_MAX || a_duration > UINT32_MAX;
+}
+
+static uint8_t chooseVersion(const Box& a_box) {
+    switch (a_box.kind) {
+    case BoxKind::Mvhd: {
+        const Mvhd& box = static_cast<const Mvhd&>(a_box);
+        return box.version == 1 || needsVersion1(box.creation_time, box.modification_time, box.duration);
+    }
+    case BoxKind::Tkhd: {
+        const Tkhd& box = static_cast<const Tkhd&>(a_box);
+        return box.version == 1 || needsVersion1(box.creation_time, box.modification_time, box.duration);
+    }
+    case BoxKind::Mdhd: {
+        const Mdhd& box = static_cast<const Mdhd&>(a_box);
+        return box.version == 1 || needsVersion1(box.creation_time, box.modification_time, box.duration);
+    }
+    case BoxKind::Elst: {
+        const Elst& box = static_cast<const Elst&>(a_box);
+        bool large = box.version == 1;
+        for (size_t i = 0; i < box.segment_duration.size() && !large; i++) {
+            large = box.segment_duration[i] > UINT32_MAX || box.media_time[i] > INT32_MAX || box.media_time[i] < INT32_MIN;
+        }
+        return large;
+    }
+    default:
+        return dynamic_cast<const FullBox*>(&a_box) != nullptr ? static_cast<const FullBox&>(a_box).version : 0;
+    }
+}
+
+// Chaînes d'une boîte : le tampon lu, ou les vues d'une boîte construite en mémoire.
+static uint64_t stringsSize(const BoxStrings& a_strings, std::initializer_list<std::string_view> a_views) {
+    if (a_strings.size() > 0) {
+        return a_strings.size();
+    }
+    uint64_t size = 0;
+    for (std::string_view view : a_views) {
+        size += view.size() + 1;
+    }
+    return size;
+}
+
+// Vérifie qu'une table a été conservée par l'analyse.
+static void checkTable(const Box& a_box, uint64_t a_count, size_t a_entries) {
+    if (a_count != a_entries) {
+        throw std::runtime_error("Table of `" + std::string(a_box.type.data(), 4) + "` box not loaded.");
+    }
+}
+
+// Taille des champs décodés d'une boîte, après l'entête (version et drapeaux compris) et hors enfants.
+static uint64_t fieldsSize(const Box& a_box, uint8_t a_version) {
+    switch (a_box.kind) {
+    case BoxKind::Ftyp: return 8 + 4 * static_cast<const Ftyp&>(a_box).compatible_brands.size();
+    case BoxKind::Pdin: return 8 * static_cast<const Pdin&>(a_box).rate.size();
+    case BoxKind::Mvhd: return a_version == 1 ? 108 : 96;
+    case BoxKind::Tkhd: return a_version == 1 ? 92 : 80;
+    case BoxKind::Elst: return 4 + static_cast<const Elst&>(a_box).segment_duration.size() * (a_version == 1 ? 20 : 12);
+    case BoxKind::Mdhd: return a_version == 1 ? 32 : 20;
+    case BoxKind::Hdlr: {
+        const Hdlr& box = static_cast<const Hdlr&>(a_box);
+        return 20 + stringsSize(box.strings, {box.name});
+    }
+    case BoxKind::Vmhd: return 8;
+    case BoxKind::Url: {
+        const Url& box = static_cast<const Url&>(a_box);
+        return (box.flags[0] == 1 ? 0 : stringsSize(box.strings, {box.location}));
+    }
+    case BoxKind::Urn: {
+        const Urn& box = static_cast<const Urn&>(a_box);
+        return (box.flags[0] == 1 ? stringsSize(box.strings, {box.name})
+                                      : stringsSize(box.strings, {box.name, box.location}));
+    }
+    case BoxKind::Dref:
+    case BoxKind::Stsd: return 4;
+    case BoxKind::Btrt: return 12;
+    case BoxKind::Icpv:
+    case BoxKind::Hvc1: return 78;
+    case BoxKind::Hvcc: return static_cast<const Hvcc&>(a_box).record.size();
+    case BoxKind::Mp4a: return 28 + static_cast<const Mp4a&>(a_box).qt_extension.size();
+    case BoxKind::Esds: return static_cast<const Esds&>(a_box).descriptors.size();
+    case BoxKind::Stts: return 4 + 8 * static_cast<const Stts&>(a_box).sample_count.size();
+    case BoxKind::Ctts: return 4 + 8 * static_cast<const Ctts&>(a_box).sample_count.size();
+    case BoxKind::Stss: return 4 + 4 * static_cast<const Stss&>(a_box).sample_number.size();
+    case BoxKind::Stsc: return 4 + 12 * static_cast<const Stsc&>(a_box).first_chunk.size();
+    case BoxKind::Stsz: {
+        const Stsz& box = static_cast<const Stsz&>(a_box);
+        return 8 + (box.sample_size == 0 ? 4 * box.entry_size.size() : 0);
+    }
+    case BoxKind::Stco: return 4 + 4 * static_cast<const Stco&>(a_box).chunk_offset.size();
+    case BoxKind::Smhd: return 4;
+    case BoxKind::Ilst: {
+        const Ilst& box = static_cast<const Ilst&>(a_box);
+        return box.items_loaded ? box.items.size() : 0;
+    }
+    default: return 0; // conteneurs et boîtes non décodées
+    }
+}
+
+// Vrai pour les boîtes dont le contenu n'est pas décodé : il est recopié de la source.
+static bool isOpaque(const Box& a_box) {
+    switch (a_box.kind) {
+    case BoxKind::Mdat:
+    case BoxKind::Free:
+    case BoxKind::Frma:
+    case BoxKind::Avcc:
+    case BoxKind::Enca: return true;
+    case BoxKind::Ilst: return !static_cast<const Ilst&>(a_box).items_loaded;
+    default: return false;
+    }
+}
+
+// Calcule la taille d'une boîte et de ses descendants, des feuilles vers la racine.
+//     @return: la taille de la boîte, entête compris
+static uint64_t planBox(TreeSerializer& a_serializer, const Box& a_box) {
+    size_t index = a_serializer.plans.size();
+    a_serializer.plans.push_back(BoxPlan{&a_box, 0, 8, chooseVersion(a_box), 0});
+    uint64_t content = fieldsSize(a_box, a_serializer.plans[index].version);
+    if (dynamic_cast<const FullBox*>(&a_box) != nullptr) {
+        content += 4;
+    }
+    if (isOpaque(a_box)) {
+        uint64_t opaque = a_box.size != 0 ? a_box.size - a_box.header_size
+                                          : a_serializer.source_size - a_box.offset - a_box.header_size;
+        if (a_serializer.source < 0 && opaque > 0) {
+            throw std::runtime_error("Box `" + std::string(a_box.type.data(), 4) + "` needs its source file.");
+        }
+        a_serializer.plans[index].opaque = opaque;
+        content += opaque;
+    }
+    for (const std::unique_ptr<Box>& child : a_box.getChildren()) {
+        content += planBox(a_serializer, *child);
+    }
+    BoxPlan& plan = a_serializer.plans[index];
+    plan.header_size = (a_box.header_size == 16 || content + 8 > UINT32_MAX) ? 16 : 8;
+    plan.size = content + plan.header_size;
+    return plan.size;
+}
+
+// Relève la taille de la source, pour les boîtes qui s'étendent jusqu'à sa fin.
+static void statSource(TreeSerializer& a_serializer) {
+    if (a_serializer.source >= 0) {
+        struct stat status;
+        if (::fstat(a_serializer.source, &status) == 0) {
+            a_serializer.source_size = status.st_size;
+        }
+    }
+}
+
+// Planifie les enfants de la racine.
+//     @return: la taille du fichier
+static uint64_t planTree(TreeSerializer& a_serializer, const Box& a_root) {
+    statSource(a_serializer);
+    uint64_t size = 0;
+    for (const std::unique_ptr<Box>& child : a_root.getChildren()) {
+        size += planBox(a_serializer, *child);
+    }
+    return size;
+}
+
+// Termine le morceau Arena en cours.
+static void closeArena(TreeSerializer& a_serializer) {
+    uint64_t end = a_serializer.arena.size();
+    if (end > a_serializer.arena_mark) {
+        a_serializer.segments.push_back(WriteSegment{WriteSegment::Arena, 0, a_serializer.arena_mark, end - a_serializer.arena_mark});
+    }
+    a_serializer.arena_mark = end;
+}
+
+// Encode N colonnes d'une table en gros-boutiste, entrée par entrée, dans un tampon propre à la table.
+template<size_t N>
+static void encodeTable(TreeSerializer& a_serializer, const std::array<const uint32_t*, N>& a_columns, size_t a_count) {
+    if (a_count == 0) {
+        return;
+    }
+    std::vector<char> bytes(a_count * N * 4);
+    uint8_t *out = reinterpret_cast<uint8_t*>(bytes.data());
+    for (size_t i = 0; i < a_count; i++) {
+        for (size_t f = 0; f < N; f++) {
+            uint32_t x = a_columns[f][i];
+            uint8_t *p = out + (i*N + f) * 4;
+            p[0] = uint8_t(x >> 24);
+            p[1] = uint8_t(x >> 16);
+            p[2] = uint8_t(x >> 8);
+            p[3] = uint8_t(x);
+        }
+    }
+    closeArena(a_serializer);
+    a_serializer.segments.push_back(WriteSegment{WriteSegment::Table, a_serializer.tables.size(), 0, bytes.size()});
+    a_serializer.tables.push_back(std::move(bytes));
+}
+
+static void encodeStrings(BoxBuffer& a_out, const BoxStrings& a_strings, std::initializer_list<std::string_view> a_views) {
+    if (a_strings.size() > 0) {
+        a_out.bytes(a_strings.data(), a_strings.size());
+        return;
+    }
+    for (std::string_view view : a_views) {
+        a_out.bytes(view.data(), view.size());
+        a_out.u8(0);
+    }
+}
+
+static void encodeMatrix(BoxBuffer& a_out, const std::array<int32_t, 9>& a_matrix) {
+    for (int32_t x : a_matrix) {
+        a_out.u32(uint32_t(x));
+    }
+}
+
+static void encodeZeros(BoxBuffer& a_out, size_t a_count) {
+    for (size_t i = 0; i < a_count; i++) {
+        a_out.u8(0);
+    }
+}
+
+// Type écrit : celui lu dans le fichier pour les boîtes analysées sous un autre nom (avc1, avcC).
+static std::array<char, 4> fileType(const Box& a_box) {
+    switch (a_box.kind) {
+    case BoxKind::Icpv: return static_cast<const Icpv&>(a_box).transformed_type;
+    case BoxKind::Avcc: return {'a', 'v', 'c', 'C'};
+    default: return a_box.type;
+    }
+}
+
+// Encode l'entête et les champs d'une boîte.
+static void encodeFields(TreeSerializer& a_serializer, const BoxPlan& a_plan) {
+    BoxBuffer& out = a_serializer.arena;
+    const Box& box = *a_plan.box;
+    std::array<char, 4> type = fileType(box);
+    if (a_plan.header_size == 16) {
+        out.u32(1);
+        out.bytes(type.data(), 4);
+        out.u64(a_plan.size);
+    } else {
+        out.u32(uint32_t(a_plan.size));
+        out.bytes(type.data(), 4);
+    }
+    if (const FullBox *full = dynamic_cast<const FullBox*>(&box)) {
+        out.u8(a_plan.version);
+        out.u8(uint8_t(full->flags[2]));
+        out.u8(uint8_t(full->flags[1]));
+        out.u8(uint8_t(full->flags[0]));
+    }
+    bool v1 = a_plan.version == 1;
+    switch (box.kind) {
+    case BoxKind::Ftyp: {
+        const Ftyp& ftyp = static_cast<const Ftyp&>(box);
+        out.bytes(ftyp.major_brand.data(), 4);
+        out.u32(ftyp.minor_version);
+        for (const std::array<char, 4>& brand : ftyp.compatible_brands) {
+            out.bytes(brand.data(), 4);
+        }
+        return;
+    }
+    case BoxKind::Pdin: {
+        const Pdin& pdin = static_cast<const Pdin&>(box);
+        for (size_t i = 0; i < pdin.rate.size(); i++) {
+            out.u32(pdin.rate[i]);
+            out.u32(pdin.initial_delay[i]);
+        }
+        return;
+    }
+    case BoxKind::Mvhd: {
+        const Mvhd& mvhd = static_cast<const Mvhd&>(box);
+        if (v1) {
+            out.u64(mvhd.creation_time);
+            out.u64(mvhd.modification_time);
+            out.u32(mvhd.timescale);
+            out.u64(mvhd.duration);
+        } else {
+            out.u32(uint32_t(mvhd.creation_time));
+            out.u32(uint32_t(mvhd.modification_time));
+            out.u32(mvhd.timescale);
+            out.u32(uint32_t(mvhd.duration));
+        }
+        out.u32(mvhd.rate);
+        out.u16(mvhd.volume);
+        encodeZeros(out, 10);
+        encodeMatrix(out, mvhd.matrix);
+        encodeZeros(out, 24);
+        out.u32(mvhd.next_track_ID);
+        return;
+    }
+    case BoxKind::Tkhd: {
+        const Tkhd& tkhd = static_cast<const Tkhd&>(box);
+        if (v1) {
+            out.u64(tkhd.creation_time);
+            out.u64(tkhd.modification_time);
+            out.u32(tkhd.track_ID);
+            out.u32(0);
+            out.u64(tkhd.duration);
+        } else {
+            out.u32(uint32_t(tkhd.creation_time));
+            out.u32(uint32_t(tkhd.modification_time));
+            out.u32(tkhd.track_ID);
+            out.u32(0);
+            out.u32(uint32_t(tkhd.duration));
+        }
+        encodeZeros(out, 8);
+        out.u16(uint16_t(tkhd.layer));
+        out.u16(uint16_t(tkhd.alternate_group));
+        out.u16(uint16_t(tkhd.volume));
+        out.u16(0);
+        encodeMatrix(out, tkhd.matrix);
+        out.u32(tkhd.width);
+        out.u32(tkhd.height);
+        return;
+    }
+    case BoxKind::Elst: {
+        const Elst& elst = static_cast<const Elst&>(box);
+        checkTable(box, elst.entry_count, elst.segment_duration.size());
+        out.u32(elst.segment_duration.size());
+        for (size_t i = 0; i < elst.segment_duration.size(); i++) {
+            if (v1) {
+                out.u64(elst.segment_duration[i]);
+                out.u64(uint64_t(elst.media_time[i]));
+            } else {
+                out.u32(uint32_t(elst.segment_duration[i]));
+                out.u32(uint32_t(int32_t(elst.media_time[i])));
+            }
+            out.u16(uint16_t(i < elst.media_rate_integer.size() ? elst.media_rate_integer[i] : 1));
+            out.u16(uint16_t(i < elst.media_rate_fraction.size() ? elst.media_rate_fraction[i] : 0));
+        }
+        return;
+    }
+    case BoxKind::Mdhd: {
+        const Mdhd& mdhd = static_cast<const Mdhd&>(box);
+        if (v1) {
+            out.u64(mdhd.creation_time);
+            out.u64(mdhd.modification_time);
+            out.u32(mdhd.timescale);
+            out.u64(mdhd.duration);
+        } else {
+            out.u32(uint32_t(mdhd.creation_time));
+            out.u32(uint32_t(mdhd.modification_time));
+            out.u32(mdhd.timescale);
+            out.u32(uint32_t(mdhd.duration));
+        }
+        out.u16(mdhd.language);
+        out.u16(0);
+        return;
+    }
+    case BoxKind::Hdlr: {
+        const Hdlr& hdlr = static_cast<const Hdlr&>(box);
+        out.u32(hdlr.pre_defined);
+        out.u32(hdlr.handler_type);
+        out.bytes(hdlr.reserved.data(), 12);
+        encodeStrings(out, hdlr.strings, {hdlr.name});
+        return;
+    }
+    case BoxKind::Vmhd: {
+        const Vmhd& vmhd = static_cast<const Vmhd&>(box);
+        out.u16(vmhd.graphicsmode);
+        for (uint16_t x : vmhd.opcolor) {
+            out.u16(x);
+        }
+        return;
+    }
+    case BoxKind::Url: {
+        const Url& url = static_cast<const Url&>(box);
+        if (url.flags[0] != 1) {
+            encodeStrings(out, url.strings, {url.location});
+        }
+        return;
+    }
+    case BoxKind::Urn: {
+        const Urn& urn = static_cast<const Urn&>(box);
+        if (urn.flags[0] == 1) {
+            encodeStrings(out, urn.strings, {urn.name});
+        } else {
+            encodeStrings(out, urn.strings, {urn.name, urn.location});
+        }
+        return;
+    }
+    case BoxKind::Dref:
+    case BoxKind::Stsd: {
+        // entry_count : les entrées sont les enfants
+        out.u32(box.getChildren().size());
+        return;
+    }
+    case BoxKind::Btrt: {
+        const Btrt& btrt = static_cast<const Btrt&>(box);
+        out.u32(btrt.bufferSizeDB);
+        out.u32(btrt.maxBitrate);
+        out.u32(btrt.avgBitrate);
+        return;
+    }
+    case BoxKind::Icpv:
+    case BoxKind::Hvc1: {
+        const VisualSampleEntry& entry = static_cast<const VisualSampleEntry&>(box);
+        encodeZeros(out, 6);
+        out.u16(entry.data_reference_index);
+        encodeZeros(out, 16);
+        out.u16(entry.width);
+        out.u16(entry.height);
+        out.u32(entry.horizresolution);
+        out.u32(entry.vertresolution);
+        out.u32(0);
+        out.u16(entry.frame_count);
+        std::string name = entry.compressorname;
+        name.resize(32, '\0');
+        out.bytes(name.data(), 32);
+        out.u16(entry.depth);
+        out.u16(0xFFFF); // pre_defined = -1
+        return;
+    }
+    case BoxKind::Mp4a: {
+        const Mp4a& entry = static_cast<const Mp4a&>(box);
+        encodeZeros(out, 6);
+        out.u16(entry.data_reference_index);
+        out.u16(entry.version);
+        out.bytes(entry.reserved.data(), 6);
+        out.u16(entry.channelcount);
+        out.u16(entry.samplesize);
+        out.u32(entry.pre_defined);
+        out.u32(entry.samplerate);
+        out.bytes(entry.qt_extension.data(), entry.qt_extension.size());
+        return;
+    }
+    case BoxKind::Hvcc: {
+        const Hvcc& hvcc = static_cast<const Hvcc&>(box);
+        out.bytes(hvcc.record.data(), hvcc.record.size());
+        return;
+    }
+    case BoxKind::Esds: {
+        const Esds& esds = static_cast<const Esds&>(box);
+        out.bytes(esds.descriptors.data(), esds.descriptors.size());
+        return;
+    }
+    case BoxKind::Stts: {
+        const Stts& stts = static_cast<const Stts&>(box);
+        checkTable(box, stts.entry_count, stts.sample_count.size());
+        out.u32(stts.sample_count.size());
+        encodeTable<2>(a_serializer, {stts.sample_count.data(), stts.sample_delta.data()}, stts.sample_count.size());
+        return;
+    }
+    case BoxKind::Ctts: {
+        const Ctts& ctts = static_cast<const Ctts&>(box);
+        checkTable(box, ctts.entry_count, ctts.sample_count.size());
+        out.u32(ctts.sample_count.size());
+        encodeTable<2>(a_serializer, {ctts.sample_count.data(), ctts.sample_offset.data()}, ctts.sample_count.size());
+        return;
+    }
+    case BoxKind::Stss: {
+        const Stss& stss = static_cast<const Stss&>(box);
+        checkTable(box, stss.entry_count, stss.sample_number.size());
+        out.u32(stss.sample_number.size());
+        encodeTable<1>(a_serializer, {stss.sample_number.data()}, stss.sample_number.size());
+        return;
+    }
+    case BoxKind::Stsc: {
+        const Stsc& stsc = static_cast<const Stsc&>(box);
+        checkTable(box, stsc.entry_count, stsc.first_chunk.size());
+        out.u32(stsc.first_chunk.size());
+        encodeTable<3>(a_serializer, {stsc.first_chunk.data(), stsc.samples_per_chunk.data(),
+                                      stsc.samples_description_index.data()}, stsc.first_chunk.size());
+        return;
+    }
+    case BoxKind::Stsz: {
+        const Stsz& stsz = static_cast<const Stsz&>(box);
+        out.u32(stsz.sample_size);
+        if (stsz.sample_size != 0) {
+            out.u32(stsz.sample_count);
+            return;
+        }
+        checkTable(box, stsz.sample_count, stsz.entry_size.size());
+        out.u32(stsz.entry_size.size());
+        encodeTable<1>(a_serializer, {stsz.entry_size.data()}, stsz.entry_size.size());
+        return;
+    }
+    case BoxKind::Stco: {
+        const Stco& stco = static_cast<const Stco&>(box);
+        checkTable(box, stco.entry_count, stco.chunk_offset.size());
+        out.u32(stco.chunk_offset.size());
+        encodeTable<1>(a_serializer, {stco.chunk_offset.data()}, stco.chunk_offset.size());
+        return;
+    }
+    case BoxKind::Smhd: {
+        out.u16(uint16_t(static_cast<const Smhd&>(box).balance));
+        out.u16(0);
+        return;
+    }
+    case BoxKind::Ilst: {
+        const Ilst& ilst = static_cast<const Ilst&>(box);
+        if (ilst.items_loaded) {
+            out.bytes(ilst.items.data(), ilst.items.size());
+        }
+        return;
+    }
+    default:
+        return;
+    }
+}
+
+// Encode toutes les boîtes planifiées en une suite de morceaux.
+static void encodeTree(TreeSerializer& a_serializer) {
+    for (const BoxPlan& plan : a_serializer.plans) {
+        encodeFields(a_serializer, plan);
+        if (plan.opaque > 0) {
+            closeArena(a_serializer);
+            const Box& box = *plan.box;
+            a_serializer.segments.push_back(WriteSegment{WriteSegment::Source, 0, box.offset + box.header_size, plan.opaque});
+        }
+    }
+    closeArena(a_serializer);
+}
+
+// Adresse en mémoire d'un morceau Arena ou Table.
+static const char *segmentData(const TreeSerializer& a_serializer, const WriteSegment& a_segment) {
+    return a_segment.kind == WriteSegment::Arena ? a_serializer.arena.data() + a_segment.offset
+                                            : a_serializer.tables[a_segment.table].data();
+}
+
+// Écrit les morceaux en mémoire [first, last) par pwritev, IOV_MAX à la fois.
+static void writeVector(const TreeSerializer& a_serializer, size_t a_first, size_t a_last, int a_output,
+                        uint64_t a_position, SerializeStats& a_stats) {
+    std::vector<struct iovec> vectors;
+    for (size_t s = a_first; s < a_last; s++) {
+        const WriteSegment& segment = a_serializer.segments[s];
+        vectors.push_back(iovec{const_cast<char*>(segmentData(a_serializer, segment)), size_t(segment.size)});
+    }
+    a_stats.write_calls += writevAll(a_output, vectors, a_position);
+}
+
+SerializeStats serializeTree(const Box& a_root, int a_source, int a_output) {
+    TreeSerializer serializer;
+    serializer.source = a_source;
+    SerializeStats stats;
+    stats.bytes = planTree(serializer, a_root);
+    encodeTree(serializer);
+    stats.boxes = serializer.plans.size();
+    stats.segments = serializer.segments.size();
+
+    uint64_t position = 0;
+    size_t first = 0;
+    for (size_t s = 0; s <= serializer.segments.size(); s++) {
+        if (s < serializer.segments.size() && serializer.segments[s].kind != WriteSegment::Source) {
+            continue;
+        }
+        // morceaux en mémoire accumulés, puis la plage de la source
+        writeVector(serializer, first, s, a_output, position, stats);
+        for (size_t m = first; m < s; m++) {
+            position += serializer.segments[m].size;
+        }
+        if (s < serializer.segments.size()) {
+            const WriteSegment& segment = serializer.segments[s];
+            stats.copy_calls += copyFileRange(a_source, segment.offset, a_output, position, segment.size);
+            stats.source_bytes += segment.size;
+            position += segment.size;
+        }
+        first = s + 1;
+    }
+    if (::ftruncate(a_output, position) != 0) {
+        throw std::runtime_error("Error truncating serialized file.");
+    }
+    return stats;
+}
+
+SerializeStats serializeTreeToFile(const Box& a_root, const std::string& a_source, const std::string& a_output) {
+    FileDescriptor source(::open(a_source.c_str(), O_RDONLY));
+    if (!source.valid()) {
+        throw std::runtime_error("Cannot open file `" + a_source + "`.");
+    }
+    if (sameFile(source.get(), a_output)) {
+        throw std::runtime_error("Output file `" + a_output + "` is the source file.");
+    }
+    // copie unique dans le répertoire de la sortie, renommée une fois complète
+    std::string temporary = a_output + ".XXXXXX";
+    FileDescriptor output(::mkstemp(&temporary[0]));
+    if (!output.valid()) {
+        throw std::runtime_error("Cannot create file `" + a_output + "`.");
+    }
+    SerializeStats stats;
+    try {
+        if (::fchmod(output.get(), 0644) != 0) {
+            throw std::runtime_error("Cannot set mode of file `" + temporary + "`.");
+        }
+        stats = serializeTree(a_root, source.get(), output.get());
+        if (!output.close()) {
+            throw std::runtime_error("Error closing file `" + temporary + "`.");
+        }
+    } catch (...) {
+        std::remove(temporary.c_str());
+        throw;
+    }
+    if (std::rename(temporary.c_str(), a_output.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Cannot replace file `" + a_output + "`.");
+    }
+    return stats;
+}
+
+uint64_t serializedSize(const Box& a_root, int a_source) {
+    TreeSerializer serializer;
+    serializer.source = a_source;
+    return planTree(serializer, a_root);
+}
+
+// Rassemble en mémoire les morceaux encodés.
+//     @size: taille totale planifiée
+static std::vector<char> gatherSegments(TreeSerializer& a_serializer, uint64_t a_size) {
+    std::vector<char> bytes(a_size);
+    encodeTree(a_serializer);
+    uint64_t position = 0;
+    for (const WriteSegment& segment : a_serializer.segments) {
+        if (segment.kind == WriteSegment::Source) {
+            readAll(a_serializer.source, bytes.data() + position, segment.size, segment.offset);
+        } else {
+            std::memcpy(bytes.data() + position, segmentData(a_serializer, segment), segment.size);
+        }
+        position += segment.size;
+    }
+    return bytes;
+}
+
+std::vector<char> serializeToMemory(const Box& a_root, int a_source) {
+    TreeSerializer serializer;
+    serializer.source = a_source;
+    uint64_t size = planTree(serializer, a_root);
+    return gatherSegments(serializer, size);
+}
+
+std::vector<char> serializeBox(const Box& a_box, int a_source) {
+    TreeSerializer serializer;
+    serializer.source = a_source;
+    statSource(serializer);
+    uint64_t size = planBox(serializer, a_box);
+    return gatherSegments(serializer, size);
+}
+
+static uint64_t countBoxes(const Box& a_box) {
+    uint64_t count = 1;
+    for (const std::unique_ptr<Box>& child : a_box.getChildren()) {
+        count += countBoxes(*child);
+    }
+    return count;
+}
+
+// Texte de dumpTree d'un arbre.
+static std::string dumpText(Box& a_root) {
+    std::ostringstream text;
+    {
+        DumpWriter writer(text);
+        dumpTree(writer, a_root);
+    }
+    return text.str();
+}
+
+RoundTripReport checkRoundTrip(const std::string& a_path) {
+    std::ifstream file(a_path, std::ios::binary);
+    if (!file) {
+        throw std::runtime_error("Cannot open file `" + a_path + "`.");
+    }
+    std::vector<char> source((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    file.clear();
+    file.seekg(0);
+    Root root;
+    root.size = 0;
+    root.parse(file);
+
+    FileDescriptor fd(::open(a_path.c_str(), O_RDONLY));
+    if (!fd.valid()) {
+        throw std::runtime_error("Cannot open file `" + a_path + "`.");
+    }
+    std::vector<char> written = serializeToMemory(root, fd.get());
+
+    RoundTripReport report;
+    report.source_size  = source.size();
+    report.written_size = written.size();
+    auto mismatch = std::mismatch(source.begin(), source.end(), written.begin(), written.end());
+    report.first_mismatch = mismatch.first - source.begin();
+    report.same_bytes = source == written;
+
+    std::istringstream copy(std::string(written.begin(), written.end()));
+    Root reparsed;
+    reparsed.size = 0;
+    reparsed.parse(copy);
+    report.same_tree = dumpText(root) == dumpText(reparsed);
+    report.boxes = countBoxes(reparsed) - 1;
+    return report;
+}
+
+void printRoundTripReport(std::ostream& a_outstream, const RoundTripReport& a_report) {
+    a_outstream << "round trip: " << a_report.boxes << " boxes, " << a_report.source_size << " bytes read, "
+                << a_report.written_size << " bytes written, ";
+    if (a_report.same_bytes) {
+        a_outstream << "identical bytes";
+    } else {
+        a_outstream << "first difference at byte " << a_report.first_mismatch;
+    }
+    a_outstream << ", " << (a_report.same_tree ? "identical tree" : "DIFFERENT TREE") << '\n';
+}
@@ -0,0 +1,184 @@
+// Écriture de boîtes (cf box-writer.hpp).
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <climits>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <box-writer.hpp>
+
+
+void BoxBuffer::put(uint64_t a_x, size_t a_length) {
+    for (size_t i = a_length; i-- > 0; ) {
+        m_data.push_back(char(a_x >> (8*i)));
+    }
+}
+
+void BoxBuffer::bytes(const void *a_data, size_t a_size) {
+    const char *bytes = static_cast<const char*>(a_data);
+    m_data.insert(m_data.end(), bytes, bytes + a_size);
+}
+
+size_t BoxBuffer::begin(std::array<char, 4> a_type) {
+    size_t position = m_data.size();
+    u32(0);
+    bytes(a_type.data(), 4);
+    return position;
+}
+
+size_t BoxBuffer::beginFull(std::array<char, 4> a_type, uint8_t a_version, uint32_t a_flags) {
+    size_t position = begin(a_type);
+    u8(a_version);
+    put(a_flags, 3);
+    return position;
+}
+
+void BoxBuffer::end(size_t a_position) {
+    uint64_t size = m_data.size() - a_position;
+    if (size > UINT32_MAX) {
+        throw std::runtime_error("Box too large for a 32-bit size.");
+    }
+    patch(a_position, size, 4);
+}
+
+void BoxBuffer::patch(size_t a_position, uint64_t a_x, size_t a_length) {
+    for (size_t i = 0; i < a_length; i++) {
+        m_data[a_position + i] = char(a_x >> (8*(a_length-1 - i)));
+    }
+}
+
+
+FileDescriptor& FileDescriptor::operator=(FileDescriptor&& a_other) {
+    if (this != &a_other) {
+        reset(a_other.release());
+    }
+    return *this;
+}
+
+int FileDescriptor::release() {
+    int fd = m_fd;
+    m_fd = -1;
+    return fd;
+}
+
+void FileDescriptor::reset(int a_fd) {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+    m_fd = a_fd;
+}
+
+bool FileDescriptor::close() {
+    int fd = release();
+    return fd < 0 || ::close(fd) == 0;
+}
+
+
+void readAll(int a_fd, char *a_data, size_t a_size, uint64_t a_offset) {
+    for (size_t done = 0; done < a_size; ) {
+        ssize_t n = ::pread(a_fd, a_data + done, a_size - done, a_offset + done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw std::runtime_error("Error reading source file.");
+        }
+        done += n;
+    }
+}
+
+void writeAll(int a_fd, const char *a_data, size_t a_size, uint64_t a_offset) {
+    for (size_t done = 0; done < a_size; ) {
+        ssize_t n = ::pwrite(a_fd, a_data + done, a_size - done, a_offset + done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw std::runtime_error("Error writing output file.");
+        }
+        done += n;
+    }
+}
+
+uint64_t writevAll(int a_fd, std::vector<struct iovec>& a_vectors, uint64_t a_offset) {
+    uint64_t calls = 0;
+    size_t done = 0;
+    while (done < a_vectors.size()) {
+        int count = int(std::min<size_t>(a_vectors.size() - done, IOV_MAX));
+        ssize_t n = ::pwritev(a_fd, a_vectors.data() + done, count, a_offset);
+        calls++;
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw std::runtime_error("Error writing output file.");
+        }
+        a_offset += n;
+        // écriture partielle : on avance dans les vecteurs
+        size_t written = n;
+        while (done < a_vectors.size() && written >= a_vectors[done].iov_len) {
+            written -= a_vectors[done].iov_len;
+            done++;
+        }
+        if (written > 0) {
+            a_vectors[done].iov_base = static_cast<char*>(a_vectors[done].iov_base) + written;
+            a_vectors[done].iov_len -= written;
+        }
+    }
+    return calls;
+}
+
+uint64_t copyFileRange(int a_in, uint64_t a_in_offset, int a_out, uint64_t a_out_offset, uint64_t a_size) {
+    uint64_t calls = 0;
+    uint64_t done = 0;
+    // copie par le noyau
+    while (done < a_size) {
+        loff_t in_offset  = a_in_offset + done;
+        loff_t out_offset = a_out_offset + done;
+        ssize_t n = ::copy_file_range(a_in, &in_offset, a_out, &out_offset, a_size - done, 0);
+        calls++;
+        if (n > 0) {
+            done += n;
+            continue;
+        }
+        if (n == 0) {
+            throw std::runtime_error("Source file too short while copying.");
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP) {
+            break; // non pris en charge : copie par un tampon
+        }
+        throw std::runtime_error("Error copying file range.");
+    }
+    std::vector<char> buffer;
+    while (done < a_size) {
+        buffer.resize(std::min<uint64_t>(a_size - done, 1 << 20));
+        ssize_t n = ::pread(a_in, buffer.data(), buffer.size(), a_in_offset + done);
+        calls++;
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw std::runtime_error("Source file too short while copying.");
+        }
+        writeAll(a_out, buffer.data(), n, a_out_offset + done);
+        done += n;
+    }
+    return calls;
+}
+
+bool sameFile(int a_fd, const std::string& a_path) {
+    struct stat source, output;
+    return ::fstat(a_fd, &source) == 0 && ::stat(a_path.c_str(), &output) == 0
+        && source.st_dev == output.st_dev && source.st_ino == output.st_ino;
+}
@@ -0,0 +1,324 @@
+// Représentation compacte des tables d'échantillons (cf compact-table.hpp).
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include <compact-table.hpp>
+#include <container-parser.hpp>
+#include <sample-table.hpp>
+
+
+PackedArray::PackedArray(const uint32_t *a_values, size_t a_count) {
+    assign(a_values, a_count);
+}
+
+PackedArray::PackedArray(const uint64_t *a_values, size_t a_count) {
+    assign(a_values, a_count);
+}
+
+template<typename T>
+void PackedArray::assign(const T *a_values, size_t a_count) {
+    m_size = a_count;
+    m_blocks.reserve((a_count + BLOCK - 1) / BLOCK);
+    for (size_t beg = 0; beg < a_count; beg += BLOCK) {
+        size_t n = std::min(BLOCK, a_count - beg);
+        const T *values = a_values + beg;
+        uint64_t lo = *std::min_element(values, values + n);
+        uint64_t hi = *std::max_element(values, values + n);
+        uint8_t width = 0;
+        for (uint64_t range = hi - lo; range != 0; range >>= 1) {
+            width++;
+        }
+        m_blocks.push_back(Block{lo, (uint32_t) m_words.size(), width});
+        if (width == 0) {
+            continue;
+        }
+        size_t first_word = m_words.size();
+        m_words.resize(first_word + (n * width + 63) / 64, 0);
+        for (size_t i = 0; i < n; i++) {
+            uint64_t delta = values[i] - lo;
+            uint64_t bit   = i * width;
+            unsigned shift = bit % 64;
+            m_words[first_word + bit / 64] |= delta << shift;
+            if (shift + width > 64) {
+                m_words[first_word + bit / 64 + 1] |= delta >> (64 - shift);
+            }
+        }
+    }
+    if (!m_words.empty()) {
+        m_words.push_back(0);
+    }
+    m_words.shrink_to_fit();
+}
+
+template<typename T>
+void PackedArray::decodeBlock(size_t a_block, size_t a_from, size_t a_to, T *a_out) const {
+    const Block& block = m_blocks[a_block];
+    size_t n = a_to - a_from;
+    if (block.width == 0) {
+        std::fill(a_out, a_out + n, (T) block.base);
+        return;
+    }
+    const uint64_t *words = m_words.data() + block.word;
+    const uint64_t  value_mask = mask(block.width);
+    // les largeurs usuelles des tailles d'échantillons (8, 16 bits) ne
+    // chevauchent jamais deux mots : boucle sans branche
+    if (64 % block.width == 0) {
+        const size_t per_word = 64 / block.width;
+        for (size_t i = 0; i < n; i++) {
+            size_t j = a_from + i;
+            a_out[i] = (T) (block.base + ((words[j / per_word] >> (j % per_word * block.width)) & value_mask));
+        }
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        uint64_t bit   = (a_from + i) * block.width;
+        unsigned shift = bit % 64;
+        uint64_t value = words[bit / 64] >> shift;
+        if (shift + block.width > 64) {
+            value |= words[bit / 64 + 1] << (64 - shift);
+        }
+        a_out[i] = (T) (block.base + (value & value_mask));
+    }
+}
+
+void PackedArray::decode(size_t a_first, size_t a_count, uint32_t *a_out) const {
+    for (size_t done = 0; done < a_count; ) {
+        size_t index = a_first + done;
+        size_t from  = index % BLOCK;
+        size_t to    = std::min(BLOCK, from + a_count - done);
+        decodeBlock(index / BLOCK, from, to, a_out + done);
+        done += to - from;
+    }
+}
+
+void PackedArray::decode(size_t a_first, size_t a_count, uint64_t *a_out) const {
+    for (size_t done = 0; done < a_count; ) {
+        size_t index = a_first + done;
+        size_t from  = index % BLOCK;
+        size_t to    = std::min(BLOCK, from + a_count - done);
+        decodeBlock(index / BLOCK, from, to, a_out + done);
+        done += to - from;
+    }
+}
+
+uint64_t PackedArray::sum(size_t a_first, size_t a_count) const {
+    uint64_t buffer[BLOCK];
+    uint64_t total = 0;
+    for (size_t done = 0; done < a_count; ) {
+        size_t index = a_first + done;
+        size_t from  = index % BLOCK;
+        size_t to    = std::min(BLOCK, from + a_count - done);
+        decodeBlock(index / BLOCK, from, to, buffer);
+        for (size_t i = 0; i < to - from; i++) {
+            total += buffer[i];
+        }
+        done += to - from;
+    }
+    return total;
+}
+
+size_t PackedArray::memoryBytes() const {
+    return sizeof(*this) + m_blocks.capacity() * sizeof(Block) + m_words.capacity() * sizeof(uint64_t);
+}
+
+
+CompactSampleTable::CompactSampleTable(const Trak& a_trak) {
+    TrackBoxes boxes = findTrackBoxes(a_trak);
+    if (boxes.stts == nullptr || boxes.stsc == nullptr
+        || boxes.stsz == nullptr || boxes.stco == nullptr) {
+        throw std::runtime_error("Missing sample table box in trak.");
+    }
+    const Stts& stts = *boxes.stts;
+    const Stsc& stsc = *boxes.stsc;
+    const Stsz& stsz = *boxes.stsz;
+    const Stco& stco = *boxes.stco;
+    m_sample_count = stsz.sample_count;
+
+    // tailles
+    if (stsz.sample_size != 0) {
+        m_constant_size = stsz.sample_size;
+    } else {
+        if (stsz.entry_size.size() < m_sample_count) {
+            throw std::runtime_error("Missing stsz entries.");
+        }
+        m_sizes = PackedArray(stsz.entry_size.data(), m_sample_count);
+        std::vector<uint64_t> anchors((m_sample_count + ANCHOR - 1) / ANCHOR + 1);
+        uint64_t total = 0;
+        for (uint32_t i=0; i<m_sample_count; i++) {
+            if (i % ANCHOR == 0) {
+                anchors[i / ANCHOR] = total;
+            }
+            total += stsz.entry_size[i];
+        }
+        anchors.back() = total;
+        m_size_anchors = PackedArray(anchors.data(), anchors.size());
+    }
+
+    // instants de décodage
+    uint64_t dts = 0;
+    uint32_t n = 0;
+    for (uint32_t i=0; i<stts.entry_count && n<m_sample_count; i++) {
+        if (stts.sample_count[i] == 0) {
+            continue;
+        }
+        m_time_runs.push_back(TimeRun{n, stts.sample_delta[i], dts});
+        uint32_t count = std::min(stts.sample_count[i], m_sample_count - n);
+        dts += uint64_t(count) * stts.sample_delta[i];
+        n   += count;
+    }
+    if (n != m_sample_count) {
+        throw std::runtime_error("stts and stsz sample counts differ.");
+    }
+    m_time_runs.shrink_to_fit();
+
+    // points d'accès aléatoire : sans `stss`, tous les échantillons le sont
+    if (boxes.stss != nullptr) {
+        std::vector<uint32_t> numbers = boxes.stss->sample_number;
+        for (uint32_t number : numbers) {
+            if (number == 0 || number > m_sample_count) {
+                throw std::runtime_error("stss sample number out of range.");
+            }
+        }
+        std::sort(numbers.begin(), numbers.end());
+        m_sync_samples = PackedArray(numbers.data(), numbers.size());
+        m_all_sync = false;
+    }
+
+    // chunks : chaque entrée de `stsc` s'applique jusqu'au premier chunk
+    // de l'entrée suivante. La base d'un chunk est calculée modulo 2^64 :
+    // un chunk placé avant les échantillons précédents de la piste a une
+    // base « négative », que la compression par blocs restitue à l'identique.
+    std::vector<uint64_t> bases(stco.entry_count);
+    n = 0;
+    for (uint32_t i=0; i<stsc.entry_count && n<m_sample_count; i++) {
+        uint32_t last_chunk = (i+1 < stsc.entry_count) ? stsc.first_chunk[i+1] - 1
+                                                       : stco.entry_count;
+        if (stsc.first_chunk[i] == 0 || last_chunk > stco.entry_count) {
+            throw std::runtime_error("stsc chunk index out of range.");
+        }
+        uint32_t samples_per_chunk = stsc.samples_per_chunk[i];
+        if (samples_per_chunk == 0 || last_chunk < stsc.first_chunk[i]) {
+            continue;
+        }
+        m_chunk_runs.push_back(ChunkRun{n, stsc.first_chunk[i] - 1,
+                                        samples_per_chunk > 1 ? ~uint64_t(0) / samples_per_chunk + 1 : 0});
+        for (uint32_t chunk = stsc.first_chunk[i]; chunk <= last_chunk && n < m_sample_count; chunk++) {
+            bases[chunk-1] = stco.chunk_offset[chunk-1] - sizePrefix(n);
+            n = (uint32_t) std::min<uint64_t>(uint64_t(n) + samples_per_chunk, m_sample_count);
+        }
+    }
+    if (n != m_sample_count) {
+        throw std::runtime_error("stsc and stsz sample counts differ.");
+    }
+    m_chunk_runs.shrink_to_fit();
+    m_chunk_bases = PackedArray(bases.data(), bases.size());
+
+    if (m_chunk_runs.size() > 1) {
+        std::vector<uint32_t> anchor_runs((m_sample_count + ANCHOR - 1) / ANCHOR);
+        uint32_t run = 0;
+        for (uint32_t i=0; i<anchor_runs.size(); i++) {
+            while (run+1 < m_chunk_runs.size() && m_chunk_runs[run+1].first_sample <= i * ANCHOR) {
+                run++;
+            }
+            anchor_runs[i] = run;
+        }
+        m_anchor_runs = PackedArray(anchor_runs.data(), anchor_runs.size());
+    }
+}
+
+uint64_t CompactSampleTable::sampleDts(uint32_t a_index) const {
+    auto run = std::upper_bound(m_time_runs.begin(), m_time_runs.end(), a_index,
+                                [](uint32_t i, const TimeRun& r) { return i < r.first_sample; }) - 1;
+    return run->first_dts + uint64_t(a_index - run->first_sample) * run->delta;
+}
+
+uint32_t CompactSampleTable::chunkOf(uint32_t a_index) const {
+    // la plage de l'échantillon est celle de l'ancre précédente ou l'une des
+    // suivantes, au plus une par chunk entre les deux ; `stsc` n'a souvent
+    // qu'une plage
+    const ChunkRun *run = m_chunk_runs.data();
+    if (m_chunk_runs.size() > 1) {
+        run += m_anchor_runs.get(a_index / ANCHOR);
+        const ChunkRun *end = m_chunk_runs.data() + m_chunk_runs.size();
+        while (run + 1 != end && run[1].first_sample <= a_index) {
+            run++;
+        }
+    }
+    // quotient exact par multiplication, bien moins coûteux qu'une division
+    // (Lemire, Kaser, Kurz, « Faster Remainder by Direct Computation »)
+    uint32_t k = a_index - run->first_sample;
+    uint32_t quotient = (uint32_t) (((unsigned __int128) run->reciprocal * k) >> 64);
+    return run->first_chunk + (run->reciprocal != 0 ? quotient : k);
+}
+
+uint64_t CompactSampleTable::sizePrefix(uint32_t a_index) const {
+    if (m_constant_size != 0) {
+        return uint64_t(a_index) * m_constant_size;
+    }
+    // somme depuis l'ancre la plus proche : en avant depuis la précédente,
+    // en arrière depuis la suivante (la dernière est le total) ; le sens,
+    // imprévisible pour des accès aléatoires, est choisi par des masques
+    uint32_t before   = a_index % ANCHOR;
+    uint32_t after    = std::min(a_index - before + ANCHOR, m_sample_count) - a_index;
+    uint32_t backward = uint32_t(0) - (before > ANCHOR / 2);
+    uint64_t anchor   = m_size_anchors.get(a_index / ANCHOR + (backward & 1));
+    uint64_t sum      = m_sizes.sumFew<ANCHOR / 2>(a_index - (before & ~backward),
+                                                   (before & ~backward) | (after & backward));
+    // `sum` ou son opposé
+    uint64_t sign     = uint64_t(0) - (backward & 1);
+    return anchor + ((sum ^ sign) - sign);
+}
+
+uint64_t CompactSampleTable::sampleOffset(uint32_t a_index) const {
+    return m_chunk_bases.get(chunkOf(a_index)) + sizePrefix(a_index);
+}
+
+bool CompactSampleTable::isSync(uint32_t a_index) const {
+    if (m_all_sync) {
+        return true;
+    }
+    // recherche dichotomique du numéro de l'échantillon
+    uint64_t number = uint64_t(a_index) + 1;
+    size_t lo = 0;
+    size_t hi = m_sync_samples.size();
+    while (lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if (m_sync_samples.get(mid) < number) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo < m_sync_samples.size() && m_sync_samples.get(lo) == number;
+}
+
+SampleInfo CompactSampleTable::sample(uint32_t a_index) const {
+    SampleInfo info;
+    info.offset = sampleOffset(a_index);
+    info.dts    = sampleDts(a_index);
+    info.size   = sampleSize(a_index);
+    info.sync   = isSync(a_index) ? 1 : 0;
+    return info;
+}
+
+void CompactSampleTable::decodeSizes(uint32_t a_first, uint32_t a_count, uint32_t *a_out) const {
+    if (m_constant_size != 0) {
+        std::fill(a_out, a_out + a_count, m_constant_size);
+    } else {
+        m_sizes.decode(a_first, a_count, a_out);
+    }
+}
+
+size_t CompactSampleTable::memoryBytes() const {
+    return sizeof(*this)
+         + m_sizes.memoryBytes()         - sizeof(PackedArray)
+         + m_size_anchors.memoryBytes()  - sizeof(PackedArray)
+         + m_chunk_bases.memoryBytes()   - sizeof(PackedArray)
+         + m_anchor_runs.memoryBytes()   - sizeof(PackedArray)
+         + m_sync_samples.memoryBytes()  - sizeof(PackedArray)
+         + m_time_runs.capacity()  * sizeof(TimeRun)
+         + m_chunk_runs.capacity() * sizeof(ChunkRun);
+}
@@ -0,0 +1,127 @@
+// Concaténation de fichiers sans réencodage (cf concat.hpp).
+
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+
+#include <box-writer.hpp>
+#include <concat.hpp>
+#include <container-parser.hpp>
+#include <movie-writer.hpp>
+#include <sample-table.hpp>
+
+// Octets de la boîte stsd d'une piste.
+static std::vector<char> readStsd(const TrackBoxes& a_boxes, int a_fd) {
+    const Box *stsd = a_boxes.stbl != nullptr ? a_boxes.stbl->findChild({'s', 't', 's', 'd'}) : nullptr;
+    if (stsd == nullptr) {
+        throw std::runtime_error("Missing stsd in track.");
+    }
+    std::vector<char> bytes(stsd->size);
+    readAll(a_fd, bytes.data(), bytes.size(), stsd->offset);
+    return bytes;
+}
+
+ConcatResult concatFiles(const std::vector<const Root*>& a_roots, const std::vector<std::string>& a_paths,
+                         const std::string& a_output) {
+    if (a_roots.empty() || a_roots.size() != a_paths.size()) {
+        throw std::runtime_error("Concatenation needs one path per input tree.");
+    }
+    std::vector<FileDescriptor> files;
+    std::vector<int> fds;
+    for (const std::string& path : a_paths) {
+        files.emplace_back(::open(path.c_str(), O_RDONLY));
+        if (!files.back().valid()) {
+            throw std::runtime_error("Cannot open file `" + path + "`.");
+        }
+        fds.push_back(files.back().get());
+    }
+
+    const Root& first = *a_roots[0];
+    const Box *moov = first.findChild({'m', 'o', 'o', 'v'});
+    const Mvhd *mvhd = moov != nullptr ? static_cast<const Mvhd*>(moov->findChild({'m', 'v', 'h', 'd'})) : nullptr;
+    if (mvhd == nullptr || mvhd->timescale == 0) {
+        throw std::runtime_error("Missing moov or mvhd in `" + a_paths[0] + "`.");
+    }
+    std::vector<Trak*> traks = findTracks(first);
+    std::vector<TrackBoxes> reference;
+    std::vector<std::vector<char>> descriptions;
+    std::vector<OutputTrack> tracks;
+    for (Trak *trak : traks) {
+        reference.push_back(findTrackBoxes(*trak));
+        if (reference.back().mdhd == nullptr || reference.back().mdhd->timescale == 0 || reference.back().tkhd == nullptr) {
+            throw std::runtime_error("Missing tkhd or mdhd in `" + a_paths[0] + "`.");
+        }
+        descriptions.push_back(readStsd(reference.back(), fds[0]));
+        tracks.push_back(copyTrack(*trak, 0));
+    }
+
+    // les entrées suivantes : mêmes pistes, mêmes descriptions, échantillons ajoutés
+    for (uint32_t input = 1; input < a_roots.size(); input++) {
+        std::vector<Trak*> others = findTracks(*a_roots[input]);
+        if (others.size() != traks.size()) {
+            throw std::runtime_error("`" + a_paths[input] + "` does not have the same tracks as `" + a_paths[0] + "`.");
+        }
+        for (size_t t = 0; t < others.size(); t++) {
+            TrackBoxes boxes = findTrackBoxes(*others[t]);
+            uint32_t handler   = boxes.hdlr != nullptr ? boxes.hdlr->handler_type : 0;
+            uint32_t reference_handler = reference[t].hdlr != nullptr ? reference[t].hdlr->handler_type : 0;
+            if (boxes.mdhd == nullptr || boxes.mdhd->timescale != reference[t].mdhd->timescale
+                || handler != reference_handler) {
+                throw std::runtime_error("Track " + std::to_string(t + 1) + " of `" + a_paths[input]
+                                         + "`: handler or timescale differs from the first input.");
+            }
+            if (readStsd(boxes, fds[input]) != descriptions[t]) {
+                throw std::runtime_error("Track " + std::to_string(t + 1) + " of `" + a_paths[input]
+                                         + "`: sample descriptions differ from the first input.");
+            }
+            OutputTrack other = copyTrack(*others[t], input);
+            tracks[t].samples.insert(tracks[t].samples.end(), other.samples.begin(), other.samples.end());
+        }
+    }
+
+    // liste d'éditions : décalage initial du premier fichier, puis tout le média
+    ConcatResult result;
+    result.inputs = a_roots.size();
+    for (size_t t = 0; t < tracks.size(); t++) {
+        OutputTrack& track = tracks[t];
+        uint64_t duration = 0;
+        for (const OutputSample& sample : track.samples) {
+            duration += sample.delta;
+        }
+        if (!track.edits.empty()) {
+            std::vector<EditEntry> edits;
+            size_t e = 0;
+            for (; e < track.edits.size() && track.edits[e].media_time == -1; e++) {
+                edits.push_back(track.edits[e]);
+            }
+            int64_t media_time = e < track.edits.size() ? track.edits[e].media_time : 0;
+            uint64_t media = duration > uint64_t(media_time) ? duration - media_time : 0;
+            edits.push_back(EditEntry{uint64_t(std::llround(double(media) * mvhd->timescale / reference[t].mdhd->timescale)),
+                                      media_time});
+            track.edits = edits;
+        }
+        result.tracks.push_back(ConcatTrack{reference[t].tkhd->track_ID,
+                                            reference[t].hdlr != nullptr ? reference[t].hdlr->handler_type : 0,
+                                            uint32_t(track.samples.size()), duration});
+    }
+    result.write = writeMovie(first, fds, tracks, a_output);
+    return result;
+}
+
+void printConcatResult(std::ostream& a_outstream, const ConcatResult& a_result) {
+    const MovieWriteStats& write = a_result.write;
+    a_outstream << "concat: " << a_result.inputs << " inputs, " << write.file_size << " bytes written (moov "
+                << write.moov_size << "), " << write.copied_bytes << " bytes copied in " << write.copy_runs
+                << " runs (" << write.copy_calls << " copy calls)\n";
+    for (const ConcatTrack& track : a_result.tracks) {
+        char handler[4] = {char(track.handler_type >> 24), char(track.handler_type >> 16),
+                           char(track.handler_type >> 8),  char(track.handler_type)};
+        a_outstream << "track " << track.track_ID << " (" << std::string(handler, 4) << "): "
+                    << track.sample_count << " samples, duration " << track.duration << '\n';
+    }
+}
@@ -4,6 +4,8 @@
 // seulement leur index de début et de fin dans le bitstream (cf boîte `mdat`).
 
 
+#include <algorithm>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
 #include <filesystem>
@@ -12,7 +14,10 @@
 #include <memory>
 #include <stdexcept>
 
+#include <box-visitor.hpp>
 #include <container-parser.hpp>
+#include <parse-stats.hpp>
+#include <parse-trace.hpp>
 #include <string>
 #include <sys/types.h>
 #include <system_error>
@@ -60,25 +65,128 @@ void readBigEndian(std::istream& a_file, T& a_x) {
     }
 }
 
-// Avance et écrit le bitstream dans `str` tant que le charactère '\0' n'est pas
-// rencontré.
+void BoxStrings::read(std::istream& a_file, uint64_t a_size) {
+    m_data.reset(new char[a_size]);
+    m_size = a_size;
+    m_position = 0;
+    a_file.read(m_data.get(), a_size);
+    if ((uint64_t) a_file.gcount() != a_size) {
+        throw std::runtime_error("End of file reached reading a string.");
+    }
+}
+
+std::string_view BoxStrings::next() {
+    const char *beg = m_data.get() + m_position;
+    size_t left = m_size - m_position;
+    const char *end = static_cast<const char*>(std::memchr(beg, '\0', left));
+    size_t length = end != nullptr ? end - beg : left;
+    m_position += end != nullptr ? length + 1 : length;
+    return std::string_view(beg, length);
+}
+
+// Taille de la fin de la boîte, après les champs déjà lus.
+//     @box: la boîte, dont la taille doit être connue
+//     @return: le nombre d'octets restant
+static uint64_t remainingBytes(const Box& a_box) {
+    if (a_box.size == 0 || a_box.size < a_box.getParseOffset()) {
+        throw std::runtime_error("Invalid box size for a string field.");
+    }
+    return a_box.size - a_box.getParseOffset();
+}
+
+// Avance le bitstream sans lire les données.
 //     @file: le bitstream lu
-//     @str: référence vers la chaine de sortie
-//     @return: le nombre d'octets lus
-uint32_t readNullTerminatedString(std::istream& a_file, std::string& a_str) {
-    uint32_t cmt = 0;
-    a_str = "";
-    char buffer = a_file.get();
-    cmt ++;
-    while (buffer != '\0') {
-        if (buffer == EOF) {
-            throw std::runtime_error("End of file reached reading a string.");
+//     @count: le nombre d'octets sautés
+static void skipBytes(std::istream& a_file, uint64_t a_count) {
+    TraceScope trace("seek", "io");
+    ParseCounters& counters = parseCounters();
+    counters.seeks++;
+    counters.skipped += a_count;
+    a_file.seekg((uint64_t) a_file.tellg() + a_count);
+}
+
+// Avance le bitstream jusqu'à la fin du fichier.
+//     @file: le bitstream lu
+static void skipToEnd(std::istream& a_file) {
+    TraceScope trace("seek", "io");
+    uint64_t beg = (uint64_t) a_file.tellg();
+    a_file.seekg(0, a_file.end);
+    ParseCounters& counters = parseCounters();
+    counters.seeks++;
+    counters.skipped += (uint64_t) a_file.tellg() - beg;
+}
+
+// Nombre d'entrées lues à la fois dans les tables d'échantillons
+constexpr size_t TABLE_BATCH = 1024;
+
+// Taille du tampon d'écriture de `Box::print`, vidé dans le flux quand il est plein
+constexpr size_t PRINT_CAPACITY = 4096;
+
+// Largeur des colonnes de l'affichage en colonnes des tables d'échantillons
+constexpr size_t COLUMN_WIDTH = 12;
+
+// Lit par lots une table de `count` entrées formées de N champs de 4 octets.
+// Chaque lot est décodé champ par champ puis transmis à `on_batch`, qui reçoit
+// un tableau par champ et le nombre d'entrées du lot.
+//     @file: le bitstream lu
+//     @count: le nombre d'entrées de la table
+//     @on_batch: fonction appelée pour chaque lot, renvoie l'action à suivre
+//     @return: l'action renvoyée par le dernier lot transmis
+template<size_t N, typename F>
+VisitAction readTableBatches(std::istream& a_file, uint32_t a_count, F a_on_batch) {
+    uint8_t raw[TABLE_BATCH * N * 4];
+    std::array<std::array<uint32_t, TABLE_BATCH>, N> columns;
+    for (uint32_t done = 0; done < a_count; ) {
+        size_t n = std::min<size_t>(TABLE_BATCH, a_count - done);
+        {
+            TraceScope trace("read", "io");
+            a_file.read(reinterpret_cast<char*>(raw), n * N * 4);
+        }
+        if (!a_file) {
+            throw std::runtime_error("End of file reached reading a sample table.");
+        }
+        {
+            TraceScope trace("decode", "table");
+            for (size_t i=0; i<n; i++) {
+                for (size_t f=0; f<N; f++) {
+                    const uint8_t *p = raw + (i*N + f) * 4;
+                    columns[f][i] = uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16
+                                  | uint32_t(p[2]) << 8  | uint32_t(p[3]);
+                }
+            }
         }
-        a_str += buffer;
-        buffer = a_file.get();
-        cmt ++;
+        done += n;
+        VisitAction action = a_on_batch(columns, n);
+        if (action != VisitAction::Continue) {
+            return action;
+        }
+    }
+    return VisitAction::Continue;
+}
+
+// Visiteur de l'analyse en cours, nullptr si l'arbre est construit sans visiteur.
+static BoxVisitor *currentVisitor() {
+    ParseContext *context = ParseContext::current();
+    return context != nullptr ? context->visitor : nullptr;
+}
+
+// Vrai si les entrées des tables d'échantillons doivent être conservées.
+static bool keepTables() {
+    BoxVisitor *visitor = currentVisitor();
+    return visitor == nullptr || visitor->keepsTables();
+}
+
+// Applique l'action renvoyée par le visiteur pendant la lecture d'une table :
+// saute la fin de la boîte ou interrompt l'analyse.
+//     @file: le bitstream lu
+//     @box: la boîte de la table
+//     @action: l'action renvoyée
+static void applyTableAction(std::istream& a_file, const Box& a_box, VisitAction a_action) {
+    if (a_action == VisitAction::SkipSubtree) {
+        skipBox(a_file, a_box);
+    } else if (a_action == VisitAction::Stop) {
+        ParseContext::current()->stopped = true;
     }
-    return cmt;
 }
 
 // Alloue une boite du type correspondant au paramètre fourni.
@@ -109,18 +217,24 @@ std::unique_ptr<Box> makeBoxFromString(std::string a_type) {
     if (a_type == "stsd") return std::make_unique<Stsd>();
     if (a_type == "meta") return std::make_unique<Meta>();
     if (a_type == "avcC") return std::make_unique<Avcc>();
+    if (a_type == "hvcC") return std::make_unique<Hvcc>();
+    if (a_type == "hvc1") return std::make_unique<Hvc1>();
+    if (a_type == "hev1") return std::make_unique<Hvc1>(std::array<char, 4>{'h', 'e', 'v', '1'});
     if (a_type == "stts") return std::make_unique<Stts>();
+    if (a_type == "ctts") return std::make_unique<Ctts>();
     if (a_type == "stss") return std::make_unique<Stss>();
     if (a_type == "stsc") return std::make_unique<Stsc>();
     if (a_type == "stsz") return std::make_unique<Stsz>();
     if (a_type == "stco") return std::make_unique<Stco>();
     if (a_type == "smhd") return std::make_unique<Smhd>();
+    if (a_type == "enca") return std::make_unique<Enca>();
+    if (a_type == "mp4a") return std::make_unique<Mp4a>();
+    if (a_type == "esds") return std::make_unique<Esds>();
     if (a_type == "udta") return std::make_unique<Udta>();
     if (a_type == "ilst") return std::make_unique<Ilst>();
 
     // boites `alias`
     if (a_type == "avc1") return std::make_unique<Icpv>();
-    if (a_type == "mp4a") return std::make_unique<Enca>();
     
         //     pChildBox = new Mdat;
         // } else if (type =="avc1")) {
@@ -143,7 +257,8 @@ std::unique_ptr<Box> makeBoxFromString(std::string a_type) {
 // Parse le header directement à la position du stream.
 //     @file: un pointeur vers le bitstream de lecture
 //     @return: la boite du type lu
-std::unique_ptr<Box> parseHeader(std::ifstream& a_file) {    
+std::unique_ptr<Box> parseHeader(std::istream& a_file) {    
+    uint64_t offset = (uint64_t) a_file.tellg();
     // size
     uint32_t size;
     readBigEndian<uint32_t>(a_file, size);
@@ -172,6 +287,7 @@ std::unique_ptr<Box> parseHeader(std::ifstream& a_file) {
         }
     }
     box->size = size;
+    box->offset = offset;
 
     // largesize
     uint8_t parse_offset = 8;
@@ -179,19 +295,96 @@ std::unique_ptr<Box> parseHeader(std::ifstream& a_file) {
         readBigEndian<uint64_t>(a_file, box->size);
         parse_offset += 8;
     }
+    box->header_size = parse_offset;
     box->setParseOffset(parse_offset);
 
-    std::cout << "-- header parsed\n"; // debug
     return box;
 }
 
 
+// Transmet une boîte décodée à la fonction de rappel typée du visiteur.
+//     @visitor: le destinataire
+//     @box: la boîte analysée
+//     @return: l'action renvoyée par le visiteur
+static VisitAction dispatchDecoded(BoxVisitor& a_visitor, Box& a_box) {
+    switch (a_box.kind) {
+    case BoxKind::Ftyp: return a_visitor.onFtyp(static_cast<Ftyp&>(a_box));
+    case BoxKind::Mdat: return a_visitor.onMdat(static_cast<Mdat&>(a_box));
+    case BoxKind::Pdin: return a_visitor.onPdin(static_cast<Pdin&>(a_box));
+    case BoxKind::Mvhd: return a_visitor.onMvhd(static_cast<Mvhd&>(a_box));
+    case BoxKind::Tkhd: return a_visitor.onTkhd(static_cast<Tkhd&>(a_box));
+    case BoxKind::Elst: return a_visitor.onElst(static_cast<Elst&>(a_box));
+    case BoxKind::Mdhd: return a_visitor.onMdhd(static_cast<Mdhd&>(a_box));
+    case BoxKind::Hdlr: return a_visitor.onHdlr(static_cast<Hdlr&>(a_box));
+    case BoxKind::Vmhd: return a_visitor.onVmhd(static_cast<Vmhd&>(a_box));
+    case BoxKind::Smhd: return a_visitor.onSmhd(static_cast<Smhd&>(a_box));
+    case BoxKind::Url:  return a_visitor.onUrl (static_cast<Url&>(a_box));
+    case BoxKind::Urn:  return a_visitor.onUrn (static_cast<Urn&>(a_box));
+    case BoxKind::Btrt: return a_visitor.onBtrt(static_cast<Btrt&>(a_box));
+    case BoxKind::Icpv: return a_visitor.onVisualSampleEntry(static_cast<Icpv&>(a_box));
+    case BoxKind::Hvc1: return a_visitor.onVisualSampleEntry(static_cast<Hvc1&>(a_box));
+    case BoxKind::Hvcc: return a_visitor.onHvcc(static_cast<Hvcc&>(a_box));
+    case BoxKind::Mp4a: return a_visitor.onAudioSampleEntry(static_cast<Mp4a&>(a_box));
+    case BoxKind::Esds: return a_visitor.onEsds(static_cast<Esds&>(a_box));
+    default:            return VisitAction::Continue;
+    }
+}
+
+// Analyse une boîte et ajoute ses statistiques à celles de son type. Les
+// cumuls des boîtes enfants sont retirés pour ne compter que la boîte elle-même.
+//     @file: le bitstream du fichier analysé
+//     @box: la boîte dont l'entête vient d'être lu
+//     @counters: les compteurs du thread
+static void parseCounted(std::istream& a_file, Box& a_box, ParseCounters& a_counters) {
+    ParseCounters::Totals parent_children = a_counters.children;
+    a_counters.children = ParseCounters::Totals();
+    uint64_t seeks   = a_counters.seeks;
+    uint64_t skipped = a_counters.skipped;
+    std::chrono::steady_clock::time_point beg;
+    if (a_counters.timed) {
+        beg = std::chrono::steady_clock::now();
+    }
+
+    {
+        TraceScope trace(std::string_view(a_box.type.data(), 4), "parse");
+        trace.setBox(a_box.type, a_box.offset, a_box.size);
+        visitBox(a_box, [&](auto& a_typed) { a_typed.parse(a_file); });
+    }
+
+    ParseCounters::Totals total;
+    if (a_counters.timed) {
+        total.ns  = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - beg).count();
+    }
+    total.bytes   = a_box.size;
+    total.seeks   = a_counters.seeks - seeks;
+    total.skipped = a_counters.skipped - skipped;
+
+    uint32_t fourcc = uint32_t(uint8_t(a_box.type[0])) << 24 | uint32_t(uint8_t(a_box.type[1])) << 16
+                    | uint32_t(uint8_t(a_box.type[2])) << 8 | uint8_t(a_box.type[3]);
+    BoxTypeStats& stats = a_counters.by_type[fourcc];
+    const ParseCounters::Totals& children = a_counters.children;
+    uint64_t payload = a_box.size != 0 ? a_box.size - a_box.header_size : 0;
+    uint64_t not_decoded = children.bytes + (total.skipped - children.skipped);
+    stats.type = a_box.type;
+    stats.count++;
+    stats.bytes         += a_box.size;
+    stats.decoded_bytes += payload > not_decoded ? payload - not_decoded : 0;
+    stats.parse_ns      += total.ns - children.ns;
+    stats.seeks         += total.seeks - children.seeks;
+
+    a_counters.children.ns      = parent_children.ns      + total.ns;
+    a_counters.children.bytes   = parent_children.bytes   + total.bytes;
+    a_counters.children.seeks   = parent_children.seeks   + total.seeks;
+    a_counters.children.skipped = parent_children.skipped + total.skipped;
+}
+
 // Parse la boîte à la position du bitstream.
 //     @file: un pointeur vers le bitstream de lecture
 //     @box:  la boîte analysée, parente des boîtes suivantes
 //     @box_size: taille de la boîte
 //     @return: pas de valeur de sortie
-void parseBox(std::ifstream& a_file, Box& a_box) {
+void parseBox(std::istream& a_file, Box& a_box) {
     // position du début de la boîte, après l'entête
     uint64_t beg_box = (uint64_t) a_file.tellg();
     uint64_t end_box;
@@ -201,16 +394,135 @@ void parseBox(std::ifstream& a_file, Box& a_box) {
     } else {                             // cas de lecture jusqu'à la fin du fichier
         end_box = (uint64_t) -1;         // max uint64
     }
+    static TreeBuilder tree_builder;
+    ParseContext *context = ParseContext::current();
+    BoxVisitor& visitor = (context != nullptr && context->visitor != nullptr) ? *context->visitor
+                                                                              : tree_builder;
+    size_t depth = 1;
+    for (Box *parent = a_box.getParent(); parent != nullptr; parent = parent->getParent()) {
+        depth++;
+    }
+    std::vector<PathSegment> siblings; // nombre de boîtes sœurs déjà lues, par type
+    ParseCounters& counters = parseCounters();
     std::unique_ptr<Box> child_box;
     while ( (uint64_t) a_file.tellg() < end_box && a_file.peek() != EOF) { // 2e condition pour le cas box_size = 0
-        child_box = parseHeader(a_file);
-        child_box->setParent(&a_box);
-        
-        Box* raw_ptr = child_box.get();
-        a_box.addChild(child_box);
-        raw_ptr->parse(a_file);
-        raw_ptr->print(std::cout); // debug
+        if (context != nullptr && context->stopped) {
+            break;
+        }
+        std::chrono::steady_clock::time_point header_beg;
+        if (counters.timed) {
+            header_beg = std::chrono::steady_clock::now();
+        }
+        {
+            TraceScope trace("parseHeader", "header");
+            child_box = parseHeader(a_file);
+            trace.setBox(child_box->type, child_box->offset, child_box->size);
+        }
+        counters.headers++;
+        if (counters.timed) {
+            counters.header_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                      std::chrono::steady_clock::now() - header_beg).count();
+        }
+
+        bool was_selected = false;
+        bool filtered = context != nullptr && context->query != nullptr;
+        if (filtered) {
+            uint32_t index = 0;
+            auto sibling = std::find_if(siblings.begin(), siblings.end(),
+                                        [&](const PathSegment& s) { return s.type == child_box->type; });
+            if (sibling == siblings.end()) {
+                siblings.push_back(PathSegment{child_box->type, 1});
+            } else {
+                index = sibling->index++;
+            }
+            context->path.push_back(PathSegment{child_box->type, index});
+            was_selected = context->selected;
+            if (!context->selected) {
+                BoxQuery::Match match = context->query->match(context->path);
+                if (match == BoxQuery::Match::None) {
+                    context->path.pop_back();
+                    context->skipped_boxes++;
+                    context->skipped_bytes += skipBox(a_file, *child_box);
+                    continue;
+                }
+                context->selected = (match == BoxQuery::Match::Selected);
+            }
+        }
+
+        // appels directs vers la classe concrète (cf visitBox)
+        visitBox(*child_box, [&](auto& a_child) { a_child.setParent(&a_box); });
+
+        VisitAction action = visitor.enterBox(*child_box, depth);
+        if (action == VisitAction::Continue) {
+            parseCounted(a_file, *child_box, counters);
+            if (context == nullptr || !context->stopped) {
+                action = dispatchDecoded(visitor, *child_box);
+            }
+            if (action == VisitAction::Continue && (context == nullptr || !context->stopped)) {
+                action = visitor.leaveBox(*child_box, depth);
+            }
+            visitor.adopt(a_box, child_box);
+        }
+        if (action == VisitAction::SkipSubtree) {
+            skipBox(a_file, *child_box);
+        } else if (action == VisitAction::Stop && context != nullptr) {
+            context->stopped = true;
+        }
+
+        if (filtered) {
+            context->selected = was_selected;
+            context->path.pop_back();
+        }
+    }
+}
+
+uint64_t skipBox(std::istream& a_file, const Box& a_box) {
+    uint64_t beg_data = (uint64_t) a_file.tellg();
+    if (a_box.size == 0) {           // on saute jusqu'à la fin du fichier
+        TraceScope trace("seek", "io");
+        a_file.seekg(0, a_file.end);
+    } else {
+        TraceScope trace("seek", "io");
+        a_file.seekg(a_box.offset + a_box.size);
     }
+    ParseCounters& counters = parseCounters();
+    counters.seeks++;
+    counters.skipped += (uint64_t) a_file.tellg() - beg_data;
+    return (uint64_t) a_file.tellg() - beg_data;
+}
+
+void parseSelective(std::istream& a_file, Root& a_root, const BoxQuery& a_query,
+                    ParseContext& a_context) {
+    TreeBuilder tree_builder;
+    a_context.query = &a_query;
+    parseEvents(a_file, a_root, tree_builder, a_context);
+}
+
+void parseEvents(std::istream& a_file, Root& a_root, BoxVisitor& a_visitor, ParseContext& a_context) {
+    a_context.visitor  = &a_visitor;
+    a_context.stopped  = false;
+    a_context.selected = a_context.query == nullptr || a_context.query->empty();
+    a_context.path.clear();
+    ParseContext::Scope scope(a_context);
+    a_root.parse(a_file);
+}
+
+// Emplacement du contexte actif, propre à chaque thread.
+static ParseContext *&currentParseContext() {
+    static thread_local ParseContext *context = nullptr;
+    return context;
+}
+
+ParseContext *ParseContext::current() {
+    return currentParseContext();
+}
+
+ParseContext::Scope::Scope(ParseContext& a_context) : m_previous(currentParseContext()) {
+    currentParseContext() = &a_context;
+}
+
+ParseContext::Scope::~Scope() {
+    currentParseContext() = m_previous;
 }
 
 void Box::setParent(Box* a_parent, const std::array<char, 4> a_expected_parent_type) {
@@ -240,15 +552,28 @@ void Box::setParent(Box* a_parent, const std::vector<std::array<char, 4>> a_expe
     throw std::runtime_error(errs.str());
 }
 
-void Box::print(std::ostream& a_outstream) { 
-    a_outstream << "type: "
-                << std::string(type.data(), 4)
-                << "\nsize: "
-                << size
-                << std::endl;
+Box* Box::findChild(std::array<char, 4> a_type) const {
+    for (const std::unique_ptr<Box>& child : m_children) {
+        if (child->type == a_type) {
+            return child.get();
+        }
+    }
+    return nullptr;
+}
+
+void Box::print(std::ostream& a_outstream) {
+    DumpWriter writer(a_outstream, PRINT_CAPACITY);
+    visitBox(*this, [&](auto& a_box) { a_box.dump(writer); });
+}
+void Box::dump(DumpWriter& a_writer) const {
+    a_writer << "type: "
+             << std::string_view(type.data(), 4)
+             << "\nsize: "
+             << size
+             << '\n';
 }
 
-void FullBox::parse(std::ifstream& a_file) {
+void FullBox::parse(std::istream& a_file) {
     // version
     readBigEndian<uint8_t>(a_file, version);
     // flags
@@ -258,20 +583,20 @@ void FullBox::parse(std::ifstream& a_file) {
 
     m_parse_offset += 4;
 }
-void FullBox::print(std::ostream& a_outstream) {
-    Box::print(a_outstream);
-    a_outstream << "version: " << (int) version << std::endl
-                << "flags: ";
+void FullBox::dump(DumpWriter& a_writer) const {
+    Box::dump(a_writer);
+    a_writer << "version: " << (int) version << '\n'
+             << "flags: ";
     for (uint8_t i = 0; i < 3; i++) {
         for (uint8_t j = 0; j < 4; j++) {
-            a_outstream << (flags[i] & (1 << j));
+            a_writer << (flags[i] & (1 << j));
         }
-        a_outstream << ' ';
+        a_writer << ' ';
     }
-    a_outstream << std::endl;
+    a_writer << '\n';
 }
 
-void Root::parse(std::ifstream& a_file) {
+void Root::parse(std::istream& a_file) {
     parseBox(a_file, *this);
 }
 void Root::setParent(Box* a_parent) {
@@ -279,7 +604,7 @@ void Root::setParent(Box* a_parent) {
     throw std::runtime_error("Root object cannot have a parent.");
 }
 
-void Ftyp::parse(std::ifstream& a_file) {
+void Ftyp::parse(std::istream& a_file) {
     a_file.read(major_brand.data(), 4);
 
     readBigEndian<uint32_t>(a_file, minor_version);
@@ -297,48 +622,48 @@ void Ftyp::parse(std::ifstream& a_file) {
         }
     }
 }
-void Ftyp::print(std::ostream& a_outstream) {
-    Box::print(a_outstream);
-    a_outstream << "major brand: " << std::string(major_brand.data(), 4) << std::endl
-                << "minor version: " << (int)minor_version << std::endl
-                << "compatible brands: " << std::endl;
+void Ftyp::dump(DumpWriter& a_writer) const {
+    Box::dump(a_writer);
+    a_writer << "major brand: " << std::string(major_brand.data(), 4) << '\n'
+             << "minor version: " << (int)minor_version << '\n'
+             << "compatible brands: " << '\n';
     for (int i=0; i < (int) compatible_brands.size(); i++) {
-        a_outstream << '\t';
-        a_outstream.write(compatible_brands[i].data(), 4);
-        a_outstream << std::endl;
+        a_writer << '\t';
+        a_writer.write(compatible_brands[i].data(), 4);
+        a_writer << '\n';
     }
-    a_outstream << std::endl;
+    a_writer << '\n';
 }
 void Ftyp::setParent(Box* a_parent) {
     Box::setParent(a_parent, {'r', 'o', 'o', 't'});
 }
 
-void Mdat::parse(std::ifstream& a_file) {
+void Mdat::parse(std::istream& a_file) {
     beg_data = a_file.tellg();
     if (size == 0) {           // on lit jusqu'à la fin du fichier
-        a_file.seekg(0, a_file.end);
+        skipToEnd(a_file);
     } else {
-        a_file.seekg((uint64_t) a_file.tellg() + size - m_parse_offset);
+        skipBytes(a_file, size - m_parse_offset);
     }
 }
-void Mdat::print(std::ostream& a_outstream) {
-    Box::print(a_outstream);
-    a_outstream << "beginning of data: " << beg_data
-                << std::endl
-                << std::endl;
+void Mdat::dump(DumpWriter& a_writer) const {
+    Box::dump(a_writer);
+    a_writer << "beginning of data: " << beg_data
+             << '\n'
+             << '\n';
 }
 void Mdat::setParent(Box* a_parent) {
     Box::setParent(a_parent, {'r', 'o', 'o', 't'});
 }
 
-void Free::parse(std::ifstream& a_file) {
-    a_file.seekg( (uint64_t) a_file.tellg() + size - m_parse_offset);
+void Free::parse(std::istream& a_file) {
+    skipBytes(a_file, size - m_parse_offset);
 }
 void Free::setParent(Box* a_parent) {
     m_parent = a_parent;
 }
 
-void Pdin::parse(std::ifstream& a_file) {
+void Pdin::parse(std::istream& a_file) {
     FullBox::parse(a_file);
     uint32_t buffer;
 
@@ -350,29 +675,29 @@ void Pdin::parse(std::ifstream& a_file) {
         initial_delay.push_back(buffer);
     }
 }
-void Pdin::print(std::ostream& a_outstream) {
-    FullBox::print(a_outstream);
-    a_outstream << "rate\tinitial delay:" << std::endl;
+void Pdin::dump(DumpWriter& a_writer) const {
+    FullBox::dump(a_writer);
+    a_writer << "rate\tinitial delay:" << '\n';
     for (int i = 0; i < (int) rate.size(); i++) {
-        a_outstream << rate[i]
-                    << ' '
-                    << initial_delay[i]
-                    << std::endl;
+        a_writer << rate[i]
+                 << ' '
+                 << initial_delay[i]
+                 << '\n';
     }
-    a_outstream << std::endl;
+    a_writer << '\n';
 }
 void Pdin::setParent(Box* a_parent) {
     Box::setParent(a_parent, {'r', 'o', 'o', 't'});
 }
 
-void Moov::parse(std::ifstream& a_file) {
+void Moov::parse(std::istream& a_file) {
     parseBox(a_file, *this);
 }
 void Moov::setParent(Box* a_parent) {
     Box::setParent(a_parent, {'r', 'o', 'o', 't'});
 }
 
-void Mvhd::parse(std::ifstream& a_file) {
+void Mvhd::parse(std::istream& a_file) {
     FullBox::parse(a_file);
     if (version == 1) {
         // creation_time
@@ -404,50 +729,50 @@ void Mvhd::parse(std::ifstream& a_file) {
     // volume
     readBigEndian<uint16_t>(a_file, volume);
     // reserved (2 octets)
-    a_file.seekg( (uint64_t) a_file.tellg() + 2);
+    skipBytes(a_file, 2);
     // reserved ( (4 octets)[2] )
-    a_file.seekg( (uint64_t) a_file.tellg() + 8);
+    skipBytes(a_file, 8);
     // matrix
     for (int i=0; i<9; i++) {
         readBigEndian<int32_t>(a_file, matrix[i]);
     }
     // pre_defined ( (4 octets)[6] )
-    a_file.seekg( (uint64_t) a_file.tellg() + 24);
+    skipBytes(a_file, 24);
     // next_track_ID
     readBigEndian<uint32_t>(a_file, next_track_ID);
 }
-void Mvhd::print(std::ostream& a_outstream) {
-    FullBox::print(a_outstream);
-    a_outstream << "creation time: " << creation_time << std::endl
-                << "timescale: "     << timescale << std::endl
-                << "duration: "      << duration << std::endl
-                << "rate: "          << (int) (rate >> 16) << '.'
-                                     << (int) (rate & ((1<<16)-1) ) << std::endl
-                << "volume: "        << (int) (volume >> 8) << '.'
-                                     << (int) (volume & 255) << std::endl
-                << "matrix: "        << std::endl;
+void Mvhd::dump(DumpWriter& a_writer) const {
+    FullBox::dump(a_writer);
+    a_writer << "creation time: " << creation_time << '\n'
+             << "timescale: "     << timescale << '\n'
+             << "duration: "      << duration << '\n'
+             << "rate: "          << (int) (rate >> 16) << '.'
+                                  << (int) (rate & ((1<<16)-1) ) << '\n'
+             << "volume: "        << (int) (volume >> 8) << '.'
+                                  << (int) (volume & 255) << '\n'
+             << "matrix: "        << '\n';
     for (uint8_t i = 0; i < 3; i++) {
-        a_outstream << '\t';
+        a_writer << '\t';
         for (uint8_t j = 0; j < 3; j++) {
-            a_outstream << matrix[3*i+j] << ' ';
+            a_writer << matrix[3*i+j] << ' ';
         }
-        a_outstream << std::endl;
+        a_writer << '\n';
     }
-    a_outstream << "next track ID: " << next_track_ID << std::endl
-                << std::endl;
+    a_writer << "next track ID: " << next_track_ID << '\n'
+             << '\n';
 }
 void Mvhd::setParent(Box* a_parent) {
     Box::setParent(a_parent, {'m', 'o', 'o', 'v'});
 }
 
-void Trak::parse(std::ifstream& a_file) {
+void Trak::parse(std::istream& a_file) {
     parseBox(a_file, *this);
 }
 void Trak::setParent(Box* a_parent) {
     Box::setParent(a_parent, {'m', 'o', 'o', 'v'});
 }
 
-void Tkhd::parse(std::ifstream& a_file) {
+void Tkhd::parse(std::istream& a_file) {
     FullBox::parse(a_file);    
     if (version == 1) {
         // creation_time
@@ -457,7 +782,7 @@ void Tkhd::parse(std::ifstream& a_file) {
         // track_ID
         readBigEndian<uint32_t>(a_file, track_ID);
         // reserved (4 octets)
-        a_file.seekg( (uint64_t) a_file.tellg() + 4);
+        skipBytes(a_file, 4);
         // duration
         readBigEndian<uint64_t>(a_file, duration);
     } else if (version == 0) {
@@ -471,7 +796,7 @@ void Tkhd::parse(std::ifstream& a_file) {
         // track_ID
         readBigEndian<uint32_t>(a_file, track_ID);
         // reserved (4 octets)
-        a_file.seekg( (uint64_t) a_file.tellg() + 4);
+        skipBytes(a_file, 4);
         // duration
         readBigEndian<uint32_t>(a_file, tmp_32);
         duration = tmp_32;
@@ -479,7 +804,7 @@ void Tkhd::parse(std::ifstream& a_file) {
         throw std::runtime_error("Mvhd version must be 0 or 1.");
     }
     // reserved ((4 octets)[2])
-    a_file.seekg( (uint64_t) a_file.tellg() + 8);
+    skipBytes(a_file, 8);
     // layer
     readBigEndian<int16_t>(a_file, layer);
     // alternate_group
@@ -487,7 +812,7 @@ void Tkhd::parse(std::ifstream& a_file) {
     // volume
     readBigEndian<int16_t>(a_file, volume);
     // reserved (2 octets)
-    a_file.seekg( (uint64_t) a_file.tellg() + 2);
+    skipBytes(a_file, 2);
     // matrix
     for (int i=0; i<9; i++) {
         readBigEndian<int32_t>(a_file, matrix[i]);
@@ -497,40 +822,40 @@ void Tkhd::parse(std::ifstream& a_file) {
     // height
     readBigEndian<uint32_t>(a_file, height);
 }
-void Tkhd::print(std::ostream& a_outstream) {
-    FullBox::print(a_outstream);
-    a_outstream << "creation time: "     << creation_time << std::endl
-                << "modification time: " << modification_time << std::endl
-                << "track ID: "          << track_ID << std::endl
-                << "duration: "          << duration << std::endl
-                << "layer: "             << layer << std::endl
-                << "alternate group: "   << alternate_group << std::endl
-                << "volume: "            << (int) (volume >> 8) << '.'
-                                         << (int) (volume & 255) << std::endl
-                << "matrix: "            << std::endl;
+void Tkhd::dump(DumpWriter& a_writer) const {
+    FullBox::dump(a_writer);
+    a_writer << "creation time: "     << creation_time << '\n'
+             << "modification time: " << modification_time << '\n'
+             << "track ID: "          << track_ID << '\n'
+             << "duration: "          << duration << '\n'
+             << "layer: "             << layer << '\n'
+             << "alternate group: "   << alternate_group << '\n'
+             << "volume: "            << (int) (volume >> 8) << '.'
+                                      << (int) (volume & 255) << '\n'
+             << "matrix: "            << '\n';
     for (uint8_t i = 0; i < 3; i++) {
-        a_outstream << '\t';
+        a_writer << '\t';
         for (uint8_t j = 0; j < 3; j++) {
-            a_outstream << matrix[3*i+j] << ' ';
+            a_writer << matrix[3*i+j] << ' ';
         }
-        a_outstream << std::endl;
+        a_writer << '\n';
     }
-    a_outstream << "width: "  << width << std::endl
-                << "height: " << height << std::endl
-                << std::endl;
+    a_writer << "width: "  << width << '\n'
+             << "height: " << height << '\n'
+             << '\n';
 }
 void Tkhd::setParent(Box* a_parent) {
     Box::setParent(a_parent, {'t', 'r', 'a', 'k'});
 }
 
-void Edts::parse(std::ifstream& a_file) {
+void Edts::parse(std::istream& a_file) {
     parseBox(a_file, *this);
 }
 void Edts::setParent(Box* a_parent) {
     Box::setParent(a_parent, {'t', 'r', 'a', 'k'});
 }
 
-void Elst::parse(std::ifstream& a_file) {
+void Elst::parse(std::istream& a_file) {
     FullBox::parse(a_file);
     
     // entry_count
@@ -538,6 +863,7 @@ void Elst::parse(std::ifstream& a_file) {
     if (version == 1) {
         uint64_t ubuffer;
         int64_t  sbuffer;
+        int16_t  ibuffer;
         for (uint32_t i=0; i<entry_count; i++) {
             // segment_duration
             readBigEndian<uint64_t>(a_file, ubuffer);
@@ -545,6 +871,12 @@ void Elst::parse(std::ifstream& a_file) {
             // media_time
             readBigEndian<int64_t>(a_file, sbuffer);
             media_time.push_back(sbuffer);
+            // media_rate_integer
+            readBigEndian<int16_t>(a_file, ibuffer);
+            media_rate_integer.push_back(ibuffer);
+            // media_rate_fraction
+            readBigEndian<int16_t>(a_file, ibuffer);
+            media_rate_fraction.push_back(ibuffer);
         }
     } else if (version == 0) {
         uint32_t ubuffer;
@@ -568,36 +900,36 @@ void Elst::parse(std::ifstream& a_file) {
         throw std::runtime_error("FullBox version must be 0 or 1.");
     }
 }
-void Elst::print(std::ostream& a_outstream) {
-    FullBox::print(a_outstream);
-    a_outstream << "entry count: " << entry_count << std::endl
-                << "segment duration: ";
-    for (uint32_t i=0; i<entry_count; i++) {
-        a_outstream << segment_duration[i] << ' ';
+void Elst::dump(DumpWriter& a_writer) const {
+    FullBox::dump(a_writer);
+    a_writer << "entry count: " << entry_count << '\n'
+             << "segment duration: ";
+    for (size_t i=0; i<segment_duration.size(); i++) {
+        a_writer << segment_duration[i] << ' ';
     }
-    a_outstream << "\nmedia time: ";
-    for (uint32_t i=0; i<entry_count; i++) {
-        a_outstream << media_time[i] << ' ';
+    a_writer << "\nmedia time: ";
+    for (size_t i=0; i<media_time.size(); i++) {
+        a_writer << media_time[i] << ' ';
     }
-    a_outstream << "\nmedia rate: ";
-    for (uint32_t i=0; i<entry_count; i++) {
-        a_outstream << media_rate_integer[i] << '.'
-                    << media_rate_fraction[i] << ' ';
+    a_writer << "\nmedia rate: ";
+    for (size_t i=0; i<media_rate_integer.size(); i++) {
+        a_writer << media_rate_integer[i] << '.'
+                 << media_rate_fraction[i] << ' ';
     }
-    a_outstream << '\n';
+    a_writer << '\n';
 }
 void Elst::setParent(Box* a_parent) {
     Box::setParent(a_parent, {'e', 'd', 't', 's'});
 }
 
-void Mdia::parse(std::ifstream& a_file) {
+void Mdia::parse(std::istream& a_file) {
     parseBox(a_file, *this);
 }
 void Mdia::setParent(Box* a_parent) {
     Box::setParent(a_parent, {'t', 'r', 'a', 'k'});
 }
 
-void Mdhd::parse(std::ifstream& a_file) {
+void Mdhd::parse(std::istream& a_file) {
     FullBox::parse(a_file);
     
     if (version == 1) {
@@ -626,58 +958,56 @@ void Mdhd::parse(std::ifstream& a_file) {
         throw std::runtime_error("FullBox version must be 0 or 1.");
     }
     // padding (1 octet)
-    // a_file.seekg( (uint64_t) a_file.tellg() + 1);
+    // skipBytes(a_file, 1);
     // language
     readBigEndian<uint16_t>(a_file, language);
     // pre_defined (2 octets)
-    a_file.seekg( (uint64_t) a_file.tellg() + 2);
+    skipBytes(a_file, 2);
 }
-void Mdhd::print(std::ostream& a_outstream) {
-    FullBox::print(a_outstream);
-    a_outstream << "creation time: "     << creation_time     << '\n'
-                << "modification time: " << modification_time << '\n'
-                << "timescale: "         << timescale         << '\n'
-                << "duration: "          << duration          << '\n'
-                << "language: " << language << '\n';
+void Mdhd::dump(DumpWriter& a_writer) const {
+    FullBox::dump(a_writer);
+    a_writer << "creation time: "     << creation_time     << '\n'
+             << "modification time: " << modification_time << '\n'
+             << "timescale: "         << timescale         << '\n'
+             << "duration: "          << duration          << '\n'
+             << "language: " << language << '\n';
 }
 void Mdhd::setParent(Box* a_parent) {
     Box::setParent(a_parent, {'m', 'd', 'i', 'a'});
 }
 
-void Hdlr::parse(std::ifstream& a_file) {
+void Hdlr::parse(std::istream& a_file) {
     FullBox::parse(a_file);
     
-    // pre_defined (4 octets)
-    a_file.seekg( (uint64_t) a_file.tellg() + 4);
+    // pre_defined (4 octets), conservé pour la réécriture
+    readBigEndian<uint32_t>(a_file, pre_defined);
     // handler_type
     readBigEndian<uint32_t>(a_file, handler_type);
-    // reserved (4 octets)[3]
-    a_file.seekg( (uint64_t) a_file.tellg() + 12);
+    // reserved (4 octets)[3], conservé pour la réécriture
+    a_file.read(reserved.data(), 12);
 
     m_parse_offset += 20;
-    // name
-    m_parse_offset += readNullTerminatedString(a_file, name);
-    if (m_parse_offset > size) {
-        throw std::runtime_error("Overflow box size while reading (hdlr)");
-    }
+    // name, borné par la fin de la boîte
+    strings.read(a_file, remainingBytes(*this));
+    name = strings.next();
 }
-void Hdlr::print(std::ostream& a_outstream) {
-    FullBox::print(a_outstream);
-    a_outstream << "handler type: " << handler_type << '\n'
-                << "name: "         << name         << '\n';
+void Hdlr::dump(DumpWriter& a_writer) const {
+    FullBox::dump(a_writer);
+    a_writer << "handler type: " << handler_type << '\n'
+             << "name: "         << name         << '\n';
 }
 void Hdlr::setParent(Box* a_parent) {
     Box::setParent(a_parent, {{'m', 'd', 'i', 'a'}, {'m', 'e', 't', 'a'} });
 }
 
-void Minf::parse(std::ifstream& a_file) {
+void Minf::parse(std::istream& a_file) {
     parseBox(a_file, *this);
 }
 void Minf::setParent(Box* a_parent) {
     Box::setParent(a_parent, {'m', 'd', 'i', 'a'});
 }
 
-void Vmhd::parse(std::ifstream& a_file) {
+void Vmhd::parse(std::istream& a_file) {
     FullBox::parse(a_file);
 
     // graphicsmode
@@ -687,60 +1017,61 @@ void Vmhd::parse(std::ifstream& a_file) {
         readBigEndian<uint16_t>(a_file, opcolor[i]);
     }
 }
-void Vmhd::print(std::ostream& a_outstream) {
-    FullBox::print(a_outstream);
-    a_outstream << "graphics mode: " << graphicsmode << '\n'
-                << "opcolor: "       << opcolor[0]
-                                     << opcolor[1]
-                                     << opcolor[2]   << '\n';
+void Vmhd::dump(DumpWriter& a_writer) const {
+    FullBox::dump(a_writer);
+    a_writer << "graphics mode: " << graphicsmode << '\n'
+             << "opcolor: "       << opcolor[0]
+                                  << opcolor[1]
+                                  << opcolor[2]   << '\n';
 }
 void Vmhd::setParent(Box* a_parent) {
     Box::setParent(a_parent, {'m', 'i', 'n', 'f'});
 }
 
-void Dinf::parse(std::ifstream& a_file) {
+void Dinf::parse(std::istream& a_file) {
     parseBox(a_file, *this);
 }
 void Dinf::setParent(Box* a_parent) {
     Box::setParent(a_parent, {{'m', 'i', 'n', 'f'}, {'m', 'e', 't', 'a'}});
 }
 
-void Url::parse(std::ifstream& a_file) {
+void Url::parse(std::istream& a_file) {
     FullBox::parse(a_file);
     
     // location (optionnel)
     if (flags[0] != 1) {
-        m_parse_offset += readNullTerminatedString(a_file, location);
+        strings.read(a_file, remainingBytes(*this));
+        location = strings.next();
     }
 }
-void Url::print(std::ostream& a_outstream) {
-    FullBox::print(a_outstream);
-    a_outstream << "location: " << location << '\n';
+void Url::dump(DumpWriter& a_writer) const {
+    FullBox::dump(a_writer);
+    a_writer << "location: " << location << '\n';
 }
 void Url::setParent(Box* a_parent) {
     Box::setParent(a_parent, {'d', 'r', 'e', 'f'});
 }
 
-void Urn::parse(std::ifstream& a_file) {
+void Urn::parse(std::istream& a_file) {
     FullBox::parse(a_file);
     
-    // name
-    m_parse_offset += readNullTerminatedString(a_file, name);
-    // location (optionnel)
+    // name et location (optionnel)
+    strings.read(a_file, remainingBytes(*this));
+    name = strings.next();
     if (flags[0] != 1) {
-        m_parse_offset += readNullTerminatedString(a_file, location);
+        location = strings.next();
     }
 }
-void Urn::print(std::ostream& a_outstream) {
-    FullBox::print(a_outstream);
-    a_outstream << "name: "    << name     << '\n'
-                <<"location: " << location << '\n';
+void Urn::dump(DumpWriter& a_writer) const {
+    FullBox::dump(a_writer);
+    a_writer << "name: "    << name     << '\n'
+             <<"location: " << location << '\n';
 }
 void Urn::setParent(Box* a_parent) {
     Box::setParent(a_parent, {'d', 'r', 'e', 'f'});
 }
 
-void Dref::parse(std::ifstream& a_file) {
+void Dref::parse(std::istream& a_file) {
     FullBox::parse(a_file);
     
     // entry_count
@@ -749,34 +1080,34 @@ void Dref::parse(std::ifstream& a_file) {
     // data_entry
     parseBox(a_file, *this);
 }
-void Dref::print(std::ostream& a_outstream) {
-    FullBox::print(a_outstream);
-    a_outstream << "entry count: " << entry_count << '\n';
+void Dref::dump(DumpWriter& a_writer) const {
+    FullBox::dump(a_writer);
+    a_writer << "entry count: " << entry_count << '\n';
 }
 void Dref::setParent(Box* a_parent) {
     Box::setParent(a_parent, {'d', 'i', 'n', 'f'});
 }
 
-void Stbl::parse(std::ifstream& a_file) {
+void Stbl::parse(std::istream& a_file) {
     parseBox(a_file, *this);
 }
 void Stbl::setParent(Box* a_parent) {
     Box::setParent(a_parent, {'m', 'i', 'n', 'f'});
 }
 
-void SampleEntry::parse(std::ifstream& a_file) {
+void SampleEntry::parse(std::istream& a_file) {
     // reserved (1 octet)[6]
-    a_file.seekg( (uint64_t) a_file.tellg() + 6);
+    skipBytes(a_file, 6);
     // data_reference_index
     readBigEndian<uint16_t>(a_file, data_reference_index);
     m_parse_offset += 8;
 }
-void SampleEntry::print(std::ostream& a_outstream) {
-    Box::print(a_outstream);
-    a_outstream << "data reference index: " << data_reference_index << '\n';
+void SampleEntry::dump(DumpWriter& a_writer) const {
+    Box::dump(a_writer);
+    a_writer << "data reference index: " << data_reference_index << '\n';
 }
 
-void Btrt::parse(std::ifstream& a_file) {
+void Btrt::parse(std::istream& a_file) {
     // bufferSizeDB
     readBigEndian<uint32_t>(a_file, bufferSizeDB);
     // maxBitrate
@@ -784,17 +1115,18 @@ void Btrt::parse(std::ifstream& a_file) {
     // avgBitrate
     readBigEndian<uint32_t>(a_file, avgBitrate);
 }
-void Btrt::print(std::ostream& a_outstream) {
-    Box::print(a_outstream);
-    a_outstream << "bufferSizeDB: " << bufferSizeDB << '\n'
-                << "maxBitrate: "   << maxBitrate   << '\n'
-                << "avgBitrate: "   << avgBitrate   << '\n';
+void Btrt::dump(DumpWriter& a_writer) const {
+    Box::dump(a_writer);
+    a_writer << "bufferSizeDB: " << bufferSizeDB << '\n'
+             << "maxBitrate: "   << maxBitrate   << '\n'
+             << "avgBitrate: "   << avgBitrate   << '\n';
 }
 void Btrt::setParent(Box* a_parent) {
-    Box::setParent(a_parent, {'m', 'i', 'n', 'f'});
+    Box::setParent(a_parent, {{'m', 'i', 'n', 'f'}, {'i', 'c', 'p', 'v'}, {'h', 'v', 'c', '1'}, {'h', 'e', 'v', '1'},
+                              {'m', 'p', '4', 'a'}});
 }
 
-void Stsd::parse(std::ifstream& a_file) {
+void Stsd::parse(std::istream& a_file) {
     FullBox::parse(a_file);
 
     // entry_count
@@ -803,15 +1135,15 @@ void Stsd::parse(std::ifstream& a_file) {
     // sample entries
     parseBox(a_file, *this);
 }
-void Stsd::print(std::ostream& a_outstream) {
-    FullBox::print(a_outstream);
-    a_outstream << "entry count: " << entry_count << '\n';
+void Stsd::dump(DumpWriter& a_writer) const {
+    FullBox::dump(a_writer);
+    a_writer << "entry count: " << entry_count << '\n';
 }
 void Stsd::setParent(Box* a_parent) {
     Box::setParent(a_parent, {'s', 't', 'b', 'l'});
 }
 
-void Meta::parse(std::ifstream& a_file) {
+void Meta::parse(std::istream& a_file) {
     FullBox::parse(a_file);
     parseBox(a_file, *this);
 }
@@ -819,24 +1151,24 @@ void Meta::setParent(Box *a_parent) {
     Box::setParent(a_parent, {{'m', 'o', 'o', 'v'}, {'t', 'r', 'a', 'k'}, {'u', 'd', 't', 'a'}});
 }
 
-void Frma::parse(std::ifstream& a_file) {
+void Frma::parse(std::istream& a_file) {
     m_beg_data = a_file.tellg();
     if (size == 0) {           // on lit jusqu'à la fin du fichier
-        a_file.seekg(0, a_file.end);
+        skipToEnd(a_file);
     } else {
-        a_file.seekg((uint64_t) a_file.tellg() + size - m_parse_offset);
+        skipBytes(a_file, size - m_parse_offset);
     }
 }
-void Frma::print(std::ostream& a_outstream) {
-    Box::print(a_outstream);
-    a_outstream << "data_format: " << std::string(data_format.data()) << '\n'
-                << "beginning of data: " << m_beg_data << '\n';
+void Frma::dump(DumpWriter& a_writer) const {
+    Box::dump(a_writer);
+    a_writer << "data_format: " << std::string(data_format.data(), 4) << '\n'
+             << "beginning of data: " << m_beg_data << '\n';
 }
 void Frma::setParent(Box *a_parent) {
     Box::setParent(a_parent, {'c', 'i', 'n', 'f'});
 }
 
-void Cinf::parse(std::ifstream& a_file) {
+void Cinf::parse(std::istream& a_file) {
     // original_format
     parseBox(a_file, *this);
 }
@@ -844,27 +1176,27 @@ void Cinf::setParent(Box *a_parent) {
     Box::setParent(a_parent, {'s', 't', 's', 'd'});
 }
 
-void Avcc::parse(std::ifstream& a_file) {
+void Avcc::parse(std::istream& a_file) {
     beg_data = a_file.tellg();
     if (size == 0) {           // on lit jusqu'à la fin du fichier
-        a_file.seekg(0, a_file.end);
+        skipToEnd(a_file);
     } else {
-        a_file.seekg((uint64_t) a_file.tellg() + size - m_parse_offset);
+        skipBytes(a_file, size - m_parse_offset);
     }
 }
 void Avcc::setParent(Box *a_parent) {
     Box::setParent(a_parent, {'i', 'c', 'p', 'v'});
 }
 
-void VisualSampleEntry::parse(std::ifstream& a_file) {
+void VisualSampleEntry::parse(std::istream& a_file) {
     SampleEntry::parse(a_file);
     
     // pre_defined (2 octets)
-    a_file.seekg( (uint64_t) a_file.tellg() + 2);
+    skipBytes(a_file, 2);
     // reserved (2 octets)
-    a_file.seekg( (uint64_t) a_file.tellg() + 2);
+    skipBytes(a_file, 2);
     // pre_defined (4 octets)[3]
-    a_file.seekg( (uint64_t) a_file.tellg() + 12);
+    skipBytes(a_file, 12);
     // width
     readBigEndian<uint16_t>(a_file, width);
     // height
@@ -874,7 +1206,7 @@ void VisualSampleEntry::parse(std::ifstream& a_file) {
     // vertresolution
     readBigEndian<uint32_t>(a_file, vertresolution);
     // reserved (4 octets)
-    a_file.seekg( (uint64_t) a_file.tellg() + 4);
+    skipBytes(a_file, 4);
     // frame_count
     readBigEndian<uint16_t>(a_file, frame_count);
     // compressorname
@@ -882,134 +1214,328 @@ void VisualSampleEntry::parse(std::ifstream& a_file) {
     // depth
     readBigEndian<uint16_t>(a_file, depth);
     // pre_defined (2 octets)
-    a_file.seekg( (uint64_t) a_file.tellg() + 2);
+    skipBytes(a_file, 2);
 
     m_parse_offset += 70;
 };
-void VisualSampleEntry::print(std::ostream& a_outstream){
-    SampleEntry::print(a_outstream);
-
-    a_outstream << "width: "           << width           << '\n'
-                << "height: "          << height          << '\n'
-                << "horizresolution: " << horizresolution << '\n'
-                << "vertresolution: "  << vertresolution  << '\n'
-                << "frame_count: "     << frame_count     << '\n'
-                << "compressorname: "  << compressorname  << '\n'
-                << "depth: "           << depth           << '\n';
+void VisualSampleEntry::dump(DumpWriter& a_writer) const {
+    SampleEntry::dump(a_writer);
+
+    a_writer << "width: "           << width           << '\n'
+             << "height: "          << height          << '\n'
+             << "horizresolution: " << horizresolution << '\n'
+             << "vertresolution: "  << vertresolution  << '\n'
+             << "frame_count: "     << frame_count     << '\n'
+             << "compressorname: "  << compressorname  << '\n'
+             << "depth: "           << depth           << '\n';
 };
 
-void Icpv::parse(std::ifstream& a_file) {
+void Icpv::parse(std::istream& a_file) {
     VisualSampleEntry::parse(a_file);
     
     parseBox(a_file, *this);
 }
-void Icpv::print(std::ostream& a_outstream) {
-    VisualSampleEntry::print(a_outstream);
+void Icpv::dump(DumpWriter& a_writer) const {
+    VisualSampleEntry::dump(a_writer);
 }
 void Icpv::setParent(Box *a_parent) {
     Box::setParent(a_parent, {'s', 't', 's', 'd'});
 }
 
-void Stts::parse(std::ifstream& a_file) {
+// Types des tableaux de NAL de hvcC conservés comme ensembles de paramètres.
+static const uint8_t HEVC_NAL_VPS = 32;
+static const uint8_t HEVC_NAL_SPS = 33;
+static const uint8_t HEVC_NAL_PPS = 34;
+
+void Hvcc::parse(std::istream& a_file) {
+    if (size == 0 || size < m_parse_offset) {
+        throw std::runtime_error("Invalid hvcC box size.");
+    }
+    record.resize(size - m_parse_offset);
+    a_file.read(record.data(), record.size());
+    if ((size_t) a_file.gcount() != record.size()) {
+        throw std::runtime_error("End of file reached reading hvcC box.");
+    }
+
+    const uint8_t *p = reinterpret_cast<const uint8_t*>(record.data());
+    size_t position = 0;
+    // entier gros-boutiste de 1 à 8 octets
+    auto read = [&](unsigned a_bytes) {
+        if (position + a_bytes > record.size()) {
+            throw std::runtime_error("Truncated hvcC box.");
+        }
+        uint64_t x = 0;
+        for (unsigned i = 0; i < a_bytes; i++) {
+            x = x << 8 | p[position++];
+        }
+        return x;
+    };
+    configuration_version = uint8_t(read(1));
+    uint8_t byte = uint8_t(read(1));
+    general_profile_space = byte >> 6;
+    general_tier_flag     = (byte >> 5) & 1;
+    general_profile_idc   = byte & 0x1F;
+    general_profile_compatibility_flags = uint32_t(read(4));
+    general_constraint_indicator_flags  = read(6);
+    general_level_idc = uint8_t(read(1));
+    // champs précédés de bits réservés à 1
+    min_spatial_segmentation_idc = uint16_t(read(2) & 0x0FFF);
+    parallelism_type  = uint8_t(read(1) & 0x03);
+    chroma_format_idc = uint8_t(read(1) & 0x03);
+    bit_depth_luma    = uint8_t((read(1) & 0x07) + 8);
+    bit_depth_chroma  = uint8_t((read(1) & 0x07) + 8);
+    avg_frame_rate    = uint16_t(read(2));
+    byte = uint8_t(read(1));
+    constant_frame_rate = byte >> 6;
+    num_temporal_layers = (byte >> 3) & 0x07;
+    temporal_id_nested  = (byte >> 2) & 1;
+    nal_length_size     = (byte & 0x03) + 1;
+
+    // tableaux de NAL : type, nombre, puis taille sur 16 bits et contenu de chacune
+    unsigned arrays = unsigned(read(1));
+    for (unsigned a = 0; a < arrays; a++) {
+        uint8_t nal_type = uint8_t(read(1) & 0x3F);
+        unsigned count = unsigned(read(2));
+        for (unsigned i = 0; i < count; i++) {
+            size_t length = size_t(read(2));
+            if (position + length > record.size()) {
+                throw std::runtime_error("Truncated hvcC box.");
+            }
+            std::string_view nal(record.data() + position, length);
+            if (nal_type == HEVC_NAL_VPS) {
+                vps.push_back(nal);
+            } else if (nal_type == HEVC_NAL_SPS) {
+                sps.push_back(nal);
+            } else if (nal_type == HEVC_NAL_PPS) {
+                pps.push_back(nal);
+            }
+            position += length;
+        }
+    }
+}
+void Hvcc::dump(DumpWriter& a_writer) const {
+    Box::dump(a_writer);
+    a_writer << "profile: "          << unsigned(general_profile_idc)         << '\n'
+             << "tier: "             << (general_tier_flag ? "High" : "Main") << '\n'
+             << "level: "            << unsigned(general_level_idc)           << '\n'
+             << "chroma format: "    << unsigned(chroma_format_idc)           << '\n'
+             << "bit depth luma: "   << unsigned(bit_depth_luma)              << '\n'
+             << "bit depth chroma: " << unsigned(bit_depth_chroma)            << '\n'
+             << "NAL length size: "  << unsigned(nal_length_size)             << '\n'
+             << "VPS: " << vps.size() << ", SPS: " << sps.size() << ", PPS: " << pps.size() << '\n';
+}
+void Hvcc::setParent(Box *a_parent) {
+    Box::setParent(a_parent, {{'h', 'v', 'c', '1'}, {'h', 'e', 'v', '1'}});
+}
+
+void Hvc1::parse(std::istream& a_file) {
+    VisualSampleEntry::parse(a_file);
+
+    parseBox(a_file, *this);
+}
+void Hvc1::dump(DumpWriter& a_writer) const {
+    VisualSampleEntry::dump(a_writer);
+}
+void Hvc1::setParent(Box *a_parent) {
+    Box::setParent(a_parent, {'s', 't', 's', 'd'});
+}
+
+void Stts::parse(std::istream& a_file) {
     FullBox::parse(a_file);
 
     // entry count
     readBigEndian<uint32_t>(a_file, entry_count);
     
-    uint32_t buffer;
-    for (uint32_t i=0; i<entry_count; i++) {
-        // sample count
-        readBigEndian<uint32_t>(a_file, buffer);
-        sample_count.push_back(buffer);
-        // sample delta
-        readBigEndian<uint32_t>(a_file, buffer);
-        sample_delta.push_back(buffer);
+    // sample count, sample delta
+    BoxVisitor *visitor = currentVisitor();
+    bool keep = keepTables();
+    VisitAction action = readTableBatches<2>(a_file, entry_count, [&](const auto& a_columns, size_t a_n) {
+        if (keep) {
+            sample_count.insert(sample_count.end(), a_columns[0].begin(), a_columns[0].begin() + a_n);
+            sample_delta.insert(sample_delta.end(), a_columns[1].begin(), a_columns[1].begin() + a_n);
+        }
+        return visitor == nullptr ? VisitAction::Continue
+                                  : visitor->onSttsEntries(*this, a_columns[0].data(), a_columns[1].data(), a_n);
+    });
+    applyTableAction(a_file, *this, action);
+}
+void Stts::dump(DumpWriter& a_writer) const {
+    FullBox::dump(a_writer);
+    if (a_writer.columnar()) {
+        a_writer << "entry count: " << entry_count << '\n'
+                 << "       index      count       delta\n";
+        for (size_t i=0; i<sample_count.size() && i<sample_delta.size(); i++) {
+            a_writer.column(i+1, COLUMN_WIDTH);
+            a_writer.column(sample_count[i], COLUMN_WIDTH);
+            a_writer.column(sample_delta[i], COLUMN_WIDTH);
+            a_writer << '\n';
+        }
+        return;
     }
-}
-void Stts::print(std::ostream& a_outstream) {
-    FullBox::print(a_outstream);
-    a_outstream << "entry count: " << entry_count << std::endl
-                << "sample count: ";
-    for (uint32_t i=0; i<entry_count; i++) {
-        a_outstream << sample_count[i] << ' ';
+    a_writer << "entry count: " << entry_count << '\n'
+             << "sample count: ";
+    for (size_t i=0; i<sample_count.size(); i++) {
+        a_writer << sample_count[i] << ' ';
     }
-    a_outstream << "\nsample delta: ";
-    for (uint32_t i=0; i<entry_count; i++) {
-        a_outstream << sample_delta[i] << ' ';
+    a_writer << "\nsample delta: ";
+    for (size_t i=0; i<sample_delta.size(); i++) {
+        a_writer << sample_delta[i] << ' ';
     }
-    a_outstream << '\n';
+    a_writer << '\n';
 }
 void Stts::setParent(Box *a_parent) {
     Box::setParent(a_parent, {'s', 't', 'b', 'l'});
 }
 
-void Stss::parse(std::ifstream& a_file) {
+void Ctts::parse(std::istream& a_file) {
     FullBox::parse(a_file);
 
     // entry count
     readBigEndian<uint32_t>(a_file, entry_count);
     
-    uint32_t buffer;
-    for (uint32_t i=0; i<entry_count; i++) {
-        // sample_number
-        readBigEndian<uint32_t>(a_file, buffer);
-        sample_number.push_back(buffer);
+    // sample count, sample offset
+    BoxVisitor *visitor = currentVisitor();
+    bool keep = keepTables();
+    VisitAction action = readTableBatches<2>(a_file, entry_count, [&](const auto& a_columns, size_t a_n) {
+        if (keep) {
+            sample_count.insert(sample_count.end(), a_columns[0].begin(), a_columns[0].begin() + a_n);
+            sample_offset.insert(sample_offset.end(), a_columns[1].begin(), a_columns[1].begin() + a_n);
+        }
+        return visitor == nullptr ? VisitAction::Continue
+                                  : visitor->onCttsEntries(*this, a_columns[0].data(), a_columns[1].data(), a_n);
+    });
+    applyTableAction(a_file, *this, action);
+}
+void Ctts::dump(DumpWriter& a_writer) const {
+    FullBox::dump(a_writer);
+    // en version 1, les décalages sont signés
+    auto offset = [this](size_t a_i) {
+        return version == 1 ? int64_t(int32_t(sample_offset[a_i])) : int64_t(sample_offset[a_i]);
+    };
+    if (a_writer.columnar()) {
+        a_writer << "entry count: " << entry_count << '\n'
+                 << "       index      count      offset\n";
+        for (size_t i=0; i<sample_count.size() && i<sample_offset.size(); i++) {
+            a_writer.column(i+1, COLUMN_WIDTH);
+            a_writer.column(sample_count[i], COLUMN_WIDTH);
+            a_writer.column(offset(i), COLUMN_WIDTH);
+            a_writer << '\n';
+        }
+        return;
+    }
+    a_writer << "entry count: " << entry_count << '\n'
+             << "sample count: ";
+    for (size_t i=0; i<sample_count.size(); i++) {
+        a_writer << sample_count[i] << ' ';
+    }
+    a_writer << "\nsample offset: ";
+    for (size_t i=0; i<sample_offset.size(); i++) {
+        a_writer << offset(i) << ' ';
     }
+    a_writer << '\n';
 }
-void Stss::print(std::ostream& a_outstream) {
-    FullBox::print(a_outstream);
-    a_outstream << "entry count: " << entry_count << std::endl
-                << "sample number: ";
-    for (uint32_t i=0; i<entry_count; i++) {
-        a_outstream << sample_number[i] << ' ';
+void Ctts::setParent(Box *a_parent) {
+    Box::setParent(a_parent, {'s', 't', 'b', 'l'});
+}
+
+void Stss::parse(std::istream& a_file) {
+    FullBox::parse(a_file);
+
+    // entry count
+    readBigEndian<uint32_t>(a_file, entry_count);
+    
+    // sample_number
+    BoxVisitor *visitor = currentVisitor();
+    bool keep = keepTables();
+    VisitAction action = readTableBatches<1>(a_file, entry_count, [&](const auto& a_columns, size_t a_n) {
+        if (keep) {
+            sample_number.insert(sample_number.end(), a_columns[0].begin(), a_columns[0].begin() + a_n);
+        }
+        return visitor == nullptr ? VisitAction::Continue
+                                  : visitor->onStssEntries(*this, a_columns[0].data(), a_n);
+    });
+    applyTableAction(a_file, *this, action);
+}
+void Stss::dump(DumpWriter& a_writer) const {
+    FullBox::dump(a_writer);
+    if (a_writer.columnar()) {
+        a_writer << "entry count: " << entry_count << '\n'
+                 << "       index      sample\n";
+        for (size_t i=0; i<sample_number.size(); i++) {
+            a_writer.column(i+1, COLUMN_WIDTH);
+            a_writer.column(sample_number[i], COLUMN_WIDTH);
+            a_writer << '\n';
+        }
+        return;
+    }
+    a_writer << "entry count: " << entry_count << '\n'
+             << "sample number: ";
+    for (size_t i=0; i<sample_number.size(); i++) {
+        a_writer << sample_number[i] << ' ';
     }
-    a_outstream << '\n';
+    a_writer << '\n';
 }
 void Stss::setParent(Box *a_parent) {
     Box::setParent(a_parent, {'s', 't', 'b', 'l'});
 }
 
-void Stsc::parse(std::ifstream& a_file) {
+void Stsc::parse(std::istream& a_file) {
     FullBox::parse(a_file);
 
     // entry count
     readBigEndian<uint32_t>(a_file, entry_count);
     
-    uint32_t buffer;
-    for (uint32_t i=0; i<entry_count; i++) {
-        // first_chunk
-        readBigEndian<uint32_t>(a_file, buffer);
-        first_chunk.push_back(buffer);
-        // samples_per_chunk
-        readBigEndian<uint32_t>(a_file, buffer);
-        samples_per_chunk.push_back(buffer);
-        // samples_description_entry
-        readBigEndian<uint32_t>(a_file, buffer);
-        samples_description_index.push_back(buffer);
+    // first_chunk, samples_per_chunk, samples_description_entry
+    BoxVisitor *visitor = currentVisitor();
+    bool keep = keepTables();
+    VisitAction action = readTableBatches<3>(a_file, entry_count, [&](const auto& a_columns, size_t a_n) {
+        if (keep) {
+            first_chunk.insert(first_chunk.end(), a_columns[0].begin(), a_columns[0].begin() + a_n);
+            samples_per_chunk.insert(samples_per_chunk.end(), a_columns[1].begin(), a_columns[1].begin() + a_n);
+            samples_description_index.insert(samples_description_index.end(),
+                                             a_columns[2].begin(), a_columns[2].begin() + a_n);
+        }
+        return visitor == nullptr ? VisitAction::Continue
+                                  : visitor->onStscEntries(*this, a_columns[0].data(), a_columns[1].data(),
+                                                           a_columns[2].data(), a_n);
+    });
+    applyTableAction(a_file, *this, action);
+}
+void Stsc::dump(DumpWriter& a_writer) const {
+    FullBox::dump(a_writer);
+    if (a_writer.columnar()) {
+        a_writer << "entry count: " << entry_count << '\n'
+                 << "       index first chunk     samples description\n";
+        for (size_t i=0; i<first_chunk.size() && i<samples_per_chunk.size()
+                         && i<samples_description_index.size(); i++) {
+            a_writer.column(i+1, COLUMN_WIDTH);
+            a_writer.column(first_chunk[i], COLUMN_WIDTH);
+            a_writer.column(samples_per_chunk[i], COLUMN_WIDTH);
+            a_writer.column(samples_description_index[i], COLUMN_WIDTH);
+            a_writer << '\n';
+        }
+        return;
     }
-}
-void Stsc::print(std::ostream& a_outstream) {
-    FullBox::print(a_outstream);
-    a_outstream << "entry count: " << entry_count << std::endl
-                << "first chunk: ";
-    for (uint32_t i=0; i<entry_count; i++) {
-        a_outstream << first_chunk[i] << ' ';
+    a_writer << "entry count: " << entry_count << '\n'
+             << "first chunk: ";
+    for (size_t i=0; i<first_chunk.size(); i++) {
+        a_writer << first_chunk[i] << ' ';
     }
-    a_outstream << "\nsamples per chunk: ";
-    for (uint32_t i=0; i<entry_count; i++) {
-        a_outstream << samples_per_chunk[i] << ' ';
+    a_writer << "\nsamples per chunk: ";
+    for (size_t i=0; i<samples_per_chunk.size(); i++) {
+        a_writer << samples_per_chunk[i] << ' ';
     }
-    a_outstream << "\nsamples description index: ";
-    for (uint32_t i=0; i<entry_count; i++) {
-        a_outstream << samples_description_index[i] << ' ';
+    a_writer << "\nsamples description index: ";
+    for (size_t i=0; i<samples_description_index.size(); i++) {
+        a_writer << samples_description_index[i] << ' ';
     }
-    a_outstream << '\n';
+    a_writer << '\n';
 }
 void Stsc::setParent(Box *a_parent) {
     Box::setParent(a_parent, {'s', 't', 'b', 'l'});
 }
 
-void Stsz::parse(std::ifstream& a_file) {
+void Stsz::parse(std::istream& a_file) {
     FullBox::parse(a_file);
 
     // sample_size
@@ -1019,104 +1545,367 @@ void Stsz::parse(std::ifstream& a_file) {
     readBigEndian<uint32_t>(a_file, sample_count);
 
     if (sample_size == 0) {
-        uint32_t buffer;
-        for (uint32_t i=0; i<sample_count; i++) {
-            // entry_size
-            readBigEndian<uint32_t>(a_file, buffer);
-            entry_size.push_back(buffer);
-        }
+        // entry_size
+        BoxVisitor *visitor = currentVisitor();
+        bool keep = keepTables();
+        VisitAction action = readTableBatches<1>(a_file, sample_count, [&](const auto& a_columns, size_t a_n) {
+            if (keep) {
+                entry_size.insert(entry_size.end(), a_columns[0].begin(), a_columns[0].begin() + a_n);
+            }
+            return visitor == nullptr ? VisitAction::Continue
+                                      : visitor->onStszEntries(*this, a_columns[0].data(), a_n);
+        });
+        applyTableAction(a_file, *this, action);
     }
 }
-void Stsz::print(std::ostream& a_outstream) {
-    FullBox::print(a_outstream);
-    a_outstream << "sample size: "  << sample_size  << '\n'
-                << "sample count: " << sample_count << '\n';
+void Stsz::dump(DumpWriter& a_writer) const {
+    FullBox::dump(a_writer);
+    a_writer << "sample size: "  << sample_size  << '\n'
+             << "sample count: " << sample_count << '\n';
+    if (sample_size == 0 && a_writer.columnar()) {
+        a_writer << "       index        size\n";
+        for (size_t i=0; i<entry_size.size(); i++) {
+            a_writer.column(i+1, COLUMN_WIDTH);
+            a_writer.column(entry_size[i], COLUMN_WIDTH);
+            a_writer << '\n';
+        }
+        return;
+    }
     if (sample_size == 0) {
-        a_outstream << "entry_size: ";
-        for (uint32_t i=0; i<sample_count; i++) {
-            a_outstream << entry_size[i] << ' ';
+        a_writer << "entry_size: ";
+        for (size_t i=0; i<entry_size.size(); i++) {
+            a_writer << entry_size[i] << ' ';
         }
-    a_outstream << "\n";
+    a_writer << "\n";
     }
 }
 void Stsz::setParent(Box *a_parent) {
     Box::setParent(a_parent, {'s', 't', 'b', 'l'});
 }
 
-void Stco::parse(std::ifstream& a_file) {
+void Stco::parse(std::istream& a_file) {
     FullBox::parse(a_file);
 
     // entry count
     readBigEndian<uint32_t>(a_file, entry_count);
     
-    uint32_t buffer;
-    for (uint32_t i=0; i<entry_count; i++) {
-        // chunk_offset
-        readBigEndian<uint32_t>(a_file, buffer);
-        chunk_offset.push_back(buffer);
+    // chunk_offset
+    BoxVisitor *visitor = currentVisitor();
+    bool keep = keepTables();
+    VisitAction action = readTableBatches<1>(a_file, entry_count, [&](const auto& a_columns, size_t a_n) {
+        if (keep) {
+            chunk_offset.insert(chunk_offset.end(), a_columns[0].begin(), a_columns[0].begin() + a_n);
+        }
+        return visitor == nullptr ? VisitAction::Continue
+                                  : visitor->onStcoEntries(*this, a_columns[0].data(), a_n);
+    });
+    applyTableAction(a_file, *this, action);
+}
+void Stco::dump(DumpWriter& a_writer) const {
+    FullBox::dump(a_writer);
+    if (a_writer.columnar()) {
+        a_writer << "entry count: " << entry_count << '\n'
+                 << "       index      offset\n";
+        for (size_t i=0; i<chunk_offset.size(); i++) {
+            a_writer.column(i+1, COLUMN_WIDTH);
+            a_writer.column(chunk_offset[i], COLUMN_WIDTH);
+            a_writer << '\n';
+        }
+        return;
     }
-}
-void Stco::print(std::ostream& a_outstream) {
-    FullBox::print(a_outstream);
-    a_outstream << "entry count: " << entry_count << std::endl
-                << "chunk offset: ";
-    for (uint32_t i=0; i<entry_count; i++) {
-        a_outstream << chunk_offset[i] << ' ';
+    a_writer << "entry count: " << entry_count << '\n'
+             << "chunk offset: ";
+    for (size_t i=0; i<chunk_offset.size(); i++) {
+        a_writer << chunk_offset[i] << ' ';
     }
-    a_outstream << '\n';
+    a_writer << '\n';
 }
 void Stco::setParent(Box *a_parent) {
     Box::setParent(a_parent, {'s', 't', 'b', 'l'});
 }
 
-void Smhd::parse(std::ifstream& a_file) {
+void Smhd::parse(std::istream& a_file) {
     FullBox::parse(a_file);
 
     // balance
     readBigEndian<int16_t>(a_file, balance);
     
     // reserved (2 octets)
-    a_file.seekg( (uint64_t) a_file.tellg() + 2);
+    skipBytes(a_file, 2);
 }
-void Smhd::print(std::ostream& a_outstream) {
-    FullBox::print(a_outstream);
-    a_outstream << "balance: " << balance << '\n';
+void Smhd::dump(DumpWriter& a_writer) const {
+    FullBox::dump(a_writer);
+    a_writer << "balance: " << balance << '\n';
 }
 void Smhd::setParent(Box *a_parent) {
     Box::setParent(a_parent, {'m', 'i', 'n', 'f'});
 }
 
-void Enca::parse(std::ifstream& a_file) {
+void Enca::parse(std::istream& a_file) {
     beg_data = a_file.tellg();
     if (size == 0) {           // on lit jusqu'à la fin du fichier
-        a_file.seekg(0, a_file.end);
+        skipToEnd(a_file);
     } else {
-        a_file.seekg((uint64_t) a_file.tellg() + size - m_parse_offset);
+        skipBytes(a_file, size - m_parse_offset);
     }
 }
 void Enca::setParent(Box *a_parent) {
     Box::setParent(a_parent, {'s', 't', 's', 'd'});
 }
 
-void Udta::parse(std::ifstream& a_file) {
+void AudioSampleEntry::parse(std::istream& a_file) {
+    SampleEntry::parse(a_file);
+
+    // reserved (4 octets)[2] : version, revision et vendor en QuickTime
+    readBigEndian<uint16_t>(a_file, version);
+    a_file.read(reserved.data(), 6);
+    // channelcount
+    readBigEndian<uint16_t>(a_file, channelcount);
+    // samplesize
+    readBigEndian<uint16_t>(a_file, samplesize);
+    // pre_defined (2 octets), reserved (2 octets)
+    readBigEndian<uint32_t>(a_file, pre_defined);
+    // samplerate
+    readBigEndian<uint32_t>(a_file, samplerate);
+    m_parse_offset += 20;
+
+    // QuickTime : champs ajoutés par les versions 1 et 2 de la description
+    size_t extension = version == 1 ? 16 : version == 2 ? 36 : 0;
+    if (extension > 0) {
+        qt_extension.resize(extension);
+        a_file.read(qt_extension.data(), extension);
+        if ((size_t) a_file.gcount() != extension) {
+            throw std::runtime_error("End of file reached reading a sound description.");
+        }
+        m_parse_offset += extension;
+    }
+}
+void AudioSampleEntry::dump(DumpWriter& a_writer) const {
+    SampleEntry::dump(a_writer);
+
+    a_writer << "channelcount: " << channelcount       << '\n'
+             << "samplesize: "   << samplesize         << '\n'
+             << "samplerate: "   << (samplerate >> 16) << '\n';
+}
+
+void Mp4a::parse(std::istream& a_file) {
+    AudioSampleEntry::parse(a_file);
+
+    parseBox(a_file, *this);
+}
+void Mp4a::dump(DumpWriter& a_writer) const {
+    AudioSampleEntry::dump(a_writer);
+}
+void Mp4a::setParent(Box *a_parent) {
+    Box::setParent(a_parent, {'s', 't', 's', 'd'});
+}
+
+// Lecture des descripteurs MPEG-4 (ISO/IEC 14496-1) dans le tampon d'une
+// boîte esds. Chaque descripteur commence par son tag et sa taille.
+struct DescriptorCursor {
+    const uint8_t *data;
+    size_t position;
+
+    // Entier gros-boutiste de 1 à 4 octets, borné par `end`.
+    uint32_t read(unsigned a_bytes, size_t a_end) {
+        if (position + a_bytes > a_end) {
+            throw std::runtime_error("Truncated esds descriptor.");
+        }
+        uint32_t x = 0;
+        for (unsigned i = 0; i < a_bytes; i++) {
+            x = x << 8 | data[position++];
+        }
+        return x;
+    }
+
+    // Entête d'un descripteur : tag, puis taille sur 1 à 4 octets de 7 bits.
+    //     @tag: reçoit le tag lu
+    //     @end: fin du descripteur englobant
+    //     @return: la fin du descripteur lu
+    size_t header(uint8_t& a_tag, size_t a_end) {
+        a_tag = uint8_t(read(1, a_end));
+        size_t length = 0;
+        for (int i = 0; i < 4; i++) {
+            uint8_t byte = uint8_t(read(1, a_end));
+            length = length << 7 | (byte & 0x7F);
+            if ((byte & 0x80) == 0) {
+                break;
+            }
+        }
+        if (position + length > a_end) {
+            throw std::runtime_error("Truncated esds descriptor.");
+        }
+        return position + length;
+    }
+};
+
+// Tags des descripteurs lus.
+static const uint8_t ES_DESCR_TAG             = 0x03;
+static const uint8_t DECODER_CONFIG_DESCR_TAG = 0x04;
+static const uint8_t DEC_SPECIFIC_INFO_TAG    = 0x05;
+
+// DecoderConfigDescriptor, et son DecSpecificInfo.
+static void decodeDecoderConfig(Esds& a_box, DescriptorCursor& a_cursor, size_t a_end) {
+    a_box.object_type_indication = uint8_t(a_cursor.read(1, a_end));
+    a_box.stream_type            = uint8_t(a_cursor.read(1, a_end) >> 2); // streamType, upStream, reserved
+    a_box.buffer_size_DB         = a_cursor.read(3, a_end);
+    a_box.max_bitrate            = a_cursor.read(4, a_end);
+    a_box.avg_bitrate            = a_cursor.read(4, a_end);
+    while (a_cursor.position < a_end) {
+        uint8_t tag;
+        size_t end = a_cursor.header(tag, a_end);
+        if (tag == DEC_SPECIFIC_INFO_TAG) {
+            a_box.decoder_specific_info = std::string_view(reinterpret_cast<const char*>(a_cursor.data) + a_cursor.position,
+                                                           end - a_cursor.position);
+        }
+        a_cursor.position = end;
+    }
+}
+
+// ES_Descriptor, et son DecoderConfigDescriptor.
+static void decodeEsDescriptor(Esds& a_box, DescriptorCursor& a_cursor, size_t a_end) {
+    a_box.ES_ID = uint16_t(a_cursor.read(2, a_end));
+    uint8_t flags = uint8_t(a_cursor.read(1, a_end));
+    a_box.stream_priority = flags & 0x1F;
+    if (flags & 0x80) { // streamDependenceFlag : dependsOn_ES_ID
+        a_cursor.read(2, a_end);
+    }
+    if (flags & 0x40) { // URL_Flag : URLlength, URLstring
+        a_cursor.position += a_cursor.read(1, a_end);
+    }
+    if (flags & 0x20) { // OCRstreamFlag : OCR_ES_Id
+        a_cursor.read(2, a_end);
+    }
+    while (a_cursor.position < a_end) {
+        uint8_t tag;
+        size_t end = a_cursor.header(tag, a_end);
+        if (tag == DECODER_CONFIG_DESCR_TAG) {
+            decodeDecoderConfig(a_box, a_cursor, end);
+        }
+        a_cursor.position = end;
+    }
+}
+
+void Esds::parse(std::istream& a_file) {
+    FullBox::parse(a_file);
+
+    if (size == 0 || size < m_parse_offset) {
+        throw std::runtime_error("Invalid esds box size.");
+    }
+    descriptors.resize(size - m_parse_offset);
+    a_file.read(descriptors.data(), descriptors.size());
+    if ((size_t) a_file.gcount() != descriptors.size()) {
+        throw std::runtime_error("End of file reached reading esds descriptors.");
+    }
+
+    DescriptorCursor cursor{reinterpret_cast<const uint8_t*>(descriptors.data()), 0};
+    while (cursor.position < descriptors.size()) {
+        uint8_t tag;
+        size_t end = cursor.header(tag, descriptors.size());
+        if (tag == ES_DESCR_TAG) {
+            decodeEsDescriptor(*this, cursor, end);
+        }
+        cursor.position = end;
+    }
+    // audio MPEG-4, ou AAC MPEG-2 (Main, LC, SSR) décrit de la même façon
+    bool aac = object_type_indication == 0x40 || (object_type_indication >= 0x66 && object_type_indication <= 0x68);
+    if (aac && !decoder_specific_info.empty()) {
+        audio_config = decodeAudioSpecificConfig(decoder_specific_info.data(), decoder_specific_info.size());
+    }
+}
+void Esds::dump(DumpWriter& a_writer) const {
+    FullBox::dump(a_writer);
+    a_writer << "ES_ID: "                  << ES_ID                          << '\n'
+             << "objectTypeIndication: "   << unsigned(object_type_indication) << '\n'
+             << "streamType: "             << unsigned(stream_type)          << '\n'
+             << "bufferSizeDB: "           << buffer_size_DB                 << '\n'
+             << "maxBitrate: "             << max_bitrate                    << '\n'
+             << "avgBitrate: "             << avg_bitrate                    << '\n';
+    if (!decoder_specific_info.empty()) {
+        a_writer << "audioObjectType: "      << unsigned(audio_config.audio_object_type)     << '\n'
+                 << "samplingFrequency: "    << audio_config.sampling_frequency              << '\n'
+                 << "channelConfiguration: " << unsigned(audio_config.channel_configuration) << '\n';
+    }
+}
+void Esds::setParent(Box *a_parent) {
+    Box::setParent(a_parent, {'m', 'p', '4', 'a'});
+}
+
+// Lecture bit à bit d'un AudioSpecificConfig, bit de poids fort en premier.
+struct ConfigBitCursor {
+    const uint8_t *data;
+    size_t size;
+    size_t bit = 0;
+
+    uint32_t read(unsigned a_count) {
+        if (bit + a_count > size * 8) {
+            throw std::runtime_error("Truncated AudioSpecificConfig.");
+        }
+        uint32_t x = 0;
+        for (unsigned i = 0; i < a_count; i++, bit++) {
+            x = x << 1 | ((data[bit / 8] >> (7 - bit % 8)) & 1);
+        }
+        return x;
+    }
+};
+
+// Fréquences désignées par samplingFrequencyIndex (0 à 12).
+static const uint32_t AAC_SAMPLING_FREQUENCIES[13] = {
+    96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350
+};
+
+AudioSpecificConfig decodeAudioSpecificConfig(const char *a_data, size_t a_size) {
+    ConfigBitCursor bits{reinterpret_cast<const uint8_t*>(a_data), a_size};
+    auto objectType = [&]() {
+        uint8_t type = uint8_t(bits.read(5));
+        return type == 31 ? uint8_t(32 + bits.read(6)) : type;
+    };
+    auto frequency = [&](uint8_t& a_index) {
+        a_index = uint8_t(bits.read(4));
+        return a_index == 15 ? bits.read(24) : a_index < 13 ? AAC_SAMPLING_FREQUENCIES[a_index] : 0;
+    };
+
+    AudioSpecificConfig config;
+    config.audio_object_type     = objectType();
+    config.sampling_frequency    = frequency(config.sampling_frequency_index);
+    config.channel_configuration = uint8_t(bits.read(4));
+    if (config.audio_object_type == 5 || config.audio_object_type == 29) {
+        // signalisation explicite de SBR ou PS : fréquence de l'extension, puis le cœur
+        config.extension_object_type = config.audio_object_type;
+        uint8_t extension_index;
+        frequency(extension_index);
+        config.audio_object_type = objectType();
+    }
+    return config;
+}
+
+void Udta::parse(std::istream& a_file) {
     parseBox(a_file, *this);
 }
 void Udta::setParent(Box* a_parent) {
     Box::setParent(a_parent, {{'m', 'o', 'o', 'v'}, {'t', 'r', 'a', 'k'}});
 }
 
-void Ilst::parse(std::ifstream& a_file) {
+void Ilst::parse(std::istream& a_file) {
     beg_data = a_file.tellg();
     if (size == 0) {           // on lit jusqu'à la fin du fichier
-        a_file.seekg(0, a_file.end);
+        skipToEnd(a_file);
     } else {
-        a_file.seekg((uint64_t) a_file.tellg() + size - m_parse_offset);
+        skipBytes(a_file, size - m_parse_offset);
     }
 }
 void Ilst::setParent(Box *a_parent) {
     Box::setParent(a_parent, {'m', 'e', 't', 'a'});
 }
 
+void dumpTree(DumpWriter& a_writer, Box& a_box) {
+    visitBox(a_box, [&](auto& a_typed) { a_typed.dump(a_writer); });
+    a_writer << '\n';
+    for (const std::unique_ptr<Box>& child : a_box.getChildren()) {
+        dumpTree(a_writer, *child);
+    }
+}
+
 void displayFileTree(Box* pRoot, const std::string fileName) {
     std::vector<TreeBoxDisplay> queue;
     queue.emplace_back(TreeBoxDisplay{pRoot, 0});
@@ -1146,32 +1935,3 @@ void displayFileTree(Box* pRoot, const std::string fileName) {
     }
     std::cout << std::endl;
 }
-
-int main() {
-    char filepath[] = "test/big_buck_bunny_240p_1mb.mp4";
-    // Open the binary file for reading
-    std::ifstream file(filepath, std::ios::binary);
-    if (!file) {
-        std::cerr << "Error opening file for reading.";
-        return 1;
-    }
-
-    Root root;
-    root.size = 0;
-    root.parse(file);
-
-    displayFileTree(&root, filepath);
-
-    // Ftyp ftyp_box;
-    // uint64_t a;
-    // BoxType b;
-    // parseHeader(file, a, b);
-    // ftyp_box.setSize(a);
-    // std::cout << boxTypeToString(b) << std::endl;
-    // ftyp_box.parse(file);
-    
-    // displayFileTree(&ftyp_box, filepath);
-    // ftyp_box.print(std::cout);
-    return 0;
-}
-        
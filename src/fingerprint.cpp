@@ -0,0 +1,201 @@
+// Empreintes du contenu des pistes (cf fingerprint.hpp).
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <container-parser.hpp>
+#include <fingerprint.hpp>
+#include <hash.hpp>
+#include <parallel.hpp>
+#include <sample-table.hpp>
+
+
+// Échantillons consécutifs d'une piste, contigus dans le fichier.
+struct SampleRun {
+    uint64_t offset;
+    uint64_t bytes;
+    uint32_t track;        // indice de la piste dans le résultat
+    uint32_t first_sample;
+    uint32_t sample_count;
+};
+
+// Une lecture : la plage [offset, offset+size) couvre les suites
+// [first_run, first_run+run_count) de la liste triée.
+struct ReadJob {
+    uint64_t offset;
+    uint64_t size;
+    size_t   first_run;
+    size_t   run_count;
+};
+
+// Hashs des échantillons d'une piste, rangés à leur indice.
+struct TrackHashes {
+    const Stsz *stsz;
+    std::vector<uint64_t>       samples;
+    std::vector<Sha256::Digest> sha256;
+};
+
+// Découpe les échantillons d'une piste en suites contiguës d'au plus `max_read` octets.
+static void collectRuns(const Trak& a_trak, uint32_t a_track, size_t a_max_read, std::vector<SampleRun>& a_runs) {
+    size_t first = a_runs.size();
+    for (SampleCursor cursor(a_trak); !cursor.done(); cursor.next()) {
+        const SampleInfo& sample = cursor.sample();
+        if (a_runs.size() > first) {
+            SampleRun& run = a_runs.back();
+            if (run.offset + run.bytes == sample.offset && run.bytes + sample.size <= a_max_read) {
+                run.bytes += sample.size;
+                run.sample_count++;
+                continue;
+            }
+        }
+        a_runs.push_back(SampleRun{sample.offset, sample.size, a_track, cursor.index(), 1});
+    }
+}
+
+// Regroupe les suites triées par position en lectures : une suite rejoint la
+// lecture précédente si elle la suit à moins de `max_gap` octets et si la
+// lecture reste sous `max_read` octets.
+static std::vector<ReadJob> planReads(const std::vector<SampleRun>& a_runs, const FingerprintOptions& a_options) {
+    std::vector<ReadJob> jobs;
+    for (size_t i = 0; i < a_runs.size(); i++) {
+        const SampleRun& run = a_runs[i];
+        if (!jobs.empty()) {
+            ReadJob& job = jobs.back();
+            uint64_t end = job.offset + job.size;
+            if (run.offset >= end && run.offset - end <= a_options.max_gap
+                && run.offset + run.bytes - job.offset <= a_options.max_read) {
+                job.size = run.offset + run.bytes - job.offset;
+                job.run_count++;
+                continue;
+            }
+        }
+        jobs.push_back(ReadJob{run.offset, run.bytes, i, 1});
+    }
+    return jobs;
+}
+
+Fingerprints fingerprintTracks(const Root& a_root, RangeReader& a_reader, const FingerprintOptions& a_options) {
+    auto beg = std::chrono::steady_clock::now();
+    Fingerprints result;
+    std::vector<TrackHashes> hashes;
+    std::vector<SampleRun> runs;
+
+    std::vector<Trak*> traks = findTracks(a_root);
+    for (uint32_t t = 0; t < traks.size(); t++) {
+        TrackBoxes boxes = findTrackBoxes(*traks[t]);
+        TrackFingerprint track;
+        track.track_ID     = boxes.tkhd != nullptr ? boxes.tkhd->track_ID : 0;
+        track.handler_type = boxes.hdlr != nullptr ? boxes.hdlr->handler_type : 0;
+        track.has_sha256   = a_options.sha256;
+        size_t first = runs.size();
+        collectRuns(*traks[t], t, std::max<size_t>(a_options.max_read, 1), runs);
+        for (size_t i = first; i < runs.size(); i++) {
+            track.sample_count += runs[i].sample_count;
+            track.bytes        += runs[i].bytes;
+        }
+        result.tracks.push_back(track);
+        hashes.push_back(TrackHashes{boxes.stsz, std::vector<uint64_t>(track.sample_count),
+                                     std::vector<Sha256::Digest>(a_options.sha256 ? track.sample_count : 0)});
+    }
+    std::sort(runs.begin(), runs.end(), [](const SampleRun& a, const SampleRun& b) { return a.offset < b.offset; });
+    std::vector<ReadJob> jobs = planReads(runs, a_options);
+
+    // chaque thread prend la lecture suivante ; les hashs sont écrits à des
+    // indices distincts, sans verrou
+    // un thread de plus n'est démarré que s'il a au moins `min_thread_bytes` à lire
+    uint64_t total = 0;
+    for (const ReadJob& job : jobs) {
+        total += job.size;
+    }
+    unsigned threads = a_options.threads != 0 ? a_options.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = (unsigned) std::max<uint64_t>(1, std::min<uint64_t>(threads, total / std::max<uint64_t>(a_options.min_thread_bytes, 1)));
+
+    std::atomic<uint64_t> reads{0};
+    std::atomic<uint64_t> bytes_read{0};
+    threads = runParallel(jobs.size(), threads, [&]() -> ParallelJob {
+        return [&, buffer = std::vector<char>()](size_t a_job) mutable {
+            const ReadJob& job = jobs[a_job];
+            buffer.resize(job.size);
+            if (a_reader.read(job.offset, buffer.data(), job.size) != job.size) {
+                throw std::runtime_error("Short read while fingerprinting samples.");
+            }
+            reads++;
+            bytes_read += job.size;
+            for (size_t r = job.first_run; r < job.first_run + job.run_count; r++) {
+                const SampleRun& run = runs[r];
+                TrackHashes& track = hashes[run.track];
+                const char *data = buffer.data() + (run.offset - job.offset);
+                for (uint32_t s = run.first_sample; s < run.first_sample + run.sample_count; s++) {
+                    uint32_t size = track.stsz->sample_size != 0 ? track.stsz->sample_size
+                                                                 : track.stsz->entry_size[s];
+                    track.samples[s] = xxhash64(data, size);
+                    if (a_options.sha256) {
+                        track.sha256[s] = Sha256::hash(data, size);
+                    }
+                    data += size;
+                }
+            }
+        };
+    });
+
+    // combinaison dans l'ordre de décodage, indépendante de l'exécution
+    for (size_t t = 0; t < result.tracks.size(); t++) {
+        TrackFingerprint& track = result.tracks[t];
+        std::vector<uint8_t> bytes(8 * hashes[t].samples.size());
+        for (size_t s = 0; s < hashes[t].samples.size(); s++) {
+            for (int k = 0; k < 8; k++) {
+                bytes[8*s + k] = uint8_t(hashes[t].samples[s] >> (8*k)); // petit-boutiste
+            }
+        }
+        track.digest = xxhash64(bytes.data(), bytes.size());
+        if (a_options.sha256) {
+            Sha256 sha;
+            for (const Sha256::Digest& digest : hashes[t].sha256) {
+                sha.update(digest.data(), digest.size());
+            }
+            track.sha256 = sha.digest();
+        }
+    }
+
+    result.stats.threads    = threads;
+    result.stats.reads      = reads;
+    result.stats.bytes_read = bytes_read;
+    result.stats.seconds    = std::chrono::duration<double>(std::chrono::steady_clock::now() - beg).count();
+    return result;
+}
+
+void printFingerprints(std::ostream& a_outstream, const Fingerprints& a_fingerprints) {
+    const FingerprintStats& stats = a_fingerprints.stats;
+    uint64_t bytes = 0;
+    for (const TrackFingerprint& track : a_fingerprints.tracks) {
+        bytes += track.bytes;
+    }
+    a_outstream << "fingerprint: " << a_fingerprints.tracks.size() << " tracks, " << bytes << " bytes in "
+                << stats.seconds << " s (" << (stats.seconds > 0 ? bytes / stats.seconds / 1e6 : 0) << " MB/s), "
+                << stats.threads << " threads, " << stats.reads << " reads of " << stats.bytes_read << " bytes\n";
+    std::ios_base::fmtflags flags = a_outstream.flags();
+    char fill = a_outstream.fill();
+    for (const TrackFingerprint& track : a_fingerprints.tracks) {
+        char handler[4] = {char(track.handler_type >> 24), char(track.handler_type >> 16),
+                           char(track.handler_type >> 8),  char(track.handler_type)};
+        a_outstream << "track " << std::dec << track.track_ID << " (" << std::string(handler, 4) << "): "
+                    << track.sample_count << " samples, xxh64 "
+                    << std::hex << std::setfill('0') << std::setw(16) << track.digest;
+        if (track.has_sha256) {
+            a_outstream << ", sha256 ";
+            for (uint8_t byte : track.sha256) {
+                a_outstream << std::setw(2) << unsigned(byte);
+            }
+        }
+        a_outstream << std::setfill(fill) << '\n';
+    }
+    a_outstream.flags(flags);
+}
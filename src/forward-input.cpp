@@ -0,0 +1,180 @@
+// Entrée non repositionnable et conservation des octets sautés (cf forward-input.hpp).
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <forward-input.hpp>
+
+
+Spool::Spool(uint64_t a_cap, const std::string& a_directory) : m_cap(a_cap) {
+    if (a_directory.empty()) {
+        return;
+    }
+    std::string path = a_directory + "/mp4-spool-XXXXXX";
+    m_fd = ::mkstemp(path.data());
+    if (m_fd < 0) {
+        throw std::runtime_error("Cannot create spool file in `" + a_directory + "`.");
+    }
+    ::unlink(path.c_str()); // fichier anonyme, supprimé à la fermeture
+}
+
+Spool::~Spool() {
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+}
+
+void Spool::append(uint64_t a_offset, const char *a_data, size_t a_size) {
+    size_t kept = std::min<uint64_t>(a_size, m_cap - m_spooled);
+    m_dropped += a_size - kept;
+    if (kept == 0) {
+        return;
+    }
+    if (m_fd < 0) {
+        m_memory.insert(m_memory.end(), a_data, a_data + kept);
+    } else {
+        for (size_t done = 0; done < kept; ) {
+            ssize_t n = ::pwrite(m_fd, a_data + done, kept - done, m_spooled + done);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                throw std::runtime_error("Error writing spool file.");
+            }
+            done += n;
+        }
+    }
+    if (!m_ranges.empty() && m_ranges.back().offset + m_ranges.back().size == a_offset) {
+        m_ranges.back().size += kept;
+    } else {
+        m_ranges.push_back(Range{a_offset, kept, m_spooled});
+    }
+    m_spooled += kept;
+}
+
+bool Spool::contains(uint64_t a_offset, uint64_t a_size) const {
+    auto range = std::upper_bound(m_ranges.begin(), m_ranges.end(), a_offset,
+                                  [](uint64_t offset, const Range& r) { return offset < r.offset; });
+    if (range == m_ranges.begin()) {
+        return false;
+    }
+    --range;
+    return a_offset + a_size <= range->offset + range->size;
+}
+
+uint64_t Spool::size() {
+    return m_ranges.empty() ? 0 : m_ranges.back().offset + m_ranges.back().size;
+}
+
+size_t Spool::read(uint64_t a_offset, char *a_buffer, size_t a_size) {
+    if (!contains(a_offset, a_size)) {
+        throw std::runtime_error("Byte range not spooled.");
+    }
+    auto range = std::upper_bound(m_ranges.begin(), m_ranges.end(), a_offset,
+                                  [](uint64_t offset, const Range& r) { return offset < r.offset; }) - 1;
+    uint64_t position = range->position + (a_offset - range->offset);
+    if (m_fd < 0) {
+        std::memcpy(a_buffer, m_memory.data() + position, a_size);
+        return a_size;
+    }
+    for (size_t done = 0; done < a_size; ) {
+        ssize_t n = ::pread(m_fd, a_buffer + done, a_size - done, position + done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            throw std::runtime_error("Error reading spool file.");
+        }
+        done += n;
+    }
+    return a_size;
+}
+
+
+ForwardStreamBuf::ForwardStreamBuf(int a_fd, Spool *a_spool, size_t a_buffer_size)
+    : m_fd(a_fd), m_spool(a_spool), m_buffer(std::max<size_t>(a_buffer_size, 1)) {
+    setg(m_buffer.data(), m_buffer.data(), m_buffer.data());
+}
+
+bool ForwardStreamBuf::fill() {
+    m_buffer_offset = position();
+    ssize_t n;
+    do {
+        n = ::read(m_fd, m_buffer.data(), m_buffer.size());
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+        setg(m_buffer.data(), m_buffer.data(), m_buffer.data());
+        return false;
+    }
+    setg(m_buffer.data(), m_buffer.data(), m_buffer.data() + n);
+    return true;
+}
+
+ForwardStreamBuf::int_type ForwardStreamBuf::underflow() {
+    if (gptr() == egptr() && !fill()) {
+        return traits_type::eof();
+    }
+    return traits_type::to_int_type(*gptr());
+}
+
+uint64_t ForwardStreamBuf::skip(uint64_t a_count) {
+    uint64_t skipped = 0;
+    while (skipped < a_count) {
+        size_t take = std::min<uint64_t>(egptr() - gptr(), a_count - skipped);
+        // après un retour en arrière dans le tampon, les octets déjà confiés
+        // au spool ne le sont pas une seconde fois
+        uint64_t from = std::max(position(), m_spool_end);
+        if (m_spool != nullptr && from < position() + take) {
+            m_spool->append(from, gptr() + (from - position()), position() + take - from);
+            m_spool_end = position() + take;
+        }
+        gbump((int) take);
+        skipped += take;
+        if (skipped < a_count && !fill()) {
+            break;
+        }
+    }
+    m_discarded += skipped;
+    return skipped;
+}
+
+ForwardStreamBuf::pos_type ForwardStreamBuf::seekoff(off_type a_offset, std::ios_base::seekdir a_dir,
+                                                     std::ios_base::openmode a_which) {
+    int64_t base;
+    if (a_dir == std::ios_base::beg) {
+        base = 0;
+    } else if (a_dir == std::ios_base::cur) {
+        base = position();
+    } else {
+        // la fin n'est connue qu'une fois l'entrée lue entièrement
+        skip(UINT64_MAX);
+        base = position();
+    }
+    return seekpos(pos_type(off_type(base + a_offset)), a_which);
+}
+
+ForwardStreamBuf::pos_type ForwardStreamBuf::seekpos(pos_type a_position, std::ios_base::openmode /*which*/) {
+    int64_t target = off_type(a_position);
+    uint64_t current = position();
+    if (target < 0) {
+        return pos_type(off_type(-1));
+    }
+    if ((uint64_t) target >= current) {
+        uint64_t count = target - current;
+        return skip(count) == count ? a_position : pos_type(off_type(-1));
+    }
+    // retour en arrière : seulement dans le tampon courant
+    if ((uint64_t) target >= m_buffer_offset) {
+        setg(eback(), eback() + (target - m_buffer_offset), egptr());
+        return a_position;
+    }
+    return pos_type(off_type(-1));
+}
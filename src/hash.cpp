@@ -0,0 +1,185 @@
+// Fonctions de hachage (cf hash.hpp).
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <hash.hpp>
+
+constexpr uint64_t XXH_PRIME64_1 = 0x9E3779B185EBCA87;
+constexpr uint64_t XXH_PRIME64_2 = 0xC2B2AE3D27D4EB4F;
+constexpr uint64_t XXH_PRIME64_3 = 0x165667B19E3779F9;
+constexpr uint64_t XXH_PRIME64_4 = 0x85EBCA77C2B2AE63;
+constexpr uint64_t XXH_PRIME64_5 = 0x27D4EB2F165667C5;
+
+static uint64_t rotl64(uint64_t a_x, int a_bits) {
+    return (a_x << a_bits) | (a_x >> (64 - a_bits));
+}
+
+static uint32_t rotr32(uint32_t a_x, int a_bits) {
+    return (a_x >> a_bits) | (a_x << (32 - a_bits));
+}
+
+// Lectures petit-boutistes, quelle que soit la machine.
+static uint64_t readLittleEndian64(const uint8_t *a_bytes) {
+    uint64_t x = 0;
+    for (int i = 7; i >= 0; i--) {
+        x = (x << 8) | a_bytes[i];
+    }
+    return x;
+}
+static uint32_t readLittleEndian32(const uint8_t *a_bytes) {
+    return uint32_t(a_bytes[0]) | uint32_t(a_bytes[1]) << 8 | uint32_t(a_bytes[2]) << 16 | uint32_t(a_bytes[3]) << 24;
+}
+
+static uint64_t xxhRound(uint64_t a_acc, uint64_t a_input) {
+    a_acc += a_input * XXH_PRIME64_2;
+    return rotl64(a_acc, 31) * XXH_PRIME64_1;
+}
+
+static uint64_t xxhMergeRound(uint64_t a_acc, uint64_t a_value) {
+    a_acc ^= xxhRound(0, a_value);
+    return a_acc * XXH_PRIME64_1 + XXH_PRIME64_4;
+}
+
+uint64_t xxhash64(const void *a_data, size_t a_size, uint64_t a_seed) {
+    const uint8_t *p   = static_cast<const uint8_t*>(a_data);
+    const uint8_t *end = p + a_size;
+    uint64_t h;
+
+    if (a_size >= 32) {
+        // quatre accumulateurs indépendants, un bloc de 32 octets par tour
+        uint64_t v1 = a_seed + XXH_PRIME64_1 + XXH_PRIME64_2;
+        uint64_t v2 = a_seed + XXH_PRIME64_2;
+        uint64_t v3 = a_seed;
+        uint64_t v4 = a_seed - XXH_PRIME64_1;
+        for (; end - p >= 32; p += 32) {
+            v1 = xxhRound(v1, readLittleEndian64(p));
+            v2 = xxhRound(v2, readLittleEndian64(p + 8));
+            v3 = xxhRound(v3, readLittleEndian64(p + 16));
+            v4 = xxhRound(v4, readLittleEndian64(p + 24));
+        }
+        h = rotl64(v1, 1) + rotl64(v2, 7) + rotl64(v3, 12) + rotl64(v4, 18);
+        h = xxhMergeRound(h, v1);
+        h = xxhMergeRound(h, v2);
+        h = xxhMergeRound(h, v3);
+        h = xxhMergeRound(h, v4);
+    } else {
+        h = a_seed + XXH_PRIME64_5;
+    }
+    h += a_size;
+
+    for (; end - p >= 8; p += 8) {
+        h ^= xxhRound(0, readLittleEndian64(p));
+        h = rotl64(h, 27) * XXH_PRIME64_1 + XXH_PRIME64_4;
+    }
+    if (end - p >= 4) {
+        h ^= uint64_t(readLittleEndian32(p)) * XXH_PRIME64_1;
+        h = rotl64(h, 23) * XXH_PRIME64_2 + XXH_PRIME64_3;
+        p += 4;
+    }
+    for (; p < end; p++) {
+        h ^= *p * XXH_PRIME64_5;
+        h = rotl64(h, 11) * XXH_PRIME64_1;
+    }
+
+    // mélange final
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+
+constexpr std::array<uint32_t, 64> SHA256_K = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+Sha256::Sha256()
+    : m_state{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19} {}
+
+void Sha256::compress(const uint8_t *a_block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = uint32_t(a_block[4*i]) << 24 | uint32_t(a_block[4*i + 1]) << 16
+             | uint32_t(a_block[4*i + 2]) << 8 | uint32_t(a_block[4*i + 3]);
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = rotr32(w[i-15], 7) ^ rotr32(w[i-15], 18) ^ (w[i-15] >> 3);
+        uint32_t s1 = rotr32(w[i-2], 17) ^ rotr32(w[i-2], 19) ^ (w[i-2] >> 10);
+        w[i] = w[i-16] + s0 + w[i-7] + s1;
+    }
+    uint32_t a = m_state[0], b = m_state[1], c = m_state[2], d = m_state[3];
+    uint32_t e = m_state[4], f = m_state[5], g = m_state[6], h = m_state[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 = rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + ch + SHA256_K[i] + w[i];
+        uint32_t s0 = rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + maj;
+        h = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    m_state[0] += a; m_state[1] += b; m_state[2] += c; m_state[3] += d;
+    m_state[4] += e; m_state[5] += f; m_state[6] += g; m_state[7] += h;
+}
+
+void Sha256::update(const void *a_data, size_t a_size) {
+    const uint8_t *p = static_cast<const uint8_t*>(a_data);
+    m_length += a_size;
+    if (m_block_size != 0) {
+        size_t take = std::min(a_size, m_block.size() - m_block_size);
+        std::memcpy(m_block.data() + m_block_size, p, take);
+        m_block_size += take;
+        p += take;
+        a_size -= take;
+        if (m_block_size < m_block.size()) {
+            return;
+        }
+        compress(m_block.data());
+        m_block_size = 0;
+    }
+    // blocs complets traités sans copie
+    for (; a_size >= 64; p += 64, a_size -= 64) {
+        compress(p);
+    }
+    std::memcpy(m_block.data(), p, a_size);
+    m_block_size = a_size;
+}
+
+Sha256::Digest Sha256::digest() {
+    uint64_t bits = m_length * 8;
+    uint8_t padding[72] = {0x80};
+    size_t padding_size = (m_block_size < 56 ? 56 : 120) - m_block_size;
+    for (int i = 0; i < 8; i++) {
+        padding[padding_size + i] = uint8_t(bits >> (56 - 8*i));
+    }
+    update(padding, padding_size + 8);
+
+    Digest digest;
+    for (int i = 0; i < 8; i++) {
+        digest[4*i]     = uint8_t(m_state[i] >> 24);
+        digest[4*i + 1] = uint8_t(m_state[i] >> 16);
+        digest[4*i + 2] = uint8_t(m_state[i] >> 8);
+        digest[4*i + 3] = uint8_t(m_state[i]);
+    }
+    return digest;
+}
+
+Sha256::Digest Sha256::hash(const void *a_data, size_t a_size) {
+    Sha256 sha;
+    sha.update(a_data, a_size);
+    return sha.digest();
+}
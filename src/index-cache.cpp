@@ -0,0 +1,233 @@
+// Index persistant des fichiers mp4 analysés (cf index-cache.hpp).
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <container-parser.hpp>
+#include <index-cache.hpp>
+#include <sample-table.hpp>
+
+
+// Arrondit une position au multiple de 8 supérieur.
+static uint64_t align8(uint64_t a_offset) {
+    return (a_offset + 7) & ~uint64_t(7);
+}
+
+// Vrai si une section de `count` éléments de type T placée à `offset` tient
+// dans un fichier de `size` octets et est alignée pour T. Les comparaisons ne
+// débordent pas, même sur un sidecar corrompu.
+template <typename T>
+static bool sectionFits(uint64_t a_offset, uint64_t a_count, uint64_t a_size) {
+    return a_offset <= a_size && a_count <= (a_size - a_offset) / sizeof(T) && a_offset % alignof(T) == 0;
+}
+
+// Relève la taille, la date de modification et l'inode du fichier source, sans
+// l'ouvrir ni le lire.
+//     @source_path: chemin du fichier
+//     @header: entête dont les champs `source_*` sont renseignés
+//     @return: false si le fichier est inaccessible
+static bool statSource(const std::string& a_source_path, IndexHeader& a_header) {
+    struct stat st;
+    if (::stat(a_source_path.c_str(), &st) != 0) {
+        return false;
+    }
+    a_header.source_size  = st.st_size;
+    a_header.source_mtime = int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    a_header.source_inode = st.st_ino;
+    return true;
+}
+
+std::string indexPath(const std::string& a_source_path) {
+    return a_source_path + ".idx";
+}
+
+MappedIndex::~MappedIndex() {
+    if (m_data != nullptr) {
+        munmap(m_data, m_size);
+    }
+}
+
+std::unique_ptr<MappedIndex> MappedIndex::open(const std::string& a_source_path) {
+    IndexHeader source;
+    if (!statSource(a_source_path, source)) {
+        return nullptr;
+    }
+
+    int fd = ::open(indexPath(a_source_path).c_str(), O_RDONLY);
+    if (fd < 0) {
+        return nullptr;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t) st.st_size < sizeof(IndexHeader)) {
+        close(fd);
+        return nullptr;
+    }
+    void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return nullptr;
+    }
+
+    std::unique_ptr<MappedIndex> index(new MappedIndex());
+    index->m_data = data;
+    index->m_size = st.st_size;
+
+    const IndexHeader *header = static_cast<const IndexHeader*>(data);
+    if (header->magic        != INDEX_MAGIC
+        || header->version      != INDEX_VERSION
+        || header->header_size  != sizeof(IndexHeader)
+        || header->source_size  != source.source_size
+        || header->source_mtime != source.source_mtime
+        || header->source_inode != source.source_inode) {
+        return nullptr;
+    }
+    // les sections doivent tenir dans le fichier projeté
+    if (!sectionFits<IndexedBox>(header->boxes_offset, header->box_count, index->m_size)
+        || !sectionFits<IndexedTrack>(header->tracks_offset, header->track_count, index->m_size)
+        || !sectionFits<IndexedSample>(header->samples_offset, header->sample_count, index->m_size)) {
+        return nullptr;
+    }
+
+    const char *base = static_cast<const char*>(data);
+    index->m_header  = header;
+    index->m_boxes   = reinterpret_cast<const IndexedBox*>(base + header->boxes_offset);
+    index->m_tracks  = reinterpret_cast<const IndexedTrack*>(base + header->tracks_offset);
+    index->m_samples = reinterpret_cast<const IndexedSample*>(base + header->samples_offset);
+    for (uint32_t i=0; i<header->track_count; i++) {
+        const IndexedTrack& track = index->m_tracks[i];
+        if (track.first_sample > header->sample_count
+            || track.sample_count > header->sample_count - track.first_sample) {
+            return nullptr;
+        }
+    }
+    return index;
+}
+
+// Ajoute une boîte et ses descendants à la table, en ordre préfixe.
+//     @box: la boîte à ajouter
+//     @parent: indice du parent dans la table
+//     @depth: profondeur de la boîte
+//     @boxes: la table des boîtes
+static void flattenTree(const Box& a_box, uint32_t a_parent, uint8_t a_depth,
+                        std::vector<IndexedBox>& a_boxes) {
+    IndexedBox entry = {};
+    entry.type        = a_box.type;
+    entry.header_size = a_box.header_size;
+    entry.depth       = a_depth;
+    entry.parent      = a_parent;
+    entry.child_count = a_box.getChildren().size();
+    entry.offset      = a_box.offset;
+    entry.size        = a_box.size;
+    uint32_t index = a_boxes.size();
+    a_boxes.push_back(entry);
+    for (const std::unique_ptr<Box>& child : a_box.getChildren()) {
+        flattenTree(*child, index, a_depth + 1, a_boxes);
+    }
+}
+
+void writeIndex(const std::string& a_source_path, const Root& a_root) {
+    IndexHeader header = {};
+    if (!statSource(a_source_path, header)) {
+        throw std::runtime_error("Cannot stat indexed file `" + a_source_path + "`.");
+    }
+    header.magic       = INDEX_MAGIC;
+    header.version     = INDEX_VERSION;
+    header.header_size = sizeof(IndexHeader);
+
+    std::vector<IndexedBox> boxes;
+    flattenTree(a_root, INDEX_NO_PARENT, 0, boxes);
+    boxes[0].size = header.source_size;
+    boxes[0].header_size = 0;
+
+    std::vector<IndexedTrack>  tracks;
+    std::vector<IndexedSample> samples;
+    for (Trak *trak : findTracks(a_root)) {
+        TrackBoxes track_boxes = findTrackBoxes(*trak);
+        IndexedTrack track = {};
+        if (track_boxes.tkhd != nullptr) track.track_ID     = track_boxes.tkhd->track_ID;
+        if (track_boxes.hdlr != nullptr) track.handler_type = track_boxes.hdlr->handler_type;
+        if (track_boxes.mdhd != nullptr) {
+            track.timescale = track_boxes.mdhd->timescale;
+            track.duration  = track_boxes.mdhd->duration;
+        }
+        for (uint32_t i=0; i<boxes.size(); i++) {
+            if (boxes[i].offset == trak->offset && boxes[i].type == trak->type) {
+                track.trak_box = i;
+                break;
+            }
+        }
+        track.first_sample = samples.size();
+        for (const SampleInfo& info : flattenSamples(*trak)) {
+            samples.push_back(IndexedSample{info.offset, info.dts, info.size, info.sync});
+        }
+        track.sample_count = samples.size() - track.first_sample;
+        tracks.push_back(track);
+    }
+
+    header.box_count      = boxes.size();
+    header.track_count    = tracks.size();
+    header.sample_count   = samples.size();
+    header.boxes_offset   = align8(sizeof(IndexHeader));
+    header.tracks_offset  = align8(header.boxes_offset + boxes.size() * sizeof(IndexedBox));
+    header.samples_offset = align8(header.tracks_offset + tracks.size() * sizeof(IndexedTrack));
+    uint64_t total_size   = header.samples_offset + samples.size() * sizeof(IndexedSample);
+
+    std::vector<char> buffer(total_size, 0);
+    std::memcpy(buffer.data(), &header, sizeof(header));
+    std::memcpy(buffer.data() + header.boxes_offset,   boxes.data(),   boxes.size()   * sizeof(IndexedBox));
+    std::memcpy(buffer.data() + header.tracks_offset,  tracks.data(),  tracks.size()  * sizeof(IndexedTrack));
+    std::memcpy(buffer.data() + header.samples_offset, samples.data(), samples.size() * sizeof(IndexedSample));
+
+    // fichier temporaire unique dans le répertoire du sidecar : deux écritures
+    // concurrentes ne partagent pas de fichier, et rename reste atomique
+    std::string path = indexPath(a_source_path);
+    std::string tmp_path = path + ".XXXXXX";
+    int fd = ::mkstemp(&tmp_path[0]);
+    if (fd < 0) {
+        throw std::runtime_error("Cannot create index file `" + tmp_path + "`.");
+    }
+    bool written = ::fchmod(fd, 0644) == 0;
+    for (size_t done = 0; written && done < buffer.size(); ) {
+        ssize_t n = ::write(fd, buffer.data() + done, buffer.size() - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        written = n > 0;
+        done += written ? n : 0;
+    }
+    written = ::close(fd) == 0 && written;
+    if (!written) {
+        std::remove(tmp_path.c_str());
+        throw std::runtime_error("Error writing index file `" + tmp_path + "`.");
+    }
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+        std::remove(tmp_path.c_str());
+        throw std::runtime_error("Cannot rename index file to `" + path + "`.");
+    }
+}
+
+void displayIndexTree(const MappedIndex& a_index, const std::string fileName) {
+    std::cout << fileName << std::endl;
+    for (uint32_t i=0; i<a_index.header().box_count; i++) {
+        const IndexedBox& box = a_index.boxes()[i];
+        for (int j=0; j<box.depth; j++) {
+            std::cout << "│   ";
+        }
+        std::cout << "└───"
+                  << std::string(box.type.data(), 4)
+                  << std::endl;
+    }
+    std::cout << std::endl;
+}
@@ -0,0 +1,163 @@
+// Analyse et reprise de l'entrelacement des pistes (cf interleave.hpp).
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+
+#include <box-writer.hpp>
+#include <container-parser.hpp>
+#include <interleave.hpp>
+#include <movie-writer.hpp>
+#include <sample-table.hpp>
+
+
+// Chunk d'une piste placé sur la ligne de temps commune.
+struct TimelineChunk {
+    uint64_t offset;
+    uint64_t size;
+    double   start; // instants de décodage (s)
+    double   end;
+    uint32_t track;
+};
+
+// Durée d'une piste selon stts, dans l'échelle de temps du média.
+static uint64_t mediaDuration(const TrackBoxes& a_boxes) {
+    uint64_t duration = 0;
+    for (size_t e = 0; a_boxes.stts != nullptr && e < a_boxes.stts->sample_count.size(); e++) {
+        duration += uint64_t(a_boxes.stts->sample_count[e]) * a_boxes.stts->sample_delta[e];
+    }
+    return duration;
+}
+
+InterleaveReport analyzeInterleaving(const Root& a_root) {
+    InterleaveReport report;
+    std::vector<std::vector<TimelineChunk>> timelines;
+    std::vector<TimelineChunk> file_order;
+    for (const Trak *trak : findTracks(a_root)) {
+        TrackBoxes boxes = findTrackBoxes(*trak);
+        if (boxes.mdhd == nullptr || boxes.mdhd->timescale == 0) {
+            throw std::runtime_error("Missing mdhd in track.");
+        }
+        double timescale = boxes.mdhd->timescale;
+        uint32_t index = timelines.size();
+        std::vector<TimelineChunk> chunks;
+        uint32_t chunk = 0;
+        for (SampleCursor cursor(*trak); !cursor.done(); cursor.next()) {
+            const SampleInfo& sample = cursor.sample();
+            if (chunks.empty() || cursor.chunk() != chunk) {
+                if (!chunks.empty()) {
+                    chunks.back().end = sample.dts / timescale;
+                }
+                chunks.push_back(TimelineChunk{sample.offset, 0, sample.dts / timescale, 0, index});
+                chunk = cursor.chunk();
+            }
+            chunks.back().size += sample.size;
+        }
+        double duration = mediaDuration(boxes) / timescale;
+        if (!chunks.empty()) {
+            chunks.back().end = duration;
+        }
+
+        TrackInterleave track;
+        track.track_ID     = boxes.tkhd != nullptr ? boxes.tkhd->track_ID : 0;
+        track.handler_type = boxes.hdlr != nullptr ? boxes.hdlr->handler_type : 0;
+        track.chunks       = chunks.size();
+        for (const TimelineChunk& c : chunks) {
+            track.bytes += c.size;
+        }
+        track.chunk_duration = chunks.empty() ? 0 : duration / chunks.size();
+        report.tracks.push_back(track);
+        file_order.insert(file_order.end(), chunks.begin(), chunks.end());
+        timelines.push_back(std::move(chunks));
+    }
+
+    // lecture séquentielle : changements de piste d'un chunk au suivant
+    std::sort(file_order.begin(), file_order.end(), [](const TimelineChunk& a, const TimelineChunk& b) {
+        return a.offset < b.offset;
+    });
+    for (size_t c = 1; c < file_order.size(); c++) {
+        report.track_switches += file_order[c].track != file_order[c - 1].track;
+    }
+
+    // à chaque début de chunk, les chunks qui couvrent cet instant dans chaque piste
+    std::vector<double> times;
+    for (const std::vector<TimelineChunk>& chunks : timelines) {
+        for (const TimelineChunk& c : chunks) {
+            times.push_back(c.start);
+        }
+    }
+    std::sort(times.begin(), times.end());
+    times.erase(std::unique(times.begin(), times.end()), times.end());
+    std::vector<size_t> current(timelines.size(), 0);
+    for (double time : times) {
+        uint64_t first = UINT64_MAX, last = 0;  // positions des chunks
+        uint64_t low = UINT64_MAX, high = 0;    // plage couverte
+        for (size_t t = 0; t < timelines.size(); t++) {
+            const std::vector<TimelineChunk>& chunks = timelines[t];
+            while (current[t] + 1 < chunks.size() && chunks[current[t] + 1].start <= time) {
+                current[t]++;
+            }
+            if (chunks.empty() || chunks[current[t]].start > time || chunks[current[t]].end <= time) {
+                continue; // piste pas encore commencée ou terminée
+            }
+            const TimelineChunk& c = chunks[current[t]];
+            first = std::min(first, c.offset);
+            last  = std::max(last, c.offset);
+            low   = std::min(low, c.offset);
+            high  = std::max(high, c.offset + c.size);
+        }
+        if (high == 0) {
+            continue;
+        }
+        if (last - first > report.max_distance) {
+            report.max_distance      = last - first;
+            report.max_distance_time = time;
+        }
+        report.read_ahead = std::max(report.read_ahead, high - low);
+    }
+    return report;
+}
+
+MovieWriteStats reinterleave(const Root& a_root, const std::string& a_source, const std::string& a_output,
+                             double a_interleave) {
+    if (!(a_interleave > 0)) {
+        throw std::runtime_error("Interleave duration must be positive.");
+    }
+    FileDescriptor source(::open(a_source.c_str(), O_RDONLY));
+    if (!source.valid()) {
+        throw std::runtime_error("Cannot open file `" + a_source + "`.");
+    }
+    std::vector<OutputTrack> tracks;
+    for (const Trak *trak : findTracks(a_root)) {
+        TrackBoxes boxes = findTrackBoxes(*trak);
+        if (boxes.mdhd == nullptr || boxes.mdhd->timescale == 0) {
+            throw std::runtime_error("Missing mdhd in track.");
+        }
+        // un chunk par tranche de `interleave` secondes
+        OutputTrack track = copyTrack(*trak);
+        uint64_t dts = 0;
+        for (OutputSample& sample : track.samples) {
+            sample.source_chunk = uint32_t(dts / (a_interleave * boxes.mdhd->timescale));
+            dts += sample.delta;
+        }
+        tracks.push_back(std::move(track));
+    }
+    return writeMovie(a_root, {source.get()}, tracks, a_output, ChunkOrder::Time);
+}
+
+void printInterleaveReport(std::ostream& a_outstream, const InterleaveReport& a_report) {
+    a_outstream << "interleaving: max A/V distance " << a_report.max_distance << " bytes at "
+                << a_report.max_distance_time << " s, read-ahead " << a_report.read_ahead << " bytes, "
+                << a_report.track_switches << " track switches\n";
+    for (const TrackInterleave& track : a_report.tracks) {
+        char handler[4] = {char(track.handler_type >> 24), char(track.handler_type >> 16),
+                           char(track.handler_type >> 8),  char(track.handler_type)};
+        a_outstream << "track " << track.track_ID << " (" << std::string(handler, 4) << "): " << track.chunks
+                    << " chunks, " << track.bytes << " bytes, " << track.chunk_duration << " s per chunk\n";
+    }
+}
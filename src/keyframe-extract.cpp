@@ -0,0 +1,341 @@
+// Extraction d'images clés réparties sur la durée (cf keyframe-extract.hpp).
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <container-parser.hpp>
+#include <keyframe-extract.hpp>
+#include <parallel.hpp>
+#include <range-reader.hpp>
+#include <sample-table.hpp>
+
+
+// Position d'une image clé retenue.
+struct KeyframeLocation {
+    uint32_t sample; // numéro, à partir de 1
+    uint64_t dts;
+    uint64_t offset;
+    uint32_t size;
+};
+
+// Une lecture : la plage [offset, offset+size) couvre les images
+// [first, first+count) de la liste triée.
+struct KeyframeRead {
+    uint64_t offset;
+    uint64_t size;
+    size_t   first;
+    size_t   count;
+};
+
+VideoConfig decodeAvcConfig(const char *a_data, size_t a_size) {
+    const uint8_t *p = reinterpret_cast<const uint8_t*>(a_data);
+    if (a_size < 6) {
+        throw std::runtime_error("Truncated avcC box.");
+    }
+    VideoConfig config;
+    config.profile         = p[1];
+    config.compatibility   = p[2];
+    config.level           = p[3];
+    config.nal_length_size = (p[4] & 0x03) + 1;
+    size_t position = 5;
+    // ensembles de paramètres : nombre, puis taille sur 16 bits et contenu de chacun
+    auto readSets = [&](uint8_t a_mask, std::vector<std::vector<char>>& a_sets) {
+        if (position >= a_size) {
+            throw std::runtime_error("Truncated avcC box.");
+        }
+        unsigned count = p[position++] & a_mask;
+        for (unsigned i = 0; i < count; i++) {
+            if (position + 2 > a_size) {
+                throw std::runtime_error("Truncated avcC box.");
+            }
+            size_t length = size_t(p[position]) << 8 | p[position + 1];
+            position += 2;
+            if (position + length > a_size) {
+                throw std::runtime_error("Truncated avcC box.");
+            }
+            a_sets.emplace_back(a_data + position, a_data + position + length);
+            position += length;
+        }
+    };
+    readSets(0x1F, config.sps);
+    readSets(0xFF, config.pps);
+    return config;
+}
+
+std::vector<char> toAnnexB(const char *a_data, size_t a_size, uint8_t a_length_size) {
+    static const char START_CODE[4] = {0, 0, 0, 1};
+    std::vector<char> out;
+    out.reserve(a_size + 16);
+    const uint8_t *p = reinterpret_cast<const uint8_t*>(a_data);
+    size_t position = 0;
+    while (position + a_length_size <= a_size) {
+        size_t length = 0;
+        for (uint8_t i = 0; i < a_length_size; i++) {
+            length = length << 8 | p[position + i];
+        }
+        position += a_length_size;
+        if (length > a_size - position) {
+            throw std::runtime_error("NAL unit overruns its sample.");
+        }
+        out.insert(out.end(), START_CODE, START_CODE + 4);
+        out.insert(out.end(), a_data + position, a_data + position + length);
+        position += length;
+    }
+    return out;
+}
+
+// Instants de décodage des échantillons de synchronisation, dans l'ordre de stss.
+static std::vector<uint64_t> syncTimes(const TrackBoxes& a_boxes, const std::vector<uint32_t>& a_syncs) {
+    std::vector<uint64_t> times;
+    times.reserve(a_syncs.size());
+    uint64_t dts = 0;
+    uint32_t first = 1; // premier échantillon de l'entrée courante de stts
+    size_t   entry = 0;
+    for (uint32_t sample : a_syncs) {
+        while (entry < a_boxes.stts->sample_count.size() && sample >= first + a_boxes.stts->sample_count[entry]) {
+            dts   += uint64_t(a_boxes.stts->sample_count[entry]) * a_boxes.stts->sample_delta[entry];
+            first += a_boxes.stts->sample_count[entry];
+            entry++;
+        }
+        if (entry == a_boxes.stts->sample_count.size()) {
+            throw std::runtime_error("Sync sample beyond the stts table.");
+        }
+        times.push_back(dts + uint64_t(sample - first) * a_boxes.stts->sample_delta[entry]);
+    }
+    return times;
+}
+
+// Renseigne position et taille des échantillons demandés, triés par numéro,
+// en un parcours de stsc.
+static void locateSamples(const TrackBoxes& a_boxes, std::vector<KeyframeLocation>& a_locations) {
+    const Stsc& stsc = *a_boxes.stsc;
+    const Stsz& stsz = *a_boxes.stsz;
+    const std::vector<uint32_t>& chunks = a_boxes.stco->chunk_offset;
+    auto sizeOf = [&](uint32_t a_sample) {
+        if (stsz.sample_size != 0) {
+            return stsz.sample_size;
+        }
+        if (a_sample - 1 >= stsz.entry_size.size()) {
+            throw std::runtime_error("Sample beyond the stsz table.");
+        }
+        return stsz.entry_size[a_sample - 1];
+    };
+    size_t   entry = 0;
+    uint32_t first_sample = 1; // premier échantillon de l'entrée courante de stsc
+    for (KeyframeLocation& location : a_locations) {
+        while (true) {
+            if (entry >= stsc.first_chunk.size()) {
+                throw std::runtime_error("Sample beyond the stsc table.");
+            }
+            uint64_t next_chunk = entry + 1 < stsc.first_chunk.size() ? stsc.first_chunk[entry + 1] : chunks.size() + 1;
+            uint64_t samples = (next_chunk - stsc.first_chunk[entry]) * stsc.samples_per_chunk[entry];
+            if (location.sample < first_sample + samples) {
+                break;
+            }
+            first_sample += samples;
+            entry++;
+        }
+        uint32_t index = location.sample - first_sample;
+        uint64_t chunk = stsc.first_chunk[entry] + index / stsc.samples_per_chunk[entry];
+        if (chunk - 1 >= chunks.size()) {
+            throw std::runtime_error("Chunk beyond the stco table.");
+        }
+        uint64_t offset = chunks[chunk - 1];
+        for (uint32_t s = location.sample - index % stsc.samples_per_chunk[entry]; s < location.sample; s++) {
+            offset += sizeOf(s);
+        }
+        location.offset = offset;
+        location.size   = sizeOf(location.sample);
+    }
+}
+
+// Regroupe les images triées par position en lectures (cf planReads de fingerprint.cpp).
+static std::vector<KeyframeRead> planKeyframeReads(const std::vector<KeyframeLocation>& a_locations,
+                                                   const KeyframeOptions& a_options) {
+    std::vector<KeyframeRead> reads;
+    for (size_t i = 0; i < a_locations.size(); i++) {
+        const KeyframeLocation& location = a_locations[i];
+        if (!reads.empty()) {
+            KeyframeRead& read = reads.back();
+            uint64_t end = read.offset + read.size;
+            if (location.offset >= end && location.offset - end <= a_options.max_gap
+                && location.offset + location.size - read.offset <= a_options.max_read) {
+                read.size = location.offset + location.size - read.offset;
+                read.count++;
+                continue;
+            }
+        }
+        reads.push_back(KeyframeRead{location.offset, location.size, i, 1});
+    }
+    return reads;
+}
+
+KeyframeSet extractKeyframes(const Root& a_root, RangeReader& a_reader, size_t a_count, const KeyframeOptions& a_options) {
+    // première piste vidéo décrite par une configuration avcC ou hvcC
+    const Trak *video = nullptr;
+    const Box  *avcc  = nullptr;
+    const Hvcc *hvcc  = nullptr;
+    TrackBoxes boxes;
+    for (const Trak *trak : findTracks(a_root)) {
+        boxes = findTrackBoxes(*trak);
+        const Box *stsd = boxes.stbl != nullptr ? boxes.stbl->findChild({'s', 't', 's', 'd'}) : nullptr;
+        if (boxes.hdlr == nullptr || boxes.hdlr->handler_type != ('v' << 24 | 'i' << 16 | 'd' << 8 | 'e')
+            || stsd == nullptr || stsd->getChildren().empty()) {
+            continue;
+        }
+        const Box *entry = stsd->getChildren()[0].get();
+        if (entry->kind == BoxKind::Hvc1) {
+            hvcc = static_cast<const Hvcc*>(entry->findChild({'h', 'v', 'c', 'C'}));
+        } else {
+            avcc = entry->findChild({'a', 'v', 'c', 'c'});
+        }
+        if (avcc != nullptr || hvcc != nullptr) {
+            video = trak;
+            break;
+        }
+    }
+    if (video == nullptr) {
+        throw std::runtime_error("No AVC or HEVC video track.");
+    }
+    if (boxes.stts == nullptr || boxes.stsc == nullptr || boxes.stsz == nullptr || boxes.stco == nullptr
+        || boxes.mdhd == nullptr || boxes.mdhd->timescale == 0) {
+        throw std::runtime_error("Missing sample tables in the video track.");
+    }
+
+    KeyframeSet result;
+    result.track_ID = boxes.tkhd != nullptr ? boxes.tkhd->track_ID : 0;
+    result.format   = a_options.format;
+    if (hvcc != nullptr) {
+        // déjà décodée par l'analyse : les ensembles de paramètres sont copiés depuis les vues
+        VideoConfig& config = result.config;
+        config.codec           = VideoCodec::Hevc;
+        config.profile         = hvcc->general_profile_idc;
+        config.level           = hvcc->general_level_idc;
+        config.nal_length_size = hvcc->nal_length_size;
+        for (std::string_view nal : hvcc->vps) {
+            config.vps.emplace_back(nal.begin(), nal.end());
+        }
+        for (std::string_view nal : hvcc->sps) {
+            config.sps.emplace_back(nal.begin(), nal.end());
+        }
+        for (std::string_view nal : hvcc->pps) {
+            config.pps.emplace_back(nal.begin(), nal.end());
+        }
+    } else {
+        std::vector<char> config(avcc->size - avcc->header_size);
+        if (a_reader.read(avcc->offset + avcc->header_size, config.data(), config.size()) != config.size()) {
+            throw std::runtime_error("Short read of the avcC box.");
+        }
+        result.reads++;
+        result.bytes_read += config.size();
+        result.config = decodeAvcConfig(config.data(), config.size());
+    }
+
+    // images clés : toutes les images si stss est absent
+    uint32_t sample_count = boxes.stsz->sample_count;
+    std::vector<uint32_t> syncs;
+    if (boxes.stss != nullptr) {
+        syncs = boxes.stss->sample_number;
+    } else {
+        for (uint32_t s = 1; s <= sample_count; s++) {
+            syncs.push_back(s);
+        }
+    }
+    if (syncs.empty() || a_count == 0) {
+        return result;
+    }
+    std::vector<uint64_t> times = syncTimes(boxes, syncs);
+    uint64_t duration = 0;
+    for (size_t e = 0; e < boxes.stts->sample_count.size(); e++) {
+        duration += uint64_t(boxes.stts->sample_count[e]) * boxes.stts->sample_delta[e];
+    }
+
+    // instant visé -> image clé la plus proche
+    double timescale = boxes.mdhd->timescale;
+    std::vector<size_t> chosen;
+    for (size_t i = 0; i < a_count; i++) {
+        double target = (i + 0.5) * duration / a_count;
+        size_t k = std::lower_bound(times.begin(), times.end(), uint64_t(target)) - times.begin();
+        if (k == times.size() || (k > 0 && target - times[k - 1] <= times[k] - target)) {
+            k--;
+        }
+        chosen.push_back(k);
+        Keyframe frame;
+        frame.target = target / timescale;
+        frame.time   = times[k] / timescale;
+        frame.sample = syncs[k];
+        result.frames.push_back(frame);
+    }
+    std::vector<size_t> distinct = chosen;
+    distinct.erase(std::unique(distinct.begin(), distinct.end()), distinct.end());
+    std::vector<KeyframeLocation> locations;
+    for (size_t k : distinct) {
+        locations.push_back(KeyframeLocation{syncs[k], times[k], 0, 0});
+    }
+    locateSamples(boxes, locations);
+    std::sort(locations.begin(), locations.end(), [](const KeyframeLocation& a, const KeyframeLocation& b) {
+        return a.offset < b.offset;
+    });
+    std::vector<KeyframeRead> reads = planKeyframeReads(locations, a_options);
+
+    // chaque thread prend la lecture suivante et range les images à leur indice
+    std::vector<std::vector<char>> samples(locations.size());
+    std::atomic<uint64_t> bytes_read{0};
+    runParallel(reads.size(), a_options.threads, [&]() -> ParallelJob {
+        return [&, buffer = std::vector<char>()](size_t a_read) mutable {
+            const KeyframeRead& read = reads[a_read];
+            buffer.resize(read.size);
+            if (a_reader.read(read.offset, buffer.data(), read.size) != read.size) {
+                throw std::runtime_error("Short read while extracting keyframes.");
+            }
+            bytes_read += read.size;
+            for (size_t i = read.first; i < read.first + read.count; i++) {
+                const char *data = buffer.data() + (locations[i].offset - read.offset);
+                if (a_options.format == NalFormat::AnnexB) {
+                    samples[i] = toAnnexB(data, locations[i].size, result.config.nal_length_size);
+                } else {
+                    samples[i].assign(data, data + locations[i].size);
+                }
+            }
+        };
+    });
+
+    for (Keyframe& frame : result.frames) {
+        size_t i = std::find_if(locations.begin(), locations.end(), [&](const KeyframeLocation& a_location) {
+            return a_location.sample == frame.sample;
+        }) - locations.begin();
+        frame.offset = locations[i].offset;
+        frame.size   = locations[i].size;
+        frame.data   = samples[i];
+    }
+    result.distinct = locations.size();
+    for (const KeyframeLocation& location : locations) {
+        result.sample_bytes += location.size;
+    }
+    result.reads      += reads.size();
+    result.bytes_read += bytes_read;
+    return result;
+}
+
+void printKeyframeSet(std::ostream& a_outstream, const KeyframeSet& a_set) {
+    const VideoConfig& config = a_set.config;
+    bool hevc = config.codec == VideoCodec::Hevc;
+    a_outstream << "keyframes: track " << a_set.track_ID << ", " << a_set.frames.size() << " frames ("
+                << a_set.distinct << " distinct, " << a_set.sample_bytes << " bytes), "
+                << (a_set.format == NalFormat::AnnexB ? "Annex B" : "length-prefixed") << ", "
+                << a_set.reads << " reads of " << a_set.bytes_read << " bytes\n"
+                << (hevc ? "hvcC" : "avcC") << ": profile " << unsigned(config.profile) << ", level "
+                << unsigned(config.level) << ", NAL length " << unsigned(config.nal_length_size) << " bytes, "
+                << (hevc ? std::to_string(config.vps.size()) + " VPS, " : "") << config.sps.size() << " SPS, "
+                << config.pps.size() << " PPS\n";
+    for (const Keyframe& frame : a_set.frames) {
+        a_outstream << "  " << frame.target << " s -> sample " << frame.sample << " at " << frame.time << " s, "
+                    << frame.size << " bytes @" << frame.offset << ", " << frame.data.size() << " bytes out\n";
+    }
+}
@@ -0,0 +1,523 @@
+// Point d'entrée du décodeur : analyse un fichier mp4 et affiche son arbre.
+//
+// Usage : decoder [--index] [--events] [--dump [--columns]] [--stats] [--memory] [--analytics] [--validate] [--fingerprint [--sha256] [--threads n]] [--trim début fin sortie] [--split préfixe] [--concat sortie] [--write sortie] [--roundtrip] [--tags] [--tag clé valeur]... [--keyframes n] [--adts sortie] [--interleave] [--reinterleave durée sortie] [--segments durée] [--range [--latency us]] [--spool-cap octets [--spool-dir rép]]
+//                 [--trace sortie.json] [--query chemin]... [fichier... | -]
+//     --index: réutilise le sidecar du fichier s'il est valide, le crée sinon ; avec
+//             d'autres options, le fichier est analysé et le sidecar réécrit
+//     --events: affiche les évènements d'analyse au fil de l'eau, sans construire l'arbre
+//     --dump: écrit le contenu de toutes les boîtes au lieu de l'arborescence
+//     --columns: avec --dump, affiche les tables d'échantillons en colonnes
+//     --stats: affiche les statistiques d'analyse par type de boîte
+//     --memory: affiche la mémoire occupée par l'arbre, par type de boîte et par piste
+//     --analytics: affiche débits, GOP et tailles d'échantillons de chaque piste
+//     --validate: vérifie les tables d'échantillons (bornes de mdat, recouvrements,
+//                 totaux) ; code de sortie 2 si le fichier est invalide
+//     --fingerprint: calcule l'empreinte du contenu de chaque piste (hash des échantillons)
+//     --sha256: avec --fingerprint, ajoute un condensé SHA-256
+//     --threads: avec --fingerprint, nombre de threads (un par cœur par défaut)
+//     --trim: copie l'intervalle [début, fin) (s) dans le fichier de sortie, sans réencodage,
+//             le début ramené sur l'image clé qui le précède
+//     --split: écrit chaque piste dans son fichier, <préfixe>-track<ID>.mp4, en une lecture
+//     --concat: met bout à bout les fichiers donnés (pistes et descriptions identiques)
+//               dans le fichier de sortie, sans réencodage
+//     --write: réécrit l'arbre analysé dans le fichier de sortie
+//     --roundtrip: vérifie que l'analyse puis la réécriture du fichier redonnent les mêmes octets
+//     --tags: affiche les métadonnées texte (moov/udta/meta/ilst)
+//     --tag: modifie un élément des métadonnées dans le fichier même (répétable) ;
+//            clé de 4 caractères, '@' pour '©' (ex. @nam), valeur vide pour le supprimer
+//     --keyframes: extrait n images clés réparties sur la durée de la piste vidéo (Annex B)
+//     --adts: écrit la piste AAC en flux ADTS dans le fichier de sortie
+//     --interleave: affiche l'entrelacement des pistes (écart entre pistes, lecture anticipée)
+//     --reinterleave: réécrit le fichier avec des chunks de la durée donnée (s), dans l'ordre de décodage
+//     --segments: découpe les pistes en segments de la durée donnée (s), alignés
+//                 sur les images clés, et écrit leurs listes de lecture HLS
+//     --range: lit le fichier par plages d'octets (cache de blocs, lecture anticipée)
+//              et affiche le nombre de requêtes
+//     --latency: avec --range, ajoute la latence donnée (µs) à chaque requête
+//     --spool-cap: avec l'entrée standard, conserve jusqu'à ce nombre d'octets sautés
+//                  (mdat avant moov) pour relire ensuite les échantillons
+//     --spool-dir: conserve les octets sautés dans un fichier temporaire de ce répertoire
+//                  plutôt qu'en mémoire
+//     --trace: écrit la chronologie de l'analyse au format Chrome trace event (Perfetto)
+//     --query: n'analyse que les boîtes du chemin donné (répétable), ex. moov/trak/mdia/mdhd
+//     -: lit l'entrée standard (tube), en avant uniquement
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <adts-demux.hpp>
+#include <box-serializer.hpp>
+#include <box-visitor.hpp>
+#include <concat.hpp>
+#include <container-parser.hpp>
+#include <fingerprint.hpp>
+#include <forward-input.hpp>
+#include <index-cache.hpp>
+#include <interleave.hpp>
+#include <keyframe-extract.hpp>
+#include <memory-report.hpp>
+#include <metadata-edit.hpp>
+#include <parse-stats.hpp>
+#include <parse-trace.hpp>
+#include <range-reader.hpp>
+#include <sample-table.hpp>
+#include <segment-planner.hpp>
+#include <table-validation.hpp>
+#include <track-analytics.hpp>
+#include <track-split.hpp>
+#include <trim.hpp>
+
+
+// Affiche les évènements d'analyse : entrée dans chaque boîte et résumé des
+// boîtes décodées.
+class EventPrinter : public BoxVisitor {
+public:
+    VisitAction enterBox(Box& a_box, size_t a_depth) override {
+        std::cout << std::string(2 * (a_depth - 1), ' ')
+                  << std::string(a_box.type.data(), 4)
+                  << " @" << a_box.offset << " (" << a_box.size << " bytes)" << std::endl;
+        return VisitAction::Continue;
+    }
+    VisitAction onMvhd(const Mvhd& a_box) override {
+        std::cout << "  timescale: " << a_box.timescale << ", duration: " << a_box.duration << std::endl;
+        return VisitAction::Continue;
+    }
+    VisitAction onTkhd(const Tkhd& a_box) override {
+        std::cout << "  track ID: " << a_box.track_ID << std::endl;
+        return VisitAction::Continue;
+    }
+    VisitAction onMdhd(const Mdhd& a_box) override {
+        std::cout << "  timescale: " << a_box.timescale << ", duration: " << a_box.duration << std::endl;
+        return VisitAction::Continue;
+    }
+    VisitAction onStszEntries(const Stsz& a_box, const uint32_t *a_entry_size, size_t a_count) override {
+        (void) a_box; (void) a_entry_size;
+        std::cout << "  stsz batch: " << a_count << " entries" << std::endl;
+        return VisitAction::Continue;
+    }
+    VisitAction onStcoEntries(const Stco& a_box, const uint32_t *a_chunk_offset, size_t a_count) override {
+        (void) a_box; (void) a_chunk_offset;
+        std::cout << "  stco batch: " << a_count << " entries" << std::endl;
+        return VisitAction::Continue;
+    }
+};
+
+
+// Clé d'un élément de métadonnées : 4 caractères, '@' ou '©' pour l'octet 0xA9.
+//     @text: la clé saisie
+//     @key: la clé décodée
+//     @return: faux si la clé n'a pas 4 caractères
+static bool tagKey(const std::string& a_text, std::array<char, 4>& a_key) {
+    std::string key = a_text;
+    if (key.compare(0, 2, "\xC2\xA9") == 0) {
+        key = '\xA9' + key.substr(2);
+    } else if (!key.empty() && key[0] == '@') {
+        key[0] = '\xA9';
+    }
+    if (key.size() != 4) {
+        return false;
+    }
+    std::copy(key.begin(), key.end(), a_key.begin());
+    return true;
+}
+
+
+int main(int argc, char *argv[]) {
+    std::string filepath = "test/big_buck_bunny_240p_1mb.mp4";
+    bool use_index = false;
+    bool print_events = false;
+    bool dump = false;
+    bool columns = false;
+    bool stats = false;
+    bool memory = false;
+    bool analytics = false;
+    bool validate = false;
+    bool fingerprint = false;
+    FingerprintOptions fingerprint_options;
+    double trim_start = 0;
+    double trim_end = 0;
+    std::string trim_output;
+    std::string split_prefix;
+    std::string concat_output;
+    std::string write_output;
+    bool roundtrip = false;
+    bool list_tags = false;
+    std::vector<MetadataTag> tags;
+    size_t keyframes = 0;
+    std::string adts_output;
+    bool interleave = false;
+    double reinterleave_duration = 0;
+    std::string reinterleave_output;
+    std::vector<std::string> inputs;
+    double segment_duration = 0;
+    bool use_range = false;
+    long latency = 0;
+    uint64_t spool_cap = 0;
+    std::string spool_dir;
+    std::string trace_path;
+    std::vector<std::string> query_paths;
+    std::array<char, 4> key;
+    bool other_options = false; // une option autre que --index, qui demande l'arbre analysé
+    for (int i = 1; i < argc; i++) {
+        if (std::strncmp(argv[i], "--", 2) == 0 && std::strcmp(argv[i], "--index") != 0) {
+            other_options = true;
+        }
+        if (std::strcmp(argv[i], "--index") == 0) {
+            use_index = true;
+        } else if (std::strcmp(argv[i], "--events") == 0) {
+            print_events = true;
+        } else if (std::strcmp(argv[i], "--dump") == 0) {
+            dump = true;
+        } else if (std::strcmp(argv[i], "--columns") == 0) {
+            columns = true;
+        } else if (std::strcmp(argv[i], "--stats") == 0) {
+            stats = true;
+        } else if (std::strcmp(argv[i], "--memory") == 0) {
+            memory = true;
+        } else if (std::strcmp(argv[i], "--analytics") == 0) {
+            analytics = true;
+        } else if (std::strcmp(argv[i], "--validate") == 0) {
+            validate = true;
+        } else if (std::strcmp(argv[i], "--fingerprint") == 0) {
+            fingerprint = true;
+        } else if (std::strcmp(argv[i], "--sha256") == 0) {
+            fingerprint_options.sha256 = true;
+        } else if (std::strcmp(argv[i], "--threads") == 0 && i+1 < argc) {
+            fingerprint_options.threads = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--trim") == 0 && i+3 < argc) {
+            trim_start = std::atof(argv[++i]);
+            trim_end = std::atof(argv[++i]);
+            trim_output = argv[++i];
+        } else if (std::strcmp(argv[i], "--split") == 0 && i+1 < argc) {
+            split_prefix = argv[++i];
+        } else if (std::strcmp(argv[i], "--concat") == 0 && i+1 < argc) {
+            concat_output = argv[++i];
+        } else if (std::strcmp(argv[i], "--write") == 0 && i+1 < argc) {
+            write_output = argv[++i];
+        } else if (std::strcmp(argv[i], "--roundtrip") == 0) {
+            roundtrip = true;
+        } else if (std::strcmp(argv[i], "--tags") == 0) {
+            list_tags = true;
+        } else if (std::strcmp(argv[i], "--tag") == 0 && i+2 < argc) {
+            if (!tagKey(argv[i+1], key)) {
+                std::cerr << "Metadata key `" << argv[i+1] << "` is not 4 characters long.";
+                return 1;
+            }
+            tags.push_back(MetadataTag{key, argv[i+2]});
+            i += 2;
+        } else if (std::strcmp(argv[i], "--keyframes") == 0 && i+1 < argc) {
+            keyframes = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--adts") == 0 && i+1 < argc) {
+            adts_output = argv[++i];
+        } else if (std::strcmp(argv[i], "--interleave") == 0) {
+            interleave = true;
+        } else if (std::strcmp(argv[i], "--reinterleave") == 0 && i+2 < argc) {
+            reinterleave_duration = std::atof(argv[++i]);
+            reinterleave_output = argv[++i];
+        } else if (std::strcmp(argv[i], "--segments") == 0 && i+1 < argc) {
+            segment_duration = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--range") == 0) {
+            use_range = true;
+        } else if (std::strcmp(argv[i], "--latency") == 0 && i+1 < argc) {
+            latency = std::atol(argv[++i]);
+        } else if (std::strcmp(argv[i], "--spool-cap") == 0 && i+1 < argc) {
+            spool_cap = std::strtoull(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--spool-dir") == 0 && i+1 < argc) {
+            spool_dir = argv[++i];
+        } else if (std::strcmp(argv[i], "--trace") == 0 && i+1 < argc) {
+            trace_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--query") == 0 && i+1 < argc) {
+            query_paths.push_back(argv[++i]);
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            std::cerr << "Unknown option `" << argv[i] << "`.\n"
+                      << "Usage: " << argv[0] << " [--index] [--events] [--dump [--columns]] [--stats] [--memory] [--analytics] [--validate] [--fingerprint [--sha256] [--threads n]] [--trim start end output] [--split prefix] [--concat output] [--write output] [--roundtrip] [--tags] [--tag key value]... [--keyframes n] [--adts output] [--interleave] [--reinterleave seconds output] [--segments seconds] [--range [--latency us]] [--spool-cap bytes [--spool-dir dir]] [--trace out.json] [--query path]... [file... | -]\n";
+            return 1;
+        } else {
+            inputs.push_back(argv[i]);
+        }
+    }
+    if (!inputs.empty()) {
+        filepath = inputs[0];
+    }
+    if (inputs.size() > 1 && concat_output.empty()) {
+        std::cerr << "Several input files are only accepted with --concat.";
+        return 1;
+    }
+
+    bool use_stdin = filepath == "-";
+    // le sidecar suffit à l'affichage de l'arborescence, seul
+    if (use_index && !use_stdin && !other_options) {
+        std::unique_ptr<MappedIndex> index = MappedIndex::open(filepath);
+        if (index) {
+            displayIndexTree(*index, filepath);
+            return 0;
+        }
+    }
+
+    // Open the binary file for reading
+    std::ifstream file;
+    std::unique_ptr<RangeReader> reader;
+    std::unique_ptr<RangeStreamBuf> range_buffer;
+    std::unique_ptr<std::istream> range_stream;
+    std::unique_ptr<Spool> spool;
+    std::unique_ptr<ForwardStreamBuf> forward_buffer;
+    std::unique_ptr<std::istream> forward_stream;
+    std::istream *input = &file;
+    if (use_stdin) {
+        if (spool_cap > 0) {
+            try {
+                spool = std::make_unique<Spool>(spool_cap, spool_dir);
+            } catch (const std::runtime_error& e) {
+                std::cerr << e.what();
+                return 1;
+            }
+        }
+        forward_buffer = std::make_unique<ForwardStreamBuf>(0, spool.get());
+        forward_stream = std::make_unique<std::istream>(forward_buffer.get());
+        input = forward_stream.get();
+    } else if (use_range) {
+        try {
+            reader = std::make_unique<FileRangeReader>(filepath);
+        } catch (const std::runtime_error&) {
+            std::cerr << "Error opening file for reading.";
+            return 1;
+        }
+        if (latency > 0) {
+            reader = std::make_unique<LatencyRangeReader>(std::move(reader), std::chrono::microseconds(latency));
+        }
+        range_buffer = std::make_unique<RangeStreamBuf>(*reader);
+        range_stream = std::make_unique<std::istream>(range_buffer.get());
+        input = range_stream.get();
+    } else {
+        file.open(filepath, std::ios::binary);
+        if (!file) {
+            std::cerr << "Error opening file for reading.";
+            return 1;
+        }
+    }
+
+    std::ofstream trace_file;
+    std::unique_ptr<TraceWriter> trace;
+    if (!trace_path.empty()) {
+        trace_file.open(trace_path);
+        if (!trace_file) {
+            std::cerr << "Error opening trace file for writing.";
+            return 1;
+        }
+        trace = std::make_unique<TraceWriter>(trace_file);
+        TraceWriter::install(trace.get());
+    }
+
+    if (stats) {
+        setParseTiming(true);
+    }
+    Root root;
+    root.size = 0;
+    BoxQuery query(query_paths);
+    ParseContext context;
+    if (print_events) {
+        context.query = &query;
+        EventPrinter printer;
+        parseEvents(*input, root, printer, context);
+        if (stats) {
+            printParseStats(std::cout, parseStats());
+        }
+        return 0;
+    }
+    if (!query_paths.empty()) {
+        parseSelective(*input, root, query, context);
+    } else {
+        root.parse(*input);
+    }
+
+    // les commandes lèvent une exception en cas d'entrée invalide ou d'erreur d'entrée-sortie
+    try {
+        if (dump) {
+            DumpWriter writer(std::cout, DumpWriter::DEFAULT_CAPACITY, columns);
+            dumpTree(writer, root);
+        } else {
+            displayFileTree(&root, filepath);
+        }
+
+        if (!query_paths.empty()) {
+            std::cout << "skipped: " << context.skipped_boxes << " boxes, "
+                      << context.skipped_bytes << " bytes" << std::endl;
+        } else if (use_index && !use_stdin) {
+            writeIndex(filepath, root);
+        }
+        if (stats) {
+            printParseStats(std::cout, parseStats());
+        }
+        if (forward_buffer) {
+            std::cout << "forward input: " << forward_buffer->discarded() << " bytes skipped";
+            if (spool) {
+                uint64_t samples = 0;
+                uint64_t resolvable = 0;
+                for (const Trak *trak : findTracks(root)) {
+                    for (SampleCursor cursor(*trak); !cursor.done(); cursor.next()) {
+                        samples++;
+                        resolvable += spool->contains(cursor.sample().offset, cursor.sample().size);
+                    }
+                }
+                std::cout << ", " << spool->spooled() << " spooled, " << spool->dropped() << " dropped; "
+                          << resolvable << '/' << samples << " samples readable from the spool";
+            }
+            std::cout << std::endl;
+        }
+        if (range_buffer) {
+            RangeCounters counters = range_buffer->counters();
+            std::cout << "range reader: " << counters.requests << " requests, "
+                      << counters.fetched << " bytes fetched, " << counters.overfetched << " over-fetched, "
+                      << counters.cache_hits << " cache hits, " << counters.cache_misses << " misses" << std::endl;
+        }
+        if (memory) {
+            printMemoryReport(std::cout, memoryReport(root));
+        }
+        if (analytics) {
+            for (const TrackAnalytics& track : analyzeTracks(root)) {
+                printTrackAnalytics(std::cout, track);
+            }
+        }
+        if (segment_duration > 0) {
+            SegmentPlan plan = planSegments(root, segment_duration);
+            printSegmentPlan(std::cout, plan);
+            for (const TrackPlan& track : plan.tracks) {
+                std::cout << "\ntrack " << track.track_ID << " playlist:\n";
+                writeHlsPlaylist(std::cout, track, filepath);
+            }
+        }
+        if (fingerprint) {
+            // l'entrée standard n'est relisible qu'au travers du spool
+            std::unique_ptr<RangeReader> file_reader;
+            RangeReader *reader = spool.get();
+            if (!use_stdin) {
+                file_reader = std::make_unique<FileRangeReader>(filepath);
+                reader = file_reader.get();
+            }
+            if (reader == nullptr) {
+                std::cerr << "--fingerprint on standard input needs --spool-cap.";
+                return 1;
+            }
+            printFingerprints(std::cout, fingerprintTracks(root, *reader, fingerprint_options));
+        }
+        if (keyframes > 0) {
+            if (use_stdin) {
+                std::cerr << "--keyframes needs a file input.";
+                return 1;
+            }
+            FileRangeReader frames_reader(filepath);
+            printKeyframeSet(std::cout, extractKeyframes(root, frames_reader, keyframes));
+        }
+        if (!adts_output.empty()) {
+            if (use_stdin) {
+                std::cerr << "--adts needs a file input.";
+                return 1;
+            }
+            FileRangeReader audio_reader(filepath);
+            printAdtsStats(std::cout, demuxAdts(root, audio_reader, adts_output));
+        }
+        if (interleave) {
+            printInterleaveReport(std::cout, analyzeInterleaving(root));
+        }
+        if (!reinterleave_output.empty()) {
+            if (use_stdin) {
+                std::cerr << "--reinterleave needs a file input.";
+                return 1;
+            }
+            MovieWriteStats written = reinterleave(root, filepath, reinterleave_output, reinterleave_duration);
+            std::cout << "reinterleave: " << written.file_size << " bytes written (moov " << written.moov_size << "), "
+                      << written.copied_bytes << " bytes copied in " << written.copy_runs << " runs ("
+                      << written.copy_calls << " copy calls)" << std::endl;
+        }
+        if (!trim_output.empty()) {
+            if (use_stdin) {
+                std::cerr << "--trim needs a file input.";
+                return 1;
+            }
+            printTrimResult(std::cout, trimFile(root, filepath, trim_start, trim_end, trim_output));
+        }
+        if (!split_prefix.empty()) {
+            if (use_stdin) {
+                std::cerr << "--split needs a file input.";
+                return 1;
+            }
+            printSplitResult(std::cout, splitTracks(root, filepath, split_prefix));
+        }
+        if (!concat_output.empty()) {
+            if (use_stdin) {
+                std::cerr << "--concat needs file inputs.";
+                return 1;
+            }
+            // le premier fichier est déjà analysé, les suivants le sont ici
+            std::vector<std::unique_ptr<Root>> others;
+            std::vector<const Root*> roots = {&root};
+            for (size_t i = 1; i < inputs.size(); i++) {
+                std::ifstream other(inputs[i], std::ios::binary);
+                if (!other) {
+                    std::cerr << "Error opening file `" << inputs[i] << "` for reading.";
+                    return 1;
+                }
+                others.push_back(std::make_unique<Root>());
+                others.back()->size = 0;
+                others.back()->parse(other);
+                roots.push_back(others.back().get());
+            }
+            printConcatResult(std::cout, concatFiles(roots, inputs.empty() ? std::vector<std::string>{filepath} : inputs,
+                                                     concat_output));
+        }
+        if (!write_output.empty() || roundtrip) {
+            if (use_stdin) {
+                std::cerr << "--write and --roundtrip need a file input.";
+                return 1;
+            }
+        }
+        if (!write_output.empty()) {
+            SerializeStats written = serializeTreeToFile(root, filepath, write_output);
+            std::cout << "write: " << written.boxes << " boxes, " << written.bytes << " bytes ("
+                      << written.source_bytes << " copied from the source), " << written.segments << " segments, "
+                      << written.write_calls << " pwritev calls, " << written.copy_calls << " copy calls" << std::endl;
+        }
+        if (roundtrip) {
+            RoundTripReport report = checkRoundTrip(filepath);
+            printRoundTripReport(std::cout, report);
+            if (!report.same_bytes || !report.same_tree) {
+                return 2;
+            }
+        }
+        if (!tags.empty() || list_tags) {
+            if (use_stdin) {
+                std::cerr << "--tag and --tags need a file input.";
+                return 1;
+            }
+        }
+        if (!tags.empty()) {
+            printMetadataEditResult(std::cout, editMetadata(root, filepath, tags));
+        }
+        if (list_tags) {
+            printMetadata(std::cout, readMetadata(root, filepath));
+        }
+        if (validate) {
+            // taille réelle de l'entrée, lue jusqu'au bout si besoin
+            input->clear();
+            input->seekg(0, std::ios::end);
+            ValidationReport report = validateSampleTables(root, (uint64_t) input->tellg());
+            printValidationReport(std::cout, report);
+            if (!report.valid()) {
+                return 2;
+            }
+        }
+    } catch (const std::runtime_error& e) {
+        std::cerr << e.what();
+        return 1;
+    }
+    return 0;
+}
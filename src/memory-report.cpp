@@ -0,0 +1,181 @@
+// Bilan mémoire de l'arbre des boîtes (cf memory-report.hpp).
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <container-parser.hpp>
+#include <memory-report.hpp>
+#include <sample-table.hpp>
+
+
+// Ajoute l'allocation d'un vecteur.
+template<typename T>
+static void addVector(MemoryUsage& a_usage, const std::vector<T>& a_vector) {
+    a_usage.heap += a_vector.capacity() * sizeof(T);
+    a_usage.used += a_vector.size() * sizeof(T);
+}
+
+// Ajoute l'allocation d'une chaîne. Les chaînes courtes sont stockées dans
+// l'objet lui-même (small string optimization) et n'allouent rien.
+static void addString(MemoryUsage& a_usage, const std::string& a_string) {
+    const char *object = reinterpret_cast<const char*>(&a_string);
+    if (a_string.data() >= object && a_string.data() < object + sizeof(a_string)) {
+        return;
+    }
+    a_usage.heap += a_string.capacity() + 1; // zéro terminal compris
+    a_usage.used += a_string.size() + 1;
+}
+
+// Ajoute le tampon des chaînes d'une boîte, entièrement utilisé.
+static void addStrings(MemoryUsage& a_usage, const BoxStrings& a_strings) {
+    a_usage.heap += a_strings.size();
+    a_usage.used += a_strings.size();
+}
+
+// Allocations propres à chaque classe. La surcharge la plus dérivée est
+// choisie ; les boîtes sans vecteur ni chaîne n'ont rien à ajouter.
+static void addFields(MemoryUsage& /*usage*/, const Box& /*box*/) {}
+static void addFields(MemoryUsage& a_usage, const Ftyp& a_box) {
+    addVector(a_usage, a_box.compatible_brands);
+}
+static void addFields(MemoryUsage& a_usage, const Pdin& a_box) {
+    addVector(a_usage, a_box.rate);
+    addVector(a_usage, a_box.initial_delay);
+}
+static void addFields(MemoryUsage& a_usage, const Elst& a_box) {
+    addVector(a_usage, a_box.segment_duration);
+    addVector(a_usage, a_box.media_time);
+    addVector(a_usage, a_box.media_rate_integer);
+    addVector(a_usage, a_box.media_rate_fraction);
+}
+static void addFields(MemoryUsage& a_usage, const Hdlr& a_box) {
+    addStrings(a_usage, a_box.strings);
+}
+static void addFields(MemoryUsage& a_usage, const Url& a_box) {
+    addStrings(a_usage, a_box.strings);
+}
+static void addFields(MemoryUsage& a_usage, const Urn& a_box) {
+    addStrings(a_usage, a_box.strings);
+}
+static void addFields(MemoryUsage& a_usage, const VisualSampleEntry& a_box) {
+    addString(a_usage, a_box.compressorname);
+}
+static void addFields(MemoryUsage& a_usage, const Hvcc& a_box) {
+    addVector(a_usage, a_box.vps);
+    addVector(a_usage, a_box.sps);
+    addVector(a_usage, a_box.pps);
+    addVector(a_usage, a_box.record);
+}
+static void addFields(MemoryUsage& a_usage, const AudioSampleEntry& a_box) {
+    addVector(a_usage, a_box.qt_extension);
+}
+static void addFields(MemoryUsage& a_usage, const Esds& a_box) {
+    addVector(a_usage, a_box.descriptors);
+}
+static void addFields(MemoryUsage& a_usage, const Stts& a_box) {
+    addVector(a_usage, a_box.sample_count);
+    addVector(a_usage, a_box.sample_delta);
+}
+static void addFields(MemoryUsage& a_usage, const Ctts& a_box) {
+    addVector(a_usage, a_box.sample_count);
+    addVector(a_usage, a_box.sample_offset);
+}
+static void addFields(MemoryUsage& a_usage, const Stss& a_box) {
+    addVector(a_usage, a_box.sample_number);
+}
+static void addFields(MemoryUsage& a_usage, const Stsc& a_box) {
+    addVector(a_usage, a_box.first_chunk);
+    addVector(a_usage, a_box.samples_per_chunk);
+    addVector(a_usage, a_box.samples_description_index);
+}
+static void addFields(MemoryUsage& a_usage, const Stsz& a_box) {
+    addVector(a_usage, a_box.entry_size);
+}
+static void addFields(MemoryUsage& a_usage, const Stco& a_box) {
+    addVector(a_usage, a_box.chunk_offset);
+}
+
+MemoryUsage boxMemory(const Box& a_box) {
+    MemoryUsage usage;
+    visitBox(const_cast<Box&>(a_box), [&](const auto& a_typed) {
+        usage.objects = sizeof(a_typed);
+        addFields(usage, a_typed);
+    });
+    addVector(usage, a_box.getChildren());
+    return usage;
+}
+
+// Ajoute la mémoire d'une boîte et de ses descendants, par type de boîte.
+//     @box: la racine du sous-arbre
+//     @by_kind: cumuls indexés par BoxKind
+//     @total: cumul du sous-arbre
+static void addSubtree(const Box& a_box, std::vector<BoxTypeMemory>& a_by_kind, MemoryUsage& a_total) {
+    MemoryUsage usage = boxMemory(a_box);
+    size_t index = (size_t) a_box.kind;
+    if (index >= a_by_kind.size()) {
+        a_by_kind.resize(index + 1);
+    }
+    BoxTypeMemory& memory = a_by_kind[index];
+    memory.type = a_box.type;
+    memory.count++;
+    memory.usage.add(usage);
+    a_total.add(usage);
+    for (const std::unique_ptr<Box>& child : a_box.getChildren()) {
+        addSubtree(*child, a_by_kind, a_total);
+    }
+}
+
+MemoryReport memoryReport(const Root& a_root) {
+    MemoryReport report;
+    std::vector<BoxTypeMemory> by_kind;
+    addSubtree(a_root, by_kind, report.total);
+    for (const BoxTypeMemory& memory : by_kind) {
+        if (memory.count != 0) {
+            report.boxes.push_back(memory);
+        }
+    }
+    std::sort(report.boxes.begin(), report.boxes.end(),
+              [](const BoxTypeMemory& a, const BoxTypeMemory& b) { return a.usage.total() > b.usage.total(); });
+
+    for (const Trak *trak : findTracks(a_root)) {
+        TrackMemory track;
+        TrackBoxes boxes = findTrackBoxes(*trak);
+        if (boxes.tkhd != nullptr) track.track_ID = boxes.tkhd->track_ID;
+        if (boxes.hdlr != nullptr) track.handler_type = boxes.hdlr->handler_type;
+        std::vector<BoxTypeMemory> unused;
+        addSubtree(*trak, unused, track.usage);
+        report.tracks.push_back(track);
+    }
+    return report;
+}
+
+// Affiche une ligne de bilan : total, objets, allocations, part inutilisée.
+static void printUsage(std::ostream& a_outstream, const MemoryUsage& a_usage) {
+    a_outstream << std::setw(12) << a_usage.total()
+                << std::setw(12) << a_usage.objects
+                << std::setw(12) << a_usage.heap
+                << std::setw(12) << a_usage.wasted() << '\n';
+}
+
+void printMemoryReport(std::ostream& a_outstream, const MemoryReport& a_report) {
+    a_outstream << "type      count       total     objects        heap      wasted\n";
+    for (const BoxTypeMemory& memory : a_report.boxes) {
+        a_outstream << std::string(memory.type.data(), 4) << std::setw(11) << memory.count;
+        printUsage(a_outstream, memory.usage);
+    }
+    a_outstream << "all  " << std::setw(10) << "";
+    printUsage(a_outstream, a_report.total);
+
+    a_outstream << "\ntrack    hdlr         total     objects        heap      wasted\n";
+    for (const TrackMemory& track : a_report.tracks) {
+        char handler[4] = {char(track.handler_type >> 24), char(track.handler_type >> 16),
+                           char(track.handler_type >> 8),  char(track.handler_type)};
+        a_outstream << std::setw(5) << track.track_ID << "    " << std::string(handler, 4) << "  ";
+        printUsage(a_outstream, track.usage);
+    }
+}
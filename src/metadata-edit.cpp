@@ -0,0 +1,373 @@
+// Modification des métadonnées sans réécriture des échantillons (cf metadata-edit.hpp).
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <box-serializer.hpp>
+#include <box-writer.hpp>
+#include <container-parser.hpp>
+#include <metadata-edit.hpp>
+#include <sample-table.hpp>
+
+// Type de la boîte data d'un élément : texte UTF-8.
+constexpr uint32_t DATA_UTF8 = 1;
+
+// Élément de la liste ilst : sa clé et la boîte complète.
+struct IlstItem {
+    std::array<char, 4> key;
+    std::vector<char>   bytes;
+};
+
+static uint32_t loadU32(const char *a_data) {
+    const uint8_t *p = reinterpret_cast<const uint8_t*>(a_data);
+    return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | p[3];
+}
+
+// Découpe le contenu d'une boîte ilst en éléments.
+static std::vector<IlstItem> splitItems(const std::vector<char>& a_items) {
+    std::vector<IlstItem> items;
+    size_t position = 0;
+    while (position + 8 <= a_items.size()) {
+        uint64_t size = loadU32(a_items.data() + position);
+        if (size == 1 && position + 16 <= a_items.size()) {
+            size = uint64_t(loadU32(a_items.data() + position + 8)) << 32 | loadU32(a_items.data() + position + 12);
+        } else if (size == 0) {
+            size = a_items.size() - position;
+        }
+        if (size < 8 || size > a_items.size() - position) {
+            throw std::runtime_error("Malformed item in ilst box.");
+        }
+        IlstItem item;
+        std::copy(a_items.begin() + position + 4, a_items.begin() + position + 8, item.key.begin());
+        item.bytes.assign(a_items.begin() + position, a_items.begin() + position + size);
+        items.push_back(std::move(item));
+        position += size;
+    }
+    return items;
+}
+
+// Texte de la boîte data d'un élément.
+//     @return: vrai si l'élément contient du texte UTF-8
+static bool itemText(const IlstItem& a_item, std::string& a_text) {
+    size_t position = 8;
+    while (position + 16 <= a_item.bytes.size()) {
+        uint32_t size = loadU32(a_item.bytes.data() + position);
+        if (size < 8 || size > a_item.bytes.size() - position) {
+            return false;
+        }
+        if (std::string(a_item.bytes.data() + position + 4, 4) == "data" && size >= 16) {
+            if ((loadU32(a_item.bytes.data() + position + 8) & 0xFFFFFF) != DATA_UTF8) {
+                return false;
+            }
+            a_text.assign(a_item.bytes.data() + position + 16, size - 16);
+            return true;
+        }
+        position += size;
+    }
+    return false;
+}
+
+// Encode un élément texte : la boîte de la clé et sa boîte data.
+static IlstItem textItem(const MetadataTag& a_tag) {
+    BoxBuffer out;
+    size_t item = out.begin(a_tag.key);
+    size_t data = out.begin({'d', 'a', 't', 'a'});
+    out.u32(DATA_UTF8);
+    out.u32(0); // locale
+    out.bytes(a_tag.value.data(), a_tag.value.size());
+    out.end(data);
+    out.end(item);
+    return IlstItem{a_tag.key, std::vector<char>(out.data(), out.data() + out.size())};
+}
+
+// Contenu d'une boîte ilst lue dans le fichier.
+static std::vector<char> readItems(const Ilst& a_ilst, int a_fd) {
+    if (a_ilst.items_loaded) {
+        return a_ilst.items;
+    }
+    std::vector<char> items(a_ilst.size - a_ilst.header_size);
+    readAll(a_fd, items.data(), items.size(), a_ilst.offset + a_ilst.header_size);
+    return items;
+}
+
+static Ilst *findIlst(const Root& a_root) {
+    Box *moov = a_root.findChild({'m', 'o', 'o', 'v'});
+    Box *udta = moov != nullptr ? moov->findChild({'u', 'd', 't', 'a'}) : nullptr;
+    Box *meta = udta != nullptr ? udta->findChild({'m', 'e', 't', 'a'}) : nullptr;
+    return meta != nullptr ? static_cast<Ilst*>(meta->findChild({'i', 'l', 's', 't'})) : nullptr;
+}
+
+std::vector<MetadataTag> readMetadata(const Root& a_root, const std::string& a_path) {
+    std::vector<MetadataTag> tags;
+    const Ilst *ilst = findIlst(a_root);
+    if (ilst == nullptr) {
+        return tags;
+    }
+    FileDescriptor file(::open(a_path.c_str(), O_RDONLY));
+    if (!file.valid()) {
+        throw std::runtime_error("Cannot open file `" + a_path + "`.");
+    }
+    for (const IlstItem& item : splitItems(readItems(*ilst, file.get()))) {
+        std::string text;
+        if (itemText(item, text)) {
+            tags.push_back(MetadataTag{item.key, text});
+        }
+    }
+    return tags;
+}
+
+// Ajoute à une boîte un enfant construit en mémoire.
+template<typename T>
+static T *addBox(Box& a_parent) {
+    std::unique_ptr<Box> child = std::make_unique<T>();
+    T *box = static_cast<T*>(child.get());
+    box->setParent(&a_parent);
+    a_parent.addChild(child);
+    return box;
+}
+
+// Réécrit le champ taille de l'entête d'une boîte.
+static void patchSize(int a_fd, const Box& a_box, uint64_t a_size, MetadataEditResult& a_result) {
+    BoxBuffer out;
+    if (a_box.header_size == 16) {
+        out.u64(a_size);
+        writeAll(a_fd, out.data(), out.size(), a_box.offset + 8);
+    } else {
+        if (a_size > UINT32_MAX) {
+            throw std::runtime_error("Box `" + std::string(a_box.type.data(), 4) + "` outgrows its 32-bit size.");
+        }
+        out.u32(uint32_t(a_size));
+        writeAll(a_fd, out.data(), out.size(), a_box.offset);
+    }
+    a_result.bytes_written += out.size();
+    a_result.write_calls++;
+}
+
+// Vrai si une boîte free peut prendre cette taille : supprimée, ou au moins un entête.
+static bool freeFits(int64_t a_size) {
+    return a_size == 0 || (a_size >= 8 && a_size <= int64_t(UINT32_MAX)) || a_size >= 16;
+}
+
+// Décale les positions des chunks situés après `a_from`.
+//     @return: le nombre de positions décalées
+static uint64_t shiftChunks(const Root& a_root, uint64_t a_from, int64_t a_delta) {
+    uint64_t shifted = 0;
+    for (Trak *trak : findTracks(a_root)) {
+        TrackBoxes boxes = findTrackBoxes(*trak);
+        Stco *stco = boxes.stbl != nullptr ? static_cast<Stco*>(boxes.stbl->findChild({'s', 't', 'c', 'o'})) : nullptr;
+        if (stco == nullptr) {
+            continue;
+        }
+        for (uint32_t& offset : stco->chunk_offset) {
+            if (offset >= a_from) {
+                int64_t moved = int64_t(offset) + a_delta;
+                if (moved < 0 || moved > int64_t(UINT32_MAX)) {
+                    throw std::runtime_error("Chunk offset does not fit in 32 bits after moving moov.");
+                }
+                offset = uint32_t(moved);
+                shifted++;
+            }
+        }
+    }
+    return shifted;
+}
+
+MetadataEditResult editMetadata(Root& a_root, const std::string& a_path, const std::vector<MetadataTag>& a_tags) {
+    Box *moov = a_root.findChild({'m', 'o', 'o', 'v'});
+    if (moov == nullptr) {
+        throw std::runtime_error("Missing moov box.");
+    }
+    FileDescriptor file(::open(a_path.c_str(), O_RDWR));
+    if (!file.valid()) {
+        throw std::runtime_error("Cannot open file `" + a_path + "` for writing.");
+    }
+    struct stat status;
+    if (::fstat(file.get(), &status) != 0) {
+        throw std::runtime_error("Cannot stat file `" + a_path + "`.");
+    }
+    uint64_t file_size = status.st_size;
+    MetadataEditResult result;
+
+    // branche udta/meta/ilst, complétée si besoin ; `changed` est la plus
+    // profonde boîte déjà présente dans le fichier
+    Box *changed = moov;
+    Box *udta = moov->findChild({'u', 'd', 't', 'a'});
+    if (udta != nullptr) {
+        changed = udta;
+    } else {
+        udta = addBox<Udta>(*moov);
+    }
+    Box *meta = udta->findChild({'m', 'e', 't', 'a'});
+    if (meta != nullptr) {
+        changed = meta;
+    } else {
+        meta = addBox<Meta>(*udta);
+        Hdlr *hdlr = addBox<Hdlr>(*meta);
+        hdlr->handler_type = 'm' << 24 | 'd' << 16 | 'i' << 8 | 'r';
+        hdlr->reserved = {'a', 'p', 'p', 'l'};
+    }
+    Ilst *ilst = static_cast<Ilst*>(meta->findChild({'i', 'l', 's', 't'}));
+    std::vector<IlstItem> items;
+    if (ilst != nullptr) {
+        changed = ilst;
+        result.ilst_size_before = ilst->size;
+        items = splitItems(readItems(*ilst, file.get()));
+    } else {
+        ilst = addBox<Ilst>(*meta);
+    }
+
+    // éléments remplacés, supprimés ou ajoutés en fin de liste
+    for (const MetadataTag& tag : a_tags) {
+        size_t i = 0;
+        while (i < items.size() && items[i].key != tag.key) {
+            i++;
+        }
+        if (tag.value.empty()) {
+            if (i < items.size()) {
+                items.erase(items.begin() + i);
+            }
+        } else if (i < items.size()) {
+            items[i] = textItem(tag);
+        } else {
+            items.push_back(textItem(tag));
+        }
+    }
+    ilst->items.clear();
+    for (const IlstItem& item : items) {
+        ilst->items.insert(ilst->items.end(), item.bytes.begin(), item.bytes.end());
+    }
+    ilst->items_loaded = true;
+    result.ilst_size_after = 8 + ilst->items.size();
+
+    std::vector<char> region = serializeBox(*changed, file.get());
+    int64_t delta = int64_t(region.size()) - int64_t(changed->size);
+
+    // la variation remonte jusqu'à la première boîte qui peut l'absorber
+    Box *level = changed;
+    int64_t free_size = 0;
+    while (delta != 0) {
+        Box *parent = level->getParent();
+        const std::vector<std::unique_ptr<Box>>& siblings = parent->getChildren();
+        size_t index = 0;
+        while (siblings[index].get() != level) {
+            index++;
+        }
+        const Box *next = index + 1 < siblings.size() ? siblings[index + 1].get() : nullptr;
+        if (next != nullptr && next->kind == BoxKind::Free) {
+            uint64_t size = next->size != 0 ? next->size : file_size - next->offset;
+            if (freeFits(int64_t(size) - delta)) {
+                result.free_before = size;
+                free_size = int64_t(size) - delta;
+                break;
+            }
+        }
+        if (delta <= -8) {
+            free_size = -delta;
+            break;
+        }
+        if (parent == &a_root) {
+            result.placement = level->offset + level->size == file_size ? MetadataPlacement::EndOfFile
+                                                                        : MetadataPlacement::Rewritten;
+            break;
+        }
+        level = parent;
+    }
+    result.resized = level->type;
+    result.free_after = free_size;
+
+    if (result.placement == MetadataPlacement::Rewritten) {
+        // moov agrandi devant d'autres boîtes : tout ce qui le suit est décalé
+        result.shifted_chunks = shiftChunks(a_root, moov->offset + moov->size, delta);
+        // copie unique dans le même répertoire, aux droits du fichier, renommée à la fin
+        std::string temporary = a_path + ".XXXXXX";
+        FileDescriptor output(::mkstemp(&temporary[0]));
+        if (!output.valid()) {
+            throw std::runtime_error("Cannot create file `" + temporary + "`.");
+        }
+        try {
+            if (::fchmod(output.get(), status.st_mode & 07777) != 0) {
+                throw std::runtime_error("Cannot set mode of file `" + temporary + "`.");
+            }
+            SerializeStats stats = serializeTree(a_root, file.get(), output.get());
+            result.bytes_written = stats.bytes;
+            result.write_calls = stats.write_calls + stats.copy_calls;
+        } catch (...) {
+            std::remove(temporary.c_str());
+            throw;
+        }
+        if (std::rename(temporary.c_str(), a_path.c_str()) != 0) {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("Cannot replace file `" + a_path + "`.");
+        }
+        return result;
+    }
+
+    // la boîte modifiée, ce qui la suit dans `level`, puis l'entête de la boîte free
+    uint64_t changed_end = changed->offset + changed->size;
+    uint64_t level_end   = level->offset + level->size;
+    size_t length = region.size();
+    region.resize(length + (level_end - changed_end));
+    readAll(file.get(), region.data() + length, level_end - changed_end, changed_end);
+    if (free_size > 0) {
+        BoxBuffer header;
+        if (free_size <= int64_t(UINT32_MAX)) {
+            header.u32(uint32_t(free_size));
+            header.bytes("free", 4);
+        } else {
+            header.u32(1);
+            header.bytes("free", 4);
+            header.u64(uint64_t(free_size));
+        }
+        region.insert(region.end(), header.data(), header.data() + header.size());
+    }
+    writeAll(file.get(), region.data(), region.size(), changed->offset);
+    result.bytes_written += region.size();
+    result.write_calls++;
+    for (Box *box = changed->getParent(); box != level->getParent(); box = box->getParent()) {
+        patchSize(file.get(), *box, box->size + delta, result);
+    }
+    if (result.placement == MetadataPlacement::EndOfFile && delta < 0
+        && ::ftruncate(file.get(), file_size + delta) != 0) {
+        throw std::runtime_error("Cannot truncate file `" + a_path + "`.");
+    }
+    return result;
+}
+
+// Clé affichable : '©' pour l'octet 0xA9 des clés iTunes.
+static std::string keyText(const std::array<char, 4>& a_key) {
+    std::string text;
+    for (char c : a_key) {
+        text += uint8_t(c) == 0xA9 ? std::string("\xC2\xA9") : std::string(1, c);
+    }
+    return text;
+}
+
+void printMetadata(std::ostream& a_outstream, const std::vector<MetadataTag>& a_tags) {
+    for (const MetadataTag& tag : a_tags) {
+        a_outstream << keyText(tag.key) << ": " << tag.value << '\n';
+    }
+}
+
+void printMetadataEditResult(std::ostream& a_outstream, const MetadataEditResult& a_result) {
+    static const char *const PLACEMENTS[] = {"in place", "at the end of the file", "by rewriting the file"};
+    a_outstream << "metadata: ilst " << a_result.ilst_size_before << " -> " << a_result.ilst_size_after
+                << " bytes, written " << PLACEMENTS[int(a_result.placement)] << " ("
+                << std::string(a_result.resized.data(), 4) << " resized";
+    if (a_result.free_before > 0 || a_result.free_after > 0) {
+        a_outstream << ", free " << a_result.free_before << " -> " << a_result.free_after;
+    }
+    if (a_result.placement == MetadataPlacement::Rewritten) {
+        a_outstream << ", " << a_result.shifted_chunks << " chunk offsets shifted";
+    }
+    a_outstream << "), " << a_result.bytes_written << " bytes in " << a_result.write_calls << " writes\n";
+}
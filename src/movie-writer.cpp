@@ -0,0 +1,476 @@
+// Écriture d'un fichier mp4 à partir d'échantillons de fichiers sources (cf movie-writer.hpp).
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+
+#include <box-writer.hpp>
+#include <container-parser.hpp>
+#include <movie-writer.hpp>
+#include <sample-table.hpp>
+
+
+// Chunk du fichier écrit : échantillons consécutifs d'une piste, de même chunk d'origine.
+struct OutputChunk {
+    uint32_t track;        // indice dans les pistes écrites
+    uint32_t first_sample; // indice dans OutputTrack::samples
+    uint32_t sample_count;
+    uint32_t source;
+    uint32_t description;
+    uint64_t source_offset; // position du premier échantillon dans sa source
+    uint64_t size;
+    uint64_t offset;       // position dans le fichier écrit
+    double   start;        // instant de décodage du premier échantillon (s)
+};
+
+// État de l'écriture de `moov`.
+struct MoovWriter {
+    BoxBuffer& out;
+    int        source;                        // fichier de l'arbre, pour les boîtes recopiées
+    const std::vector<OutputTrack>& tracks;
+    const std::vector<OutputChunk>& chunks;   // regroupés par piste, dans l'ordre de décodage
+    std::vector<size_t>   chunk_begin;        // premier chunk de chaque piste
+    std::vector<uint64_t> media_durations;    // échelle de temps du média
+    std::vector<uint64_t> track_durations;    // échelle de temps du film
+    uint64_t              movie_duration = 0;
+};
+
+// Recopie une boîte du fichier source, entête compris.
+//     @return: la position de la boîte dans le tampon
+static size_t copyBox(MoovWriter& a_writer, const Box& a_box) {
+    size_t position = a_writer.out.size();
+    std::vector<char> bytes(a_box.size);
+    readAll(a_writer.source, bytes.data(), bytes.size(), a_box.offset);
+    a_writer.out.bytes(bytes.data(), bytes.size());
+    return position;
+}
+
+// Recopie une boîte mvhd, tkhd ou mdhd en remplaçant sa durée.
+//     @skip: octets entre les dates et la durée (timescale, track_ID...)
+static void copyWithDuration(MoovWriter& a_writer, const FullBox& a_box, size_t a_skip, uint64_t a_duration) {
+    size_t position = copyBox(a_writer, a_box);
+    size_t field = position + a_box.header_size + 4 + (a_box.version == 1 ? 16 : 8) + a_skip;
+    if (a_box.version == 1) {
+        a_writer.out.patch(field, a_duration, 8);
+    } else if (a_duration <= UINT32_MAX) {
+        a_writer.out.patch(field, a_duration, 4);
+    } else {
+        throw std::runtime_error("Duration does not fit a version 0 box.");
+    }
+}
+
+static void writeElst(MoovWriter& a_writer, const OutputTrack& a_track) {
+    bool large = false;
+    for (const EditEntry& edit : a_track.edits) {
+        large = large || edit.segment_duration > UINT32_MAX || edit.media_time > INT32_MAX;
+    }
+    BoxBuffer& out = a_writer.out;
+    size_t position = out.beginFull({'e', 'l', 's', 't'}, large ? 1 : 0);
+    out.u32(a_track.edits.size());
+    for (const EditEntry& edit : a_track.edits) {
+        if (large) {
+            out.u64(edit.segment_duration);
+            out.u64(uint64_t(edit.media_time));
+        } else {
+            out.u32(uint32_t(edit.segment_duration));
+            out.u32(uint32_t(int32_t(edit.media_time)));
+        }
+        out.u16(1); // media_rate_integer
+        out.u16(0); // media_rate_fraction
+    }
+    out.end(position);
+}
+
+static void writeStts(MoovWriter& a_writer, const OutputTrack& a_track) {
+    std::vector<std::pair<uint32_t, uint32_t>> entries; // nombre, durée
+    for (const OutputSample& sample : a_track.samples) {
+        if (!entries.empty() && entries.back().second == sample.delta) {
+            entries.back().first++;
+        } else {
+            entries.emplace_back(1, sample.delta);
+        }
+    }
+    BoxBuffer& out = a_writer.out;
+    size_t position = out.beginFull({'s', 't', 't', 's'}, 0);
+    out.u32(entries.size());
+    for (const auto& entry : entries) {
+        out.u32(entry.first);
+        out.u32(entry.second);
+    }
+    out.end(position);
+}
+
+// Écrit ctts si un échantillon a un décalage de composition, en version 1
+// (décalages signés) si l'un d'eux est négatif.
+static void writeCtts(MoovWriter& a_writer, const OutputTrack& a_track) {
+    std::vector<std::pair<uint32_t, int32_t>> entries; // nombre, décalage
+    bool negative = false;
+    bool shifted  = false;
+    for (const OutputSample& sample : a_track.samples) {
+        negative = negative || sample.composition < 0;
+        shifted  = shifted  || sample.composition != 0;
+        if (!entries.empty() && entries.back().second == sample.composition) {
+            entries.back().first++;
+        } else {
+            entries.emplace_back(1, sample.composition);
+        }
+    }
+    if (!shifted) {
+        return;
+    }
+    BoxBuffer& out = a_writer.out;
+    size_t position = out.beginFull({'c', 't', 't', 's'}, negative ? 1 : 0);
+    out.u32(entries.size());
+    for (const auto& entry : entries) {
+        out.u32(entry.first);
+        out.u32(uint32_t(entry.second));
+    }
+    out.end(position);
+}
+
+static void writeStss(MoovWriter& a_writer, const OutputTrack& a_track) {
+    BoxBuffer& out = a_writer.out;
+    size_t position = out.beginFull({'s', 't', 's', 's'}, 0);
+    size_t count_position = out.size();
+    out.u32(0);
+    uint32_t count = 0;
+    for (size_t i = 0; i < a_track.samples.size(); i++) {
+        if (a_track.samples[i].sync) {
+            out.u32(i + 1);
+            count++;
+        }
+    }
+    out.patch(count_position, count, 4);
+    out.end(position);
+}
+
+static void writeStsc(MoovWriter& a_writer, size_t a_track) {
+    BoxBuffer& out = a_writer.out;
+    size_t position = out.beginFull({'s', 't', 's', 'c'}, 0);
+    size_t count_position = out.size();
+    out.u32(0);
+    uint32_t count = 0;
+    const OutputChunk *previous = nullptr;
+    size_t end = a_track+1 < a_writer.chunk_begin.size() ? a_writer.chunk_begin[a_track+1] : a_writer.chunks.size();
+    for (size_t c = a_writer.chunk_begin[a_track]; c < end; c++) {
+        const OutputChunk& chunk = a_writer.chunks[c];
+        if (previous == nullptr || chunk.sample_count != previous->sample_count
+            || chunk.description != previous->description) {
+            out.u32(c - a_writer.chunk_begin[a_track] + 1);
+            out.u32(chunk.sample_count);
+            out.u32(chunk.description);
+            count++;
+        }
+        previous = &chunk;
+    }
+    out.patch(count_position, count, 4);
+    out.end(position);
+}
+
+static void writeStsz(MoovWriter& a_writer, const OutputTrack& a_track, const Stsz& a_source) {
+    bool constant = a_source.sample_size != 0;
+    for (const OutputSample& sample : a_track.samples) {
+        constant = constant && sample.size == a_source.sample_size;
+    }
+    BoxBuffer& out = a_writer.out;
+    size_t position = out.beginFull({'s', 't', 's', 'z'}, 0);
+    out.u32(constant ? a_source.sample_size : 0);
+    out.u32(a_track.samples.size());
+    if (!constant) {
+        for (const OutputSample& sample : a_track.samples) {
+            out.u32(sample.size);
+        }
+    }
+    out.end(position);
+}
+
+static void writeStco(MoovWriter& a_writer, size_t a_track) {
+    BoxBuffer& out = a_writer.out;
+    size_t position = out.beginFull({'s', 't', 'c', 'o'}, 0);
+    size_t end = a_track+1 < a_writer.chunk_begin.size() ? a_writer.chunk_begin[a_track+1] : a_writer.chunks.size();
+    out.u32(end - a_writer.chunk_begin[a_track]);
+    for (size_t c = a_writer.chunk_begin[a_track]; c < end; c++) {
+        if (a_writer.chunks[c].offset > UINT32_MAX) {
+            throw std::runtime_error("Chunk offset beyond 4 GiB (co64 not supported).");
+        }
+        out.u32(a_writer.chunks[c].offset);
+    }
+    out.end(position);
+}
+
+// Écrit une boîte de `moov` et ses descendants.
+//     @track: indice de la piste écrite contenant la boîte, -1 hors d'une piste
+static void writeMoovBox(MoovWriter& a_writer, const Box& a_box, int a_track) {
+    BoxBuffer& out = a_writer.out;
+    const OutputTrack *track = a_track >= 0 ? &a_writer.tracks[a_track] : nullptr;
+    switch (a_box.kind) {
+    case BoxKind::Moov: {
+        size_t position = out.begin(a_box.type);
+        for (const std::unique_ptr<Box>& child : a_box.getChildren()) {
+            int index = -1;
+            if (child->kind == BoxKind::Trak) {
+                for (size_t t = 0; t < a_writer.tracks.size(); t++) {
+                    if (a_writer.tracks[t].trak == child.get()) {
+                        index = t;
+                    }
+                }
+                if (index < 0) {
+                    continue; // piste non écrite
+                }
+            }
+            writeMoovBox(a_writer, *child, index);
+        }
+        out.end(position);
+        return;
+    }
+    case BoxKind::Edts:
+        if (track == nullptr || track->edits.empty()) {
+            return;
+        }
+        [[fallthrough]];
+    case BoxKind::Trak:
+    case BoxKind::Mdia:
+    case BoxKind::Minf: {
+        size_t position = out.begin(a_box.type);
+        for (const std::unique_ptr<Box>& child : a_box.getChildren()) {
+            writeMoovBox(a_writer, *child, a_track);
+        }
+        out.end(position);
+        return;
+    }
+    case BoxKind::Stbl: {
+        // les autres boîtes (sdtp, sbgp, sgpd...) sont indexées par les
+        // échantillons de la source : recopiées, elles ne décriraient plus
+        // ceux de la piste écrite
+        size_t position = out.begin(a_box.type);
+        for (const std::unique_ptr<Box>& child : a_box.getChildren()) {
+            switch (child->kind) {
+            case BoxKind::Stsd:
+            case BoxKind::Stss:
+            case BoxKind::Stsc:
+            case BoxKind::Stsz:
+            case BoxKind::Stco:
+                writeMoovBox(a_writer, *child, a_track);
+                break;
+            case BoxKind::Stts:
+                writeStts(a_writer, *track);
+                writeCtts(a_writer, *track);
+                break;
+            case BoxKind::Ctts:
+                break; // écrite après stts
+            default:
+                throw std::runtime_error("Sample table box `" + std::string(child->type.data(), 4)
+                                         + "` cannot be rewritten.");
+            }
+        }
+        out.end(position);
+        return;
+    }
+    case BoxKind::Mvhd:
+        copyWithDuration(a_writer, static_cast<const Mvhd&>(a_box), 4, a_writer.movie_duration);
+        return;
+    case BoxKind::Tkhd:
+        copyWithDuration(a_writer, static_cast<const Tkhd&>(a_box), 8, a_writer.track_durations[a_track]);
+        return;
+    case BoxKind::Mdhd:
+        copyWithDuration(a_writer, static_cast<const Mdhd&>(a_box), 4, a_writer.media_durations[a_track]);
+        return;
+    case BoxKind::Elst: writeElst(a_writer, *track); return;
+    case BoxKind::Stss: writeStss(a_writer, *track); return;
+    case BoxKind::Stsc: writeStsc(a_writer, a_track); return;
+    case BoxKind::Stsz: writeStsz(a_writer, *track, static_cast<const Stsz&>(a_box)); return;
+    case BoxKind::Stco: writeStco(a_writer, a_track); return;
+    default:
+        copyBox(a_writer, a_box);
+        return;
+    }
+}
+
+// Durée convertie d'une échelle de temps à une autre, arrondie au plus proche.
+static uint64_t rescale(uint64_t a_value, uint32_t a_from, uint32_t a_to) {
+    return a_value / a_from * a_to + (a_value % a_from * a_to + a_from / 2) / a_from;
+}
+
+OutputTrack copyTrack(const Trak& a_trak, uint32_t a_source) {
+    OutputTrack track;
+    track.trak = &a_trak;
+    SampleCursor cursor(a_trak);
+    track.samples.reserve(cursor.sampleCount());
+    uint64_t previous_dts = 0;
+    for (; !cursor.done(); cursor.next()) {
+        const SampleInfo& sample = cursor.sample();
+        if (!track.samples.empty()) {
+            track.samples.back().delta = uint32_t(sample.dts - previous_dts);
+        }
+        track.samples.push_back(OutputSample{sample.offset, sample.size, 0, cursor.compositionOffset(), a_source,
+                                             cursor.chunk(), cursor.descriptionIndex(), sample.sync != 0});
+        previous_dts = sample.dts;
+    }
+    if (!track.samples.empty()) {
+        track.samples.back().delta = uint32_t(cursor.endDts() - previous_dts);
+    }
+    Box *edts = a_trak.findChild({'e', 'd', 't', 's'});
+    const Elst *elst = edts != nullptr ? static_cast<const Elst*>(edts->findChild({'e', 'l', 's', 't'})) : nullptr;
+    for (uint32_t i = 0; elst != nullptr && i < elst->entry_count; i++) {
+        track.edits.push_back(EditEntry{elst->segment_duration[i], elst->media_time[i]});
+    }
+    return track;
+}
+
+MovieLayout layoutMovie(const Root& a_root, int a_boxes_source, const std::vector<OutputTrack>& a_tracks,
+                        ChunkOrder a_order) {
+    const Box *moov = a_root.findChild({'m', 'o', 'o', 'v'});
+    const Mvhd *mvhd = moov != nullptr ? static_cast<const Mvhd*>(moov->findChild({'m', 'v', 'h', 'd'})) : nullptr;
+    if (mvhd == nullptr || mvhd->timescale == 0) {
+        throw std::runtime_error("Missing moov or mvhd in source.");
+    }
+
+    // chunks et durées
+    std::vector<OutputChunk> chunks;
+    std::vector<size_t> chunk_begin;
+    std::vector<uint64_t> media_durations, track_durations;
+    uint64_t movie_duration = 0;
+    for (uint32_t t = 0; t < a_tracks.size(); t++) {
+        const OutputTrack& track = a_tracks[t];
+        TrackBoxes boxes = findTrackBoxes(*track.trak);
+        if (boxes.mdhd == nullptr || boxes.mdhd->timescale == 0 || boxes.stsz == nullptr) {
+            throw std::runtime_error("Missing mdhd or stsz in source track.");
+        }
+        chunk_begin.push_back(chunks.size());
+        uint64_t media_duration = 0;
+        for (uint32_t i = 0; i < track.samples.size(); i++) {
+            const OutputSample& sample = track.samples[i];
+            if (i > 0 && chunks.back().source == sample.source && chunks.back().description == sample.description
+                && track.samples[i-1].source_chunk == sample.source_chunk) {
+                chunks.back().sample_count++;
+                chunks.back().size += sample.size;
+            } else {
+                chunks.push_back(OutputChunk{t, i, 1, sample.source, sample.description, sample.offset, sample.size, 0,
+                                             double(media_duration) / boxes.mdhd->timescale});
+            }
+            media_duration += sample.delta;
+        }
+        uint64_t track_duration = 0;
+        for (const EditEntry& edit : track.edits) {
+            track_duration += edit.segment_duration;
+        }
+        if (track.edits.empty()) {
+            track_duration = rescale(media_duration, boxes.mdhd->timescale, mvhd->timescale);
+        }
+        media_durations.push_back(media_duration);
+        track_durations.push_back(track_duration);
+        movie_duration = std::max(movie_duration, track_duration);
+    }
+
+    // disposition : chunks dans l'ordre des sources, ou dans l'ordre de décodage
+    std::vector<size_t> order(chunks.size());
+    for (size_t c = 0; c < order.size(); c++) {
+        order[c] = c;
+    }
+    if (a_order == ChunkOrder::Source) {
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return chunks[a].source != chunks[b].source ? chunks[a].source < chunks[b].source
+                                                        : chunks[a].source_offset < chunks[b].source_offset;
+        });
+    } else {
+        std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+            return chunks[a].start != chunks[b].start ? chunks[a].start < chunks[b].start
+                                                      : chunks[a].track < chunks[b].track;
+        });
+    }
+    uint64_t payload = 0;
+    for (const OutputChunk& chunk : chunks) {
+        payload += chunk.size;
+    }
+
+    MovieLayout layout;
+    BoxBuffer& head = layout.head;
+    MovieWriteStats& stats = layout.stats;
+    const Box *ftyp = a_root.findChild({'f', 't', 'y', 'p'});
+    {
+        // taille de moov : indépendante des positions, les entrées de stco étant sur 32 bits
+        BoxBuffer probe;
+        MoovWriter writer{probe, a_boxes_source, a_tracks, chunks, chunk_begin, media_durations, track_durations,
+                          movie_duration};
+        writeMoovBox(writer, *moov, -1);
+        stats.moov_size = probe.size();
+    }
+    uint64_t mdat_header = payload + 8 <= UINT32_MAX ? 8 : 16;
+    uint64_t position = (ftyp != nullptr ? ftyp->size : 0) + stats.moov_size + mdat_header;
+    for (size_t c : order) {
+        chunks[c].offset = position;
+        position += chunks[c].size;
+    }
+
+    MoovWriter writer{head, a_boxes_source, a_tracks, chunks, chunk_begin, media_durations, track_durations,
+                      movie_duration};
+    if (ftyp != nullptr) {
+        copyBox(writer, *ftyp);
+    }
+    writeMoovBox(writer, *moov, -1);
+    if (mdat_header == 8) {
+        head.u32(payload + 8);
+        head.bytes("mdat", 4);
+    } else {
+        head.u32(1);
+        head.bytes("mdat", 4);
+        head.u64(payload + 16);
+    }
+    stats.mdat_size = payload + mdat_header;
+    stats.file_size = head.size() + payload;
+
+    // plages contiguës d'une même source, copiées en une fois
+    for (size_t c : order) {
+        const OutputChunk& chunk = chunks[c];
+        const OutputTrack& track = a_tracks[chunk.track];
+        uint64_t offset = chunk.offset;
+        for (uint32_t i = chunk.first_sample; i < chunk.first_sample + chunk.sample_count; i++) {
+            const OutputSample& sample = track.samples[i];
+            PayloadRun *run = layout.runs.empty() ? nullptr : &layout.runs.back();
+            if (run != nullptr && run->source == sample.source && run->source_offset + run->size == sample.offset
+                && run->offset + run->size == offset) {
+                run->size += sample.size;
+            } else {
+                layout.runs.push_back(PayloadRun{sample.source, sample.offset, sample.size, offset});
+            }
+            offset += sample.size;
+        }
+    }
+    return layout;
+}
+
+MovieWriteStats writeMovie(const Root& a_root, const std::vector<int>& a_sources,
+                           const std::vector<OutputTrack>& a_tracks, const std::string& a_output,
+                           ChunkOrder a_order) {
+    if (a_sources.empty()) {
+        throw std::runtime_error("No source file.");
+    }
+    for (int source : a_sources) {
+        if (sameFile(source, a_output)) {
+            throw std::runtime_error("Output file `" + a_output + "` is a source file.");
+        }
+    }
+    MovieLayout layout = layoutMovie(a_root, a_sources[0], a_tracks, a_order);
+    MovieWriteStats stats = layout.stats;
+
+    FileDescriptor out(::open(a_output.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+    if (!out.valid()) {
+        throw std::runtime_error("Cannot create file `" + a_output + "`.");
+    }
+    writeAll(out.get(), layout.head.data(), layout.head.size(), 0);
+    for (const PayloadRun& run : layout.runs) {
+        stats.copy_calls += copyFileRange(a_sources[run.source], run.source_offset, out.get(), run.offset, run.size);
+        stats.copy_runs++;
+        stats.copied_bytes += run.size;
+    }
+    if (!out.close()) {
+        throw std::runtime_error("Error closing file `" + a_output + "`.");
+    }
+    return stats;
+}
@@ -0,0 +1,49 @@
+// Traitement de tâches indépendantes par un groupe de threads (cf parallel.hpp).
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <parallel.hpp>
+
+
+unsigned runParallel(size_t a_count, unsigned a_threads, const std::function<ParallelJob()>& a_make_job) {
+    std::atomic<size_t> next{0};
+    std::atomic<bool>   failed{false};
+    std::exception_ptr  error;
+    std::mutex          error_mutex;
+    auto worker = [&]() {
+        try {
+            ParallelJob job = a_make_job();
+            for (size_t i = next++; i < a_count && !failed; i = next++) {
+                job(i);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+            failed = true;
+        }
+    };
+
+    unsigned threads = a_threads != 0 ? a_threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::max<unsigned>(1, std::min<size_t>(threads, a_count));
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < threads; i++) {
+        pool.emplace_back(worker);
+    }
+    worker(); // le thread appelant participe
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+    return threads;
+}
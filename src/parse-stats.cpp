@@ -0,0 +1,80 @@
+// Statistiques d'analyse par type de boîte (cf parse-stats.hpp).
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <ios>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <parse-stats.hpp>
+
+
+void ParseStats::merge(const ParseStats& a_other) {
+    for (const BoxTypeStats& other : a_other.boxes) {
+        auto it = std::find_if(boxes.begin(), boxes.end(),
+                               [&](const BoxTypeStats& s) { return s.type == other.type; });
+        if (it == boxes.end()) {
+            boxes.push_back(other);
+            continue;
+        }
+        it->count         += other.count;
+        it->bytes         += other.bytes;
+        it->decoded_bytes += other.decoded_bytes;
+        it->parse_ns      += other.parse_ns;
+        it->seeks         += other.seeks;
+    }
+    headers   += a_other.headers;
+    header_ns += a_other.header_ns;
+    std::sort(boxes.begin(), boxes.end(),
+              [](const BoxTypeStats& a, const BoxTypeStats& b) { return a.parse_ns > b.parse_ns; });
+}
+
+ParseCounters& parseCounters() {
+    static thread_local ParseCounters counters;
+    return counters;
+}
+
+ParseStats parseStats() {
+    const ParseCounters& counters = parseCounters();
+    ParseStats stats;
+    for (const auto& entry : counters.by_type) {
+        stats.boxes.push_back(entry.second);
+    }
+    stats.headers   = counters.headers;
+    stats.header_ns = counters.header_ns;
+    std::sort(stats.boxes.begin(), stats.boxes.end(),
+              [](const BoxTypeStats& a, const BoxTypeStats& b) { return a.parse_ns > b.parse_ns; });
+    return stats;
+}
+
+void resetParseStats() {
+    bool timed = parseCounters().timed;
+    parseCounters() = ParseCounters();
+    parseCounters().timed = timed;
+}
+
+void setParseTiming(bool a_enabled) {
+    parseCounters().timed = a_enabled;
+}
+
+void printParseStats(std::ostream& a_outstream, const ParseStats& a_stats) {
+    std::ios_base::fmtflags flags = a_outstream.flags();
+    std::streamsize precision = a_outstream.precision();
+    a_outstream << "type      count        bytes      decoded   parse (us)    seeks\n";
+    for (const BoxTypeStats& box : a_stats.boxes) {
+        a_outstream << std::string(box.type.data(), 4)
+                    << std::setw(11) << box.count
+                    << std::setw(13) << box.bytes
+                    << std::setw(13) << box.decoded_bytes
+                    << std::setw(13) << std::fixed << std::setprecision(1) << box.parse_ns / 1000.
+                    << std::setw(9)  << box.seeks << '\n';
+    }
+    a_outstream << "headers"
+                << std::setw(8) << a_stats.headers
+                << std::setw(39) << std::fixed << std::setprecision(1) << a_stats.header_ns / 1000.
+                << '\n';
+    a_outstream.flags(flags);
+    a_outstream.precision(precision);
+}
@@ -0,0 +1,77 @@
+// Export de la chronologie de l'analyse (cf parse-trace.hpp).
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string_view>
+
+#include <parse-trace.hpp>
+
+
+// Identifiant du thread appelant dans la trace, attribué au premier évènement.
+static uint32_t traceThreadId() {
+    static std::atomic<uint32_t> next_id{1};
+    static thread_local uint32_t id = next_id++;
+    return id;
+}
+
+TraceWriter::TraceWriter(std::ostream& a_out)
+    : m_writer(a_out), m_epoch(std::chrono::steady_clock::now()) {
+    m_writer << "{\"traceEvents\":[";
+}
+
+TraceWriter::~TraceWriter() {
+    if (s_active == this) {
+        s_active = nullptr;
+    }
+    m_writer << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+void TraceWriter::complete(std::string_view a_name, const char *a_category,
+                           std::chrono::steady_clock::time_point a_beg,
+                           std::chrono::steady_clock::time_point a_end, const BoxArgs *a_box) {
+    uint64_t beg = std::chrono::duration_cast<std::chrono::nanoseconds>(a_beg - m_epoch).count();
+    uint64_t dur = std::chrono::duration_cast<std::chrono::nanoseconds>(a_end - a_beg).count();
+    uint32_t tid = traceThreadId();
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_writer << (m_first ? "\n{\"name\":" : ",\n{\"name\":");
+    m_first = false;
+    writeString(a_name);
+    m_writer << ",\"cat\":\"" << a_category << "\",\"ph\":\"X\",\"ts\":";
+    writeMicros(beg);
+    m_writer << ",\"dur\":";
+    writeMicros(dur);
+    m_writer << ",\"pid\":1,\"tid\":" << tid;
+    if (a_box != nullptr) {
+        m_writer << ",\"args\":{\"type\":";
+        writeString(std::string_view(a_box->type.data(), 4));
+        m_writer << ",\"offset\":" << a_box->offset << ",\"size\":" << a_box->size << '}';
+    }
+    m_writer << '}';
+}
+
+void TraceWriter::writeString(std::string_view a_str) {
+    static const char hex[] = "0123456789abcdef";
+    m_writer << '"';
+    for (char c : a_str) {
+        uint8_t u = (uint8_t) c;
+        if (c == '"' || c == '\\') {
+            m_writer << '\\' << c;
+        } else if (u < 0x20 || u >= 0x7f) { // les types de boîtes ne sont pas forcément de l'ASCII
+            m_writer << "\\u00" << hex[u >> 4] << hex[u & 0xf];
+        } else {
+            m_writer << c;
+        }
+    }
+    m_writer << '"';
+}
+
+void TraceWriter::writeMicros(uint64_t a_ns) {
+    uint64_t frac = a_ns % 1000;
+    m_writer << a_ns / 1000 << '.'
+             << char('0' + frac / 100) << char('0' + frac / 10 % 10) << char('0' + frac % 10);
+}
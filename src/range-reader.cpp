@@ -0,0 +1,190 @@
+// Lecture par plages d'octets (cf range-reader.hpp).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <range-reader.hpp>
+
+
+FileRangeReader::FileRangeReader(const std::string& a_path) {
+    m_fd = ::open(a_path.c_str(), O_RDONLY);
+    if (m_fd < 0) {
+        throw std::runtime_error("Cannot open file `" + a_path + "`.");
+    }
+    struct stat status;
+    if (::fstat(m_fd, &status) != 0) {
+        ::close(m_fd);
+        throw std::runtime_error("Cannot stat file `" + a_path + "`.");
+    }
+    m_size = status.st_size;
+}
+
+FileRangeReader::~FileRangeReader() {
+    ::close(m_fd);
+}
+
+size_t FileRangeReader::read(uint64_t a_offset, char *a_buffer, size_t a_size) {
+    size_t done = 0;
+    while (done < a_size) {
+        ssize_t n = ::pread(m_fd, a_buffer + done, a_size - done, a_offset + done);
+        if (n < 0) {
+            throw std::runtime_error("Error reading file range.");
+        }
+        if (n == 0) {
+            break;
+        }
+        done += n;
+    }
+    return done;
+}
+
+size_t LatencyRangeReader::read(uint64_t a_offset, char *a_buffer, size_t a_size) {
+    std::this_thread::sleep_for(m_latency);
+    return m_source->read(a_offset, a_buffer, a_size);
+}
+
+
+RangeStreamBuf::RangeStreamBuf(RangeReader& a_reader, Options a_options)
+    : m_reader(a_reader), m_options(a_options), m_size(a_reader.size()) {
+    m_options.block_size     = std::max<size_t>(m_options.block_size, 1);
+    m_options.min_read_ahead = std::max<size_t>(m_options.min_read_ahead, 1);
+    m_options.max_read_ahead = std::max(m_options.max_read_ahead, m_options.min_read_ahead);
+    // une requête ne doit pas évincer les blocs qu'elle vient de lire
+    m_options.cache_blocks   = std::max(m_options.cache_blocks, m_options.max_read_ahead + 1);
+    m_blocks.reserve(m_options.cache_blocks);
+    m_read_ahead = m_options.min_read_ahead;
+}
+
+RangeCounters RangeStreamBuf::counters() const {
+    RangeCounters counters = m_counters;
+    for (const Block& block : m_blocks) {
+        if (!block.touched) {
+            counters.overfetched += block.data.size();
+        }
+    }
+    return counters;
+}
+
+uint64_t RangeStreamBuf::position() const {
+    return eback() != nullptr ? m_area_offset + (gptr() - eback()) : m_position;
+}
+
+RangeStreamBuf::Block& RangeStreamBuf::evictBlock() {
+    if (m_blocks.size() < m_options.cache_blocks) {
+        m_blocks.push_back(Block{0, 0, {}, false});
+        return m_blocks.back();
+    }
+    Block *oldest = &m_blocks.front();
+    for (Block& block : m_blocks) {
+        if (block.last_use < oldest->last_use) {
+            oldest = &block;
+        }
+    }
+    if (!oldest->touched) {
+        m_counters.overfetched += oldest->data.size();
+    }
+    return *oldest;
+}
+
+RangeStreamBuf::Block& RangeStreamBuf::loadBlock(uint64_t a_index) {
+    auto cached = [&](uint64_t a_block) {
+        return std::find_if(m_blocks.begin(), m_blocks.end(),
+                            [&](const Block& b) { return b.index == a_block && !b.data.empty(); });
+    };
+    auto hit = cached(a_index);
+    if (hit != m_blocks.end()) {
+        m_counters.cache_hits++;
+        hit->last_use = ++m_clock;
+        return *hit;
+    }
+    m_counters.cache_misses++;
+
+    // fenêtre adaptative : doublée si l'accès prolonge la requête précédente
+    m_read_ahead = a_index == m_next_block ? std::min(m_read_ahead * 2, m_options.max_read_ahead)
+                                           : m_options.min_read_ahead;
+    uint64_t block_count = (m_size + m_options.block_size - 1) / m_options.block_size;
+    size_t n = 1;
+    while (n < m_read_ahead && a_index + n < block_count && cached(a_index + n) == m_blocks.end()) {
+        n++;
+    }
+
+    // une seule requête pour les n blocs
+    uint64_t offset = a_index * m_options.block_size;
+    size_t length = std::min<uint64_t>(n * m_options.block_size, m_size - offset);
+    std::vector<char> buffer(length);
+    size_t got = m_reader.read(offset, buffer.data(), length);
+    m_counters.requests++;
+    m_counters.fetched += got;
+    if (got == 0) {
+        throw std::runtime_error("Short read from range reader.");
+    }
+    m_next_block = a_index + n;
+
+    Block *requested = nullptr;
+    for (size_t k = 0; k < n && k * m_options.block_size < got; k++) {
+        size_t beg = k * m_options.block_size;
+        size_t end = std::min(got, beg + m_options.block_size);
+        Block& block = evictBlock();
+        block.index = a_index + k;
+        block.data.assign(buffer.data() + beg, buffer.data() + end);
+        block.touched = false;
+        block.last_use = ++m_clock;
+        if (k == 0) {
+            requested = &block;
+        }
+    }
+    requested->last_use = ++m_clock;
+    return *requested;
+}
+
+RangeStreamBuf::int_type RangeStreamBuf::underflow() {
+    uint64_t position = this->position();
+    if (position >= m_size) {
+        return traits_type::eof();
+    }
+    uint64_t index = position / m_options.block_size;
+    Block& block = loadBlock(index);
+    block.touched = true;
+    size_t in_block = position % m_options.block_size;
+    if (in_block >= block.data.size()) {
+        return traits_type::eof();
+    }
+    char *data = block.data.data();
+    setg(data, data + in_block, data + block.data.size());
+    m_area_offset = index * m_options.block_size;
+    return traits_type::to_int_type(*gptr());
+}
+
+RangeStreamBuf::pos_type RangeStreamBuf::seekoff(off_type a_offset, std::ios_base::seekdir a_dir,
+                                                 std::ios_base::openmode a_which) {
+    int64_t base = a_dir == std::ios_base::beg ? 0
+                 : a_dir == std::ios_base::cur ? (int64_t) position()
+                 : (int64_t) m_size;
+    return seekpos(pos_type(off_type(base + a_offset)), a_which);
+}
+
+RangeStreamBuf::pos_type RangeStreamBuf::seekpos(pos_type a_position, std::ios_base::openmode /*which*/) {
+    int64_t target = off_type(a_position);
+    if (target < 0 || (uint64_t) target > m_size) {
+        return pos_type(off_type(-1));
+    }
+    // déplacement dans la zone de lecture courante : aucun changement de bloc
+    if (eback() != nullptr && (uint64_t) target >= m_area_offset
+        && (uint64_t) target < m_area_offset + (egptr() - eback())) {
+        setg(eback(), eback() + (target - m_area_offset), egptr());
+    } else {
+        m_position = target;
+        setg(nullptr, nullptr, nullptr);
+    }
+    return a_position;
+}
@@ -0,0 +1,250 @@
+// Lecture des tables d'échantillons d'une piste.
+// Les boîtes stts/stss/stsc/stsz/stco décrivent les échantillons de façon
+// compacte (par plages, par chunks) ; on les déroule ici en une liste plate.
+
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include <container-parser.hpp>
+#include <sample-table.hpp>
+
+
+TrackBoxes findTrackBoxes(const Trak& a_trak) {
+    TrackBoxes boxes;
+    boxes.tkhd = static_cast<Tkhd*>(a_trak.findChild({'t', 'k', 'h', 'd'}));
+    Box *mdia = a_trak.findChild({'m', 'd', 'i', 'a'});
+    if (mdia == nullptr) {
+        return boxes;
+    }
+    boxes.mdhd = static_cast<Mdhd*>(mdia->findChild({'m', 'd', 'h', 'd'}));
+    boxes.hdlr = static_cast<Hdlr*>(mdia->findChild({'h', 'd', 'l', 'r'}));
+    Box *minf = mdia->findChild({'m', 'i', 'n', 'f'});
+    if (minf == nullptr) {
+        return boxes;
+    }
+    boxes.stbl = static_cast<Stbl*>(minf->findChild({'s', 't', 'b', 'l'}));
+    if (boxes.stbl == nullptr) {
+        return boxes;
+    }
+    boxes.stts = static_cast<Stts*>(boxes.stbl->findChild({'s', 't', 't', 's'}));
+    boxes.ctts = static_cast<Ctts*>(boxes.stbl->findChild({'c', 't', 't', 's'}));
+    boxes.stss = static_cast<Stss*>(boxes.stbl->findChild({'s', 't', 's', 's'}));
+    boxes.stsc = static_cast<Stsc*>(boxes.stbl->findChild({'s', 't', 's', 'c'}));
+    boxes.stsz = static_cast<Stsz*>(boxes.stbl->findChild({'s', 't', 's', 'z'}));
+    boxes.stco = static_cast<Stco*>(boxes.stbl->findChild({'s', 't', 'c', 'o'}));
+    return boxes;
+}
+
+std::vector<Trak*> findTracks(const Root& a_root) {
+    std::vector<Trak*> tracks;
+    Box *moov = a_root.findChild({'m', 'o', 'o', 'v'});
+    if (moov == nullptr) {
+        return tracks;
+    }
+    for (const std::unique_ptr<Box>& child : moov->getChildren()) {
+        if (child->type == std::array<char, 4>{'t', 'r', 'a', 'k'}) {
+            tracks.push_back(static_cast<Trak*>(child.get()));
+        }
+    }
+    return tracks;
+}
+
+// Vérifie que les tables d'échantillons sont présentes et que leurs entrées
+// lues couvrent les nombres déclarés (une boîte tronquée en a moins) : les
+// accès indexés par entry_count et sample_count restent dans les tableaux.
+//     @boxes: les boîtes de la piste
+static void checkSampleTables(const TrackBoxes& a_boxes) {
+    if (a_boxes.stts == nullptr || a_boxes.stsc == nullptr
+        || a_boxes.stsz == nullptr || a_boxes.stco == nullptr) {
+        throw std::runtime_error("Missing sample table box in trak.");
+    }
+    const Stts& stts = *a_boxes.stts;
+    if (stts.sample_count.size() < stts.entry_count || stts.sample_delta.size() < stts.entry_count) {
+        throw std::runtime_error("Missing stts entries.");
+    }
+    const Ctts *ctts = a_boxes.ctts;
+    if (ctts != nullptr && (ctts->sample_count.size() < ctts->entry_count || ctts->sample_offset.size() < ctts->entry_count)) {
+        throw std::runtime_error("Missing ctts entries.");
+    }
+    const Stsc& stsc = *a_boxes.stsc;
+    if (stsc.first_chunk.size() < stsc.entry_count || stsc.samples_per_chunk.size() < stsc.entry_count) {
+        throw std::runtime_error("Missing stsc entries.");
+    }
+    const Stsz& stsz = *a_boxes.stsz;
+    if (stsz.sample_size == 0 && stsz.entry_size.size() < stsz.sample_count) {
+        throw std::runtime_error("Missing stsz entries.");
+    }
+    if (a_boxes.stco->chunk_offset.size() < a_boxes.stco->entry_count) {
+        throw std::runtime_error("Missing stco entries.");
+    }
+}
+
+std::vector<SampleInfo> flattenSamples(const Trak& a_trak) {
+    TrackBoxes boxes = findTrackBoxes(a_trak);
+    checkSampleTables(boxes);
+    const Stts& stts = *boxes.stts;
+    const Stsc& stsc = *boxes.stsc;
+    const Stsz& stsz = *boxes.stsz;
+    const Stco& stco = *boxes.stco;
+
+    std::vector<SampleInfo> samples(stsz.sample_count);
+
+    // tailles
+    if (stsz.sample_size != 0) {
+        for (SampleInfo& sample : samples) {
+            sample.size = stsz.sample_size;
+        }
+    } else {
+        for (uint32_t i=0; i<stsz.sample_count; i++) {
+            samples[i].size = stsz.entry_size[i];
+        }
+    }
+
+    // instants de décodage
+    uint64_t dts = 0;
+    uint32_t n = 0;
+    for (uint32_t i=0; i<stts.entry_count; i++) {
+        for (uint32_t j=0; j<stts.sample_count[i] && n<samples.size(); j++) {
+            samples[n++].dts = dts;
+            dts += stts.sample_delta[i];
+        }
+    }
+    if (n != samples.size()) {
+        throw std::runtime_error("stts and stsz sample counts differ.");
+    }
+
+    // points d'accès aléatoire : sans `stss`, tous les échantillons le sont
+    if (boxes.stss == nullptr) {
+        for (SampleInfo& sample : samples) {
+            sample.sync = 1;
+        }
+    } else {
+        for (SampleInfo& sample : samples) {
+            sample.sync = 0;
+        }
+        for (uint32_t number : boxes.stss->sample_number) {
+            if (number == 0 || number > samples.size()) {
+                throw std::runtime_error("stss sample number out of range.");
+            }
+            samples[number-1].sync = 1;
+        }
+    }
+
+    // positions : chaque entrée de `stsc` s'applique jusqu'au premier chunk
+    // de l'entrée suivante
+    n = 0;
+    for (uint32_t i=0; i<stsc.entry_count; i++) {
+        uint32_t last_chunk = (i+1 < stsc.entry_count) ? stsc.first_chunk[i+1] - 1
+                                                       : stco.entry_count;
+        if (stsc.first_chunk[i] == 0 || last_chunk > stco.entry_count) {
+            throw std::runtime_error("stsc chunk index out of range.");
+        }
+        for (uint32_t chunk = stsc.first_chunk[i]; chunk <= last_chunk; chunk++) {
+            uint64_t offset = stco.chunk_offset[chunk-1];
+            for (uint32_t j=0; j<stsc.samples_per_chunk[i] && n<samples.size(); j++) {
+                samples[n].offset = offset;
+                offset += samples[n].size;
+                n++;
+            }
+        }
+    }
+    if (n != samples.size()) {
+        throw std::runtime_error("stsc and stsz sample counts differ.");
+    }
+    return samples;
+}
+
+SampleCursor::SampleCursor(const Trak& a_trak) : m_boxes(findTrackBoxes(a_trak)) {
+    checkSampleTables(m_boxes);
+    m_count = m_boxes.stsz->sample_count;
+    if (m_count == 0) {
+        return;
+    }
+    const Stsc& stsc = *m_boxes.stsc;
+    if (stsc.entry_count == 0) {
+        throw std::runtime_error("stsc and stsz sample counts differ.");
+    }
+    if (stsc.first_chunk[0] == 0) {
+        throw std::runtime_error("stsc chunk index out of range.");
+    }
+    while (m_stts_entry < m_boxes.stts->entry_count && m_boxes.stts->sample_count[m_stts_entry] == 0) {
+        m_stts_entry++;
+    }
+    m_chunk = stsc.first_chunk[0] - 1;
+    nextChunk();
+    loadSample();
+}
+
+void SampleCursor::next() {
+    const Stts& stts = *m_boxes.stts;
+    m_sample.dts += stts.sample_delta[m_stts_entry];
+    if (++m_stts_done == stts.sample_count[m_stts_entry]) {
+        m_stts_done = 0;
+        do {
+            m_stts_entry++;
+        } while (m_stts_entry < stts.entry_count && stts.sample_count[m_stts_entry] == 0);
+    }
+    if (m_boxes.ctts != nullptr && ++m_ctts_done == m_boxes.ctts->sample_count[m_ctts_entry]) {
+        m_ctts_done = 0;
+        m_ctts_entry++;
+    }
+    m_index++;
+    if (done()) {
+        return;
+    }
+    if (--m_chunk_left == 0) {
+        nextChunk();
+    } else {
+        m_sample.offset += m_sample.size;
+    }
+    loadSample();
+}
+
+void SampleCursor::nextChunk() {
+    const Stsc& stsc = *m_boxes.stsc;
+    const Stco& stco = *m_boxes.stco;
+    do {
+        m_chunk++;
+        // chaque entrée de `stsc` s'applique jusqu'au premier chunk de l'entrée suivante
+        while (m_stsc_entry+1 < stsc.entry_count && m_chunk >= stsc.first_chunk[m_stsc_entry+1]) {
+            m_stsc_entry++;
+        }
+        if (m_chunk > stco.entry_count) {
+            throw std::runtime_error("stsc and stsz sample counts differ.");
+        }
+        m_chunk_left = stsc.samples_per_chunk[m_stsc_entry];
+    } while (m_chunk_left == 0);
+    m_sample.offset = stco.chunk_offset[m_chunk-1];
+}
+
+void SampleCursor::loadSample() {
+    if (m_stts_entry >= m_boxes.stts->entry_count) {
+        throw std::runtime_error("stts and stsz sample counts differ.");
+    }
+    const Stsz& stsz = *m_boxes.stsz;
+    m_sample.size = stsz.sample_size != 0 ? stsz.sample_size : stsz.entry_size[m_index];
+    if (m_boxes.ctts != nullptr) {
+        const Ctts& ctts = *m_boxes.ctts;
+        while (m_ctts_entry < ctts.entry_count && ctts.sample_count[m_ctts_entry] == 0) {
+            m_ctts_entry++;
+        }
+        if (m_ctts_entry >= ctts.entry_count) {
+            throw std::runtime_error("ctts and stsz sample counts differ.");
+        }
+        uint32_t offset = ctts.sample_offset[m_ctts_entry];
+        if (ctts.version == 0 && offset > INT32_MAX) {
+            throw std::runtime_error("ctts offset out of range.");
+        }
+        m_composition = int32_t(offset);
+    }
+    if (m_boxes.stss == nullptr) {
+        m_sample.sync = 1;
+        return;
+    }
+    const std::vector<uint32_t>& numbers = m_boxes.stss->sample_number;
+    while (m_stss_next < numbers.size() && numbers[m_stss_next] < m_index + 1) {
+        m_stss_next++;
+    }
+    m_sample.sync = m_stss_next < numbers.size() && numbers[m_stss_next] == m_index + 1;
+}
@@ -0,0 +1,172 @@
+// Découpage des pistes en segments HLS/DASH (cf segment-planner.hpp).
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <container-parser.hpp>
+#include <sample-table.hpp>
+#include <segment-planner.hpp>
+
+// handler_type des pistes vidéo
+constexpr uint32_t HANDLER_VIDE = 0x76696465;
+
+
+ByteRange Segment::span() const {
+    if (ranges.empty()) {
+        return ByteRange{0, 0};
+    }
+    uint64_t beg = ranges.front().offset;
+    uint64_t end = 0;
+    for (const ByteRange& range : ranges) {
+        beg = std::min(beg, range.offset);
+        end = std::max(end, range.offset + range.size);
+    }
+    return ByteRange{beg, end - beg};
+}
+
+// Échelle de temps d'une piste.
+static uint32_t trackTimescale(const TrackBoxes& a_boxes) {
+    if (a_boxes.mdhd == nullptr || a_boxes.mdhd->timescale == 0) {
+        throw std::runtime_error("Missing mdhd timescale in trak.");
+    }
+    return a_boxes.mdhd->timescale;
+}
+
+// Découpe une piste aux limites données.
+//     @trak: la piste
+//     @limits: débuts des segments, dans l'échelle de temps de la piste
+//     @track: les segments produits
+static void splitTrack(const Trak& a_trak, const std::vector<uint64_t>& a_limits, TrackPlan& a_track) {
+    SampleCursor cursor(a_trak);
+    size_t limit = 0;
+    Segment segment;
+    for (; !cursor.done(); cursor.next()) {
+        const SampleInfo& sample = cursor.sample();
+        while (limit+1 < a_limits.size() && sample.dts >= a_limits[limit+1]) {
+            if (segment.sample_count != 0) {
+                a_track.segments.push_back(std::move(segment));
+                segment = Segment();
+            }
+            limit++;
+        }
+        if (segment.sample_count == 0) {
+            segment.first_sample = cursor.index();
+            segment.start = sample.dts;
+        }
+        segment.sample_count++;
+        if (!segment.ranges.empty()
+            && segment.ranges.back().offset + segment.ranges.back().size == sample.offset) {
+            segment.ranges.back().size += sample.size;
+        } else {
+            segment.ranges.push_back(ByteRange{sample.offset, sample.size});
+        }
+    }
+    if (segment.sample_count != 0) {
+        a_track.segments.push_back(std::move(segment));
+    }
+    uint64_t end = cursor.endDts();
+    for (size_t i = a_track.segments.size(); i-- > 0; ) {
+        a_track.segments[i].duration = end - a_track.segments[i].start;
+        end = a_track.segments[i].start;
+    }
+}
+
+SegmentPlan planSegments(const Root& a_root, double a_target) {
+    SegmentPlan plan;
+    std::vector<Trak*> traks = findTracks(a_root);
+    if (traks.empty()) {
+        return plan;
+    }
+    const Trak *reference = traks.front();
+    for (const Trak *trak : traks) {
+        TrackBoxes boxes = findTrackBoxes(*trak);
+        if (boxes.hdlr != nullptr && boxes.hdlr->handler_type == HANDLER_VIDE) {
+            reference = trak;
+            break;
+        }
+    }
+    TrackBoxes reference_boxes = findTrackBoxes(*reference);
+    plan.timescale = trackTimescale(reference_boxes);
+    plan.reference_track = reference_boxes.tkhd != nullptr ? reference_boxes.tkhd->track_ID : 0;
+
+    // limites : premier point d'accès aléatoire à au moins `target` de la limite précédente
+    const uint64_t target = std::max<uint64_t>(1, std::llround(a_target * plan.timescale));
+    for (SampleCursor cursor(*reference); !cursor.done(); cursor.next()) {
+        const SampleInfo& sample = cursor.sample();
+        if (plan.boundaries.empty()
+            || (sample.sync && sample.dts - plan.boundaries.back() >= target)) {
+            plan.boundaries.push_back(sample.dts);
+        }
+    }
+    if (plan.boundaries.empty()) {
+        plan.boundaries.push_back(0);
+    }
+
+    for (const Trak *trak : traks) {
+        TrackBoxes boxes = findTrackBoxes(*trak);
+        TrackPlan track;
+        track.track_ID     = boxes.tkhd != nullptr ? boxes.tkhd->track_ID : 0;
+        track.handler_type = boxes.hdlr != nullptr ? boxes.hdlr->handler_type : 0;
+        track.timescale    = trackTimescale(boxes);
+        // conversion exacte (arrondi inférieur) sans dépassement pour les grandes valeurs
+        std::vector<uint64_t> limits;
+        limits.reserve(plan.boundaries.size());
+        for (uint64_t boundary : plan.boundaries) {
+            limits.push_back(boundary / plan.timescale * track.timescale
+                           + boundary % plan.timescale * track.timescale / plan.timescale);
+        }
+        splitTrack(*trak, limits, track);
+        plan.tracks.push_back(std::move(track));
+    }
+    return plan;
+}
+
+void writeHlsPlaylist(std::ostream& a_outstream, const TrackPlan& a_track, const std::string& a_uri) {
+    double timescale = a_track.timescale;
+    uint64_t target = 0;
+    for (const Segment& segment : a_track.segments) {
+        target = std::max<uint64_t>(target, std::ceil(segment.duration / timescale));
+    }
+    a_outstream << "#EXTM3U\n"
+                << "#EXT-X-VERSION:4\n"
+                << "#EXT-X-TARGETDURATION:" << target << '\n'
+                << "#EXT-X-PLAYLIST-TYPE:VOD\n";
+    std::ios_base::fmtflags flags = a_outstream.flags();
+    for (const Segment& segment : a_track.segments) {
+        ByteRange span = segment.span();
+        a_outstream << "#EXTINF:" << std::fixed << std::setprecision(3) << segment.duration / timescale << ",\n"
+                    << "#EXT-X-BYTERANGE:" << span.size << '@' << span.offset << '\n'
+                    << a_uri << '\n';
+    }
+    a_outstream.flags(flags);
+    a_outstream << "#EXT-X-ENDLIST\n";
+}
+
+void printSegmentPlan(std::ostream& a_outstream, const SegmentPlan& a_plan) {
+    a_outstream << "reference track: " << a_plan.reference_track << ", "
+                << a_plan.boundaries.size() << " segments\n";
+    for (const TrackPlan& track : a_plan.tracks) {
+        char handler[4] = {char(track.handler_type >> 24), char(track.handler_type >> 16),
+                           char(track.handler_type >> 8),  char(track.handler_type)};
+        double timescale = track.timescale;
+        a_outstream << "track " << track.track_ID << " (" << std::string(handler, 4) << "): "
+                    << track.segments.size() << " segments\n";
+        for (size_t i = 0; i < track.segments.size(); i++) {
+            const Segment& segment = track.segments[i];
+            a_outstream << "  #" << i << ": samples " << segment.first_sample << '-'
+                        << segment.first_sample + segment.sample_count - 1
+                        << ", start " << segment.start / timescale << " s, duration "
+                        << segment.duration / timescale << " s, " << segment.ranges.size() << " ranges:";
+            for (const ByteRange& range : segment.ranges) {
+                a_outstream << ' ' << range.size << '@' << range.offset;
+            }
+            a_outstream << '\n';
+        }
+    }
+}
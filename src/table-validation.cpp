@@ -0,0 +1,361 @@
+// Vérification des tables d'échantillons (cf table-validation.hpp).
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <container-parser.hpp>
+#include <sample-table.hpp>
+#include <table-validation.hpp>
+
+
+// Données d'une boîte mdat : [beg, end).
+struct MdatRange {
+    uint64_t beg;
+    uint64_t end;
+};
+
+// Octets occupés par un chunk : [beg, end).
+struct ChunkExtent {
+    uint64_t beg;
+    uint64_t end;
+    uint32_t track_ID;
+    uint32_t first_sample;
+    uint32_t sample_count;
+};
+
+// Erreurs d'une vérification en cours.
+struct Validation {
+    ValidationReport& report;
+    size_t            max_issues;
+
+    void add(const ValidationIssue& a_issue) {
+        report.issue_count++;
+        if (report.issues.size() < max_issues) {
+            report.issues.push_back(a_issue);
+        }
+    }
+};
+
+const char *validationErrorName(ValidationError a_error) {
+    switch (a_error) {
+    case ValidationError::MissingMovie:   return "missing moov";
+    case ValidationError::NoTracks:       return "no tracks";
+    case ValidationError::MissingTable:   return "missing table";
+    case ValidationError::EntryCount:     return "entry count";
+    case ValidationError::StscFirstChunk: return "first_chunk order";
+    case ValidationError::StscTotal:      return "stsc sample total";
+    case ValidationError::SttsTotal:      return "stts sample total";
+    case ValidationError::StssOrder:      return "sync sample order";
+    case ValidationError::OutOfBounds:    return "out of mdat";
+    case ValidationError::Overlap:        return "overlap";
+    }
+    return "unknown";
+}
+
+// Somme d'une table, sur 64 bits.
+static uint64_t sum(const uint32_t *a_values, size_t a_count) {
+    uint64_t total = 0;
+    for (size_t i = 0; i < a_count; i++) {
+        total += a_values[i];
+    }
+    return total;
+}
+
+// Nombre d'entrées non strictement supérieures à la précédente, sans branchement.
+static uint64_t countNotIncreasing(const std::vector<uint32_t>& a_values) {
+    uint64_t bad = 0;
+    for (size_t i = 1; i < a_values.size(); i++) {
+        bad += a_values[i] <= a_values[i-1];
+    }
+    return bad;
+}
+
+// Première entrée non strictement supérieure à la précédente, size() s'il n'y en a pas.
+static size_t firstNotIncreasing(const std::vector<uint32_t>& a_values) {
+    for (size_t i = 1; i < a_values.size(); i++) {
+        if (a_values[i] <= a_values[i-1]) {
+            return i;
+        }
+    }
+    return a_values.size();
+}
+
+// Boîte mdat contenant entièrement une plage d'octets.
+//     @mdats: les boîtes mdat, par position croissante
+//     @beg, @end: la plage [beg, end)
+//     @return: la boîte trouvée, nullptr si aucune ne contient la plage
+static const MdatRange *findMdat(const std::vector<MdatRange>& a_mdats, uint64_t a_beg, uint64_t a_end) {
+    auto mdat = std::upper_bound(a_mdats.begin(), a_mdats.end(), a_beg,
+                                 [](uint64_t beg, const MdatRange& m) { return beg < m.beg; });
+    if (mdat == a_mdats.begin()) {
+        return nullptr;
+    }
+    --mdat;
+    return a_end <= mdat->end ? &*mdat : nullptr;
+}
+
+// Signale les échantillons d'un chunk hors de toute boîte mdat, regroupés par
+// suites consécutives. Appelée seulement pour un chunk qui déborde.
+static void reportOutOfBounds(Validation& a_validation, uint32_t a_track_ID, const Stsz& a_stsz,
+                              const std::vector<MdatRange>& a_mdats, const ChunkExtent& a_chunk) {
+    ValidationIssue issue{a_track_ID, ValidationError::OutOfBounds};
+    uint64_t offset = a_chunk.beg;
+    for (uint32_t k = 0; k < a_chunk.sample_count; k++) {
+        uint32_t sample = a_chunk.first_sample + k;
+        uint64_t size = a_stsz.sample_size != 0 ? a_stsz.sample_size : a_stsz.entry_size[sample];
+        if (findMdat(a_mdats, offset, offset + size) == nullptr) {
+            if (issue.count == 0) {
+                issue.index  = sample;
+                issue.offset = offset;
+            }
+            issue.count++;
+            issue.size = offset + size - issue.offset;
+        } else if (issue.count != 0) {
+            a_validation.add(issue);
+            issue.count = 0;
+        }
+        offset += size;
+    }
+    if (issue.count != 0) {
+        a_validation.add(issue);
+    }
+}
+
+// Vérifie les tables d'une piste et ajoute ses chunks à `extents`.
+static void validateTrack(Validation& a_validation, const Trak& a_trak, const std::vector<MdatRange>& a_mdats,
+                          std::vector<ChunkExtent>& a_extents) {
+    TrackBoxes boxes = findTrackBoxes(a_trak);
+    uint32_t track_ID = boxes.tkhd != nullptr ? boxes.tkhd->track_ID : 0;
+    auto error = [&](ValidationError a_error, const Box& a_table, uint64_t a_index, uint64_t a_count = 0) {
+        ValidationIssue issue{track_ID, a_error};
+        issue.table = a_table.type;
+        issue.index = a_index;
+        issue.count = a_count;
+        a_validation.add(issue);
+    };
+    a_validation.report.tracks++;
+
+    const std::array<std::pair<const Box*, std::array<char, 4>>, 4> required = {{
+        {boxes.stts, {'s', 't', 't', 's'}}, {boxes.stsc, {'s', 't', 's', 'c'}},
+        {boxes.stsz, {'s', 't', 's', 'z'}}, {boxes.stco, {'s', 't', 'c', 'o'}},
+    }};
+    bool missing = false;
+    for (const auto& table : required) {
+        if (table.first == nullptr) {
+            ValidationIssue issue{track_ID, ValidationError::MissingTable};
+            issue.table = table.second;
+            a_validation.add(issue);
+            missing = true;
+        }
+    }
+    if (missing) {
+        return;
+    }
+    const Stts& stts = *boxes.stts;
+    const Stsc& stsc = *boxes.stsc;
+    const Stsz& stsz = *boxes.stsz;
+    const Stco& stco = *boxes.stco;
+
+    // les tables lues doivent avoir la taille déclarée avant tout accès indexé
+    bool sized = true;
+    auto checkCount = [&](const Box& a_table, size_t a_read, uint64_t a_declared) {
+        if (a_read != a_declared) {
+            error(ValidationError::EntryCount, a_table, a_read, a_declared);
+            sized = false;
+        }
+    };
+    checkCount(stts, stts.sample_count.size(), stts.entry_count);
+    checkCount(stts, stts.sample_delta.size(), stts.entry_count);
+    checkCount(stsc, stsc.first_chunk.size(), stsc.entry_count);
+    checkCount(stsc, stsc.samples_per_chunk.size(), stsc.entry_count);
+    checkCount(stco, stco.chunk_offset.size(), stco.entry_count);
+    if (stsz.sample_size == 0) {
+        checkCount(stsz, stsz.entry_size.size(), stsz.sample_count);
+    }
+    if (boxes.stss != nullptr) {
+        checkCount(*boxes.stss, boxes.stss->sample_number.size(), boxes.stss->entry_count);
+    }
+    if (!sized) {
+        return;
+    }
+
+    const uint32_t sample_count = stsz.sample_count;
+    const uint64_t chunk_count  = stco.chunk_offset.size();
+
+    uint64_t stts_total = sum(stts.sample_count.data(), stts.sample_count.size());
+    if (stts_total != sample_count) {
+        error(ValidationError::SttsTotal, stts, 0, stts_total);
+    }
+
+    if (boxes.stss != nullptr) {
+        const std::vector<uint32_t>& numbers = boxes.stss->sample_number;
+        uint64_t bad = countNotIncreasing(numbers);
+        bool bounds = numbers.empty() || (numbers.front() != 0 && numbers.back() <= sample_count);
+        if (bad != 0 || !bounds) {
+            size_t index = !numbers.empty() && numbers.front() == 0 ? 0 : firstNotIncreasing(numbers);
+            error(ValidationError::StssOrder, *boxes.stss, std::min(index, numbers.size() - 1));
+        }
+    }
+
+    // stsc : first_chunk commence à 1, croît strictement et reste dans stco
+    const std::vector<uint32_t>& first_chunk = stsc.first_chunk;
+    if (!first_chunk.empty()) {
+        uint64_t bad = countNotIncreasing(first_chunk);
+        if (first_chunk.front() != 1 || bad != 0 || first_chunk.back() > chunk_count) {
+            size_t index = first_chunk.front() != 1 ? 0 : std::min(firstNotIncreasing(first_chunk),
+                                                                   first_chunk.size() - 1);
+            error(ValidationError::StscFirstChunk, stsc, index);
+            return;
+        }
+    }
+    uint64_t stsc_total = 0;
+    for (size_t i = 0; i < first_chunk.size(); i++) {
+        uint64_t next = i+1 < first_chunk.size() ? first_chunk[i+1] : chunk_count + 1;
+        stsc_total += (next - first_chunk[i]) * stsc.samples_per_chunk[i];
+    }
+    if (stsc_total != sample_count) {
+        error(ValidationError::StscTotal, stsc, 0, stsc_total);
+        return;
+    }
+
+    // chunks : une somme de tailles par chunk, la boîte mdat courante est
+    // comparée avant toute recherche
+    const MdatRange *mdat = nullptr;
+    uint32_t sample = 0;
+    uint64_t media_bytes = 0;
+    a_extents.reserve(a_extents.size() + chunk_count);
+    for (size_t i = 0; i < first_chunk.size(); i++) {
+        uint32_t per_chunk  = stsc.samples_per_chunk[i];
+        uint64_t last_chunk = i+1 < first_chunk.size() ? first_chunk[i+1] - 1 : chunk_count;
+        for (uint64_t chunk = first_chunk[i]; chunk <= last_chunk; chunk++) {
+            uint64_t beg = stco.chunk_offset[chunk-1];
+            uint64_t bytes = stsz.sample_size != 0 ? uint64_t(per_chunk) * stsz.sample_size
+                                                   : sum(stsz.entry_size.data() + sample, per_chunk);
+            ChunkExtent extent{beg, beg + bytes, track_ID, sample, per_chunk};
+            if (mdat == nullptr || extent.beg < mdat->beg || extent.end > mdat->end) {
+                mdat = findMdat(a_mdats, extent.beg, extent.end);
+                if (mdat == nullptr) {
+                    reportOutOfBounds(a_validation, track_ID, stsz, a_mdats, extent);
+                }
+            }
+            a_extents.push_back(extent);
+            sample += per_chunk;
+            media_bytes += bytes;
+        }
+    }
+    a_validation.report.chunks      += chunk_count;
+    a_validation.report.samples     += sample_count;
+    a_validation.report.media_bytes += media_bytes;
+}
+
+ValidationReport validateSampleTables(const Root& a_root, uint64_t a_file_size, size_t a_max_issues) {
+    ValidationReport report;
+    Validation validation{report, a_max_issues};
+
+    if (a_root.findChild({'m', 'o', 'o', 'v'}) == nullptr) {
+        validation.add(ValidationIssue{0, ValidationError::MissingMovie});
+        return report;
+    }
+    std::vector<Trak*> traks = findTracks(a_root);
+    if (traks.empty()) {
+        validation.add(ValidationIssue{0, ValidationError::NoTracks});
+        return report;
+    }
+
+    // fin déclarée (taille 0 : jusqu'à la fin du fichier), bornée par la
+    // taille réelle si le fichier est tronqué
+    std::vector<MdatRange> mdats;
+    for (const std::unique_ptr<Box>& child : a_root.getChildren()) {
+        if (child->kind == BoxKind::Mdat) {
+            const Mdat& mdat = static_cast<const Mdat&>(*child);
+            uint64_t end = mdat.size != 0 ? std::min(mdat.offset + mdat.size, a_file_size) : a_file_size;
+            mdats.push_back(MdatRange{mdat.beg_data, std::max(end, mdat.beg_data)});
+        }
+    }
+    std::sort(mdats.begin(), mdats.end(), [](const MdatRange& a, const MdatRange& b) { return a.beg < b.beg; });
+
+    std::vector<ChunkExtent> extents;
+    for (const Trak *trak : traks) {
+        validateTrack(validation, *trak, mdats, extents);
+    }
+
+    // recouvrements : chunks triés par début, comparés au chunk qui s'étend le
+    // plus loin parmi les précédents
+    std::sort(extents.begin(), extents.end(), [](const ChunkExtent& a, const ChunkExtent& b) {
+        return a.beg != b.beg ? a.beg < b.beg : a.end < b.end;
+    });
+    const ChunkExtent *reach = nullptr;
+    for (const ChunkExtent& extent : extents) {
+        if (extent.beg == extent.end) {
+            continue;
+        }
+        if (reach != nullptr && extent.beg < reach->end) {
+            ValidationIssue issue{extent.track_ID, ValidationError::Overlap};
+            issue.index       = extent.first_sample;
+            issue.count       = extent.sample_count;
+            issue.offset      = extent.beg;
+            issue.size        = std::min(extent.end, reach->end) - extent.beg;
+            issue.other_track = reach->track_ID;
+            validation.add(issue);
+        }
+        if (reach == nullptr || extent.end > reach->end) {
+            reach = &extent;
+        }
+    }
+    return report;
+}
+
+void printValidationReport(std::ostream& a_outstream, const ValidationReport& a_report) {
+    a_outstream << "validation: " << a_report.tracks << " tracks, " << a_report.chunks << " chunks, "
+                << a_report.samples << " samples, " << a_report.media_bytes << " bytes of media: ";
+    if (a_report.valid()) {
+        a_outstream << "OK\n";
+        return;
+    }
+    a_outstream << a_report.issue_count << " errors\n";
+    for (const ValidationIssue& issue : a_report.issues) {
+        if (issue.error == ValidationError::MissingMovie || issue.error == ValidationError::NoTracks) {
+            a_outstream << "  " << validationErrorName(issue.error) << '\n';
+            continue;
+        }
+        a_outstream << "  track " << issue.track_ID << ": " << validationErrorName(issue.error);
+        switch (issue.error) {
+        case ValidationError::MissingMovie:
+        case ValidationError::NoTracks:
+            break;
+        case ValidationError::MissingTable:
+            a_outstream << " (" << std::string(issue.table.data(), 4) << ")";
+            break;
+        case ValidationError::EntryCount:
+            a_outstream << " (" << std::string(issue.table.data(), 4) << "), "
+                        << issue.index << " read, " << issue.count << " declared";
+            break;
+        case ValidationError::StscFirstChunk:
+        case ValidationError::StssOrder:
+            a_outstream << ", entry " << issue.index;
+            break;
+        case ValidationError::StscTotal:
+        case ValidationError::SttsTotal:
+            a_outstream << ", " << issue.count << " samples described";
+            break;
+        case ValidationError::OutOfBounds:
+        case ValidationError::Overlap:
+            a_outstream << ", samples " << issue.index << '-' << issue.index + issue.count - 1
+                        << ", " << issue.size << " bytes at " << issue.offset;
+            if (issue.error == ValidationError::Overlap) {
+                a_outstream << " (track " << issue.other_track << ')';
+            }
+            break;
+        }
+        a_outstream << '\n';
+    }
+    if (a_report.issue_count > a_report.issues.size()) {
+        a_outstream << "  ... " << a_report.issue_count - a_report.issues.size() << " more\n";
+    }
+}
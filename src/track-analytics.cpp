@@ -0,0 +1,232 @@
+// Statistiques de débit, de GOP et de tailles d'échantillons (cf track-analytics.hpp).
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <container-parser.hpp>
+#include <sample-table.hpp>
+#include <track-analytics.hpp>
+
+
+// Curseur sur les instants de décodage décrits par `stts`, avancé d'un
+// échantillon à la fois.
+class SttsCursor {
+public:
+    explicit SttsCursor(const Stts& a_stts) : m_stts(a_stts) {
+        skipEmptyEntries();
+    }
+
+    bool     exhausted() const { return m_entry >= m_stts.entry_count; }
+    uint64_t dts() const { return m_dts; }
+
+    void next() {
+        m_dts += m_stts.sample_delta[m_entry];
+        if (++m_done == m_stts.sample_count[m_entry]) {
+            m_entry++;
+            m_done = 0;
+            skipEmptyEntries();
+        }
+    }
+
+private:
+    void skipEmptyEntries() {
+        while (m_entry < m_stts.entry_count && m_stts.sample_count[m_entry] == 0) {
+            m_entry++;
+        }
+    }
+
+    const Stts& m_stts;
+    uint32_t    m_entry = 0; // entrée courante
+    uint32_t    m_done  = 0; // échantillons de l'entrée courante déjà parcourus
+    uint64_t    m_dts   = 0;
+};
+
+// Cherche la première boîte d'un type parmi les descendants.
+static const Box *findDescendant(const Box& a_box, BoxKind a_kind) {
+    for (const std::unique_ptr<Box>& child : a_box.getChildren()) {
+        if (child->kind == a_kind) {
+            return child.get();
+        }
+        if (const Box *found = findDescendant(*child, a_kind)) {
+            return found;
+        }
+    }
+    return nullptr;
+}
+
+TrackAnalytics analyzeTrack(const Trak& a_trak, double a_window) {
+    TrackBoxes boxes = findTrackBoxes(a_trak);
+    if (boxes.mdhd == nullptr || boxes.stts == nullptr || boxes.stsz == nullptr) {
+        throw std::runtime_error("Missing sample table box in trak.");
+    }
+    if (boxes.mdhd->timescale == 0) {
+        throw std::runtime_error("Null mdhd timescale.");
+    }
+    const Stsz& stsz = *boxes.stsz;
+    if (stsz.sample_size == 0 && stsz.entry_size.size() < stsz.sample_count) {
+        throw std::runtime_error("Missing stsz entries.");
+    }
+
+    TrackAnalytics analytics;
+    analytics.track_ID     = boxes.tkhd != nullptr ? boxes.tkhd->track_ID : 0;
+    analytics.handler_type = boxes.hdlr != nullptr ? boxes.hdlr->handler_type : 0;
+    analytics.timescale    = boxes.mdhd->timescale;
+    analytics.sample_count = stsz.sample_count;
+    analytics.window       = a_window;
+    if (const Btrt *btrt = static_cast<const Btrt*>(findDescendant(a_trak, BoxKind::Btrt))) {
+        analytics.has_btrt         = true;
+        analytics.btrt_buffer_size = btrt->bufferSizeDB;
+        analytics.btrt_max_bitrate = btrt->maxBitrate;
+        analytics.btrt_avg_bitrate = btrt->avgBitrate;
+    }
+
+    // numéros des points d'accès aléatoire, triés ; sans `stss` tous le sont
+    std::vector<uint32_t> sorted_sync;
+    const std::vector<uint32_t> *sync_numbers = nullptr;
+    if (boxes.stss != nullptr) {
+        sync_numbers = &boxes.stss->sample_number;
+        if (!std::is_sorted(sync_numbers->begin(), sync_numbers->end())) {
+            sorted_sync = *sync_numbers;
+            std::sort(sorted_sync.begin(), sorted_sync.end());
+            sync_numbers = &sorted_sync;
+        }
+    }
+
+    const uint32_t count       = stsz.sample_count;
+    const uint32_t *sizes      = stsz.sample_size == 0 ? stsz.entry_size.data() : nullptr;
+    const uint64_t window_ticks = std::max<uint64_t>(1, std::llround(a_window * analytics.timescale));
+
+    SttsCursor head(*boxes.stts); // échantillon courant
+    SttsCursor tail(*boxes.stts); // premier échantillon de la fenêtre glissante
+    uint32_t tail_index   = 0;
+    uint64_t window_bytes = 0;
+    uint64_t peak_bytes   = 0;
+
+    size_t   next_sync = 0;
+    uint32_t last_sync = 0;
+    uint64_t last_sync_dts = 0;
+    std::map<uint32_t, uint64_t> gops;
+
+    analytics.min_sample_size = count != 0 ? UINT32_MAX : 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (head.exhausted()) {
+            throw std::runtime_error("stts and stsz sample counts differ.");
+        }
+        uint32_t size = sizes != nullptr ? sizes[i] : stsz.sample_size;
+        uint64_t dts  = head.dts();
+
+        // tailles
+        analytics.total_bytes += size;
+        analytics.min_sample_size = std::min(analytics.min_sample_size, size);
+        analytics.max_sample_size = std::max(analytics.max_sample_size, size);
+        size_t bucket = 0;
+        while (bucket < 31 && (size >> (bucket + 1)) != 0) {
+            bucket++;
+        }
+        if (bucket >= analytics.size_histogram.size()) {
+            analytics.size_histogram.resize(bucket + 1, 0);
+        }
+        analytics.size_histogram[bucket]++;
+
+        // fenêtre glissante : échantillons dont l'instant est dans ]dts - window, dts]
+        window_bytes += size;
+        while (dts - tail.dts() >= window_ticks) {
+            window_bytes -= sizes != nullptr ? sizes[tail_index] : stsz.sample_size;
+            tail.next();
+            tail_index++;
+        }
+        if (window_bytes > peak_bytes) {
+            peak_bytes = window_bytes;
+            analytics.peak_dts = tail.dts();
+        }
+
+        // GOP
+        bool sync = sync_numbers == nullptr;
+        while (sync_numbers != nullptr && next_sync < sync_numbers->size()
+               && (*sync_numbers)[next_sync] <= i + 1) {
+            sync = sync || (*sync_numbers)[next_sync] == i + 1;
+            next_sync++;
+        }
+        if (sync) {
+            if (analytics.keyframe_count != 0) {
+                gops[i - last_sync]++;
+                uint64_t interval = dts - last_sync_dts;
+                analytics.min_keyframe_interval = analytics.keyframe_count == 1
+                                                ? interval : std::min(analytics.min_keyframe_interval, interval);
+                analytics.max_keyframe_interval = std::max(analytics.max_keyframe_interval, interval);
+            }
+            analytics.keyframe_count++;
+            last_sync     = i;
+            last_sync_dts = dts;
+        }
+        head.next();
+    }
+    if (analytics.keyframe_count != 0) {
+        gops[count - last_sync]++; // dernier GOP, jusqu'à la fin de la piste
+    }
+
+    analytics.duration = head.dts();
+    if (analytics.duration != 0) {
+        analytics.average_bitrate = analytics.total_bytes * 8 * analytics.timescale / analytics.duration;
+    }
+    analytics.peak_bitrate = peak_bytes * 8 * analytics.timescale / window_ticks;
+
+    uint64_t gop_count = 0;
+    uint64_t gop_samples = 0;
+    for (const auto& gop : gops) {
+        analytics.gop_lengths.push_back(gop);
+        gop_count   += gop.second;
+        gop_samples += uint64_t(gop.first) * gop.second;
+    }
+    if (gop_count != 0) {
+        analytics.mean_gop_length = double(gop_samples) / gop_count;
+    }
+    return analytics;
+}
+
+std::vector<TrackAnalytics> analyzeTracks(const Root& a_root, double a_window) {
+    std::vector<TrackAnalytics> tracks;
+    for (const Trak *trak : findTracks(a_root)) {
+        tracks.push_back(analyzeTrack(*trak, a_window));
+    }
+    return tracks;
+}
+
+void printTrackAnalytics(std::ostream& a_outstream, const TrackAnalytics& a_analytics) {
+    const TrackAnalytics& a = a_analytics;
+    char handler[4] = {char(a.handler_type >> 24), char(a.handler_type >> 16),
+                       char(a.handler_type >> 8),  char(a.handler_type)};
+    double timescale = a.timescale;
+    a_outstream << "track " << a.track_ID << " (" << std::string(handler, 4) << "): "
+                << a.sample_count << " samples, " << a.total_bytes << " bytes, "
+                << a.duration / timescale << " s\n"
+                << "  bitrate: average " << a.average_bitrate << " bit/s, peak " << a.peak_bitrate
+                << " bit/s (" << a.window << " s window at " << a.peak_dts / timescale << " s)\n";
+    if (a.has_btrt) {
+        a_outstream << "  btrt: average " << a.btrt_avg_bitrate << " bit/s, max " << a.btrt_max_bitrate
+                    << " bit/s, buffer " << a.btrt_buffer_size << " bytes"
+                    << (a.peak_bitrate > a.btrt_max_bitrate ? " (peak exceeds declared max)" : "") << '\n';
+    }
+    a_outstream << "  sample size: " << a.min_sample_size << " to " << a.max_sample_size << " bytes\n";
+    for (size_t k = 0; k < a.size_histogram.size(); k++) {
+        if (a.size_histogram[k] != 0) {
+            a_outstream << "    [" << (k == 0 ? 0 : uint64_t(1) << k) << ", " << (uint64_t(1) << (k + 1))
+                        << "): " << a.size_histogram[k] << '\n';
+        }
+    }
+    a_outstream << "  keyframes: " << a.keyframe_count << ", mean GOP " << a.mean_gop_length
+                << " samples, interval " << a.min_keyframe_interval / timescale << " to "
+                << a.max_keyframe_interval / timescale << " s\n"
+                << "  GOP lengths:";
+    for (const auto& gop : a.gop_lengths) {
+        a_outstream << ' ' << gop.first << 'x' << gop.second;
+    }
+    a_outstream << '\n';
+}
@@ -0,0 +1,118 @@
+// Séparation des pistes en fichiers distincts (cf track-split.hpp).
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <box-writer.hpp>
+#include <container-parser.hpp>
+#include <movie-writer.hpp>
+#include <sample-table.hpp>
+#include <track-split.hpp>
+
+
+// Plage d'échantillons à recopier dans l'une des sorties.
+struct Dispatch {
+    uint64_t source_offset;
+    uint64_t size;
+    uint64_t offset;  // position dans la sortie
+    size_t   output;
+};
+
+SplitResult splitTracks(const Root& a_root, const std::string& a_source, const std::string& a_prefix,
+                        size_t a_block_size) {
+    FileDescriptor source(::open(a_source.c_str(), O_RDONLY));
+    if (!source.valid()) {
+        throw std::runtime_error("Cannot open file `" + a_source + "`.");
+    }
+
+    SplitResult result;
+    std::vector<Dispatch> dispatches;
+    std::vector<FileDescriptor> outputs;
+    for (Trak *trak : findTracks(a_root)) {
+        TrackBoxes boxes = findTrackBoxes(*trak);
+        if (boxes.tkhd == nullptr) {
+            throw std::runtime_error("Missing tkhd in track.");
+        }
+        SplitOutput output;
+        output.track_ID     = boxes.tkhd->track_ID;
+        output.handler_type = boxes.hdlr != nullptr ? boxes.hdlr->handler_type : 0;
+        output.path         = a_prefix + "-track" + std::to_string(output.track_ID) + ".mp4";
+        if (sameFile(source.get(), output.path)) {
+            throw std::runtime_error("Output file `" + output.path + "` is the source file.");
+        }
+
+        MovieLayout layout = layoutMovie(a_root, source.get(), {copyTrack(*trak)});
+        FileDescriptor fd(::open(output.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644));
+        if (!fd.valid()) {
+            throw std::runtime_error("Cannot create file `" + output.path + "`.");
+        }
+        writeAll(fd.get(), layout.head.data(), layout.head.size(), 0);
+        for (const PayloadRun& run : layout.runs) {
+            dispatches.push_back(Dispatch{run.source_offset, run.size, run.offset, outputs.size()});
+        }
+        output.write = layout.stats;
+        output.write.copy_runs = layout.runs.size();
+        outputs.push_back(std::move(fd));
+        result.outputs.push_back(output);
+    }
+
+    // une lecture séquentielle : chaque bloc est distribué aux plages qu'il couvre
+    std::sort(dispatches.begin(), dispatches.end(), [](const Dispatch& a, const Dispatch& b) {
+        return a.source_offset < b.source_offset;
+    });
+    std::vector<char> block(a_block_size);
+    uint64_t block_start = 0;
+    uint64_t block_end   = 0;
+    for (const Dispatch& dispatch : dispatches) {
+        uint64_t position = dispatch.source_offset;
+        uint64_t end      = dispatch.source_offset + dispatch.size;
+        while (position < end) {
+            if (position < block_start || position >= block_end) {
+                ssize_t n = ::pread(source.get(), block.data(), block.size(), position);
+                if (n < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (n <= 0) {
+                    throw std::runtime_error("Source file too short while splitting.");
+                }
+                block_start = position;
+                block_end   = position + n;
+                result.reads++;
+                result.bytes_read += n;
+            }
+            uint64_t length = std::min(end, block_end) - position;
+            SplitOutput& output = result.outputs[dispatch.output];
+            writeAll(outputs[dispatch.output].get(), block.data() + (position - block_start), length,
+                     dispatch.offset + (position - dispatch.source_offset));
+            output.write.copied_bytes += length;
+            output.write.copy_calls++;
+            position += length;
+        }
+    }
+    return result;
+}
+
+void printSplitResult(std::ostream& a_outstream, const SplitResult& a_result) {
+    uint64_t copied = 0;
+    for (const SplitOutput& output : a_result.outputs) {
+        copied += output.write.copied_bytes;
+    }
+    a_outstream << "split: " << a_result.outputs.size() << " files, " << copied << " bytes of samples, "
+                << a_result.reads << " reads of " << a_result.bytes_read << " bytes\n";
+    for (const SplitOutput& output : a_result.outputs) {
+        char handler[4] = {char(output.handler_type >> 24), char(output.handler_type >> 16),
+                           char(output.handler_type >> 8),  char(output.handler_type)};
+        a_outstream << "track " << output.track_ID << " (" << std::string(handler, 4) << "): " << output.path
+                    << ", " << output.write.file_size << " bytes (moov " << output.write.moov_size << "), "
+                    << output.write.copy_runs << " runs, " << output.write.copy_calls << " writes\n";
+    }
+}
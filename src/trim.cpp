@@ -0,0 +1,225 @@
+// Extraction d'un intervalle de temps sans réencodage (cf trim.hpp).
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+
+#include <box-writer.hpp>
+#include <container-parser.hpp>
+#include <movie-writer.hpp>
+#include <sample-table.hpp>
+#include <trim.hpp>
+
+constexpr uint32_t HANDLER_VIDE = 0x76696465;
+
+// Piste source : échantillons aplatis et correspondance entre temps de
+// présentation (s) et temps du média, tirée de la liste d'éditions.
+struct TrimSource {
+    const Trak *trak = nullptr;
+    TrackBoxes  boxes;
+    std::vector<SampleInfo> samples;
+    std::vector<uint32_t>   chunks;
+    std::vector<uint32_t>   descriptions;
+    std::vector<int32_t>    compositions; // décalages de composition (ctts)
+    uint64_t end_dts     = 0;     // fin du dernier échantillon
+    int64_t  end_pts     = 0;     // fin de la présentation : plus grande fin d'un échantillon
+    double   empty       = 0;     // éditions vides en tête (s)
+    int64_t  media_start = 0;     // media_time de la première édition non vide
+    bool     has_edits   = false;
+
+    double toMedia(double a_presentation) const {
+        return (a_presentation - empty) * boxes.mdhd->timescale + media_start;
+    }
+    double toPresentation(double a_media) const {
+        return (a_media - media_start) / boxes.mdhd->timescale + empty;
+    }
+    uint64_t dtsAt(size_t a_index) const {
+        return a_index < samples.size() ? samples[a_index].dts : end_dts;
+    }
+    // Instant de présentation d'un échantillon, dans l'échelle de temps du média.
+    int64_t ptsAt(size_t a_index) const {
+        return int64_t(samples[a_index].dts) + compositions[a_index];
+    }
+};
+
+static TrimSource loadSource(const Trak& a_trak, uint32_t a_movie_timescale) {
+    TrimSource source;
+    source.trak  = &a_trak;
+    source.boxes = findTrackBoxes(a_trak);
+    if (source.boxes.mdhd == nullptr || source.boxes.mdhd->timescale == 0 || source.boxes.tkhd == nullptr) {
+        throw std::runtime_error("Missing tkhd or mdhd in track.");
+    }
+    SampleCursor cursor(a_trak);
+    source.samples.reserve(cursor.sampleCount());
+    for (; !cursor.done(); cursor.next()) {
+        source.samples.push_back(cursor.sample());
+        source.chunks.push_back(cursor.chunk());
+        source.descriptions.push_back(cursor.descriptionIndex());
+        source.compositions.push_back(cursor.compositionOffset());
+    }
+    source.end_dts = cursor.endDts();
+    source.end_pts = int64_t(source.end_dts);
+    for (size_t i = 0; i < source.samples.size(); i++) {
+        source.end_pts = std::max<int64_t>(source.end_pts, source.ptsAt(i) + int64_t(source.dtsAt(i+1) - source.samples[i].dts));
+    }
+
+    Box *edts = a_trak.findChild({'e', 'd', 't', 's'});
+    const Elst *elst = edts != nullptr ? static_cast<const Elst*>(edts->findChild({'e', 'l', 's', 't'})) : nullptr;
+    if (elst != nullptr) {
+        source.has_edits = true;
+        uint64_t empty = 0;
+        for (uint32_t i = 0; i < elst->entry_count; i++) {
+            if (elst->media_time[i] != -1) {
+                source.media_start = elst->media_time[i];
+                break;
+            }
+            empty += elst->segment_duration[i];
+        }
+        source.empty = double(empty) / a_movie_timescale;
+    }
+    return source;
+}
+
+// Dernier échantillon de synchronisation d'instant de présentation au plus `media`.
+//     @return: son indice, 0 si aucun ne précède `media`
+static size_t syncBefore(const TrimSource& a_source, double a_media) {
+    size_t found = 0;
+    for (size_t i = 0; i < a_source.samples.size(); i++) {
+        if (a_source.samples[i].sync && a_source.ptsAt(i) <= a_media) {
+            found = i;
+        }
+    }
+    return found;
+}
+
+// Fin des échantillons présentés avant `media` : avec des images B, l'ordre de
+// présentation diffère de l'ordre de décodage, on garde donc tous les
+// échantillons décodés jusqu'au dernier d'instant de présentation inférieur.
+//     @return: l'indice qui suit ce dernier échantillon, 0 s'il n'y en a pas
+static size_t endBefore(const TrimSource& a_source, double a_media) {
+    size_t end = 0;
+    for (size_t i = 0; i < a_source.samples.size(); i++) {
+        if (a_source.ptsAt(i) < a_media) {
+            end = i + 1;
+        }
+    }
+    return end;
+}
+
+TrimResult trimFile(const Root& a_root, const std::string& a_source, double a_start, double a_end,
+                    const std::string& a_output) {
+    if (!(a_start >= 0 && a_end > a_start)) {
+        throw std::runtime_error("Invalid trim interval.");
+    }
+    const Box *moov = a_root.findChild({'m', 'o', 'o', 'v'});
+    const Mvhd *mvhd = moov != nullptr ? static_cast<const Mvhd*>(moov->findChild({'m', 'v', 'h', 'd'})) : nullptr;
+    if (mvhd == nullptr || mvhd->timescale == 0) {
+        throw std::runtime_error("Missing moov or mvhd.");
+    }
+    uint32_t movie_timescale = mvhd->timescale;
+
+    std::vector<TrimSource> sources;
+    size_t reference = 0;
+    for (Trak *trak : findTracks(a_root)) {
+        sources.push_back(loadSource(*trak, movie_timescale));
+        const Hdlr *hdlr = sources.back().boxes.hdlr;
+        if (hdlr != nullptr && hdlr->handler_type == HANDLER_VIDE
+            && (sources[reference].boxes.hdlr == nullptr || sources[reference].boxes.hdlr->handler_type != HANDLER_VIDE)) {
+            reference = sources.size() - 1;
+        }
+    }
+    if (sources.empty()) {
+        throw std::runtime_error("No track to trim.");
+    }
+
+    // intervalle effectif : le début est fixé par la piste de référence, la fin
+    // est bornée par la durée du film (fin de la piste la plus longue) et
+    // chaque piste est coupée à sa propre fin
+    const TrimSource& ref = sources[reference];
+    if (ref.samples.empty() || a_start >= ref.toPresentation(ref.end_pts)) {
+        throw std::runtime_error("Trim start beyond the end of the file.");
+    }
+    size_t ref_first = syncBefore(ref, ref.toMedia(a_start));
+    size_t ref_last  = std::max(endBefore(ref, ref.toMedia(a_end)), ref_first + 1);
+    if (ref.toPresentation(ref.ptsAt(ref_first)) >= a_end) {
+        throw std::runtime_error("Trim interval outside of the file.");
+    }
+    double movie_end = 0;
+    for (const TrimSource& source : sources) {
+        movie_end = std::max(movie_end, source.toPresentation(source.end_pts));
+    }
+    TrimResult result;
+    result.start = ref.toPresentation(ref.ptsAt(ref_first));
+    result.end   = std::min(a_end, movie_end);
+
+    std::vector<OutputTrack> tracks;
+    for (const TrimSource& source : sources) {
+        double media_start = source.toMedia(result.start);
+        double media_end   = source.toMedia(result.end);
+        size_t first = syncBefore(source, media_start);
+        size_t last  = endBefore(source, media_end);
+        if (&source == &ref) {
+            first = ref_first;
+            last  = std::min(ref_last, ref.samples.size());
+        }
+        if (last <= first) {
+            continue; // piste sans échantillon dans l'intervalle
+        }
+
+        OutputTrack track;
+        track.trak = source.trak;
+        int64_t kept_end = 0; // fin de présentation des échantillons gardés
+        for (size_t i = first; i < last; i++) {
+            const SampleInfo& sample = source.samples[i];
+            uint32_t delta = uint32_t(source.dtsAt(i+1) - sample.dts);
+            track.samples.push_back(OutputSample{sample.offset, sample.size, delta, source.compositions[i], 0,
+                                                 source.chunks[i], source.descriptions[i], sample.sync != 0});
+            kept_end = std::max<int64_t>(kept_end, source.ptsAt(i) + delta);
+        }
+        if (source.has_edits) {
+            uint32_t timescale = source.boxes.mdhd->timescale;
+            int64_t first_dts = int64_t(source.samples[first].dts);
+            int64_t first_pts = source.ptsAt(first);
+            // le pré-roll (échantillons avant le début) est masqué, un retard est gardé par une édition vide
+            int64_t media_time = std::max<int64_t>(first_pts, std::llround(media_start));
+            if (media_time < first_dts) {
+                throw std::runtime_error("Trim start presented before the first kept sample is decoded.");
+            }
+            double delay = source.toPresentation(first_pts) - result.start;
+            if (std::llround(delay * movie_timescale) > 0) {
+                track.edits.push_back(EditEntry{uint64_t(std::llround(delay * movie_timescale)), -1});
+            }
+            int64_t media_end_time = std::min<int64_t>(kept_end, std::max<int64_t>(media_time, std::llround(media_end)));
+            track.edits.push_back(EditEntry{
+                uint64_t(std::llround(double(media_end_time - media_time) * movie_timescale / timescale)),
+                media_time - first_dts});
+        }
+        tracks.push_back(std::move(track));
+        result.tracks.push_back(TrimTrack{source.boxes.tkhd->track_ID, uint32_t(first), uint32_t(last - first)});
+    }
+
+    FileDescriptor fd(::open(a_source.c_str(), O_RDONLY));
+    if (!fd.valid()) {
+        throw std::runtime_error("Cannot open file `" + a_source + "`.");
+    }
+    result.write = writeMovie(a_root, {fd.get()}, tracks, a_output);
+    return result;
+}
+
+void printTrimResult(std::ostream& a_outstream, const TrimResult& a_result) {
+    const MovieWriteStats& write = a_result.write;
+    a_outstream << "trim: " << a_result.start << " s - " << a_result.end << " s, "
+                << write.file_size << " bytes written (moov " << write.moov_size << ", mdat " << write.mdat_size
+                << "), " << write.copied_bytes << " bytes copied in " << write.copy_runs << " runs ("
+                << write.copy_calls << " copy calls)\n";
+    for (const TrimTrack& track : a_result.tracks) {
+        a_outstream << "track " << track.track_ID << ": samples " << track.first_sample << " to "
+                    << track.first_sample + track.sample_count - 1 << " (" << track.sample_count << ")\n";
+    }
+}